@@ -0,0 +1,53 @@
+/*
+ * DecodeBinaryLog.cpp
+ *
+ * Converts a binary SD log (CAPS_INF.BIN, written with SD_BINARY_LOG, or CAPS_INF.BSZ, written with
+ * SD_COMPRESSED_LOG) into the CSV layout of CAPS_INF.CSV, so csv_stats.py and the other analysis
+ * tools work unchanged.
+ *
+ * Usage: DecodeBinaryLog <CAPS_INF.BIN|CAPS_INF.BSZ> [output.csv]   (default output: standard out)
+ */
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "binaryLogDecoder.h"
+
+int main(int argc, char** argv) {
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "usage: %s <CAPS_INF.BIN|CAPS_INF.BSZ> [output.csv]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  FILE* in = fopen(argv[1], "rb");
+  if (in == nullptr) {
+    perror(argv[1]);
+    return EXIT_FAILURE;
+  }
+  FILE* out = argc == 3 ? fopen(argv[2], "wb") : stdout;
+  if (out == nullptr) {
+    perror(argv[2]);
+    fclose(in);
+    return EXIT_FAILURE;
+  }
+
+  BinaryLogDecodeResult result = decodeBinaryLog(in, out);
+  fclose(in);
+  if (out != stdout) {
+    fclose(out);
+  }
+
+  if (!result.ok) {
+    fprintf(stderr, "%s: %s\n", argv[1], result.error.c_str());
+    return EXIT_FAILURE;
+  }
+  fprintf(stderr, "%lu records", result.records);
+  if (result.lostRecords != 0) {
+    fprintf(stderr, ", lost %lu records to %lu corrupted bytes", result.lostRecords, result.skippedBytes);
+  }
+  if (result.trailingBytes != 0) {
+    fprintf(stderr, ", ignored %lu bytes of an incomplete final record", result.trailingBytes);
+  }
+  fprintf(stderr, "\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,225 @@
+/*
+ * binaryLogDecoder.h
+ *
+ * Turns a binary SD log (see BinaryLog.h) back into exactly the text SDCard writes in CSV mode:
+ * same header line, same Telemetry::LogSchema text for each row, same CRLF line endings. Shared
+ * by DecodeBinaryLog and the SD log benchmark, which checks the round trip.
+ *
+ * Compressed logs (CompressedLog.h) come out the same way, with each value at the resolution of its
+ * CSV column. After a corrupted stretch, decoding picks up again at the next keyframe.
+ */
+
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../../BinaryLog.h"
+#include "../../CompressedLog.h"
+
+struct BinaryLogDecodeResult {
+  bool ok;
+  std::string error;
+  unsigned long records;
+  /** Bytes at the end of the file that did not make up a whole record (e.g. power lost mid-write) */
+  unsigned long trailingBytes;
+  /** Compressed logs only: records lost to corruption, and the bytes skipped to find a keyframe */
+  unsigned long lostRecords;
+  unsigned long skippedBytes;
+};
+
+namespace binaryLogDetail {
+
+template <int capsule>
+void decodeRecords(FILE* in, FILE* out, BinaryLogDecodeResult& result) {
+  typedef Telemetry::LogSchema<capsule> Schema;
+  uint8_t record[Schema::SIZE];
+  // Same size as SDCard's line buffer, so over-long rows are cut off identically
+  char line[192];
+  size_t got;
+  while ((got = fread(record, 1, sizeof record, in)) == sizeof record) {
+    Telemetry::TextWriter row(line, sizeof line);
+    Schema::writeStored(row, record);
+    row.finish();
+    fputs(line, out);
+    fputs("\r\n", out);
+    ++result.records;
+  }
+  result.trailingBytes = got;
+}
+
+template <int capsule>
+void writeRow(const int32_t* channels, FILE* out) {
+  typedef Telemetry::LogSchema<capsule> Schema;
+  uint8_t record[Schema::SIZE];
+  Schema::restore(channels, record);
+  char line[192];
+  Telemetry::TextWriter row(line, sizeof line);
+  Schema::writeStored(row, record);
+  row.finish();
+  fputs(line, out);
+  fputs("\r\n", out);
+}
+
+/** The record index stored in the keyframe at `data` */
+inline uint32_t keyframeIndex(const uint8_t* data) {
+  const uint8_t* stored = data + sizeof CompressedLog::KEYFRAME_MARKER;
+  return stored[0] | stored[1] << 8 | stored[2] << 16 | (uint32_t)stored[3] << 24;
+}
+
+/** Does a keyframe start at `data`, which has `available` bytes? */
+inline bool isKeyframe(const uint8_t* data, size_t available) {
+  return available >= sizeof CompressedLog::KEYFRAME_MARKER + 4
+    && memcmp(data, CompressedLog::KEYFRAME_MARKER, sizeof CompressedLog::KEYFRAME_MARKER) == 0;
+}
+
+template <int capsule>
+void decodeCompressedRecords(FILE* in, FILE* out, uint16_t keyframeInterval, BinaryLogDecodeResult& result) {
+  const size_t CHANNELS = Telemetry::LogSchema<capsule>::COUNT;
+  const size_t KEYFRAME_HEADER = sizeof CompressedLog::KEYFRAME_MARKER + 4;
+  std::vector<uint8_t> data;
+  uint8_t chunk[4096];
+  size_t got;
+  while ((got = fread(chunk, 1, sizeof chunk, in)) > 0) {
+    data.insert(data.end(), chunk, chunk + got);
+  }
+
+  int32_t channels[CHANNELS] = {0};
+  size_t position = 0;
+  uint32_t index = 0;
+  while (position < data.size()) {
+    const uint8_t* record = data.data() + position;
+    size_t available = data.size() - position;
+    bool keyframe = index % keyframeInterval == 0;
+    size_t length = 0;
+    bool ok = !keyframe || (isKeyframe(record, available) && keyframeIndex(record) == index);
+    if (ok && keyframe) {
+      length = KEYFRAME_HEADER;
+    }
+
+    int32_t next[CHANNELS];
+    for (size_t i = 0; ok && i < CHANNELS; ++i) {
+      uint32_t value;
+      size_t used = CompressedLog::getVarint(record + length, available - length, &value);
+      if (used == 0) {
+        ok = false;
+        break;
+      }
+      length += used;
+      int32_t decoded = CompressedLog::unzigzag(value);
+      next[i] = keyframe ? decoded : (int32_t)((uint32_t)channels[i] + (uint32_t)decoded);
+    }
+
+    if (ok) {
+      memcpy(channels, next, sizeof channels);
+      writeRow<capsule>(channels, out);
+      ++result.records;
+      ++index;
+      position += length;
+      continue;
+    }
+
+    // Lost our place: look for the next keyframe from here on
+    size_t found = position + 1;
+    while (found < data.size()) {
+      const uint8_t* candidate = data.data() + found;
+      if (isKeyframe(candidate, data.size() - found) && keyframeIndex(candidate) >= index
+          && keyframeIndex(candidate) % keyframeInterval == 0) {
+        break;
+      }
+      ++found;
+    }
+    if (found == data.size()) {
+      // Nothing more to pick up from: an incomplete record at the end, or corruption up to it
+      result.trailingBytes = data.size() - position;
+      return;
+    }
+    uint32_t resumeIndex = keyframeIndex(data.data() + found);
+    result.lostRecords += resumeIndex - index;
+    result.skippedBytes += found - position;
+    index = resumeIndex;
+    position = found;
+  }
+}
+
+} // namespace binaryLogDetail
+
+/** The rest of a compressed log, after its header */
+inline BinaryLogDecodeResult decodeCompressedLog(const CompressedLogHeader& header, FILE* in, FILE* out) {
+  BinaryLogDecodeResult result{false, "", 0, 0, 0, 0};
+  if (header.version != COMPRESSED_LOG_VERSION) {
+    result.error = "unsupported compressed log version " + std::to_string(header.version);
+    return result;
+  }
+  if ((header.capsule != 1 && header.capsule != 2) || header.keyframeInterval == 0) {
+    result.error = "unexpected capsule " + std::to_string(header.capsule) + " / keyframe interval "
+      + std::to_string(header.keyframeInterval);
+    return result;
+  }
+
+  std::vector<char> columns(header.columnsLength);
+  if (fread(columns.data(), 1, columns.size(), in) != columns.size()) {
+    result.error = "truncated column names";
+    return result;
+  }
+  fwrite(columns.data(), 1, columns.size(), out);
+  fputs("\r\n", out);
+
+  if (header.capsule == 1) {
+    binaryLogDetail::decodeCompressedRecords<1>(in, out, header.keyframeInterval, result);
+  } else {
+    binaryLogDetail::decodeCompressedRecords<2>(in, out, header.keyframeInterval, result);
+  }
+  result.ok = true;
+  return result;
+}
+
+/** Decode `in` (positioned at the start of the file) as CSV text into `out`. */
+inline BinaryLogDecodeResult decodeBinaryLog(FILE* in, FILE* out) {
+  BinaryLogDecodeResult result{false, "", 0, 0, 0, 0};
+
+  // Both headers are the same size and start with the magic
+  BinaryLogHeader header;
+  if (fread(&header, sizeof header, 1, in) != 1) {
+    result.error = "not a binary log (bad magic)";
+    return result;
+  }
+  if (memcmp(header.magic, "BSCZ", sizeof header.magic) == 0) {
+    CompressedLogHeader compressed;
+    memcpy(&compressed, &header, sizeof compressed);
+    return decodeCompressedLog(compressed, in, out);
+  }
+  if (memcmp(header.magic, "BSCL", sizeof header.magic) != 0) {
+    result.error = "not a binary log (bad magic)";
+    return result;
+  }
+  if (header.version != BINARY_LOG_VERSION) {
+    result.error = "unsupported log version " + std::to_string(header.version);
+    return result;
+  }
+  size_t expectedSize = header.capsule == 1 ? Telemetry::LogSchema<1>::SIZE
+    : header.capsule == 2 ? Telemetry::LogSchema<2>::SIZE : 0;
+  if (expectedSize == 0 || header.recordSize != expectedSize) {
+    result.error = "unexpected capsule " + std::to_string(header.capsule) + " / record size "
+      + std::to_string(header.recordSize);
+    return result;
+  }
+
+  std::vector<char> columns(header.columnsLength);
+  if (fread(columns.data(), 1, columns.size(), in) != columns.size()) {
+    result.error = "truncated column names";
+    return result;
+  }
+  fwrite(columns.data(), 1, columns.size(), out);
+  fputs("\r\n", out);
+
+  if (header.capsule == 1) {
+    binaryLogDetail::decodeRecords<1>(in, out, result);
+  } else {
+    binaryLogDetail::decodeRecords<2>(in, out, result);
+  }
+  result.ok = true;
+  return result;
+}
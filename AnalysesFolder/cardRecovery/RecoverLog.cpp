@@ -0,0 +1,107 @@
+/*
+ * RecoverLog.cpp
+ *
+ * Rebuilds the logs SDCard wrote with SD_BLOCK_LOG from a raw image of the card (or the card
+ * itself, e.g. /dev/sdb, or a log file copied off it), however far behind the directory was when
+ * the power went. Each log found is written to the output directory under its file name and file
+ * id, e.g. CAPS_IN3-5A1C09E2.CSV, as it would have been without SD_BLOCK_LOG; DecodeBinaryLog
+ * reads the .BIN and .BSZ ones. Prints what it found.
+ *
+ * Usage: RecoverLog <card.img> [output directory]   (default: the current directory)
+ *   e.g. dd if=/dev/sdb of=card.img bs=1M && RecoverLog card.img recovered
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "cardRecovery.h"
+
+using namespace CardRecovery;
+
+namespace {
+
+// Read the image in chunks of this many sectors
+const size_t CHUNK_SECTORS = 2048;
+
+/** fseek() past 2 GB */
+bool seek(FILE* file, uint64_t offset) {
+#ifdef _WIN32
+  return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+  return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+const char* formatName(LogBlock::Format format) {
+  return format == LogBlock::CSV ? "csv" : format == LogBlock::BINARY ? "binary" : "compressed";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "usage: %s <card.img> [output directory]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  std::string directory = argc == 3 ? argv[2] : ".";
+
+  FILE* image = fopen(argv[1], "rb");
+  if (image == nullptr) {
+    perror(argv[1]);
+    return EXIT_FAILURE;
+  }
+  Scanner scanner;
+  std::vector<uint8_t> chunk(CHUNK_SECTORS * LogBlock::SIZE);
+  uint64_t offset = 0;
+  size_t got;
+  while ((got = fread(chunk.data(), 1, chunk.size(), image)) > 0) {
+    scanner.scan(chunk.data(), got, offset);
+    offset += got;
+  }
+  if (ferror(image)) {
+    perror(argv[1]);
+    fclose(image);
+    return EXIT_FAILURE;
+  }
+  std::vector<FoundLog>& logs = scanner.finish();
+  const ScanStats& stats = scanner.stats();
+  fprintf(stderr, "%llu sectors: %llu log blocks, %llu damaged, %zu logs\n",
+    static_cast<unsigned long long>(stats.sectors), static_cast<unsigned long long>(stats.blocks),
+    static_cast<unsigned long long>(stats.damaged), logs.size());
+
+  auto read = [&](uint64_t at, uint8_t* sector) {
+    return seek(image, at) && fread(sector, 1, LogBlock::SIZE, image) == LogBlock::SIZE;
+  };
+  bool failed = false;
+  for (const FoundLog& log : logs) {
+    std::string path = directory + "/" + log.fileName();
+    fprintf(stderr, "%s (%s): ", path.c_str(), formatName(log.format));
+    if (log.run == 0) {
+      fprintf(stderr, "first block missing, %zu blocks not recovered\n", log.stranded);
+      continue;
+    }
+    FILE* out = fopen(path.c_str(), "wb");
+    if (out == nullptr) {
+      perror(path.c_str());
+      failed = true;
+      continue;
+    }
+    RebuildResult result = rebuild(log, read, out);
+    failed |= fclose(out) != 0 || !result.ok;
+    fprintf(stderr, "%zu blocks, %llu bytes", log.run, static_cast<unsigned long long>(result.bytes));
+    if (result.tornBytes != 0) {
+      fprintf(stderr, ", cut %llu bytes of a partial row", static_cast<unsigned long long>(result.tornBytes));
+    }
+    if (log.stranded != 0) {
+      fprintf(stderr, ", %zu blocks after a missing one not recovered", log.stranded);
+    }
+    if (log.conflicts != 0) {
+      fprintf(stderr, ", %zu blocks found twice with different contents", log.conflicts);
+    }
+    fprintf(stderr, "%s\n", result.ok ? "" : " READ ERROR");
+  }
+  fclose(image);
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
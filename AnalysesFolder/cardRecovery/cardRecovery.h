@@ -0,0 +1,209 @@
+/*
+ * cardRecovery.h
+ *
+ * Finds the logs SDCard wrote with SD_BLOCK_LOG (see LogBlock.h) in a raw image of the card, and
+ * puts each one back together without the FAT or the directory. After a power cut those can be
+ * many seconds behind what is on the card; the blocks themselves can't. Shared by RecoverLog and
+ * the recovery benchmark (HostHarness/bench/CardRecoveryBenchmark.cpp).
+ *
+ * Every sector is checked for a block header with a valid CRC. A log is its blocks from sequence
+ * 0 up to the first one that is missing or damaged; that is all of it unless the card lost a
+ * sector in the middle, and then the rest can't be placed reliably, so it is only counted. The
+ * block being written when the power went is torn and fails its CRC, so the log ends before it,
+ * and a CSV log's last, partial row is cut off.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../../LogBlock.h"
+
+namespace CardRecovery {
+
+/** One log found on the card */
+struct FoundLog {
+  uint32_t fileId;
+  uint32_t logNumber;
+  LogBlock::Format format;
+
+  struct Block {
+    uint32_t sequence;
+    /** Where it is in the image */
+    uint64_t offset;
+    uint32_t crc;
+  };
+  /** Every valid block, in the order found until finish() sorts them */
+  std::vector<Block> blocks;
+
+  /** After finish(): blocks 0 to run - 1 are all there */
+  size_t run;
+  /** Blocks found after the first missing one */
+  size_t stranded;
+  /** The same block number twice, with different contents (the first one found is used) */
+  size_t conflicts;
+
+  /** The name SDCard gave the file, with the file id to tell apart logs that reused it */
+  std::string fileName() const {
+    char name[32];
+    if (logNumber == 0) {
+      strcpy(name, "CAPS_INF");
+    } else {
+      // SDCard::setFileName(): the number overwrites the end of CAPS_INF
+      char digits[16];
+      int length = snprintf(digits, sizeof digits, "%lu", static_cast<unsigned long>(logNumber - 1));
+      snprintf(name, sizeof name, "%.*s%s", 8 - length, "CAPS_INF", digits);
+    }
+    static const char* const EXTENSIONS[3] = {".CSV", ".BIN", ".BSZ"};
+    char full[48];
+    snprintf(full, sizeof full, "%s-%08lX%s", name, static_cast<unsigned long>(fileId), EXTENSIONS[format]);
+    return full;
+  }
+};
+
+/** Counts for a whole scan */
+struct ScanStats {
+  uint64_t sectors;
+  uint64_t blocks;
+  /** Sectors that start like a block but fail the CRC or the header checks (torn or damaged) */
+  uint64_t damaged;
+};
+
+/** Is `sector` (LogBlock::SIZE bytes) a valid block? */
+inline bool readHeader(const uint8_t* sector, LogBlockHeader& header) {
+  memcpy(&header, sector, sizeof header);
+  return memcmp(header.magic, "BSCB", sizeof header.magic) == 0 && header.version == LOG_BLOCK_VERSION
+    && header.format <= LogBlock::COMPRESSED && header.length <= LogBlock::CAPACITY
+    && LogBlock::checksum(header, sector + sizeof header) == header.crc;
+}
+
+/** Collects the blocks of every log from an image, fed to it in order in whole sectors. */
+class Scanner {
+public:
+  Scanner() : m_stats() {}
+
+  /** Scan `length` bytes (a multiple of LogBlock::SIZE) found at `offset` in the image. */
+  void scan(const uint8_t* data, size_t length, uint64_t offset) {
+    for (size_t at = 0; at + LogBlock::SIZE <= length; at += LogBlock::SIZE) {
+      ++m_stats.sectors;
+      const uint8_t* sector = data + at;
+      if (memcmp(sector, "BSCB", 4) != 0) {
+        continue;
+      }
+      LogBlockHeader header;
+      if (!readHeader(sector, header)) {
+        ++m_stats.damaged;
+        continue;
+      }
+      ++m_stats.blocks;
+      FoundLog& log = find(header);
+      log.blocks.push_back({header.sequence, offset + at, header.crc});
+    }
+  }
+
+  /** Sort each log's blocks and find how much of it is whole. */
+  std::vector<FoundLog>& finish() {
+    for (FoundLog& log : m_logs) {
+      std::stable_sort(log.blocks.begin(), log.blocks.end(),
+        [](const FoundLog::Block& a, const FoundLog::Block& b) { return a.sequence < b.sequence; });
+      std::vector<FoundLog::Block> unique;
+      for (const FoundLog::Block& block : log.blocks) {
+        if (!unique.empty() && unique.back().sequence == block.sequence) {
+          log.conflicts += unique.back().crc != block.crc;
+          continue;
+        }
+        unique.push_back(block);
+      }
+      log.blocks.swap(unique);
+      log.run = 0;
+      while (log.run < log.blocks.size() && log.blocks[log.run].sequence == log.run) {
+        ++log.run;
+      }
+      log.stranded = log.blocks.size() - log.run;
+    }
+    std::sort(m_logs.begin(), m_logs.end(), [](const FoundLog& a, const FoundLog& b) {
+      return a.logNumber != b.logNumber ? a.logNumber < b.logNumber : a.fileId < b.fileId;
+    });
+    return m_logs;
+  }
+
+  const ScanStats& stats() const {
+    return m_stats;
+  }
+
+private:
+  std::vector<FoundLog> m_logs;
+  ScanStats m_stats;
+
+  FoundLog& find(const LogBlockHeader& header) {
+    for (FoundLog& log : m_logs) {
+      if (log.fileId == header.fileId && log.logNumber == header.logNumber && log.format == header.format) {
+        return log;
+      }
+    }
+    FoundLog log;
+    log.fileId = header.fileId;
+    log.logNumber = header.logNumber;
+    log.format = static_cast<LogBlock::Format>(header.format);
+    log.run = 0;
+    log.stranded = 0;
+    log.conflicts = 0;
+    m_logs.push_back(log);
+    return m_logs.back();
+  }
+};
+
+/** What rebuild() wrote */
+struct RebuildResult {
+  bool ok;
+  uint64_t bytes;
+  /** A CSV log's partial last row, left out */
+  uint64_t tornBytes;
+};
+
+/**
+ * Write the whole run of `log` to `out`: the file as it would have been without SD_BLOCK_LOG, up to
+ * where it ends on the card. `read(offset, sector)` fetches LogBlock::SIZE bytes of the image.
+ */
+template <typename Read>
+RebuildResult rebuild(const FoundLog& log, Read read, FILE* out) {
+  RebuildResult result = {true, 0, 0};
+  uint8_t sector[LogBlock::SIZE];
+  // A CSV row is only written once its line ending is
+  std::string row;
+  for (size_t i = 0; i < log.run; ++i) {
+    LogBlockHeader header;
+    if (!read(log.blocks[i].offset, sector) || !readHeader(sector, header)) {
+      result.ok = false;
+      return result;
+    }
+    const uint8_t* data = sector + sizeof header;
+    size_t length = header.length;
+    if (log.format == LogBlock::CSV) {
+      size_t complete = length;
+      while (complete > 0 && data[complete - 1] != '\n') {
+        --complete;
+      }
+      if (complete == 0) {
+        row.append(reinterpret_cast<const char*>(data), length);
+        continue;
+      }
+      fwrite(row.data(), 1, row.size(), out);
+      fwrite(data, 1, complete, out);
+      result.bytes += row.size() + complete;
+      row.assign(reinterpret_cast<const char*>(data + complete), length - complete);
+    } else {
+      fwrite(data, 1, length, out);
+      result.bytes += length;
+    }
+  }
+  result.tornBytes = row.size();
+  return result;
+}
+
+} // namespace CardRecovery
@@ -3,20 +3,18 @@ import numpy as np
 import matplotlib.pyplot as plt
 from sklearn.metrics import r2_score
 from sklearn.linear_model import LinearRegression
-from math import sqrt
 
 # read in rocketry CSV file output by Arduino
+# For big logs, or several at once, build/AnalysesFolder/FlightStats computes the same numbers
+# natively and writes a decimated <log>_series.csv that plots quickly
 
-capsule_one_header_names = ["Latitude", "Longitude", "Altitude (MSL)", "Satellites", "Timestamp", "Accel X", "Accel Y", "Accel Z", "Altitude (AGL)", "Gyro X", "Gyro Y", "Gyro Z"]
-capsule_two_header_names = ["VOC Reading", "Humidity", "Temperature"]
-
+# Columns are named by the file's own header row, which SDCard writes from Telemetry::LogSchema
+# in TelemetrySchema.h, so they aren't listed here
 csv_file_dataframe = pd.read_csv("CAPS_INF.CSV", header = 0)
 
-# checks to see if capsule two columns are in the CSV file
-if set(capsule_two_header_names).issubset(csv_file_dataframe.iloc[0]):
-    csv_file_dataframe = pd.read_csv("CAPS_INV.CSV", header = 0)
-else:
-    print("Capsule two columns not found, handling alignment...")
+# only capsule two carries the VOC sensor (and the humidity/temperature sensor)
+if "VOC Reading" not in csv_file_dataframe.columns:
+    print("Capsule two columns not found, plotting capsule one columns only")
 
 # converts latitude output to actual coordinates
 
@@ -60,20 +58,16 @@ gyro_z = csv_file_dataframe["Gyro Z"]
 
 # IMU data plotting
 
-accel_mag = []
-for i in range(len(accel_x)):
-    x = accel_x.iloc[i]
-    y = accel_y.iloc[i]
-    z = accel_z.iloc[i]
-    accel_mag.append(sqrt(x*x + y*y + z*z))
-
-accel_np_array = np.array(accel_mag)
+accel_np_array = np.sqrt(accel_x.to_numpy()**2 + accel_y.to_numpy()**2 + accel_z.to_numpy()**2)
 
-# sets row index to be expressed in 50 millisecond increments
-row_index = np.arange(len(csv_file_dataframe)).reshape(-1, 1) / 50
+# seconds since the first row, from when the IMU took each row's sample; the logging rate changes
+# with the flight phase, so the row number says nothing about time. micros() wraps every 71.6
+# minutes, so the modulo keeps a log shorter than that in order
+sample_micros = csv_file_dataframe["Sample Time (us)"].to_numpy(dtype = np.int64)
+sample_time = ((sample_micros - sample_micros[0]) % 2**32 / 1e6).reshape(-1, 1)
 
 plt.figure()
-plt.plot(row_index, accel_np_array)
+plt.plot(sample_time, accel_np_array)
 plt.title("IMU Acceleration Magnitude (m/s^2)")
 plt.xlabel("Time (s)")
 plt.ylabel("Acceleration (m/s^2)")
@@ -83,47 +77,37 @@ plt.show()
 # altitude plotting
 
 altitude_column = "Altitude (AGL)"
-row_index = np.arange(len(csv_file_dataframe)).reshape(-1, 1)
 altitude_output = csv_file_dataframe[altitude_column].values.reshape(-1, 1)
 
 # Create a linear regression model
 altimeter_model_regression = LinearRegression()
-altimeter_model_regression.fit(row_index, altitude_output)
+altimeter_model_regression.fit(sample_time, altitude_output)
 
 # Predict Y values using the model
-altimeter_pred = altimeter_model_regression.predict(row_index)
+altimeter_pred = altimeter_model_regression.predict(sample_time)
 
 # # Calculate R^2 value and slope
 r2 = r2_score(altitude_output, altimeter_pred)
-# I have no earthly idea why the slope is defined like this, but this is what the internet said
+# feet per second, since sample_time is in seconds
 slope_output = altimeter_model_regression.coef_[0][0]
 
 # Plot the linear regression line
 plt.figure() # this creates a new figure to differentiate between altimeter and IMU graphs
-plt.plot(row_index, altimeter_pred, color='red', label=f'Linear Regression\nR^2 = {r2:.5f}\nSlope (ft/min) = {slope_output * 60:.5f}')
+plt.plot(sample_time, altimeter_pred, color='red', label=f'Linear Regression\nR^2 = {r2:.5f}\nSlope (ft/min) = {slope_output * 60:.5f}')
 
 # Display other plot details
-plt.xlabel("Row Index")
+plt.xlabel("Time (s)")
 plt.ylabel(f"{altitude_column} (ft)")
-plt.title(f"Plot of {altitude_column} vs Row Index")
+plt.title(f"Plot of {altitude_column} vs Time")
 plt.legend()
 plt.show()
 
 # Gyro plotting
 
-gyro_mag = []
-
-# gyro_x, gyro_y, and gyro_z all have the same length, so it doesn't matter which variable you use
-for i in range(len(gyro_x)):
-    x = gyro_x.iloc[i]
-    y = gyro_y.iloc[i]
-    z = gyro_z.iloc[i]
-    gyro_mag.append(sqrt(x*x + y*y + z*z))
-
-gyro_np_array = np.array(gyro_mag)
+gyro_np_array = np.sqrt(gyro_x.to_numpy()**2 + gyro_y.to_numpy()**2 + gyro_z.to_numpy()**2)
 
 plt.figure()
-plt.plot(row_index, gyro_np_array)
+plt.plot(sample_time, gyro_np_array)
 plt.title("Plot of Gyro Acceleration")
 plt.xlabel("Time (s)")
 plt.ylabel("Acceleration (m/s^2)")
@@ -138,12 +122,12 @@ msl_altitude = np.array(msl_altitude)
 
 # Plot the linear regression line
 plt.figure() # this creates a new figure to differentiate between altimeter and IMU graphs
-plt.plot(row_index, msl_altitude)
+plt.plot(sample_time, msl_altitude)
 
 # Display other plot details
-plt.xlabel("Row Index")
+plt.xlabel("Time (s)")
 plt.ylabel(f"{altitude_msl_column} (ft)")
-plt.title(f"Plot of {altitude_msl_column} vs Row Index")
+plt.title(f"Plot of {altitude_msl_column} vs Time")
 plt.legend()
 plt.show()
 
@@ -154,9 +138,9 @@ latitude_column_name = "Latitude"
 normalized_latitude = np.array(normalized_latitude)
 
 plt.figure()
-plt.plot(row_index, normalized_latitude)
-plt.title(f"Plot of Row Index vs {latitude_column_name}")
-plt.xlabel("Row Index")
+plt.plot(sample_time, normalized_latitude)
+plt.title(f"Plot of Time vs {latitude_column_name}")
+plt.xlabel("Time (s)")
 plt.ylabel("Latitude")
 plt.grid(True)
 plt.show()
@@ -168,9 +152,9 @@ longitude_column_name = "Longitude"
 normalized_longitude = np.array(normalized_longitude)
 
 plt.figure()
-plt.plot(row_index, normalized_longitude)
-plt.title(f"Plot of Row Index vs {longitude_column_name}")
-plt.xlabel("Row Index")
+plt.plot(sample_time, normalized_longitude)
+plt.title(f"Plot of Time vs {longitude_column_name}")
+plt.xlabel("Time (s)")
 plt.ylabel("Longitude")
 plt.grid(True)
 plt.show()
@@ -180,9 +164,9 @@ plt.show()
 satellites_column_name = "Satellites"
 
 plt.figure()
-plt.plot(row_index, num_satelites)
-plt.title(f"Plot of Row Index vs {satellites_column_name}")
-plt.xlabel("Row Index")
+plt.plot(sample_time, num_satelites)
+plt.title(f"Plot of Time vs {satellites_column_name}")
+plt.xlabel("Time (s)")
 plt.ylabel("Satellites")
 plt.grid(True)
 plt.show()
\ No newline at end of file
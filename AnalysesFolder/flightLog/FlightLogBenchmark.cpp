@@ -0,0 +1,175 @@
+/*
+ * FlightLogBenchmark.cpp
+ *
+ * Compares the CSV parsing ProcessFlightData used to do (getline, then grabNextField() erasing each
+ * field off the front of the line, then strtof) with MappedFile + CsvReader, on a flight log with
+ * quoted, comma-grouped altitudes. Reports the throughput of each in MB/s. Fails unless both read
+ * the same rows and the same float values, bit for bit.
+ *
+ * Usage: FlightLogBenchmark [log.csv]
+ * Without a file, a synthetic 1 kHz log of about 20 MB is written to the temp directory first.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "flightLogReader.h"
+
+using namespace std;
+
+namespace {
+
+const int PASSES = 3;
+
+/** ProcessFlightData's parser before flightLogReader.h, kept as the baseline. */
+string grabNextField(string& csvLine) {
+  size_t len;
+  string field = "";
+  while (csvLine[0] == '"') {
+    csvLine.erase(0, 1);
+    len = csvLine.find('"');
+    field += csvLine.substr(0, len);
+    csvLine.erase(0, len == string::npos ? len : len + 1);
+    // A doubled quote inside a quoted field is a literal quote
+    if (csvLine[0] == '"') {
+      field += '"';
+    }
+  }
+  len = csvLine.find(',');
+  field += csvLine.substr(0, len);
+  csvLine.erase(0, len == string::npos ? len : len + 1);
+  return field;
+}
+
+void readWithGrabNextField(const char* path, vector<float>& times, vector<float>& altitudes) {
+  ifstream data(path);
+  string line;
+  while (getline(data, line)) {
+    string timeStr = grabNextField(line);
+    char* end;
+    float time = strtof(timeStr.c_str(), &end);
+    if (end == timeStr.c_str()) {
+      continue;
+    }
+    string altStr = grabNextField(line);
+    altStr.erase(std::remove(altStr.begin(), altStr.end(), ','), altStr.end());
+    times.push_back(time);
+    altitudes.push_back(strtof(altStr.c_str(), nullptr));
+  }
+}
+
+void readWithCsvReader(const char* path, vector<float>& times, vector<float>& altitudes) {
+  MappedFile file;
+  if (!file.open(path)) {
+    return;
+  }
+  CsvReader csv(file.data(), file.size());
+  CsvField field;
+  while (csv.nextRow()) {
+    float time, altitude;
+    if (!csv.nextField(field) || !field.toFloat(time) || !csv.nextField(field) || !field.toFloat(altitude)) {
+      continue;
+    }
+    times.push_back(time);
+    altitudes.push_back(altitude);
+  }
+}
+
+/** A 1 kHz flight to 10,000 ft and back, in the shape of an exported flight log. */
+bool writeSyntheticLog(const char* path) {
+  FILE* out = fopen(path, "w");
+  if (out == nullptr) {
+    return false;
+  }
+  fprintf(out, "\"Time (s)\",\"Altitude (ft)\",\"Velocity (ft/s)\",\"Acceleration (ft/s/s)\",\"Note\"\n");
+  const double DURATION = 600.0;
+  const double APOGEE_TIME = 35.0;
+  for (long i = 0; i <= static_cast<long>(DURATION * 1000); ++i) {
+    double t = i / 1000.0;
+    double altitude = t < APOGEE_TIME
+      ? max(0.0, 10000.0 - 8.2 * (APOGEE_TIME - t) * (APOGEE_TIME - t))
+      : max(0.0, 10000.0 - 17.0 * (t - APOGEE_TIME));
+    double velocity = t < APOGEE_TIME ? 16.4 * (APOGEE_TIME - t) : -17.0;
+    char grouped[32];
+    long whole = static_cast<long>(altitude);
+    int hundredths = static_cast<int>(lround((altitude - whole) * 100.0));
+    if (hundredths == 100) {
+      ++whole;
+      hundredths = 0;
+    }
+    if (whole >= 1000) {
+      snprintf(grouped, sizeof grouped, "\"%ld,%03ld.%02d\"", whole / 1000, whole % 1000, hundredths);
+    } else {
+      snprintf(grouped, sizeof grouped, "%ld.%02d", whole, hundredths);
+    }
+    fprintf(out, "%.3f,%s,%.2f,%.2f,%s\n", t, grouped, velocity, t < APOGEE_TIME ? -32.8 : 0.0,
+      i % 1000 == 0 ? "\"event, \"\"marker\"\"\"" : "");
+  }
+  return fclose(out) == 0;
+}
+
+template <typename Reader>
+double megabytesPerSecond(Reader read, const char* path, double megabytes, vector<float>& times,
+                          vector<float>& altitudes) {
+  double best = 0.0;
+  for (int pass = 0; pass < PASSES; ++pass) {
+    times.clear();
+    altitudes.clear();
+    auto start = chrono::steady_clock::now();
+    read(path, times, altitudes);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    best = max(best, megabytes / seconds);
+  }
+  return best;
+}
+
+bool sameBits(const vector<float>& a, const vector<float>& b) {
+  return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  string path;
+  if (argc > 1) {
+    path = argv[1];
+  } else {
+    const char* tmp = getenv("TMPDIR");
+    path = string(tmp != nullptr ? tmp : "/tmp") + "/FlightLogBenchmark.csv";
+    if (!writeSyntheticLog(path.c_str())) {
+      fprintf(stderr, "Cannot write %s\n", path.c_str());
+      return EXIT_FAILURE;
+    }
+  }
+
+  MappedFile file;
+  if (!file.open(path.c_str())) {
+    fprintf(stderr, "Cannot read %s\n", path.c_str());
+    return EXIT_FAILURE;
+  }
+  double megabytes = file.size() / 1e6;
+  file.close();
+
+  vector<float> oldTimes, oldAltitudes, newTimes, newAltitudes;
+  double oldRate = megabytesPerSecond(readWithGrabNextField, path.c_str(), megabytes, oldTimes, oldAltitudes);
+  double newRate = megabytesPerSecond(readWithCsvReader, path.c_str(), megabytes, newTimes, newAltitudes);
+
+  printf("%s: %.1f MB, %zu rows, best of %d passes\n\n", path.c_str(), megabytes, newTimes.size(), PASSES);
+  printf("%-28s %10s\n", "parser", "MB/s");
+  printf("%-28s %10.1f\n", "getline + grabNextField", oldRate);
+  printf("%-28s %10.1f\n", "MappedFile + CsvReader", newRate);
+  printf("\nspeedup %.1fx\n", newRate / oldRate);
+
+  if (newTimes.empty() || !sameBits(oldTimes, newTimes) || !sameBits(oldAltitudes, newAltitudes)) {
+    printf("FAIL: the parsers read different values (%zu vs %zu rows)\n", oldTimes.size(), newTimes.size());
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,261 @@
+/*
+ * flightLogReader.h
+ *
+ * Reads CSV flight logs for the host tools without copying them: MappedFile maps the whole file
+ * into memory, and CsvReader walks it row by row, handing out fields as spans into the mapping.
+ * Numbers are parsed straight from those spans, including quoted values with thousands
+ * separators ("12,345"), so reading a log allocates nothing per row or per field.
+ *
+ *   MappedFile file;
+ *   if (!file.open(path)) { ... }
+ *   CsvReader csv(file.data(), file.size());
+ *   CsvField field;
+ *   while (csv.nextRow()) {
+ *     float time;
+ *     if (csv.nextField(field) && field.toFloat(time)) { ... }
+ *   }
+ */
+
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <system_error>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/** A read-only view of a whole file, mapped into memory. */
+class MappedFile {
+public:
+  MappedFile() noexcept : m_data(nullptr), m_size(0) {}
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile() {
+    close();
+  }
+
+  /** Map the file at `path`, unmapping any previous one. An empty file maps to size() == 0. */
+  bool open(const char* path) noexcept {
+    close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+      FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+      return false;
+    }
+    LARGE_INTEGER size;
+    bool ok = GetFileSizeEx(file, &size);
+    if (ok && size.QuadPart > 0) {
+      HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      if (mapping != nullptr) {
+        m_data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        CloseHandle(mapping);
+      }
+      ok = m_data != nullptr;
+      m_size = ok ? static_cast<size_t>(size.QuadPart) : 0;
+    }
+    CloseHandle(file);
+    return ok;
+#else
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat info;
+    bool ok = fstat(fd, &info) == 0;
+    if (ok && info.st_size > 0) {
+      void* mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+      ok = mapped != MAP_FAILED;
+      if (ok) {
+        m_data = static_cast<const char*>(mapped);
+        m_size = static_cast<size_t>(info.st_size);
+        madvise(mapped, m_size, MADV_SEQUENTIAL);
+      }
+    }
+    ::close(fd);
+    return ok;
+#endif
+  }
+
+  void close() noexcept {
+    if (m_data != nullptr) {
+#ifdef _WIN32
+      UnmapViewOfFile(m_data);
+#else
+      munmap(const_cast<char*>(m_data), m_size);
+#endif
+    }
+    m_data = nullptr;
+    m_size = 0;
+  }
+
+  const char* data() const noexcept {
+    return m_data;
+  }
+
+  size_t size() const noexcept {
+    return m_size;
+  }
+
+private:
+  const char* m_data;
+  size_t m_size;
+};
+
+/**
+ * One CSV field: the characters between the separators, or between the quotes for a quoted field.
+ * Points into the buffer the CsvReader was given.
+ */
+struct CsvField {
+  const char* begin;
+  const char* end;
+  bool quoted;
+
+  size_t size() const noexcept {
+    return end - begin;
+  }
+
+  bool equals(const char* text) const noexcept {
+    size_t length = strlen(text);
+    return length == size() && memcmp(begin, text, length) == 0;
+  }
+
+  /**
+   * Parse the whole field as a number. Surrounding spaces and a leading '+' are allowed, and in a
+   * quoted field so are thousands separators ("12,345.6"). Rounds exactly as strtof does.
+   * @return false, leaving `value` alone, if the field isn't a number.
+   */
+  bool toFloat(float& value) const noexcept {
+    return toNumber(value);
+  }
+
+  bool toDouble(double& value) const noexcept {
+    return toNumber(value);
+  }
+
+private:
+  template <typename T>
+  bool toNumber(T& value) const noexcept {
+    const char* first = begin;
+    const char* last = end;
+    while (first < last && (*first == ' ' || *first == '\t')) {
+      ++first;
+    }
+    while (last > first && (last[-1] == ' ' || last[-1] == '\t')) {
+      --last;
+    }
+    if (first < last && *first == '+') {
+      ++first;
+    }
+    // Digit groups only come quoted, and have to be squeezed out before from_chars sees them
+    char squeezed[64];
+    if (quoted && memchr(first, ',', last - first) != nullptr) {
+      size_t length = 0;
+      for (const char* p = first; p < last; ++p) {
+        if (*p == ',') {
+          continue;
+        }
+        if (length == sizeof squeezed) {
+          return false;
+        }
+        squeezed[length++] = *p;
+      }
+      first = squeezed;
+      last = squeezed + length;
+    }
+    if (first == last) {
+      return false;
+    }
+    T parsed;
+    std::from_chars_result result = std::from_chars(first, last, parsed);
+    if (result.ec != std::errc() || result.ptr != last) {
+      return false;
+    }
+    value = parsed;
+    return true;
+  }
+};
+
+/**
+ * Walks CSV text in place. Rows end at "\n" or "\r\n"; quoted fields may contain separators, line
+ * breaks and doubled quotes, which are left doubled in the field.
+ */
+class CsvReader {
+public:
+  CsvReader(const char* data, size_t size) noexcept :
+    m_position(data),
+    m_end(data + size),
+    m_inRow(false),
+    m_rowEnded(true) {}
+
+  /** Move to the next row, skipping whatever is left of the current one. false at the end. */
+  bool nextRow() noexcept {
+    CsvField skipped;
+    while (nextField(skipped)) {}
+    if (m_position == m_end) {
+      m_inRow = false;
+      return false;
+    }
+    m_inRow = true;
+    m_rowEnded = false;
+    return true;
+  }
+
+  /** The next field of the current row. false once the row has no more. */
+  bool nextField(CsvField& field) noexcept {
+    if (!m_inRow || m_rowEnded) {
+      return false;
+    }
+    const char* p = m_position;
+    if (p < m_end && *p == '"') {
+      field.begin = ++p;
+      while (p < m_end && !(*p == '"' && (p + 1 == m_end || p[1] != '"'))) {
+        p += *p == '"' ? 2 : 1;
+      }
+      field.end = p;
+      field.quoted = true;
+      // Anything between the closing quote and the separator is dropped
+      while (p < m_end && *p != ',' && *p != '\n') {
+        ++p;
+      }
+    } else {
+      field.begin = p;
+      while (p < m_end && *p != ',' && *p != '\n') {
+        ++p;
+      }
+      field.end = p > field.begin && p[-1] == '\r' && (p == m_end || *p == '\n') ? p - 1 : p;
+      field.quoted = false;
+    }
+    if (p < m_end && *p == ',') {
+      m_position = p + 1;
+    } else {
+      m_position = p < m_end ? p + 1 : p;
+      m_rowEnded = true;
+    }
+    return true;
+  }
+
+  /** Bytes not yet read. */
+  size_t remaining() const noexcept {
+    return m_end - m_position;
+  }
+
+private:
+  const char* m_position;
+  const char* m_end;
+  bool m_inRow;
+  bool m_rowEnded;
+};
@@ -0,0 +1,645 @@
+/*
+ * FlightStats.cpp
+ *
+ * Post-flight summary of capsule logs: CAPS_INF.CSV as SDCard writes it, or the CSV DecodeBinaryLog
+ * makes from a binary or compressed log. For every column it reports the mean, standard deviation,
+ * min and max, and it does the same for the magnitude of every "<name> X/Y/Z" triple (the
+ * IMU::vector3 columns). It finds launch and apogee and fits the altitude against time, over the
+ * whole log as csv_stats.py did and over the descent. Next to each log it writes a decimated
+ * series of every column, a few thousand rows of bucket means, ready to plot.
+ *
+ * Each log is memory-mapped and cut into CHUNK_BYTES chunks at line breaks. A pool of threads
+ * first counts the rows of every chunk, then parses them into blocks of columns and runs the
+ * flightStats.h kernels over each block. The partial stats are merged in file order, so the
+ * results don't depend on the thread count. SDCard never quotes fields, so chunks are cut at any
+ * line break; a log with line breaks inside quotes would be misread.
+ *
+ * Time comes from the Sample Time (us) column, when each IMU sample was taken. Logs from before it
+ * fall back to the Timestamp column (the GPS time, to 100 ms, shared by every row logged in one
+ * GPS period) when it changes over the log, and otherwise to the row number at --rate rows per
+ * second.
+ *
+ * Usage: FlightStats [options] CAPS_INF.CSV...
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../flightLog/flightLogReader.h"
+#include "flightStats.h"
+
+using namespace std;
+using namespace FlightStats;
+
+namespace {
+
+const size_t CHUNK_BYTES = 4 << 20;
+/** Rows per call of the block kernels */
+const size_t BLOCK_ROWS = 1024;
+/** m/s^2 that counts as launch, as FlightPhase::LAUNCH_ACCEL */
+const double LAUNCH_ACCEL = 29.4;
+/** The descent fit stops this far (as a share of the climb) above the starting altitude. */
+const double GROUND_MARGIN = 0.02;
+/** Rows per second csv_stats.py used to assume, used when the log has no usable time column */
+const double DEFAULT_RATE = 50.0;
+
+const char* const SAMPLE_TIME_COLUMN = "Sample Time (us)";
+const char* const TIMESTAMP_COLUMN = "Timestamp";
+const char* const ALTITUDE_COLUMN = "Altitude (AGL)";
+const char* const ACCEL_COLUMN = "Accel";
+
+struct Options {
+  vector<string> logs;
+  size_t points = 2000;
+  double rate = 0.0;           // rows per second; 0: from the log's time columns
+  bool series = true;
+  unsigned threads = 0;        // 0: one per core
+};
+
+/**
+ * How the fields of a row map to channels. Channel 0 is the time, then come the numeric columns
+ * in file order, then the magnitude of each X/Y/Z triple.
+ */
+struct Layout {
+  size_t fields = 0;
+  vector<string> names;
+  /** Per field: its channel, or -1 for the Sample Time and Timestamp fields */
+  vector<int> fieldChannel;
+  int sampleTimeField = -1;
+  int timestampField = -1;
+  /** Channels of the X, Y and Z columns of each triple; triple i's magnitude is channel `columns + i` */
+  vector<array<int, 3>> vectors;
+  size_t columns = 0;
+  int altitude = -1;
+  int accelMagnitude = -1;
+
+  size_t channels() const noexcept {
+    return columns + vectors.size();
+  }
+};
+
+/** "h:m:s:ms", the GPS time SDCard writes, as seconds since midnight. */
+bool parseTimestamp(const CsvField& field, double& seconds) noexcept {
+  long parts[4] = {};
+  int part = 0;
+  bool digits = false;
+  for (const char* p = field.begin; p < field.end; ++p) {
+    if (*p >= '0' && *p <= '9') {
+      parts[part] = parts[part] * 10 + (*p - '0');
+      digits = true;
+    } else if (*p == ':' && digits && part < 3) {
+      ++part;
+      digits = false;
+    } else {
+      return false;
+    }
+  }
+  if (part != 3 || !digits) {
+    return false;
+  }
+  seconds = parts[0] * 3600.0 + parts[1] * 60.0 + parts[2] + parts[3] / 1000.0;
+  return true;
+}
+
+/** A Sample Time: micros() on the board. */
+bool parseSampleTime(const CsvField& field, uint32_t& micros) noexcept {
+  double value;
+  if (!field.toDouble(value) || !(value >= 0.0 && value <= 4294967295.0)) {
+    return false;
+  }
+  micros = static_cast<uint32_t>(value);
+  return true;
+}
+
+/** Turns a row's Sample Time, Timestamp or number into seconds since the start of the log. */
+struct TimeBase {
+  enum Source { ROWS, SAMPLE_TIME, TIMESTAMP };
+  Source source = ROWS;
+  /** The field read for SAMPLE_TIME and TIMESTAMP */
+  int field = -1;
+  double rate = DEFAULT_RATE;
+  uint32_t startMicros = 0;
+  double startStamp = 0.0;
+
+  /** Seconds from the time field of a row */
+  bool fromField(const CsvField& value, double& seconds) const noexcept {
+    if (source == SAMPLE_TIME) {
+      uint32_t micros;
+      if (!parseSampleTime(value, micros)) {
+        return false;
+      }
+      // micros() wraps every 71.6 minutes, longer than any flight
+      seconds = static_cast<uint32_t>(micros - startMicros) / 1e6;
+      return true;
+    }
+    double stamp;
+    if (!parseTimestamp(value, stamp)) {
+      return false;
+    }
+    seconds = stamp - startStamp;
+    // The GPS time wraps at midnight UTC
+    seconds = seconds < -43200.0 ? seconds + 86400.0 : seconds;
+    return true;
+  }
+
+  const char* name() const noexcept {
+    return source == SAMPLE_TIME ? SAMPLE_TIME_COLUMN : TIMESTAMP_COLUMN;
+  }
+};
+
+/** Everything kept about a run of rows. Merging two gives the same as keeping both runs in one. */
+struct Bucket {
+  vector<RunningStats> channels;
+  /** Altitude against time */
+  LineFit altitude;
+  Peak apogee;
+  Crossing launch;
+
+  explicit Bucket(size_t channelCount = 0) : channels(channelCount) {}
+
+  void merge(const Bucket& other) {
+    for (size_t c = 0; c < channels.size(); ++c) {
+      channels[c].merge(other.channels[c]);
+    }
+    altitude.merge(other.altitude);
+    apogee.merge(other.apogee);
+    launch.merge(other.launch);
+  }
+};
+
+struct Chunk {
+  const char* begin;
+  const char* end;
+  uint64_t firstRow = 0;
+  uint64_t rows = 0;
+  uint64_t skipped = 0;
+  size_t firstBucket = 0;
+  vector<Bucket> buckets;
+};
+
+/** Field `index` of the row that starts at `begin`. */
+bool rowField(const char* begin, const char* end, int index, CsvField& field) {
+  CsvReader csv(begin, end - begin);
+  if (!csv.nextRow()) {
+    return false;
+  }
+  for (int i = 0; csv.nextField(field); ++i) {
+    if (i == index) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/** The Timestamp field of the row that starts at `begin`. */
+bool rowTimestamp(const char* begin, const char* end, const Layout& layout, double& seconds) {
+  CsvField field;
+  return rowField(begin, end, layout.timestampField, field) && parseTimestamp(field, seconds);
+}
+
+/** Read the header row, returning where the data starts. */
+const char* readHeader(const char* data, size_t size, Layout& layout) {
+  CsvReader csv(data, size);
+  CsvField field;
+  if (!csv.nextRow()) {
+    return nullptr;
+  }
+  layout.names.push_back("Time (s)");
+  while (csv.nextField(field)) {
+    string name(field.begin, field.end);
+    if (name == SAMPLE_TIME_COLUMN && layout.sampleTimeField < 0) {
+      layout.sampleTimeField = static_cast<int>(layout.fields);
+      layout.fieldChannel.push_back(-1);
+    } else if (name == TIMESTAMP_COLUMN && layout.timestampField < 0) {
+      layout.timestampField = static_cast<int>(layout.fields);
+      layout.fieldChannel.push_back(-1);
+    } else {
+      if (name == ALTITUDE_COLUMN) {
+        layout.altitude = static_cast<int>(layout.names.size());
+      }
+      layout.fieldChannel.push_back(static_cast<int>(layout.names.size()));
+      layout.names.push_back(name);
+    }
+    ++layout.fields;
+  }
+  layout.columns = layout.names.size();
+
+  for (size_t x = 1; x < layout.columns; ++x) {
+    const string& name = layout.names[x];
+    if (name.size() < 2 || name.compare(name.size() - 2, 2, " X") != 0) {
+      continue;
+    }
+    string prefix = name.substr(0, name.size() - 2);
+    auto y = find(layout.names.begin(), layout.names.end(), prefix + " Y");
+    auto z = find(layout.names.begin(), layout.names.end(), prefix + " Z");
+    if (y == layout.names.end() || z == layout.names.end()) {
+      continue;
+    }
+    if (prefix == ACCEL_COLUMN) {
+      layout.accelMagnitude = static_cast<int>(layout.columns + layout.vectors.size());
+    }
+    layout.vectors.push_back({ static_cast<int>(x), static_cast<int>(y - layout.names.begin()),
+      static_cast<int>(z - layout.names.begin()) });
+  }
+  for (const array<int, 3>& triple : layout.vectors) {
+    layout.names.push_back(layout.names[triple[0]].substr(0, layout.names[triple[0]].size() - 2) + " magnitude");
+  }
+
+  const char* body = data + (size - csv.remaining());
+  return body;
+}
+
+/** Cut [begin, end) into chunks of about CHUNK_BYTES that end at line breaks. */
+vector<Chunk> splitChunks(const char* begin, const char* end) {
+  vector<Chunk> chunks;
+  while (begin < end) {
+    const char* stop = end - begin > static_cast<ptrdiff_t>(CHUNK_BYTES) ? begin + CHUNK_BYTES : end;
+    if (stop < end) {
+      const char* newline = static_cast<const char*>(memchr(stop, '\n', end - stop));
+      stop = newline != nullptr ? newline + 1 : end;
+    }
+    Chunk chunk;
+    chunk.begin = begin;
+    chunk.end = stop;
+    chunks.push_back(move(chunk));
+    begin = stop;
+  }
+  return chunks;
+}
+
+template <typename Work>
+void parallelFor(size_t count, unsigned threads, Work work) {
+  atomic<size_t> next(0);
+  vector<thread> pool;
+  for (unsigned i = 0; i < threads; ++i) {
+    pool.emplace_back([&]() {
+      for (size_t n = next++; n < count; n = next++) {
+        work(n);
+      }
+    });
+  }
+  for (thread& t : pool) {
+    t.join();
+  }
+}
+
+/** Parse a chunk into blocks of columns and summarize each block into its bucket. */
+void summarizeChunk(Chunk& chunk, const Layout& layout, const TimeBase& time, uint64_t rowsPerPoint) {
+  size_t channelCount = layout.channels();
+  vector<vector<double>> block(channelCount, vector<double>(BLOCK_ROWS));
+  // Fields in the block that weren't numbers, per channel
+  vector<size_t> nans(channelCount);
+  vector<double> numbers(BLOCK_ROWS);
+  vector<double> numbersY(BLOCK_ROWS);
+  size_t filled = 0;
+  uint64_t blockRow = chunk.firstRow;
+  chunk.firstBucket = static_cast<size_t>(chunk.firstRow / rowsPerPoint);
+
+  auto flush = [&]() {
+    for (size_t v = 0; v < layout.vectors.size(); ++v) {
+      const array<int, 3>& triple = layout.vectors[v];
+      magnitudes(block[triple[0]].data(), block[triple[1]].data(), block[triple[2]].data(),
+        block[layout.columns + v].data(), filled);
+      nans[layout.columns + v] = nans[triple[0]] + nans[triple[1]] + nans[triple[2]];
+    }
+    size_t index = static_cast<size_t>(blockRow / rowsPerPoint) - chunk.firstBucket;
+    if (index >= chunk.buckets.size()) {
+      chunk.buckets.resize(index + 1, Bucket(channelCount));
+    }
+    Bucket& bucket = chunk.buckets[index];
+    for (size_t c = 0; c < channelCount; ++c) {
+      if (nans[c] == 0) {
+        bucket.channels[c].merge(blockStats(block[c].data(), filled));
+      } else {
+        bucket.channels[c].merge(blockStats(numbers.data(), dropNaNs(block[c].data(), filled, numbers.data())));
+      }
+    }
+    if (layout.altitude >= 0) {
+      const double* altitude = block[layout.altitude].data();
+      if (nans[0] == 0 && nans[layout.altitude] == 0) {
+        bucket.altitude.merge(blockFit(block[0].data(), altitude, filled));
+      } else {
+        size_t kept = dropNaNPairs(block[0].data(), altitude, filled, numbers.data(), numbersY.data());
+        bucket.altitude.merge(blockFit(numbers.data(), numbersY.data(), kept));
+      }
+      bucket.apogee.merge(blockPeak(altitude, block[0].data(), filled, blockRow));
+    }
+    if (layout.accelMagnitude >= 0) {
+      bucket.launch.merge(blockCrossing(block[layout.accelMagnitude].data(), block[0].data(), filled, blockRow,
+        LAUNCH_ACCEL));
+    }
+    blockRow += filled;
+    filled = 0;
+    fill(nans.begin(), nans.end(), 0);
+  };
+
+  CsvReader csv(chunk.begin, chunk.end - chunk.begin);
+  CsvField field;
+  uint64_t row = chunk.firstRow;
+  while (csv.nextRow()) {
+    // A block never spans two buckets
+    if (filled == BLOCK_ROWS || (filled > 0 && row / rowsPerPoint != blockRow / rowsPerPoint)) {
+      flush();
+    }
+    size_t fields = 0;
+    while (csv.nextField(field)) {
+      if (fields < layout.fields) {
+        int channel = layout.fieldChannel[fields];
+        double value;
+        if (channel < 0) {
+          if (static_cast<int>(fields) != time.field) {
+            // Rows are timed by the other time field, or by number (filled in below)
+          } else if (time.fromField(field, value)) {
+            block[0][filled] = value;
+          } else {
+            block[0][filled] = NAN;
+            ++nans[0];
+          }
+        } else if (field.toDouble(value) && !isnan(value)) {
+          block[channel][filled] = value;
+        } else {
+          block[channel][filled] = NAN;
+          ++nans[channel];
+        }
+      }
+      ++fields;
+    }
+    if (fields != layout.fields) {
+      // Cut short by a reset or power loss: keep its place, but none of its values
+      for (size_t c = 0; c < layout.columns; ++c) {
+        block[c][filled] = NAN;
+        ++nans[c];
+      }
+      ++chunk.skipped;
+    } else if (time.source == TimeBase::ROWS) {
+      block[0][filled] = row / time.rate;
+    }
+    ++filled;
+    ++row;
+  }
+  if (filled > 0) {
+    flush();
+  }
+}
+
+void printValue(FILE* out, double value) {
+  if (isnan(value)) {
+    fputs("nan", out);
+  } else {
+    fprintf(out, "%.10g", value);
+  }
+}
+
+bool writeSeries(const string& path, const Layout& layout, const vector<Bucket>& buckets) {
+  FILE* out = fopen(path.c_str(), "w");
+  if (out == nullptr) {
+    return false;
+  }
+  for (size_t c = 0; c < layout.names.size(); ++c) {
+    fprintf(out, c == 0 ? "%s" : ",%s", layout.names[c].c_str());
+  }
+  for (size_t c = layout.columns; c < layout.names.size(); ++c) {
+    fprintf(out, ",%s max", layout.names[c].c_str());
+  }
+  fputc('\n', out);
+  for (const Bucket& bucket : buckets) {
+    // A bucket of nothing but cut-short rows
+    if (bucket.channels[0].count == 0.0) {
+      continue;
+    }
+    for (size_t c = 0; c < bucket.channels.size(); ++c) {
+      if (c > 0) {
+        fputc(',', out);
+      }
+      printValue(out, bucket.channels[c].count > 0.0 ? bucket.channels[c].mean : NAN);
+    }
+    for (size_t c = layout.columns; c < bucket.channels.size(); ++c) {
+      fputc(',', out);
+      printValue(out, bucket.channels[c].max);
+    }
+    fputc('\n', out);
+  }
+  return fclose(out) == 0;
+}
+
+/** CAPS_INF.CSV -> CAPS_INF_series.csv */
+string seriesPath(const string& log) {
+  size_t slash = log.find_last_of("/\\");
+  size_t dot = log.find_last_of('.');
+  string stem = dot != string::npos && (slash == string::npos || dot > slash) ? log.substr(0, dot) : log;
+  return stem + "_series.csv";
+}
+
+/** Fit of the descent: from the bucket after apogee to the first one back near the starting altitude. */
+LineFit descentFit(const vector<Bucket>& buckets, const Layout& layout, const Bucket& summary) {
+  LineFit fit;
+  if (layout.altitude < 0 || !summary.apogee.found()) {
+    return fit;
+  }
+  double ground = NAN;
+  for (const Bucket& bucket : buckets) {
+    if (bucket.channels[layout.altitude].count > 0.0) {
+      ground = bucket.channels[layout.altitude].mean;
+      break;
+    }
+  }
+  double landing = ground + GROUND_MARGIN * (summary.apogee.value - ground);
+  bool afterApogee = false;
+  for (const Bucket& bucket : buckets) {
+    if (!afterApogee) {
+      afterApogee = bucket.apogee.found() && bucket.apogee.row == summary.apogee.row;
+      continue;
+    }
+    if (bucket.channels[layout.altitude].min <= landing) {
+      break;
+    }
+    fit.merge(bucket.altitude);
+  }
+  return fit;
+}
+
+void usage() {
+  fprintf(stderr,
+    "Usage: FlightStats [options] CAPS_INF.CSV...\n"
+    "  --points N   rows in each decimated series (default 2000)\n"
+    "  --rate HZ    time rows by their number at this rate instead of by the log's time columns\n"
+    "               (default: Sample Time (us), or in older logs Timestamp, or %.0f rows/s if it\n"
+    "               never changes)\n"
+    "  --no-series  don't write <log>_series.csv\n"
+    "  --threads N  worker threads (default: one per core)\n", DEFAULT_RATE);
+}
+
+bool parseArgs(int argc, char** argv, Options& opts) {
+  for (int i = 1; i < argc; ++i) {
+    string arg = argv[i];
+    if (arg.compare(0, 2, "--") != 0) {
+      opts.logs.push_back(arg);
+      continue;
+    }
+    if (arg == "--no-series") {
+      opts.series = false;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      return false;
+    }
+    const char* value = argv[++i];
+    if (arg == "--points") opts.points = strtoul(value, nullptr, 10);
+    else if (arg == "--rate") opts.rate = strtod(value, nullptr);
+    else if (arg == "--threads") opts.threads = strtoul(value, nullptr, 10);
+    else {
+      return false;
+    }
+  }
+  return !opts.logs.empty() && opts.points > 0 && opts.rate >= 0.0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  Options opts;
+  if (!parseArgs(argc, argv, opts)) {
+    usage();
+    return EXIT_FAILURE;
+  }
+  unsigned threadCount = opts.threads != 0 ? opts.threads : max(1u, thread::hardware_concurrency());
+
+  uint64_t totalRows = 0;
+  double totalBytes = 0.0;
+  double totalSeconds = 0.0;
+  for (const string& path : opts.logs) {
+    MappedFile file;
+    Layout layout;
+    const char* body = file.open(path.c_str()) ? readHeader(file.data(), file.size(), layout) : nullptr;
+    if (body == nullptr) {
+      fprintf(stderr, "Cannot read a log from %s\n", path.c_str());
+      return EXIT_FAILURE;
+    }
+    const char* end = file.data() + file.size();
+
+    auto start = chrono::steady_clock::now();
+    TimeBase time;
+    time.rate = opts.rate > 0.0 ? opts.rate : DEFAULT_RATE;
+    CsvField firstField;
+    uint32_t firstMicros;
+    if (opts.rate == 0.0 && layout.sampleTimeField >= 0 && rowField(body, end, layout.sampleTimeField, firstField)
+        && parseSampleTime(firstField, firstMicros)) {
+      time.source = TimeBase::SAMPLE_TIME;
+      time.field = layout.sampleTimeField;
+      time.startMicros = firstMicros;
+    } else if (opts.rate == 0.0 && layout.timestampField >= 0) {
+      // The last row may have been cut short, so look back from the one before it too
+      const char* last = end;
+      double first = 0.0;
+      double latest = 0.0;
+      bool found = false;
+      for (int attempt = 0; attempt < 2 && last > body; ++attempt) {
+        const char* lineEnd = last[-1] == '\n' ? last - 1 : last;
+        const char* lineStart = lineEnd;
+        while (lineStart > body && lineStart[-1] != '\n') {
+          --lineStart;
+        }
+        found = rowTimestamp(lineStart, last, layout, latest);
+        if (found) {
+          break;
+        }
+        last = lineStart;
+      }
+      if (found && rowTimestamp(body, end, layout, first) && latest != first) {
+        time.source = TimeBase::TIMESTAMP;
+        time.field = layout.timestampField;
+        time.startStamp = first;
+      }
+    }
+
+    vector<Chunk> chunks = splitChunks(body, end);
+    parallelFor(chunks.size(), threadCount, [&](size_t i) {
+      Chunk& chunk = chunks[i];
+      chunk.rows = count(chunk.begin, chunk.end, '\n') + (chunk.end[-1] != '\n' ? 1 : 0);
+    });
+    uint64_t rows = 0;
+    for (Chunk& chunk : chunks) {
+      chunk.firstRow = rows;
+      rows += chunk.rows;
+    }
+    uint64_t rowsPerPoint = max<uint64_t>(1, (rows + opts.points - 1) / opts.points);
+    parallelFor(chunks.size(), threadCount, [&](size_t i) {
+      summarizeChunk(chunks[i], layout, time, rowsPerPoint);
+    });
+
+    // Buckets that straddle two chunks are merged here, always in file order
+    size_t channelCount = layout.channels();
+    vector<Bucket> buckets(static_cast<size_t>((rows + rowsPerPoint - 1) / rowsPerPoint), Bucket(channelCount));
+    uint64_t skipped = 0;
+    for (const Chunk& chunk : chunks) {
+      for (size_t b = 0; b < chunk.buckets.size(); ++b) {
+        buckets[chunk.firstBucket + b].merge(chunk.buckets[b]);
+      }
+      skipped += chunk.skipped;
+    }
+    Bucket summary(channelCount);
+    for (const Bucket& bucket : buckets) {
+      summary.merge(bucket);
+    }
+    LineFit descent = descentFit(buckets, layout, summary);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    totalRows += rows;
+    totalBytes += file.size();
+    totalSeconds += seconds;
+
+    printf("%s: %llu rows", path.c_str(), static_cast<unsigned long long>(rows));
+    if (skipped > 0) {
+      printf(" (%llu cut short)", static_cast<unsigned long long>(skipped));
+    }
+    if (time.source == TimeBase::ROWS) {
+      printf(", timed at %g rows/s", time.rate);
+    } else {
+      printf(", timed by %s", time.name());
+    }
+    printf(", %.1f MB in %.3f s\n", file.size() / 1e6, seconds);
+    if (summary.launch.found()) {
+      printf("  launch (%s magnitude over %.1f m/s^2) at %.3f s\n", ACCEL_COLUMN, LAUNCH_ACCEL, summary.launch.time);
+    }
+    if (summary.apogee.found()) {
+      printf("  apogee %.2f ft (%s) at %.3f s", summary.apogee.value, ALTITUDE_COLUMN, summary.apogee.time);
+      if (summary.launch.found()) {
+        printf(", %.3f s after launch", summary.apogee.time - summary.launch.time);
+      }
+      printf("\n  altitude fit: %.3f ft/s over the log (r^2 %.5f)", summary.altitude.slope(), summary.altitude.r2());
+      if (descent.count > 0.0) {
+        printf(", %.3f ft/s over the descent (r^2 %.5f)", descent.slope(), descent.r2());
+      }
+      printf("\n");
+    }
+    printf("  %-20s %14s %14s %14s %14s\n", "column", "mean", "stdev", "min", "max");
+    for (size_t c = 0; c < channelCount; ++c) {
+      const RunningStats& stats = summary.channels[c];
+      printf("  %-20s %14.6g %14.6g %14.6g %14.6g\n", layout.names[c].c_str(), stats.count > 0.0 ? stats.mean : NAN,
+        stats.stdev(), stats.count > 0.0 ? stats.min : NAN, stats.count > 0.0 ? stats.max : NAN);
+    }
+
+    if (opts.series) {
+      string series = seriesPath(path);
+      if (!writeSeries(series, layout, buckets)) {
+        fprintf(stderr, "Cannot write %s\n", series.c_str());
+        return EXIT_FAILURE;
+      }
+      printf("  series: %s, %llu rows per point\n", series.c_str(), static_cast<unsigned long long>(rowsPerPoint));
+    }
+  }
+
+  printf("%zu logs, %llu rows, %.1f MB in %.3f s: %.2f M rows/s on %u threads\n", opts.logs.size(),
+    static_cast<unsigned long long>(totalRows), totalBytes / 1e6, totalSeconds, totalRows / totalSeconds / 1e6,
+    threadCount);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,267 @@
+/*
+ * flightStats.h
+ *
+ * Statistics for FlightStats that can be computed in pieces and merged afterwards, so every thread
+ * and every block of rows can keep its own and the results are combined at the end. Means and
+ * variances are merged as Welford/Chan running moments instead of sums of squares, which lose most
+ * of their digits on values like a 10,000 ft altitude.
+ *
+ * The block kernels take one column of up to a few thousand rows at a time, in plain loops marked
+ * `omp simd` so the compiler may split each sum across SIMD lanes (build with -fopenmp-simd; no
+ * OpenMP runtime is needed). A NaN test in the loop stops GCC from vectorizing it, so the kernels
+ * take numbers only: blocks with fields that weren't numbers go through dropNaNs() first.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace FlightStats {
+
+/** Count, mean, variance, min and max of one channel. */
+struct RunningStats {
+  double count = 0.0;
+  double mean = 0.0;
+  /** Sum of squared differences from the mean */
+  double m2 = 0.0;
+  double min = std::numeric_limits<double>::infinity();
+  double max = -std::numeric_limits<double>::infinity();
+
+  /** Combine with the stats of other values, as if they had all been added here. */
+  void merge(const RunningStats& other) noexcept {
+    if (other.count == 0.0) {
+      return;
+    }
+    if (count == 0.0) {
+      *this = other;
+      return;
+    }
+    double total = count + other.count;
+    double delta = other.mean - mean;
+    mean += delta * (other.count / total);
+    m2 += other.m2 + delta * delta * (count * other.count / total);
+    count = total;
+    min = other.min < min ? other.min : min;
+    max = other.max > max ? other.max : max;
+  }
+
+  /** Sample variance, NaN with fewer than two values. */
+  double variance() const noexcept {
+    return count < 2.0 ? NAN : m2 / (count - 1.0);
+  }
+
+  double stdev() const noexcept {
+    return std::sqrt(variance());
+  }
+};
+
+/** Least-squares line through (t, y) points, from the same kind of running moments. */
+struct LineFit {
+  double count = 0.0;
+  double meanT = 0.0;
+  double meanY = 0.0;
+  double m2T = 0.0;
+  double m2Y = 0.0;
+  /** Sum of (t - meanT)(y - meanY) */
+  double c2 = 0.0;
+
+  void merge(const LineFit& other) noexcept {
+    if (other.count == 0.0) {
+      return;
+    }
+    if (count == 0.0) {
+      *this = other;
+      return;
+    }
+    double total = count + other.count;
+    double weight = count * other.count / total;
+    double deltaT = other.meanT - meanT;
+    double deltaY = other.meanY - meanY;
+    meanT += deltaT * (other.count / total);
+    meanY += deltaY * (other.count / total);
+    m2T += other.m2T + deltaT * deltaT * weight;
+    m2Y += other.m2Y + deltaY * deltaY * weight;
+    c2 += other.c2 + deltaT * deltaY * weight;
+    count = total;
+  }
+
+  /** y per unit of t */
+  double slope() const noexcept {
+    return m2T > 0.0 ? c2 / m2T : NAN;
+  }
+
+  double intercept() const noexcept {
+    return meanY - slope() * meanT;
+  }
+
+  /** Coefficient of determination: the share of y's variance the line explains. */
+  double r2() const noexcept {
+    return m2T > 0.0 && m2Y > 0.0 ? c2 * c2 / (m2T * m2Y) : NAN;
+  }
+};
+
+/** The highest value of a channel and the row it was first reached in. */
+struct Peak {
+  double value = -std::numeric_limits<double>::infinity();
+  double time = NAN;
+  uint64_t row = UINT64_MAX;
+
+  bool found() const noexcept {
+    return row != UINT64_MAX;
+  }
+
+  void merge(const Peak& other) noexcept {
+    if (other.value > value || (other.value == value && other.row < row)) {
+      *this = other;
+    }
+  }
+};
+
+/** The first row in which a channel reached a threshold. */
+struct Crossing {
+  double time = NAN;
+  uint64_t row = UINT64_MAX;
+
+  bool found() const noexcept {
+    return row != UINT64_MAX;
+  }
+
+  void merge(const Crossing& other) noexcept {
+    if (other.row < row) {
+      *this = other;
+    }
+  }
+};
+
+/** Copy the values that are numbers to `out`. @return How many there were. */
+inline size_t dropNaNs(const double* values, size_t count, double* out) noexcept {
+  size_t kept = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (!std::isnan(values[i])) {
+      out[kept++] = values[i];
+    }
+  }
+  return kept;
+}
+
+/** Copy the (t[i], y[i]) pairs where both are numbers. @return How many there were. */
+inline size_t dropNaNPairs(const double* t, const double* y, size_t count, double* outT, double* outY) noexcept {
+  size_t kept = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (!std::isnan(t[i]) && !std::isnan(y[i])) {
+      outT[kept] = t[i];
+      outY[kept++] = y[i];
+    }
+  }
+  return kept;
+}
+
+/** Stats of `count` values, none of them NaN: their mean first, then the squared differences from it. */
+inline RunningStats blockStats(const double* values, size_t count) noexcept {
+  RunningStats stats;
+  if (count == 0) {
+    return stats;
+  }
+  double sum = 0.0;
+#pragma omp simd reduction(+:sum)
+  for (size_t i = 0; i < count; ++i) {
+    sum += values[i];
+  }
+  stats.count = static_cast<double>(count);
+  stats.mean = sum / stats.count;
+
+  double m2 = 0.0;
+  double min = stats.min;
+  double max = stats.max;
+#pragma omp simd reduction(+:m2) reduction(min:min) reduction(max:max)
+  for (size_t i = 0; i < count; ++i) {
+    double deviation = values[i] - stats.mean;
+    m2 += deviation * deviation;
+    min = values[i] < min ? values[i] : min;
+    max = values[i] > max ? values[i] : max;
+  }
+  stats.m2 = m2;
+  stats.min = min;
+  stats.max = max;
+  return stats;
+}
+
+/** Line through `count` (t[i], y[i]) points, none of them NaN. */
+inline LineFit blockFit(const double* t, const double* y, size_t count) noexcept {
+  LineFit fit;
+  if (count == 0) {
+    return fit;
+  }
+  double sumT = 0.0;
+  double sumY = 0.0;
+#pragma omp simd reduction(+:sumT, sumY)
+  for (size_t i = 0; i < count; ++i) {
+    sumT += t[i];
+    sumY += y[i];
+  }
+  fit.count = static_cast<double>(count);
+  fit.meanT = sumT / fit.count;
+  fit.meanY = sumY / fit.count;
+
+  double m2T = 0.0;
+  double m2Y = 0.0;
+  double c2 = 0.0;
+#pragma omp simd reduction(+:m2T, m2Y, c2)
+  for (size_t i = 0; i < count; ++i) {
+    double dt = t[i] - fit.meanT;
+    double dy = y[i] - fit.meanY;
+    m2T += dt * dt;
+    m2Y += dy * dy;
+    c2 += dt * dy;
+  }
+  fit.m2T = m2T;
+  fit.m2Y = m2Y;
+  fit.c2 = c2;
+  return fit;
+}
+
+/** out[i] = |(x[i], y[i], z[i])|, as IMU::getMagnitude() computes it on the board. */
+inline void magnitudes(const double* x, const double* y, const double* z, double* out, size_t count) noexcept {
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = std::sqrt(x[i] * x[i] + y[i] * y[i] + z[i] * z[i]);
+  }
+}
+
+/**
+ * The highest of `count` values, `firstRow` being the row of values[0].
+ * @param[in] times The time of each row.
+ */
+inline Peak blockPeak(const double* values, const double* times, size_t count, uint64_t firstRow) noexcept {
+  Peak peak;
+  size_t best = count;
+  for (size_t i = 0; i < count; ++i) {
+    if (values[i] > peak.value) {
+      peak.value = values[i];
+      best = i;
+    }
+  }
+  if (best < count) {
+    peak.time = times[best];
+    peak.row = firstRow + best;
+  }
+  return peak;
+}
+
+/** The first of `count` values at or above `threshold`. */
+inline Crossing blockCrossing(const double* values, const double* times, size_t count, uint64_t firstRow,
+                              double threshold) noexcept {
+  Crossing crossing;
+  for (size_t i = 0; i < count; ++i) {
+    if (values[i] >= threshold) {
+      crossing.time = times[i];
+      crossing.row = firstRow + i;
+      break;
+    }
+  }
+  return crossing;
+}
+
+} // namespace FlightStats
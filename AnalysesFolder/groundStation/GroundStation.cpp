@@ -0,0 +1,131 @@
+/*
+ * GroundStation.cpp
+ *
+ * Receives the radios of both capsules and the payload bay at once and writes one merged log, in
+ * the order the packets arrived (see groundStation.h for the formats). Each device is a serial port
+ * or a pseudo-terminal; capsule text lines and payload lines are told apart by their fields, but
+ * binary frames (RADIO_BINARY_FRAMES) have to be asked for. Runs until every device hangs up, the
+ * --duration is over, or Ctrl-C, then prints each stream's packet, malformed and gap counts.
+ *
+ * Usage: GroundStation [-o merged.csv] [--duration seconds] DEVICE[,frames][,BAUD]...
+ *   e.g. GroundStation -o flight.csv /dev/ttyUSB0,230400 /dev/ttyUSB1,frames /dev/ttyUSB2,57600
+ *   BAUD defaults to 230400, the capsules' radio; the payload bay's is 57600.
+ */
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "groundStation.h"
+
+using namespace GroundStation;
+
+namespace {
+
+const unsigned DEFAULT_BAUD = 230400;
+// How often the log reaches the disk, so it can be followed while the flight is on
+const int FLUSH_MS = 200;
+
+volatile sig_atomic_t g_stop = 0;
+
+void stop(int) {
+  g_stop = 1;
+}
+
+/** Parses "path[,frames][,baud]" in place. */
+bool parseDevice(char* spec, Device& device) {
+  device.framing = StreamDecoder::TEXT;
+  device.baud = DEFAULT_BAUD;
+  char* rest = nullptr;
+  device.path = strtok_r(spec, ",", &rest);
+  if (device.path == nullptr) {
+    return false;
+  }
+  for (char* option = strtok_r(nullptr, ",", &rest); option != nullptr; option = strtok_r(nullptr, ",", &rest)) {
+    if (strcmp(option, "frames") == 0) {
+      device.framing = StreamDecoder::FRAMES;
+    } else if (strcmp(option, "text") == 0) {
+      device.framing = StreamDecoder::TEXT;
+    } else {
+      char* end;
+      device.baud = static_cast<unsigned>(strtoul(option, &end, 10));
+      if (end == option || *end != '\0') {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const char* logPath = nullptr;
+  double duration = 0.0;
+  Device devices[Receiver::MAX_DEVICES];
+  size_t deviceCount = 0;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      logPath = argv[++i];
+    } else if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+      duration = atof(argv[++i]);
+    } else if (argv[i][0] != '-' && deviceCount < Receiver::MAX_DEVICES && parseDevice(argv[i], devices[deviceCount])) {
+      ++deviceCount;
+    } else {
+      deviceCount = 0;
+      break;
+    }
+  }
+  if (deviceCount == 0) {
+    fprintf(stderr, "usage: %s [-o merged.csv] [--duration seconds] DEVICE[,frames][,BAUD]... (up to %zu)\n",
+      argv[0], Receiver::MAX_DEVICES);
+    return EXIT_FAILURE;
+  }
+
+  FILE* log = logPath != nullptr ? fopen(logPath, "w") : stdout;
+  if (log == nullptr) {
+    perror(logPath);
+    return EXIT_FAILURE;
+  }
+
+  static Receiver receiver;
+  for (size_t i = 0; i < deviceCount; ++i) {
+    if (!receiver.add(devices[i])) {
+      perror(devices[i].path);
+      return EXIT_FAILURE;
+    }
+  }
+  signal(SIGINT, stop);
+  signal(SIGTERM, stop);
+
+  uint64_t start = monotonicNanos();
+  LogWriter writer(log, start);
+  writer.writeHeader(devices, deviceCount);
+  uint64_t lastFlush = start;
+  while (!g_stop && receiver.poll(FLUSH_MS, writer)) {
+    uint64_t now = monotonicNanos();
+    if (now - lastFlush >= FLUSH_MS * 1000000ULL) {
+      fflush(log);
+      lastFlush = now;
+    }
+    if (duration > 0.0 && now - start >= static_cast<uint64_t>(duration * 1e9)) {
+      break;
+    }
+  }
+  fflush(log);
+
+  fprintf(stderr, "%-24s %9s %9s %9s %8s %9s %6s %8s %10s\n", "stream", "capsule1", "capsule2", "payload",
+    "reports", "malformed", "gaps", "missing", "bytes");
+  for (size_t i = 0; i < receiver.count(); ++i) {
+    const StreamStats& stats = receiver.decoder(i).stats();
+    fprintf(stderr, "%-24s %9lu %9lu %9lu %8lu %9lu %6lu %8lu %10lu\n", devices[i].path, stats.packets[CAPSULE_1],
+      stats.packets[CAPSULE_2], stats.packets[PAYLOAD], stats.packets[REPORT], stats.malformed, stats.gaps,
+      stats.missing, stats.bytes);
+  }
+  fprintf(stderr, "longest decode of one read: %.1f us\n", receiver.maxDecodeNanos() / 1e3);
+  if (log != stdout) {
+    fclose(log);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,392 @@
+/*
+ * GroundStationBenchmark.cpp
+ *
+ * Feeds the ground station three live streams through pseudo-terminals, the way the radios would:
+ * capsule 1 as text lines and capsule 2 as binary frames at 144 Hz, and the payload bay's lines at
+ * 20 Hz. Every DROP_EVERY-th packet of a stream is never sent and every CORRUPT_EVERY-th has one
+ * byte damaged. The Receiver reads all three from one thread and writes the merged log.
+ *
+ * Fails unless every packet that was sent intact comes out with the text that went in, each
+ * damaged one is counted as malformed, the gaps add up to the packets that were dropped (and, for
+ * frames, damaged), packets come out in arrival order, and 99% of them are decoded and logged
+ * within a quarter of the 144 Hz packet period of being written. Text streams have no sequence
+ * numbers, so their gaps are only expected to match to within what the packets that came off
+ * schedule could have added or hidden. Then times the decoder alone on
+ * packets in memory.
+ *
+ * Usage: GroundStationBenchmark [seconds]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "groundStation.h"
+#include "../radioFrames/randomSnapshot.h"
+
+using namespace GroundStation;
+
+namespace {
+
+const double CAPSULE_HZ = 144.0;
+const double PAYLOAD_HZ = 20.0;
+const size_t DROP_EVERY = 97;
+const size_t CORRUPT_EVERY = 61;
+// Left after the last packet before hanging up, so it is read before the hangup is
+const int DRAIN_MS = 200;
+// Text packets written and read within this many periods of their schedule can't move
+// GapDetector's count (a quarter, less a margin for drops raising its average spacing). One further
+// off can, by stretching or shortening the silence either side of it.
+const double LATE_PERIODS = 0.2;
+
+/** One packet as it goes on the wire, and the text the receiver should make of it */
+struct Sent {
+  std::string wire;
+  std::string text;
+  bool dropped;
+  bool corrupted;
+};
+
+/** One radio: its packets, when each was written, and the pseudo-terminal it is written to */
+struct Stream {
+  const char* name;
+  StreamDecoder::Framing framing;
+  unsigned baud;
+  double hz;
+  std::vector<Sent> packets;
+  uint64_t firstNanos; // when packet 0 is due
+  std::vector<std::atomic<uint64_t>> writtenNanos;
+  std::vector<uint64_t> receivedNanos; // 0 for packets that weren't matched
+  int master;
+  std::string slave;
+
+  Stream(const char* name, StreamDecoder::Framing framing, unsigned baud, double hz, size_t count) :
+    name(name), framing(framing), baud(baud), hz(hz), packets(count), firstNanos(0), writtenNanos(count),
+    receivedNanos(count, 0), master(-1) {}
+
+  uint64_t period() const {
+    return static_cast<uint64_t>(1e9 / hz);
+  }
+
+  uint64_t dueNanos(size_t i) const {
+    return firstNanos + i * period();
+  }
+
+  /**
+   * Packets sent more than LATE_PERIODS off schedule, by when they were written or (if they
+   * decoded) read. Damaged ones are only judged by the write, as the receiver doesn't match them.
+   */
+  size_t offSchedule() const {
+    uint64_t late = static_cast<uint64_t>(LATE_PERIODS * period());
+    size_t count = 0;
+    for (size_t i = 0; i < packets.size(); ++i) {
+      if (packets[i].dropped) {
+        continue;
+      }
+      uint64_t due = dueNanos(i);
+      uint64_t seen = std::max(writtenNanos[i].load(std::memory_order_acquire), receivedNanos[i]);
+      count += seen > due + late;
+    }
+    return count;
+  }
+};
+
+/** Damage one byte of the packet, so it can't pass for another one */
+void corrupt(Sent& packet, std::mt19937& rng) {
+  std::string& wire = packet.wire;
+  // Never the terminator, so the next packet still starts cleanly
+  size_t at = std::uniform_int_distribution<size_t>(1, wire.size() - 2)(rng);
+  if (packet.text == packet.wire) {
+    // Not a digit in any field's base (and not a comma, which could make a valid shorter field)
+    wire[at] = 'G';
+  } else {
+    uint8_t flipped = static_cast<uint8_t>(wire[at]) ^ (1 << std::uniform_int_distribution<int>(0, 7)(rng));
+    wire[at] = static_cast<char>(flipped == 0 ? flipped ^ 0x80 : flipped);
+  }
+}
+
+void makeCapsule(Stream& stream, int capsule, std::mt19937& rng) {
+  for (size_t i = 0; i < stream.packets.size(); ++i) {
+    Telemetry::Snapshot snapshot = randomSnapshot(rng);
+    char text[96];
+    if (capsule == 1) {
+      RadioFrame::formatText<1>(snapshot, text, sizeof text);
+    } else {
+      RadioFrame::formatText<2>(snapshot, text, sizeof text);
+    }
+    Sent& sent = stream.packets[i];
+    sent.text = text;
+    if (stream.framing == StreamDecoder::FRAMES) {
+      uint8_t frame[RadioFrame::maxSize<2>()];
+      size_t length = capsule == 1 ? RadioFrame::encode<1>(snapshot, static_cast<uint16_t>(i), frame)
+                                   : RadioFrame::encode<2>(snapshot, static_cast<uint16_t>(i), frame);
+      sent.wire.assign(reinterpret_cast<char*>(frame), length);
+    } else {
+      sent.wire = sent.text;
+    }
+  }
+}
+
+void makePayload(Stream& stream, std::mt19937& rng) {
+  for (size_t i = 0; i < stream.packets.size(); ++i) {
+    char text[32];
+    int altitude = std::uniform_int_distribution<int>(-99999, 99999)(rng);
+    int pressure = std::uniform_int_distribution<int>(0, 1023)(rng);
+    snprintf(text, sizeof text, "%+06d,%03d,%d\n", altitude, pressure, i * 2 < stream.packets.size() ? 1 : 0);
+    stream.packets[i].text = text;
+    stream.packets[i].wire = text;
+  }
+}
+
+void markFaults(Stream& stream, std::mt19937& rng) {
+  for (size_t i = 0; i < stream.packets.size(); ++i) {
+    Sent& sent = stream.packets[i];
+    sent.dropped = i % DROP_EVERY == DROP_EVERY - 1;
+    sent.corrupted = !sent.dropped && i % CORRUPT_EVERY == CORRUPT_EVERY - 1;
+    if (sent.corrupted) {
+      corrupt(sent, rng);
+    }
+  }
+}
+
+bool openPty(Stream& stream) {
+  stream.master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (stream.master < 0 || grantpt(stream.master) != 0 || unlockpt(stream.master) != 0) {
+    return false;
+  }
+  const char* slave = ptsname(stream.master);
+  if (slave == nullptr) {
+    return false;
+  }
+  stream.slave = slave;
+  return true;
+}
+
+/** Write the stream's packets on schedule, then hang up */
+void feed(Stream& stream) {
+  for (size_t i = 0; i < stream.packets.size(); ++i) {
+    uint64_t due = stream.dueNanos(i);
+    timespec when = {static_cast<time_t>(due / 1000000000ULL), static_cast<long>(due % 1000000000ULL)};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &when, nullptr) == EINTR) {
+    }
+    const Sent& sent = stream.packets[i];
+    if (sent.dropped) {
+      continue;
+    }
+    stream.writtenNanos[i].store(monotonicNanos(), std::memory_order_release);
+    const char* data = sent.wire.data();
+    size_t left = sent.wire.size();
+    while (left > 0) {
+      ssize_t wrote = write(stream.master, data, left);
+      if (wrote > 0) {
+        data += wrote;
+        left -= static_cast<size_t>(wrote);
+      } else if (errno != EINTR && errno != EAGAIN) {
+        perror(stream.name);
+        break;
+      }
+    }
+  }
+  usleep(DRAIN_MS * 1000);
+  close(stream.master);
+}
+
+/** Checks each packet against what was sent, times it, and logs it */
+class CheckingSink {
+public:
+  CheckingSink(std::vector<Stream*>& streams, FILE* log, uint64_t startNanos) :
+    m_streams(streams), m_writer(log, startNanos), m_next(streams.size(), 0), m_lastNanos(0), m_mismatches(0),
+    m_outOfOrder(0) {
+    m_latencies.reserve(1 << 16);
+  }
+
+  void packet(const Packet& p) {
+    m_writer.packet(p);
+    uint64_t done = monotonicNanos();
+    if (p.receivedNanos < m_lastNanos) {
+      ++m_outOfOrder;
+    }
+    m_lastNanos = p.receivedNanos;
+
+    Stream& stream = *m_streams[p.stream];
+    size_t& next = m_next[p.stream];
+    while (next < stream.packets.size() && (stream.packets[next].dropped || stream.packets[next].corrupted)) {
+      ++next;
+    }
+    char text[MAX_LINE + 2];
+    p.formatText(text, sizeof text);
+    if (next == stream.packets.size() || stream.packets[next].text != text) {
+      ++m_mismatches;
+      return;
+    }
+    if (stream.hz == CAPSULE_HZ) {
+      m_latencies.push_back(done - stream.writtenNanos[next].load(std::memory_order_acquire));
+    }
+    stream.receivedNanos[next] = p.receivedNanos;
+    ++next;
+  }
+
+  void gap(int stream, uint64_t nanos, uint32_t missing) {
+    m_writer.gap(stream, nanos, missing);
+  }
+
+  unsigned long mismatches() const {
+    return m_mismatches;
+  }
+
+  unsigned long outOfOrder() const {
+    return m_outOfOrder;
+  }
+
+  std::vector<uint64_t>& latencies() {
+    return m_latencies;
+  }
+
+private:
+  std::vector<Stream*>& m_streams;
+  LogWriter m_writer;
+  std::vector<size_t> m_next;
+  uint64_t m_lastNanos;
+  unsigned long m_mismatches;
+  unsigned long m_outOfOrder;
+  std::vector<uint64_t> m_latencies;
+};
+
+/** Counts, for timing the decoder by itself */
+struct CountingSink {
+  unsigned long packets = 0;
+  unsigned long gaps = 0;
+
+  void packet(const Packet&) {
+    ++packets;
+  }
+
+  void gap(int, uint64_t, uint32_t) {
+    ++gaps;
+  }
+};
+
+/** Decoder throughput on `count` packets of `stream` already in memory, packets per second */
+double decodeRate(const Stream& stream, size_t repeat) {
+  std::string bytes;
+  for (const Sent& sent : stream.packets) {
+    bytes += sent.wire;
+  }
+  StreamDecoder decoder(0, stream.framing);
+  CountingSink sink;
+  uint64_t start = monotonicNanos();
+  for (size_t r = 0; r < repeat; ++r) {
+    decoder.push(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size(), start, sink);
+  }
+  double seconds = (monotonicNanos() - start) / 1e9;
+  return (sink.packets + decoder.stats().malformed) / seconds;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  double seconds = argc > 1 ? atof(argv[1]) : 10.0;
+  if (seconds <= 0.0) {
+    fprintf(stderr, "usage: %s [seconds]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  std::mt19937 rng(23);
+  Stream capsule1("capsule1 text", StreamDecoder::TEXT, 230400, CAPSULE_HZ, static_cast<size_t>(seconds * CAPSULE_HZ));
+  Stream capsule2("capsule2 frames", StreamDecoder::FRAMES, 230400, CAPSULE_HZ,
+    static_cast<size_t>(seconds * CAPSULE_HZ));
+  Stream payload("payload text", StreamDecoder::TEXT, 57600, PAYLOAD_HZ, static_cast<size_t>(seconds * PAYLOAD_HZ));
+  makeCapsule(capsule1, 1, rng);
+  makeCapsule(capsule2, 2, rng);
+  makePayload(payload, rng);
+  std::vector<Stream*> streams = {&capsule1, &capsule2, &payload};
+
+  static Receiver receiver;
+  for (Stream* stream : streams) {
+    markFaults(*stream, rng);
+    Device device = {nullptr, stream->framing, stream->baud};
+    if (!openPty(*stream) || (device.path = stream->slave.c_str(), !receiver.add(device))) {
+      perror(stream->name);
+      return EXIT_FAILURE;
+    }
+  }
+
+  FILE* log = tmpfile();
+  if (log == nullptr) {
+    perror("tmpfile");
+    return EXIT_FAILURE;
+  }
+  uint64_t start = monotonicNanos();
+  CheckingSink sink(streams, log, start);
+  // Give the receiver a moment to be waiting before the first packet
+  uint64_t firstPacket = start + 50000000ULL;
+  std::vector<std::thread> feeders;
+  for (Stream* stream : streams) {
+    stream->firstNanos = firstPacket;
+    feeders.emplace_back(feed, std::ref(*stream));
+  }
+  while (receiver.poll(1000, sink)) {
+  }
+  for (std::thread& feeder : feeders) {
+    feeder.join();
+  }
+  fclose(log);
+
+  bool ok = sink.mismatches() == 0 && sink.outOfOrder() == 0;
+  printf("%-16s %8s %8s %9s %9s %6s %8s %9s %6s\n", "stream", "sent", "decoded", "malformed", "(damaged)", "gaps",
+    "missing", "(dropped)", "(late)");
+  for (size_t i = 0; i < streams.size(); ++i) {
+    const Stream& stream = *streams[i];
+    size_t dropped = 0, damaged = 0;
+    for (const Sent& sent : stream.packets) {
+      dropped += sent.dropped;
+      damaged += sent.corrupted;
+    }
+    size_t intact = stream.packets.size() - dropped - damaged;
+    const StreamStats& stats = receiver.decoder(i).stats();
+    unsigned long decoded = 0;
+    for (unsigned long packets : stats.packets) {
+      decoded += packets;
+    }
+    // A damaged frame never arrives as far as the sequence numbers can tell; a damaged line does
+    size_t missing = stream.framing == StreamDecoder::FRAMES ? dropped + damaged : dropped;
+    // Sequence numbers make frames' count exact; each text packet off schedule can move a silence
+    // either side of it past a GAP_FACTOR boundary
+    size_t late = stream.offSchedule();
+    size_t tolerance = stream.framing == StreamDecoder::FRAMES ? 0 : 2 * late;
+    size_t error = stats.missing > missing ? stats.missing - missing : missing - stats.missing;
+    printf("%-16s %8zu %8lu %9lu %9zu %6lu %8lu %9zu %6zu\n", stream.name, stream.packets.size() - dropped,
+      decoded, stats.malformed, damaged, stats.gaps, stats.missing, missing, late);
+    ok = ok && decoded == intact && stats.malformed == damaged && error <= tolerance;
+  }
+  printf("%lu mismatched, %lu out of order\n", sink.mismatches(), sink.outOfOrder());
+
+  std::vector<uint64_t>& latencies = sink.latencies();
+  std::sort(latencies.begin(), latencies.end());
+  double period = 1e9 / CAPSULE_HZ;
+  if (latencies.empty()) {
+    ok = false;
+  } else {
+    double p50 = latencies[latencies.size() / 2];
+    double p99 = latencies[latencies.size() * 99 / 100];
+    double most = latencies.back();
+    printf("\nwrite to logged, 144 Hz streams: p50 %.1f us, p99 %.1f us, max %.1f us (period %.0f us, p99 limit %.0f us)\n",
+      p50 / 1e3, p99 / 1e3, most / 1e3, period / 1e3, period / 4e3);
+    printf("longest decode of one read: %.1f us\n", receiver.maxDecodeNanos() / 1e3);
+    ok = ok && p99 <= period / 4;
+  }
+
+  printf("\n%-16s %14s\n", "decoder alone", "packets/s");
+  for (const Stream* stream : streams) {
+    printf("%-16s %14.0f\n", stream->name, decodeRate(*stream, 20));
+  }
+
+  printf("\n%s\n", ok ? "PASS" : "FAIL");
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
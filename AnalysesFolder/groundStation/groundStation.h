@@ -0,0 +1,572 @@
+/*
+ * groundStation.h
+ *
+ * The ground side of the radios: turns the bytes of each serial stream into packets and notices
+ * when packets stop arriving. A stream carries one of
+ *   - the capsules' hex text lines (RadioFrame::formatText(), either capsule; told apart by their
+ *     field count),
+ *   - the capsules' binary frames (RADIO_BINARY_FRAMES, RadioFrame.h), or
+ *   - the payload bay's "%+06d,%03d,%d" lines (payload_bay_micro.ino's sendToRadio()).
+ * The capsules' text stream also carries their reports ("task,...", "phase,..." from TaskTimer.h
+ * and the sketch), which start with a lowercase word and are passed on as they are.
+ * Text lines have no checksum, so a line is only accepted if it reads back to exactly the text the
+ * board would have written for it.
+ *
+ * Nothing here allocates: every buffer is fixed when a StreamDecoder or Receiver is made. Receiver
+ * reads every device from one poll() loop and stamps each read with the monotonic clock as it
+ * returns, so the packets of all streams come out in the order they arrived.
+ */
+
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "../radioFrames/radioFrameDecoder.h"
+
+namespace GroundStation {
+
+enum Kind {
+  CAPSULE_1,
+  CAPSULE_2,
+  PAYLOAD,
+  REPORT,
+  KIND_COUNT,
+};
+
+inline const char* kindName(Kind kind) {
+  static const char* const NAMES[KIND_COUNT] = {"capsule1", "capsule2", "payload", "report"};
+  return NAMES[kind];
+}
+
+/** CLOCK_MONOTONIC in nanoseconds */
+inline uint64_t monotonicNanos() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + static_cast<uint64_t>(now.tv_nsec);
+}
+
+/** Longest text line kept; the capsule 2 line is 78 characters */
+const size_t MAX_LINE = 96;
+
+/** One decoded packet */
+struct Packet {
+  /** When the read that completed it returned, monotonicNanos() */
+  uint64_t receivedNanos;
+  /** Index of the stream it came in on */
+  int stream;
+  Kind kind;
+  /** Binary frames only */
+  bool hasSequence;
+  uint16_t sequence;
+  /** Capsules: the telemetry as Telemetry::RadioSchema<capsule> stores it */
+  uint8_t telemetry[Telemetry::RadioSchema<2>::SIZE];
+  /** Payload bay: feet AGL, tank pressure reading, and whether it has ejected the capsules */
+  int32_t altitude;
+  int32_t tankPressure;
+  bool ejected;
+  /** Reports: the line, without its newline */
+  char report[MAX_LINE + 1];
+
+  /** The packet as the board's text line, newline included. @return Its length. */
+  int formatText(char* out, size_t size) const {
+    if (kind == REPORT) {
+      return snprintf(out, size, "%s\n", report);
+    } else if (kind == CAPSULE_1) {
+      return RadioFrame::formatStoredText<1>(telemetry, out, size);
+    } else if (kind == CAPSULE_2) {
+      return RadioFrame::formatStoredText<2>(telemetry, out, size);
+    }
+    return snprintf(out, size, "%+06d,%03d,%d\n", static_cast<int>(altitude), static_cast<int>(tankPressure),
+      ejected ? 0 : 1);
+  }
+};
+
+/**
+ * Finds the packets that never arrived. With sequence numbers (binary frames) that is exact. Without
+ * them, a silence of more than GAP_FACTOR times the recent spacing of packets counts as a gap, of
+ * about as many packets as would have fit. The spacing is a running average that follows the
+ * board's rate changes between flight phases within a few packets; a slower rate shows up as one
+ * gap when it starts.
+ */
+class GapDetector {
+public:
+  static constexpr double GAP_FACTOR = 1.5;
+  /** Packets before the spacing is trusted */
+  static const unsigned WARMUP = 8;
+
+  GapDetector() : m_lastNanos(0), m_spacing(0.0), m_arrivals(0), m_lastSequence(0), m_haveSequence(false) {}
+
+  /**
+   * Note a packet (or malformed line: it still shows the link is up) arriving at `nanos`.
+   * @return How many packets seem to be missing before it.
+   */
+  uint32_t arrived(uint64_t nanos) {
+    uint32_t missing = 0;
+    if (m_arrivals > 0) {
+      if (nanos == m_lastNanos) {
+        // Came in the same read as the last one: only the reads' spacing says anything
+        return 0;
+      }
+      double interval = static_cast<double>(nanos - m_lastNanos);
+      if (m_arrivals > WARMUP && interval > GAP_FACTOR * m_spacing) {
+        double periods = interval / m_spacing + 0.5;
+        missing = periods >= 4294967295.0 ? 4294967295U : static_cast<uint32_t>(periods) - 1;
+        missing = missing == 0 ? 1 : missing;
+      }
+      // A long silence moves the average only so far, so one outage doesn't hide the next
+      double capped = interval < 4.0 * m_spacing || m_arrivals == 1 ? interval : 4.0 * m_spacing;
+      m_spacing = m_arrivals == 1 ? capped : m_spacing + (capped - m_spacing) / 8.0;
+    }
+    m_lastNanos = nanos;
+    ++m_arrivals;
+    return missing;
+  }
+
+  /** Note a frame with sequence number `sequence`. @return How many were skipped before it. */
+  uint32_t sequenced(uint16_t sequence) {
+    uint32_t missing = m_haveSequence ? static_cast<uint16_t>(sequence - m_lastSequence - 1) : 0;
+    m_lastSequence = sequence;
+    m_haveSequence = true;
+    return missing;
+  }
+
+  /** Average spacing of recent packets, ns */
+  double spacing() const {
+    return m_spacing;
+  }
+
+  uint64_t lastNanos() const {
+    return m_lastNanos;
+  }
+
+private:
+  uint64_t m_lastNanos;
+  double m_spacing;
+  unsigned long m_arrivals;
+  uint16_t m_lastSequence;
+  bool m_haveSequence;
+};
+
+/** Counts for one stream */
+struct StreamStats {
+  unsigned long packets[KIND_COUNT];
+  /** Lines or frames that were cut short, corrupted or not any known format */
+  unsigned long malformed;
+  unsigned long gaps;
+  unsigned long missing;
+  unsigned long bytes;
+};
+
+/**
+ * Splits one stream's bytes into packets. push() hands each packet to `sink.packet(const Packet&)`
+ * and each gap before one to `sink.gap(int stream, uint64_t nanos, uint32_t missing)`.
+ */
+class StreamDecoder {
+public:
+  enum Framing {
+    TEXT,
+    FRAMES,
+  };
+
+  explicit StreamDecoder(int stream = 0, Framing framing = TEXT) :
+    m_stream(stream), m_framing(framing), m_length(0), m_overflow(false), m_stats() {}
+
+  Framing framing() const {
+    return m_framing;
+  }
+
+  /** Decode `length` bytes that a read returned at `nanos`. */
+  template <typename Sink>
+  void push(const uint8_t* data, size_t length, uint64_t nanos, Sink& sink) {
+    m_stats.bytes += length;
+    for (size_t i = 0; i < length; ++i) {
+      if (m_framing == FRAMES) {
+        pushFrameByte(data[i], nanos, sink);
+      } else {
+        pushTextByte(data[i], nanos, sink);
+      }
+    }
+  }
+
+  const StreamStats& stats() const {
+    return m_stats;
+  }
+
+  const GapDetector& gaps() const {
+    return m_gaps;
+  }
+
+private:
+  int m_stream;
+  Framing m_framing;
+  // One spare for parsePayload()'s terminator
+  char m_line[MAX_LINE + 1];
+  size_t m_length;
+  bool m_overflow;
+  RadioFrameDecoder m_frames;
+  GapDetector m_gaps;
+  StreamStats m_stats;
+  Packet m_packet;
+
+  template <typename Sink>
+  void pushTextByte(uint8_t byte, uint64_t nanos, Sink& sink) {
+    if (byte != '\n') {
+      if (m_length < MAX_LINE) {
+        m_line[m_length++] = static_cast<char>(byte);
+      } else {
+        m_overflow = true;
+      }
+      return;
+    }
+    size_t length = m_length;
+    bool overflow = m_overflow;
+    m_length = 0;
+    m_overflow = false;
+    if (length > 0 && m_line[length - 1] == '\r') {
+      --length;
+    }
+    if (length == 0 && !overflow) {
+      return;
+    }
+    bool valid = !overflow && parseLine(length);
+    // Reports come with the telemetry, not in its place
+    if (!valid || m_packet.kind != REPORT) {
+      noteArrival(nanos, sink);
+    }
+    if (!valid) {
+      ++m_stats.malformed;
+      return;
+    }
+    emit(nanos, sink);
+  }
+
+  template <typename Sink>
+  void pushFrameByte(uint8_t byte, uint64_t nanos, Sink& sink) {
+    unsigned long rejected = m_frames.stats().crcErrors + m_frames.stats().malformed;
+    bool valid = m_frames.push(byte);
+    if (!valid && m_frames.stats().crcErrors + m_frames.stats().malformed == rejected) {
+      return;
+    }
+    noteArrival(nanos, sink);
+    if (!valid) {
+      ++m_stats.malformed;
+      return;
+    }
+    m_packet.kind = m_frames.capsule() == 1 ? CAPSULE_1 : CAPSULE_2;
+    memcpy(m_packet.telemetry, m_frames.telemetry(),
+      m_packet.kind == CAPSULE_1 ? Telemetry::RadioSchema<1>::SIZE : Telemetry::RadioSchema<2>::SIZE);
+    m_packet.hasSequence = true;
+    m_packet.sequence = m_frames.sequence();
+    uint32_t skipped = m_gaps.sequenced(m_packet.sequence);
+    if (skipped > 0) {
+      reportGap(nanos, skipped, sink);
+    }
+    emit(nanos, sink);
+  }
+
+  /** Timing gaps, for streams without sequence numbers */
+  template <typename Sink>
+  void noteArrival(uint64_t nanos, Sink& sink) {
+    uint32_t missing = m_gaps.arrived(nanos);
+    if (missing > 0 && m_framing == TEXT) {
+      reportGap(nanos, missing, sink);
+    }
+  }
+
+  template <typename Sink>
+  void reportGap(uint64_t nanos, uint32_t missing, Sink& sink) {
+    ++m_stats.gaps;
+    m_stats.missing += missing;
+    sink.gap(m_stream, nanos, missing);
+  }
+
+  template <typename Sink>
+  void emit(uint64_t nanos, Sink& sink) {
+    m_packet.receivedNanos = nanos;
+    m_packet.stream = m_stream;
+    ++m_stats.packets[m_packet.kind];
+    sink.packet(m_packet);
+  }
+
+  /** Fill m_packet from the text line in m_line */
+  bool parseLine(size_t length) {
+    size_t commas = 0;
+    for (size_t i = 0; i < length; ++i) {
+      commas += m_line[i] == ',';
+    }
+    m_packet.hasSequence = false;
+    if (m_line[0] >= 'a' && m_line[0] <= 'z') {
+      m_packet.kind = REPORT;
+      return parseReport(length);
+    } else if (commas == Telemetry::RadioSchema<1>::COUNT - 1) {
+      m_packet.kind = CAPSULE_1;
+      return RadioFrame::parseText<1>(m_line, length, m_packet.telemetry);
+    } else if (commas == Telemetry::RadioSchema<2>::COUNT - 1) {
+      m_packet.kind = CAPSULE_2;
+      return RadioFrame::parseText<2>(m_line, length, m_packet.telemetry);
+    } else if (commas == 2) {
+      m_packet.kind = PAYLOAD;
+      return parsePayload(length);
+    }
+    return false;
+  }
+
+  bool parseReport(size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+      if (m_line[i] < ' ' || m_line[i] > '~') {
+        return false;
+      }
+    }
+    memcpy(m_packet.report, m_line, length);
+    m_packet.report[length] = '\0';
+    return true;
+  }
+
+  bool parsePayload(size_t length) {
+    char* end;
+    char* field = m_line;
+    m_line[length] = '\0';
+    long altitude = strtol(field, &end, 10);
+    if (end == field || *end != ',') {
+      return false;
+    }
+    field = end + 1;
+    long pressure = strtol(field, &end, 10);
+    if (end == field || *end != ',') {
+      return false;
+    }
+    field = end + 1;
+    if ((field[0] != '0' && field[0] != '1') || field[1] != '\0') {
+      return false;
+    }
+    m_packet.altitude = static_cast<int32_t>(altitude);
+    m_packet.tankPressure = static_cast<int32_t>(pressure);
+    // The board sends 0 once it has ejected
+    m_packet.ejected = field[0] == '0';
+
+    char canonical[MAX_LINE + 2];
+    int canonicalLength = m_packet.formatText(canonical, sizeof canonical);
+    return canonicalLength == static_cast<int>(length) + 1 && memcmp(canonical, m_line, length) == 0;
+  }
+};
+
+/** A serial device (or pseudo-terminal) to read */
+struct Device {
+  const char* path;
+  StreamDecoder::Framing framing;
+  /** 0 leaves the line speed alone */
+  unsigned baud;
+};
+
+/** termios speed for `baud`, or B0 if there is none */
+inline speed_t termiosSpeed(unsigned baud) {
+  switch (baud) {
+  case 9600: return B9600;
+  case 19200: return B19200;
+  case 38400: return B38400;
+  case 57600: return B57600;
+  case 115200: return B115200;
+  case 230400: return B230400;
+#ifdef B460800
+  case 460800: return B460800;
+#endif
+#ifdef B921600
+  case 921600: return B921600;
+#endif
+  default: return B0;
+  }
+}
+
+/** Reads up to MAX_DEVICES streams at once, from one thread. */
+class Receiver {
+public:
+  static const size_t MAX_DEVICES = 8;
+  static const size_t READ_SIZE = 4096;
+
+  Receiver() : m_count(0), m_maxDecodeNanos(0) {}
+
+  ~Receiver() {
+    for (size_t i = 0; i < m_count; ++i) {
+      close(m_fds[i].fd);
+    }
+  }
+
+  Receiver(const Receiver&) = delete;
+  Receiver& operator=(const Receiver&) = delete;
+
+  /**
+   * Open a device for reading, raw, at its baud rate if it is a terminal. Its packets are
+   * stream number count() - 1 afterwards.
+   * @return false, with errno set, if it can't be opened or set up.
+   */
+  bool add(const Device& device) {
+    if (m_count == MAX_DEVICES) {
+      errno = EMFILE;
+      return false;
+    }
+    int fd = open(device.path, O_RDONLY | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0) {
+      return false;
+    }
+    if (isatty(fd)) {
+      termios settings;
+      if (tcgetattr(fd, &settings) != 0) {
+        close(fd);
+        return false;
+      }
+      cfmakeraw(&settings);
+      // Whatever has arrived, as soon as it has
+      settings.c_cc[VMIN] = 1;
+      settings.c_cc[VTIME] = 0;
+      settings.c_cflag |= CLOCAL | CREAD;
+      if (device.baud != 0) {
+        speed_t speed = termiosSpeed(device.baud);
+        if (speed == B0) {
+          close(fd);
+          errno = EINVAL;
+          return false;
+        }
+        cfsetispeed(&settings, speed);
+        cfsetospeed(&settings, speed);
+      }
+      if (tcsetattr(fd, TCSANOW, &settings) != 0) {
+        close(fd);
+        return false;
+      }
+    }
+    m_fds[m_count].fd = fd;
+    m_fds[m_count].events = POLLIN;
+    m_decoders[m_count] = StreamDecoder(static_cast<int>(m_count), device.framing);
+    ++m_count;
+    return true;
+  }
+
+  size_t count() const {
+    return m_count;
+  }
+
+  const StreamDecoder& decoder(size_t stream) const {
+    return m_decoders[stream];
+  }
+
+  /** Longest time from a read returning to its bytes being decoded and handed on, ns */
+  uint64_t maxDecodeNanos() const {
+    return m_maxDecodeNanos;
+  }
+
+  /**
+   * Wait up to `timeoutMs` for data and decode whatever has arrived on any device.
+   * @return false once no device is left open (all hung up) or poll() fails.
+   */
+  template <typename Sink>
+  bool poll(int timeoutMs, Sink& sink) {
+    bool anyOpen = false;
+    for (size_t i = 0; i < m_count; ++i) {
+      anyOpen = anyOpen || m_fds[i].fd >= 0;
+    }
+    if (!anyOpen) {
+      return false;
+    }
+    int ready = ::poll(m_fds, m_count, timeoutMs);
+    if (ready < 0) {
+      return errno == EINTR;
+    }
+    for (size_t i = 0; i < m_count && ready > 0; ++i) {
+      if (m_fds[i].revents == 0) {
+        continue;
+      }
+      --ready;
+      ssize_t got = read(m_fds[i].fd, m_buffer, sizeof m_buffer);
+      uint64_t nanos = monotonicNanos();
+      if (got > 0) {
+        m_decoders[i].push(m_buffer, static_cast<size_t>(got), nanos, sink);
+        uint64_t decode = monotonicNanos() - nanos;
+        m_maxDecodeNanos = decode > m_maxDecodeNanos ? decode : m_maxDecodeNanos;
+      } else if (got == 0 || (errno != EAGAIN && errno != EINTR)) {
+        // Hung up: a negative fd is skipped by poll()
+        close(m_fds[i].fd);
+        m_fds[i].fd = -1;
+      }
+    }
+    return true;
+  }
+
+private:
+  pollfd m_fds[MAX_DEVICES];
+  StreamDecoder m_decoders[MAX_DEVICES];
+  size_t m_count;
+  uint64_t m_maxDecodeNanos;
+  uint8_t m_buffer[READ_SIZE];
+};
+
+/**
+ * The merged log: one CSV line per packet or gap, in arrival order.
+ *   seconds,stream,kind,sequence,text    (text being the board's line for the packet)
+ *   seconds,stream,gap,missing,
+ * Seconds count from `startNanos`; the header gives the wall-clock time that was.
+ */
+class LogWriter {
+public:
+  LogWriter(FILE* out, uint64_t startNanos) : m_out(out), m_startNanos(startNanos) {}
+
+  void writeHeader(const Device* devices, size_t count) {
+    char when[32];
+    time_t now = time(nullptr);
+    strftime(when, sizeof when, "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    fprintf(m_out, "# started %s\n", when);
+    for (size_t i = 0; i < count; ++i) {
+      fprintf(m_out, "# stream %zu: %s (%s)\n", i, devices[i].path,
+        devices[i].framing == StreamDecoder::FRAMES ? "binary frames" : "text");
+    }
+    writeColumns<1>("capsule1");
+    writeColumns<2>("capsule2");
+    fprintf(m_out, "# payload: Altitude (AGL),Tank pressure,Not ejected\n");
+    fprintf(m_out, "Seconds,Stream,Kind,Sequence,Fields\n");
+  }
+
+  void packet(const Packet& p) {
+    char text[MAX_LINE + 2];
+    int length = p.formatText(text, sizeof text);
+    if (length > 0 && text[length - 1] == '\n') {
+      text[length - 1] = '\0';
+    }
+    char sequence[8] = "";
+    if (p.hasSequence) {
+      snprintf(sequence, sizeof sequence, "%u", static_cast<unsigned>(p.sequence));
+    }
+    fprintf(m_out, "%.6f,%d,%s,%s,%s\n", seconds(p.receivedNanos), p.stream, kindName(p.kind), sequence, text);
+  }
+
+  void gap(int stream, uint64_t nanos, uint32_t missing) {
+    fprintf(m_out, "%.6f,%d,gap,%u,\n", seconds(nanos), stream, static_cast<unsigned>(missing));
+  }
+
+private:
+  FILE* m_out;
+  uint64_t m_startNanos;
+
+  double seconds(uint64_t nanos) const {
+    return static_cast<double>(nanos - m_startNanos) / 1e9;
+  }
+
+  template <int capsule>
+  void writeColumns(const char* kind) {
+    char names[256];
+    Telemetry::TextWriter writer(names, sizeof names);
+    Telemetry::RadioSchema<capsule>::writeNames(writer);
+    writer.finish();
+    fprintf(m_out, "# %s: %s\n", kind, names);
+  }
+};
+
+} // namespace GroundStation
@@ -0,0 +1,63 @@
+/*
+ * BufferBenchmark.cpp
+ *
+ * Feeds the same noisy flight profile through Buffer (incremental) and the original full-rescan
+ * buffer at several window sizes. Reports the per-sample cost of addPoint() + isDecreasing() for
+ * each, and fails if any isDecreasing()/maximum()/minimum() result differs.
+ *
+ * Usage: BufferBenchmark [samples] [noise stdev in ft]
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "bufferBenchmark.h"
+
+std::vector<BufferBenchRunner>& bufferBenchRunners() {
+  static std::vector<BufferBenchRunner> runners;
+  return runners;
+}
+
+int main(int argc, char** argv) {
+  const size_t SAMPLES = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200000;
+  // Same noise level ProcessFlightData injects
+  const float STDEV = argc > 2 ? strtof(argv[2], nullptr) : 1.4432f;
+
+  // Coast to apogee and descend: a parabola over the run, plus barometer noise. Runs of equal
+  // values are included to exercise the tie handling.
+  std::default_random_engine rng(12345);
+  std::normal_distribution<float> gauss(0, STDEV);
+  std::vector<float> samples(SAMPLES);
+  for (size_t i = 0; i < SAMPLES; ++i) {
+    float t = static_cast<float>(i) / SAMPLES;
+    float altitude = 10000.0f - 40000.0f * (t - 0.5f) * (t - 0.5f);
+    samples[i] = (i / 1000) % 7 == 3 ? 5000.0f : altitude + gauss(rng);
+  }
+
+  std::vector<BufferBenchResult> results;
+  for (BufferBenchRunner runner : bufferBenchRunners()) {
+    results.push_back(runner(samples));
+  }
+  std::sort(results.begin(), results.end(), [](const BufferBenchResult& a, const BufferBenchResult& b) {
+    return a.bufferSize < b.bufferSize;
+  });
+
+  printf("%zu samples, noise stdev %.4f ft\n\n", SAMPLES, STDEV);
+  printf("%12s %18s %14s %10s %12s %14s\n", "BUFFER_SIZE", "incremental ns", "scan ns", "speedup",
+         "mismatches", "first trigger");
+  long totalMismatches = 0;
+  for (const BufferBenchResult& r : results) {
+    printf("%12d %18.2f %14.2f %9.1fx %12ld %14ld\n", r.bufferSize, r.incrementalNanos, r.scanNanos,
+           r.scanNanos / r.incrementalNanos, r.mismatches, r.firstDecreasing);
+    totalMismatches += r.mismatches;
+  }
+
+  if (totalMismatches != 0) {
+    printf("\nFAIL: incremental Buffer disagrees with the full scan\n");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -1,97 +1,335 @@
 /*
- * ProcessFlightData.c
+ * ProcessFlightData.cpp
  *
  *  Created on: Mar 4, 2024
  *      Author: sethm
+ *
+ * Monte Carlo replay of recorded flights through the apogee detectors. Every trial adds fresh
+ * barometer noise to one flight, runs it through the payload bay's BELOW_5K -> WATCHING logic, and
+ * notes when each detector fires relative to the true (noise-free) apogee. Trials are spread
+ * over a pool of worker threads. Each trial's noise comes from its own seed, so the results are
+ * the same whatever the thread count.
+ *
+ * Usage: ProcessFlightData [options] flight.csv...
+ * Each CSV row starts with the time in seconds and the altitude in feet, which may be quoted with
+ * thousands separators ("12,345"). Rows that don't start with two numbers (headers) are skipped.
  */
 
-// When uploading to the payload bay micro, change this to true and the other INO to false
-
-#include "bufferCopy.h"
-#include <iostream>
-#include <vector>
-#include <sstream>
-#include <fstream>
-#include <string>
 #include <algorithm>
-#include <ctime>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../flightLog/flightLogReader.h"
+#include "apogeeDetector.h"
 
 using namespace std;
 
+std::vector<ApogeeDetectorInfo>& apogeeDetectors() {
+	static std::vector<ApogeeDetectorInfo> detectors;
+	return detectors;
+}
 
-enum Mode {
-  BELOW_5K,
-  WATCHING,
-  PAST_APOGEE
+namespace {
+
+struct Options {
+	vector<string> flights;
+	long trials = 1000;          // per flight
+	float noise = 1.4432f;       // ft, 1 sigma
+	float spikeRate = 0.0f;      // chance per sample of an outlier
+	float spikeSize = 0.0f;      // ft, 1 sigma of the outliers
+	float watchAltitude = 5000.0f;
+	float earlyMargin = 0.5f;    // s before apogee that still isn't counted as early, as in ApogeeBenchmark
+	unsigned threads = 0;        // 0: one per core
+	uint64_t seed = 1;
+	vector<string> detectors;    // empty: all
+};
+
+struct Flight {
+	string path;
+	vector<float> times;
+	vector<float> altitudes;
+	float apogeeTime;
+	float apogeeAltitude;
+};
+
+/** Per detector and flight: when it fired, relative to apogee, and how often it didn't. */
+struct Outcomes {
+	vector<float> latencies;
+	long early = 0;
+	long missed = 0;
 };
 
-string grabNextField(string& csvLine) {
-	size_t len;
-	string field = "";
-	while (csvLine[0] == '"') {
-		csvLine.erase(0, 2);
-		len = csvLine.find('"');
-		field += csvLine.substr(0, len);
-		csvLine.erase(0, len + 1);
-	}
-	len = csvLine.find(',');
-	field += csvLine.substr(0, len);
-	csvLine.erase(0, len + 1);
-	return field;
+bool loadFlight(const string& path, Flight& flight) {
+	MappedFile file;
+	if (!file.open(path.c_str())) {
+		return false;
+	}
+	flight.path = path;
+	CsvReader csv(file.data(), file.size());
+	CsvField field;
+	while (csv.nextRow()) {
+		float time, altitude;
+		// Header rows don't start with a number
+		if (!csv.nextField(field) || !field.toFloat(time) || !csv.nextField(field) || !field.toFloat(altitude)) {
+			continue;
+		}
+		flight.times.push_back(time);
+		flight.altitudes.push_back(altitude);
+	}
+	if (flight.times.empty()) {
+		return false;
+	}
+	auto highest = max_element(flight.altitudes.begin(), flight.altitudes.end());
+	flight.apogeeAltitude = *highest;
+	flight.apogeeTime = flight.times[highest - flight.altitudes.begin()];
+	return true;
 }
 
-int main() {
-	srand(time(NULL));
-	std::default_random_engine rng(rand());
-	const float STDEV = 1.4432f;
-	std::normal_distribution<float> gauss(0, STDEV);
+/** xoshiro256**, seeded through splitmix64: tiny state, so reseeding for every trial is free. */
+class TrialRng {
+public:
+	typedef uint64_t result_type;
+	static constexpr uint64_t min() { return 0; }
+	static constexpr uint64_t max() { return UINT64_MAX; }
 
-	for (int i = 0; i < 10; ++i) {
-		//get input file to some data structure
-		ifstream data("C:\\Users\\sethm\\OneDrive\\Desktop\\School\\Current_Classes\\Senior_Design\\Technical\\TestingStuff\\newTest.csv");
+	void seed(uint64_t value) {
+		for (uint64_t& word : m_state) {
+			value += 0x9E3779B97F4A7C15ULL;
+			uint64_t z = value;
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+			word = z ^ (z >> 31);
+		}
+	}
 
-		float currTime;
-		float currAlt;
+	uint64_t operator()() {
+		uint64_t result = rotl(m_state[1] * 5, 7) * 9;
+		uint64_t t = m_state[1] << 17;
+		m_state[2] ^= m_state[0];
+		m_state[3] ^= m_state[1];
+		m_state[1] ^= m_state[2];
+		m_state[0] ^= m_state[3];
+		m_state[2] ^= t;
+		m_state[3] = rotl(m_state[3], 45);
+		return result;
+	}
 
-		Buffer bufData;
-		Mode mode = BELOW_5K;
+private:
+	static uint64_t rotl(uint64_t x, int k) {
+		return (x << k) | (x >> (64 - k));
+	}
 
-		string line;
-		while(getline(data,line)){
-			string timeStr = grabNextField(line);
-			currTime = strtof(timeStr.c_str(), NULL);
-			string altStr = grabNextField(line);
-			altStr.erase(std::remove<string::iterator, char>(altStr.begin(), altStr.end(), ','), altStr.end());
-			currAlt = strtof(altStr.c_str(), NULL);
+	uint64_t m_state[4];
+};
 
-			currAlt += gauss(rng);
+/** One trial of one flight through every selected detector. */
+void runTrial(const Flight& flight, const vector<const ApogeeDetectorInfo*>& detectors, const Options& opts,
+							TrialRng& rng, vector<Outcomes*>& outcomes) {
+	normal_distribution<float> gauss(0.0f, 1.0f);
+	uniform_real_distribution<float> uniform(0.0f, 1.0f);
 
-			switch (mode) {
-			case BELOW_5K:
-				if (currAlt >= 9000.0) { //right now below 30.0
-					mode = WATCHING;
-				}
-				break;
-			case WATCHING:
-	//			cout << "Adding point " << currAlt << " at time: " << currTime << endl;
-				bufData.addPoint(currAlt);
-				if (bufData.isDecreasing()) { //If we notice our altitude is decreasing, we've reached apogee
-					cout << "We hit apogee at time " << currTime << endl;
-					mode = PAST_APOGEE; //Put us in 'PAST_APOGEE' mode
-				}
-				break;
-			case PAST_APOGEE:
-				// nothing to do
-				break;
+	size_t count = detectors.size();
+	vector<unique_ptr<ApogeeDetector>> instances;
+	vector<float> fired(count, NAN);
+	for (const ApogeeDetectorInfo* info : detectors) {
+		instances.push_back(info->make());
+	}
+
+	bool watching = false;
+	size_t remaining = count;
+	for (size_t i = 0; i < flight.times.size() && remaining > 0; ++i) {
+		float altitude = flight.altitudes[i] + opts.noise * gauss(rng);
+		if (opts.spikeRate > 0.0f && uniform(rng) < opts.spikeRate) {
+			altitude += opts.spikeSize * gauss(rng);
+		}
+		watching = watching || altitude >= opts.watchAltitude;
+		for (size_t d = 0; d < count; ++d) {
+			if (isnan(fired[d]) && instances[d]->addSample(flight.times[i], altitude, watching)) {
+				fired[d] = flight.times[i];
+				--remaining;
 			}
+		}
+	}
 
+	for (size_t d = 0; d < count; ++d) {
+		Outcomes& o = *outcomes[d];
+		if (isnan(fired[d])) {
+			++o.missed;
+		} else {
+			if (fired[d] < flight.apogeeTime - opts.earlyMargin) {
+				++o.early;
+			}
+			o.latencies.push_back(fired[d] - flight.apogeeTime);
 		}
 	}
+}
+
+float percentile(const vector<float>& sorted, double p) {
+	return sorted.empty() ? NAN : sorted[static_cast<size_t>(p * (sorted.size() - 1))];
+}
+
+void usage() {
+	fprintf(stderr,
+		"Usage: ProcessFlightData [options] flight.csv...\n"
+		"  --trials N          noisy replays of each flight (default 1000)\n"
+		"  --noise FT          Gaussian barometer noise, 1 sigma (default 1.4432)\n"
+		"  --spike-rate P      chance per sample of an outlier on top of the noise (default 0)\n"
+		"  --spike-size FT     outlier size, 1 sigma (default 0)\n"
+		"  --watch-altitude FT altitude at which WATCHING starts (default 5000)\n"
+		"  --early-margin S    firing less than this before apogee isn't counted as early (default 0.5)\n"
+		"  --detectors A,B     detectors to run (default all)\n"
+		"  --threads N         worker threads (default: one per core)\n"
+		"  --seed N            base seed (default 1)\n");
+	fprintf(stderr, "Detectors:\n");
+	for (const ApogeeDetectorInfo& info : apogeeDetectors()) {
+		fprintf(stderr, "  %-14s %s\n", info.name, info.description);
+	}
+}
 
-	return 0;
+bool parseArgs(int argc, char** argv, Options& opts) {
+	for (int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+		if (arg.compare(0, 2, "--") != 0) {
+			opts.flights.push_back(arg);
+			continue;
+		}
+		if (i + 1 >= argc) {
+			return false;
+		}
+		const char* value = argv[++i];
+		if (arg == "--trials") opts.trials = strtol(value, nullptr, 10);
+		else if (arg == "--noise") opts.noise = strtof(value, nullptr);
+		else if (arg == "--spike-rate") opts.spikeRate = strtof(value, nullptr);
+		else if (arg == "--spike-size") opts.spikeSize = strtof(value, nullptr);
+		else if (arg == "--watch-altitude") opts.watchAltitude = strtof(value, nullptr);
+		else if (arg == "--early-margin") opts.earlyMargin = strtof(value, nullptr);
+		else if (arg == "--threads") opts.threads = strtoul(value, nullptr, 10);
+		else if (arg == "--seed") opts.seed = strtoull(value, nullptr, 10);
+		else if (arg == "--detectors") {
+			string list = value;
+			size_t start = 0;
+			while (start <= list.size()) {
+				size_t comma = list.find(',', start);
+				size_t end = comma == string::npos ? list.size() : comma;
+				if (end > start) {
+					opts.detectors.push_back(list.substr(start, end - start));
+				}
+				start = end + 1;
+			}
+		} else {
+			return false;
+		}
+	}
+	return !opts.flights.empty() && opts.trials > 0;
 }
 
+} // namespace
+
+int main(int argc, char** argv) {
+	Options opts;
+	sort(apogeeDetectors().begin(), apogeeDetectors().end(),
+	  [](const ApogeeDetectorInfo& a, const ApogeeDetectorInfo& b) { return strcmp(a.name, b.name) < 0; });
+	if (!parseArgs(argc, argv, opts)) {
+		usage();
+		return EXIT_FAILURE;
+	}
 
+	vector<const ApogeeDetectorInfo*> detectors;
+	for (const ApogeeDetectorInfo& info : apogeeDetectors()) {
+		if (opts.detectors.empty() || find(opts.detectors.begin(), opts.detectors.end(), info.name) != opts.detectors.end()) {
+			detectors.push_back(&info);
+		}
+	}
+	if (detectors.empty()) {
+		fprintf(stderr, "No detectors selected\n");
+		usage();
+		return EXIT_FAILURE;
+	}
 
+	vector<Flight> flights(opts.flights.size());
+	for (size_t f = 0; f < flights.size(); ++f) {
+		if (!loadFlight(opts.flights[f], flights[f])) {
+			fprintf(stderr, "Cannot read a flight from %s\n", opts.flights[f].c_str());
+			return EXIT_FAILURE;
+		}
+	}
 
+	unsigned threadCount = opts.threads != 0 ? opts.threads : max(1u, thread::hardware_concurrency());
+	long totalTrials = opts.trials * static_cast<long>(flights.size());
+	size_t cells = flights.size() * detectors.size();
+
+	// Workers take trial numbers from a shared counter and keep their own tallies, merged at the end
+	atomic<long> nextTrial(0);
+	vector<vector<Outcomes>> perThread(threadCount, vector<Outcomes>(cells));
+	auto worker = [&](unsigned index) {
+		TrialRng rng;
+		vector<Outcomes*> outcomes(detectors.size());
+		for (long trial = nextTrial++; trial < totalTrials; trial = nextTrial++) {
+			size_t f = static_cast<size_t>(trial / opts.trials);
+			for (size_t d = 0; d < detectors.size(); ++d) {
+				outcomes[d] = &perThread[index][f * detectors.size() + d];
+			}
+			rng.seed(opts.seed * 0x100000001B3ULL + static_cast<uint64_t>(trial));
+			runTrial(flights[f], detectors, opts, rng, outcomes);
+		}
+	};
+
+	auto start = chrono::steady_clock::now();
+	vector<thread> pool;
+	for (unsigned i = 0; i < threadCount; ++i) {
+		pool.emplace_back(worker, i);
+	}
+	for (thread& t : pool) {
+		t.join();
+	}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	printf("%ld trials (%ld per flight), noise %.4f ft", totalTrials, opts.trials, opts.noise);
+	if (opts.spikeRate > 0.0f) {
+		printf(" + %.4f%% spikes of %.1f ft", opts.spikeRate * 100.0f, opts.spikeSize);
+	}
+	printf(", %u threads: %.3f s, %.0f trials/s\n", threadCount, seconds, totalTrials / seconds);
+
+	for (size_t f = 0; f < flights.size(); ++f) {
+		const Flight& flight = flights[f];
+		printf("\n%s: %zu samples, apogee %.0f ft at %.3f s\n", flight.path.c_str(), flight.times.size(),
+		  flight.apogeeAltitude, flight.apogeeTime);
+		printf("%-14s %9s %9s %9s %9s %9s %9s %9s %8s %8s\n", "detector", "mean s", "stdev s", "min s", "p5 s",
+		  "median s", "p95 s", "max s", "early %", "missed %");
+		for (size_t d = 0; d < detectors.size(); ++d) {
+			Outcomes merged;
+			for (const vector<Outcomes>& tally : perThread) {
+				const Outcomes& o = tally[f * detectors.size() + d];
+				merged.latencies.insert(merged.latencies.end(), o.latencies.begin(), o.latencies.end());
+				merged.early += o.early;
+				merged.missed += o.missed;
+			}
+			vector<float>& l = merged.latencies;
+			sort(l.begin(), l.end());
+			double mean = 0.0;
+			for (float x : l) {
+				mean += x;
+			}
+			mean = l.empty() ? NAN : mean / l.size();
+			double variance = 0.0;
+			for (float x : l) {
+				variance += (x - mean) * (x - mean);
+			}
+			double stdev = l.size() < 2 ? NAN : sqrt(variance / (l.size() - 1));
+			printf("%-14s %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f %8.2f %8.2f\n", detectors[d]->name, mean, stdev,
+			  percentile(l, 0.0), percentile(l, 0.05), percentile(l, 0.5), percentile(l, 0.95), percentile(l, 1.0),
+			  100.0 * merged.early / opts.trials, 100.0 * merged.missed / opts.trials);
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,36 @@
+/*
+ * apogeeDetector.h
+ *
+ * Pluggable apogee detectors for ProcessFlightData. Each detector lives in its own translation unit
+ * (Buffer.h and bufferCopy.h both define a Buffer sized by the same macro) and adds itself to the
+ * registry at static initialization.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+class ApogeeDetector {
+public:
+  virtual ~ApogeeDetector() = default;
+
+  /**
+   * Feed one altitude sample.
+   * @param seconds Time of the sample, from the flight log.
+   * @param altitude Feet AGL, noise included.
+   * @param watching Whether the flight has reached the altitude where the payload bay starts
+   * watching for apogee (its WATCHING state). A detector may not fire before then.
+   * @return true once the detector has decided apogee has passed.
+   */
+  virtual bool addSample(float seconds, float altitude, bool watching) = 0;
+};
+
+struct ApogeeDetectorInfo {
+  const char* name;
+  const char* description;
+  std::unique_ptr<ApogeeDetector> (*make)();
+};
+
+/** Registry filled by the detector translation units at static initialization. */
+std::vector<ApogeeDetectorInfo>& apogeeDetectors();
@@ -0,0 +1,33 @@
+/*
+ * apogeeFilterDetector.cpp
+ *
+ * ApogeeFilter fed every sample from the pad, firing on its velocity estimate once WATCHING.
+ */
+
+#include <cmath>
+
+#include "apogeeDetector.h"
+
+#include "../../ApogeeFilter.h"
+
+namespace {
+
+class ApogeeFilterDetector : public ApogeeDetector {
+public:
+  bool addSample(float seconds, float altitude, bool watching) override {
+    m_filter.addAltitude(altitude, static_cast<unsigned long>(std::lround(seconds * 1e6)));
+    return watching && m_filter.isPastApogee();
+  }
+
+private:
+  ApogeeFilter m_filter;
+};
+
+std::unique_ptr<ApogeeDetector> make() {
+  return std::unique_ptr<ApogeeDetector>(new ApogeeFilterDetector());
+}
+
+const bool REGISTERED = (apogeeDetectors().push_back(ApogeeDetectorInfo{
+  "ApogeeFilter", "ApogeeFilter.h, Kalman velocity estimate crossing zero", make}), true);
+
+} // namespace
@@ -0,0 +1,23 @@
+/*
+ * bufferBenchmark.h
+ *
+ * Shared declarations for BufferBenchmark. bufferBenchmarkSize.cpp is compiled once per window size
+ * (see CMakeLists.txt) and registers a runner for that BUFFER_SIZE.
+ */
+
+#pragma once
+
+#include <vector>
+
+struct BufferBenchResult {
+  int bufferSize;
+  double incrementalNanos; // per addPoint() + isDecreasing()
+  double scanNanos;        // same, for the original full rescan
+  long mismatches;         // samples where any decision or extreme differed
+  long firstDecreasing;    // index of the first sample where isDecreasing() was true, or -1
+};
+
+typedef BufferBenchResult (*BufferBenchRunner)(const std::vector<float>& samples);
+
+/** Registry filled by the per-size translation units at static initialization. */
+std::vector<BufferBenchRunner>& bufferBenchRunners();
@@ -0,0 +1,67 @@
+/*
+ * bufferBenchmarkSize.cpp
+ *
+ * Compiled once per BUFFER_SIZE. Buffer is sized by a macro, so each copy lives in its own
+ * namespace to keep the class definitions from colliding at link time.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "bufferBenchmark.h"
+
+#define BENCH_CONCAT2(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT2(a, b)
+#define BENCH_NAMESPACE BENCH_CONCAT(bufferSize, BUFFER_SIZE)
+
+namespace BENCH_NAMESPACE {
+
+#include "../../Buffer.h"
+#include "scanBuffer.h"
+
+// Keep the optimizer from discarding the work being timed
+volatile bool g_sink;
+
+template <typename T>
+double timePerSample(const std::vector<float>& samples) {
+  T buffer;
+  bool any = false;
+  auto start = std::chrono::steady_clock::now();
+  for (float sample : samples) {
+    buffer.addPoint(sample);
+    any ^= buffer.isDecreasing();
+  }
+  auto end = std::chrono::steady_clock::now();
+  g_sink = any;
+  return std::chrono::duration<double, std::nano>(end - start).count() / samples.size();
+}
+
+BufferBenchResult run(const std::vector<float>& samples) {
+  BufferBenchResult result{BUFFER_SIZE, 0.0, 0.0, 0, -1};
+
+  // Equivalence: every decision and extreme must match the original scan
+  Buffer incremental;
+  ScanBuffer scan;
+  for (size_t i = 0; i < samples.size(); ++i) {
+    incremental.addPoint(samples[i]);
+    scan.addPoint(samples[i]);
+    bool decreasing = incremental.isDecreasing();
+    if (decreasing != scan.isDecreasing()
+        || incremental.maximum() != scan.maximum()
+        || incremental.minimum() != scan.minimum()) {
+      ++result.mismatches;
+    }
+    if (decreasing && result.firstDecreasing < 0) {
+      result.firstDecreasing = static_cast<long>(i);
+    }
+  }
+
+  result.incrementalNanos = timePerSample<Buffer>(samples);
+  result.scanNanos = timePerSample<ScanBuffer>(samples);
+  return result;
+}
+
+const bool REGISTERED = (bufferBenchRunners().push_back(run), true);
+
+} // namespace
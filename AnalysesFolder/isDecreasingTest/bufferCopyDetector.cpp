@@ -0,0 +1,35 @@
+/*
+ * bufferCopyDetector.cpp
+ *
+ * The detector ProcessFlightData was written against: bufferCopy.h's 20-sample window, which
+ * triggers when more than 40% of consecutive pairs decrease.
+ */
+
+#include "apogeeDetector.h"
+
+#include "bufferCopy.h"
+
+namespace {
+
+class BufferCopyDetector : public ApogeeDetector {
+public:
+  bool addSample(float /*seconds*/, float altitude, bool watching) override {
+    if (!watching) {
+      return false;
+    }
+    m_buffer.addPoint(altitude);
+    return m_buffer.isDecreasing();
+  }
+
+private:
+  Buffer m_buffer;
+};
+
+std::unique_ptr<ApogeeDetector> make() {
+  return std::unique_ptr<ApogeeDetector>(new BufferCopyDetector());
+}
+
+const bool REGISTERED = (apogeeDetectors().push_back(ApogeeDetectorInfo{
+  "bufferCopy", "bufferCopy.h, 20 samples, fires above 40% decreasing", make}), true);
+
+} // namespace
@@ -0,0 +1,35 @@
+/*
+ * bufferDetector.cpp
+ *
+ * The payload bay's original apogee detector: Buffer::isDecreasing() over the samples since
+ * WATCHING began.
+ */
+
+#include "apogeeDetector.h"
+
+#include "../../Buffer.h"
+
+namespace {
+
+class BufferDetector : public ApogeeDetector {
+public:
+  bool addSample(float /*seconds*/, float altitude, bool watching) override {
+    if (!watching) {
+      return false;
+    }
+    m_buffer.addPoint(altitude);
+    return m_buffer.isDecreasing();
+  }
+
+private:
+  Buffer m_buffer;
+};
+
+std::unique_ptr<ApogeeDetector> make() {
+  return std::unique_ptr<ApogeeDetector>(new BufferDetector());
+}
+
+const bool REGISTERED = (apogeeDetectors().push_back(ApogeeDetectorInfo{
+  "Buffer", "Buffer.h, the payload bay's vote over the last 200 samples", make}), true);
+
+} // namespace
@@ -0,0 +1,46 @@
+/*
+ * DecodeRadioFrames.cpp
+ *
+ * Converts a capture of binary radio frames (RADIO_BINARY_FRAMES) into the hex text lines the
+ * board sends in text mode, one per valid frame, and reports corrupted and dropped packets.
+ *
+ * Usage: DecodeRadioFrames [capture.bin] [output.txt]   (defaults: standard in / standard out)
+ */
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "radioFrameDecoder.h"
+
+int main(int argc, char** argv) {
+  if (argc > 3) {
+    fprintf(stderr, "usage: %s [capture.bin] [output.txt]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  FILE* in = argc > 1 ? fopen(argv[1], "rb") : stdin;
+  if (in == nullptr) {
+    perror(argv[1]);
+    return EXIT_FAILURE;
+  }
+  FILE* out = argc > 2 ? fopen(argv[2], "wb") : stdout;
+  if (out == nullptr) {
+    perror(argv[2]);
+    return EXIT_FAILURE;
+  }
+
+  RadioFrameDecoder decoder;
+  char line[96];
+  int c;
+  while ((c = fgetc(in)) != EOF) {
+    if (decoder.push(static_cast<uint8_t>(c))) {
+      decoder.formatText(line, sizeof line);
+      fputs(line, out);
+    }
+  }
+
+  const RadioFrameDecoder::Stats& stats = decoder.stats();
+  fprintf(stderr, "%lu frames, %lu CRC errors, %lu malformed, %lu dropped\n",
+          stats.frames, stats.crcErrors, stats.malformed, stats.dropped);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,248 @@
+/*
+ * RadioFrameBenchmark.cpp
+ *
+ * Compares the hex text radio line with the binary frame for both capsules: bytes per packet, the
+ * packet rate each allows on the 230400-baud link, and host time to build one. Fails unless every
+ * text line matches the one the sketch built with snprintf before TelemetrySchema.h (with the
+ * attitude's angles in place of the gyroscope rates), every decoded frame reproduces the text line
+ * byte for byte, and no randomly corrupted frame gets past the CRC. Past the int16 and int8 fields
+ * the line now saturates instead, which a few edge cases check.
+ *
+ * Usage: RadioFrameBenchmark [packets]
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "radioFrameDecoder.h"
+#include "randomSnapshot.h"
+
+namespace {
+
+// 8N1: ten bits on the wire per byte
+const double LINK_BYTES_PER_SECOND = 230400 / 10.0;
+
+// Keep the optimizer from discarding the work being timed
+volatile size_t g_sink;
+
+// The text line as the sketch built it before TelemetrySchema.h: scaled by hand, then one snprintf
+// (the angles themselves are Attitude.h's, which AttitudeBenchmark checks)
+int16_t referenceDegrees(float rad) {
+  return (int16_t)lroundf(rad * 57.29578F);
+}
+char referenceSign(int n) {
+  return n < 0 ? '-' : '+';
+}
+
+template <int capsule>
+int referenceText(const Telemetry::Snapshot& s, char* out, size_t size) {
+  uint32_t raw = s.timestamp;
+  uint32_t timestampMS = (((raw >> 22 & 0x1F) * 60 + (raw >> 16 & 0x3F)) * 60 + (raw >> 10 & 0x3F)) * 1000 + (raw & 0x3FF);
+  int16_t pitch = referenceDegrees(angleAboutX(s.attitude));
+  int16_t roll = referenceDegrees(angleAboutY(s.attitude));
+  int16_t yaw = referenceDegrees(angleAboutZ(s.attitude));
+  int accelX = s.accelX * 100;
+  int accelY = s.accelY * 100;
+  int accelZ = s.accelZ * 100;
+  int altitude = s.altitude;
+  int length = snprintf(out, size,
+    "%c%08X,%c%08X,%07X,%X,%c%02X,%c%02X,%c%02X,%c%04X,%c%04X,%c%04X,%c%04X\n",
+    referenceSign(s.latitude), (unsigned int)abs(s.latitude),
+    referenceSign(s.longitude), (unsigned int)abs(s.longitude),
+    (unsigned int)timestampMS,
+    s.numSatellites < 15 ? (unsigned int)s.numSatellites : 15U,
+    referenceSign(pitch), (unsigned int)abs(pitch),
+    referenceSign(roll), (unsigned int)abs(roll),
+    referenceSign(yaw), (unsigned int)abs(yaw),
+    referenceSign(accelX), (unsigned int)abs(accelX),
+    referenceSign(accelY), (unsigned int)abs(accelY),
+    referenceSign(accelZ), (unsigned int)abs(accelZ),
+    referenceSign(altitude), (unsigned int)abs(altitude));
+  if (capsule == 1) {
+    return length;
+  }
+  int temperature = s.temperature;
+  return length - 1 + snprintf(out + length - 1, size - length + 1, ",%03X,%c%03X,%02X\n",
+    (unsigned int)(uint16_t)s.vocReading,
+    referenceSign(temperature), (unsigned int)abs(temperature),
+    (unsigned int)(uint8_t)s.humidity);
+}
+
+template <int capsule>
+bool run(size_t packets) {
+  std::mt19937 rng(capsule);
+  std::vector<Telemetry::Snapshot> telemetry(packets);
+  for (auto& t : telemetry) {
+    t = randomSnapshot(rng);
+  }
+
+  // Sizes and equivalence
+  std::vector<uint8_t> stream;
+  size_t textBytes = 0;
+  long mismatches = 0;
+  RadioFrameDecoder decoder;
+  for (size_t i = 0; i < packets; ++i) {
+    char text[96], reference[96];
+    textBytes += RadioFrame::formatText<capsule>(telemetry[i], text, sizeof text);
+    referenceText<capsule>(telemetry[i], reference, sizeof reference);
+
+    uint8_t frame[RadioFrame::maxSize<capsule>()];
+    size_t length = RadioFrame::encode<capsule>(telemetry[i], static_cast<uint16_t>(i), frame);
+    stream.insert(stream.end(), frame, frame + length);
+
+    char decoded[96] = "";
+    bool complete = false;
+    for (size_t j = 0; j < length; ++j) {
+      complete = decoder.push(frame[j]);
+    }
+    if (complete) {
+      decoder.formatText(decoded, sizeof decoded);
+    }
+    if (!complete || decoder.sequence() != static_cast<uint16_t>(i) || strcmp(text, decoded) != 0
+        || strcmp(text, reference) != 0) {
+      ++mismatches;
+    }
+  }
+
+  // Build cost
+  auto start = std::chrono::steady_clock::now();
+  size_t sink = 0;
+  for (const auto& t : telemetry) {
+    char text[96];
+    sink += RadioFrame::formatText<capsule>(t, text, sizeof text);
+  }
+  double textNanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < packets; ++i) {
+    uint8_t frame[RadioFrame::maxSize<capsule>()];
+    sink += RadioFrame::encode<capsule>(telemetry[i], static_cast<uint16_t>(i), frame);
+  }
+  double frameNanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  g_sink = sink;
+
+  // Corruption: flip one to three bits in every frame and count what the receiver accepts
+  std::vector<uint8_t> corrupted = stream;
+  size_t frameStart = 0;
+  for (size_t i = 0; i < corrupted.size(); ++i) {
+    if (corrupted[i] == 0) {
+      int flips = std::uniform_int_distribution<int>(1, 3)(rng);
+      for (int f = 0; f < flips; ++f) {
+        size_t at = std::uniform_int_distribution<size_t>(frameStart, i - 1)(rng);
+        corrupted[at] ^= 1 << std::uniform_int_distribution<int>(0, 7)(rng);
+      }
+      frameStart = i + 1;
+    }
+  }
+  RadioFrameDecoder corruptDecoder;
+  unsigned long undetected = 0;
+  for (uint8_t byte : corrupted) {
+    if (corruptDecoder.push(byte)) {
+      // Accepted: only a problem if it isn't the packet that was sent
+      uint16_t seq = corruptDecoder.sequence();
+      char text[96], sent[96];
+      corruptDecoder.formatText(text, sizeof text);
+      RadioFrame::formatText<capsule>(telemetry[seq % packets], sent, sizeof sent);
+      if (seq >= packets || strcmp(text, sent) != 0) {
+        ++undetected;
+      }
+    }
+  }
+
+  double textSize = double(textBytes) / packets;
+  double frameSize = double(stream.size()) / packets;
+  printf("%8d %8s %12.1f %14.0f %10.1f\n", capsule, "text", textSize, LINK_BYTES_PER_SECOND / textSize,
+         textNanos / packets);
+  printf("%8d %8s %12.1f %14.0f %10.1f   %ld mismatches, %lu/%zu corrupted frames accepted\n", capsule,
+         "binary", frameSize, LINK_BYTES_PER_SECOND / frameSize, frameNanos / packets, mismatches,
+         undetected, packets);
+  return mismatches == 0 && undetected == 0;
+}
+
+/** Field `index` of a text line */
+std::string textField(const char* text, size_t index) {
+  const char* start = text;
+  for (size_t i = 0; i < index; ++i) {
+    start = strchr(start, ',') + 1;
+  }
+  return std::string(start, strcspn(start, ",\n"));
+}
+
+/**
+ * The old line printed accelerations, altitude and temperature past their int16/int8 fields in
+ * full; the schema saturates them. Checks each limit from just inside it to far past it, in the
+ * text line and in the decoded frame.
+ */
+bool saturates() {
+  struct Case {
+    double value;
+    const char* int16;
+    const char* int8;
+  };
+  const Case CASES[] = {
+    {127, "+007F", "+07F"}, {128, "+0080", "+07F"}, {32767, "+7FFF", "+07F"}, {32768, "+7FFF", "+07F"},
+    {1e9, "+7FFF", "+07F"},
+    {-128, "-0080", "-080"}, {-129, "-0081", "-080"}, {-32768, "-8000", "-080"}, {-32769, "-8000", "-080"},
+    {-1e9, "-8000", "-080"},
+  };
+  // Fields of capsule 2's line
+  const size_t ACCEL_X = 7, ALTITUDE = 10, TEMPERATURE = 12;
+  unsigned long failures = 0;
+  for (const Case& c : CASES) {
+    Telemetry::Snapshot s = {};
+    // Half a unit further out, so the float's error can't truncate to the next value in
+    float accel = static_cast<float>((c.value + (c.value < 0 ? -0.5 : 0.5)) / 100);
+    s.accelX = s.accelY = s.accelZ = accel;
+    s.altitude = static_cast<float>(c.value);
+    s.temperature = static_cast<float>(c.value);
+    s.attitude = {1.0F, 0.0F, 0.0F, 0.0F};
+
+    char text[96], decoded[96] = "";
+    RadioFrame::formatText<2>(s, text, sizeof text);
+    uint8_t frame[RadioFrame::maxSize<2>()];
+    size_t length = RadioFrame::encode<2>(s, 0, frame);
+    RadioFrameDecoder decoder;
+    bool complete = false;
+    for (size_t j = 0; j < length; ++j) {
+      complete = decoder.push(frame[j]);
+    }
+    if (complete) {
+      decoder.formatText(decoded, sizeof decoded);
+    }
+    bool good = complete && strcmp(text, decoded) == 0 && textField(text, TEMPERATURE) == c.int8
+      && textField(text, ALTITUDE) == c.int16;
+    for (size_t axis = 0; axis < 3; ++axis) {
+      good = good && textField(text, ACCEL_X + axis) == c.int16;
+    }
+    if (!good) {
+      printf("%.0f saturated wrong: %s", c.value, text);
+      ++failures;
+    }
+  }
+  printf("\nsaturation: %lu/%zu edge cases wrong\n", failures, sizeof CASES / sizeof *CASES);
+  return failures == 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const size_t PACKETS = argc > 1 ? strtoul(argv[1], nullptr, 10) : 65536;
+
+  printf("%zu packets per capsule, 230400 baud 8N1\n\n", PACKETS);
+  printf("%8s %8s %12s %14s %10s\n", "capsule", "format", "bytes", "max packets/s", "host ns");
+  bool ok = run<1>(PACKETS);
+  ok = run<2>(PACKETS) && ok;
+  ok = saturates() && ok;
+
+  if (!ok) {
+    printf("\nFAIL: decoded frames differ from the text lines, corruption went undetected, or a value "
+           "past its field didn't saturate\n");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
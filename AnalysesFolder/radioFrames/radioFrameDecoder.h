@@ -0,0 +1,109 @@
+/*
+ * radioFrameDecoder.h
+ *
+ * Ground-side reassembly of the binary radio frames in RadioFrame.h. Bytes are pushed one at a
+ * time as they arrive; every zero byte ends a frame, so a receiver that starts mid-stream or loses
+ * bytes resynchronizes on the next frame.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "../../RadioFrame.h"
+
+class RadioFrameDecoder {
+public:
+  struct Stats {
+    unsigned long frames;        // valid frames
+    unsigned long crcErrors;     // frames whose CRC did not match
+    unsigned long malformed;     // bad COBS, wrong length or unknown schema
+    unsigned long dropped;       // gaps in the sequence numbers between valid frames
+  };
+
+  RadioFrameDecoder() : m_length(0), m_overflow(false), m_capsule(0), m_sequence(0),
+    m_haveSequence(false), m_stats{0, 0, 0, 0} {}
+
+  /** Returns true if `byte` completed a valid frame, which is then available until the next push. */
+  bool push(uint8_t byte) {
+    if (byte != 0) {
+      if (m_length < sizeof m_encoded) {
+        m_encoded[m_length++] = byte;
+      } else {
+        m_overflow = true;
+      }
+      return false;
+    }
+
+    size_t length = m_length;
+    bool overflow = m_overflow;
+    m_length = 0;
+    m_overflow = false;
+    if (length == 0) {
+      return false;
+    }
+    if (overflow) {
+      ++m_stats.malformed;
+      return false;
+    }
+    return decode(length);
+  }
+
+  /** Capsule (1 or 2) of the last valid frame */
+  int capsule() const { return m_capsule; }
+  uint16_t sequence() const { return m_sequence; }
+
+  /** Telemetry of the last valid frame, as Telemetry::RadioSchema<capsule()> stored it */
+  const uint8_t* telemetry() const { return m_raw + 3; }
+
+  /** The last valid frame as the text line the board sends without RADIO_BINARY_FRAMES. */
+  int formatText(char* out, size_t size) const {
+    return m_capsule == 1 ? RadioFrame::formatStoredText<1>(telemetry(), out, size)
+      : RadioFrame::formatStoredText<2>(telemetry(), out, size);
+  }
+
+  const Stats& stats() const { return m_stats; }
+
+private:
+  bool decode(size_t length) {
+    size_t rawLength = RadioFrame::cobsDecode(m_encoded, length, m_raw, sizeof m_raw);
+    if (rawLength < 5) {
+      ++m_stats.malformed;
+      return false;
+    }
+
+    uint16_t crc = m_raw[rawLength - 2] | (m_raw[rawLength - 1] << 8);
+    if (RadioFrame::crc16(m_raw, rawLength - 2) != crc) {
+      ++m_stats.crcErrors;
+      return false;
+    }
+
+    int capsule = m_raw[0] == RadioFrame::schema(1) ? 1 : m_raw[0] == RadioFrame::schema(2) ? 2 : 0;
+    size_t expected = capsule == 1 ? RadioFrame::rawSize<1>() : RadioFrame::rawSize<2>();
+    if (capsule == 0 || rawLength != expected) {
+      ++m_stats.malformed;
+      return false;
+    }
+
+    uint16_t sequence = m_raw[1] | (m_raw[2] << 8);
+    if (m_haveSequence) {
+      m_stats.dropped += static_cast<uint16_t>(sequence - m_sequence - 1);
+    }
+    m_capsule = capsule;
+    m_sequence = sequence;
+    m_haveSequence = true;
+    ++m_stats.frames;
+    return true;
+  }
+
+  // Comfortably more than RadioFrame::maxSize<2>()
+  uint8_t m_encoded[64];
+  uint8_t m_raw[64];
+  size_t m_length;
+  bool m_overflow;
+  int m_capsule;
+  uint16_t m_sequence;
+  bool m_haveSequence;
+  Stats m_stats;
+};
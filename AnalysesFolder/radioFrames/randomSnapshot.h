@@ -0,0 +1,57 @@
+/*
+ * randomSnapshot.h
+ *
+ * Random telemetry for the host benchmarks that check the log and radio encoders
+ * (RadioFrameBenchmark, GroundStationBenchmark, NumberFormatBenchmark).
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+#include "../../TelemetrySchema.h"
+
+/** Milliseconds since midnight as GPS::Timestamp::rawValue */
+inline uint32_t packTimestamp(uint32_t ms) {
+  return (ms % 1000) | (ms / 1000 % 60) << 10 | (ms / 60000 % 60) << 16 | (ms / 3600000) << 22;
+}
+
+/**
+ * Sensor values anywhere the sensors can report them and every radio field can hold them: the
+ * LSM9DS1's +/-16 g and 2000 dps, altitude within the int16 feet and temperature within the int8
+ * degrees the radio carries, and any attitude.
+ */
+inline Telemetry::Snapshot randomSnapshot(std::mt19937& rng) {
+  auto between = [&](long lo, long hi) { return std::uniform_int_distribution<long>(lo, hi)(rng); };
+  auto real = [&](double lo, double hi) { return static_cast<float>(std::uniform_real_distribution<double>(lo, hi)(rng)); };
+  Telemetry::Snapshot s = {};
+  s.sample = static_cast<uint32_t>(between(0, 4294967295));
+  s.sampleMicros = static_cast<uint32_t>(between(0, 4294967295));
+  s.latitude = between(-900000000, 900000000);
+  s.longitude = between(-1800000000, 1800000000);
+  s.altitudeMSL = real(-100, 15000);
+  s.numSatellites = between(0, 20);
+  s.timestamp = packTimestamp(between(0, 86399999));
+  s.accelX = real(-160, 160);
+  s.accelY = real(-160, 160);
+  s.accelZ = real(-160, 160);
+  s.altitude = real(-200, 32000);
+  s.vocReading = between(0, 1023);
+  s.humidity = real(0, 100);
+  s.temperature = real(-40, 125);
+  s.gyroX = real(-35, 35);
+  s.gyroY = real(-35, 35);
+  s.gyroZ = real(-35, 35);
+  // A normalized 4D Gaussian is uniform over rotations
+  float q[4];
+  float norm2 = 0.0F;
+  for (float& c : q) {
+    c = static_cast<float>(std::normal_distribution<double>()(rng));
+    norm2 += c * c;
+  }
+  float scale = 1.0F / std::sqrt(norm2);
+  s.attitude = {q[0] * scale, q[1] * scale, q[2] * scale, q[3] * scale};
+  return s;
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <math.h>
+
+/**
+ * Altitude, vertical velocity and vertical acceleration estimated from barometer samples and,
+ * where there is an IMU, accelerometer samples. This is a three-state Kalman filter with a
+ * constant-acceleration model. Every call costs the same handful of float operations no matter
+ * how long it has been running.
+ *
+ * Apogee is when the velocity estimate drops through zero. The estimate is smoothed over the whole
+ * flight, so it crosses zero within a few samples of the real apogee even when single samples are
+ * noisy. Buffer::isDecreasing() has to wait until most of its window is past apogee.
+ */
+class ApogeeFilter {
+public:
+  /**
+   * @param[in] altitudeNoise Barometer noise, 1 sigma, in feet.
+   * @param[in] accelNoise Accelerometer noise, 1 sigma, in ft/s^2.
+   * @param[in] jerkNoise How fast the true acceleration can change, as the spectral density of a
+   * random jerk in ft/s^3. Higher follows burnout and drag changes faster but passes more noise.
+   */
+  ApogeeFilter(float altitudeNoise = 3.0F, float accelNoise = 3.0F, float jerkNoise = 1.0F) noexcept :
+    m_state{0.0F, 0.0F, 0.0F},
+    m_covariance{{0.0F}},
+    m_altitudeVariance(altitudeNoise * altitudeNoise),
+    m_accelVariance(accelNoise * accelNoise),
+    m_jerkDensity(jerkNoise * jerkNoise),
+    m_lastMicros(0),
+    m_started(false),
+    m_armed(false) {}
+
+  /**
+   * Add a barometer sample: advance the model to `micros` and correct it with `altitude`.
+   * @param[in] altitude Feet, as Altimeter reports it.
+   * @param[in] micros When the sample was taken, from micros().
+   */
+  void addAltitude(float altitude, unsigned long micros) noexcept {
+    if (!m_started) {
+      start(altitude, micros);
+      return;
+    }
+    advanceTo(micros);
+    correct(0, altitude, m_altitudeVariance);
+  }
+
+  /**
+   * Add an accelerometer sample: advance the model to `micros` and correct it with the measured
+   * acceleration.
+   * @param[in] specificForce What the accelerometer reads along the rocket's long axis, positive
+   * toward the nose, in m/s^2 as IMU reports it. This assumes the rocket is close to vertical, so
+   * at rest the reading is +1 g.
+   * @param[in] micros When the sample was taken, from micros().
+   */
+  void addAcceleration(float specificForce, unsigned long micros) noexcept {
+    if (!m_started) {
+      return;
+    }
+    advanceTo(micros);
+    const float FEET_PER_METER = 3.28084F;
+    const float GRAVITY = 9.80665F;
+    correct(2, (specificForce - GRAVITY) * FEET_PER_METER, m_accelVariance);
+  }
+
+  /** Estimated altitude, feet. */
+  float altitude() const noexcept {
+    return m_state[0];
+  }
+
+  /** Estimated vertical velocity, ft/s, positive up. */
+  float velocity() const noexcept {
+    return m_state[1];
+  }
+
+  /** Estimated vertical acceleration, ft/s^2, positive up. */
+  float acceleration() const noexcept {
+    return m_state[2];
+  }
+
+  /** Seconds until the velocity reaches zero at the current deceleration. Infinite if it won't. */
+  float secondsToApogee() const noexcept {
+    if (m_state[1] <= 0.0F) {
+      return 0.0F;
+    }
+    if (m_state[2] >= 0.0F) {
+      return INFINITY;
+    }
+    return -m_state[1] / m_state[2];
+  }
+
+  /**
+   * Whether the rocket has passed apogee, or will within `leadSeconds`. The filter has to have
+   * seen a real climb first (ARM_VELOCITY), so noise on the pad never counts.
+   */
+  bool isPastApogee(float leadSeconds = 0.0F) const noexcept {
+    return m_armed && secondsToApogee() <= leadSeconds;
+  }
+
+  /** Upward speed, ft/s, the estimate must exceed before isPastApogee() can be true. */
+  static constexpr float ARM_VELOCITY = 100.0F;
+
+private:
+  // Altitude (ft), velocity (ft/s), acceleration (ft/s^2)
+  float m_state[3];
+  float m_covariance[3][3];
+  float m_altitudeVariance;
+  float m_accelVariance;
+  float m_jerkDensity;
+  unsigned long m_lastMicros;
+  bool m_started;
+  bool m_armed;
+
+  void start(float altitude, unsigned long micros) noexcept {
+    m_state[0] = altitude;
+    m_state[1] = 0.0F;
+    m_state[2] = 0.0F;
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) {
+        m_covariance[i][j] = 0.0F;
+      }
+    }
+    m_covariance[0][0] = m_altitudeVariance;
+    m_covariance[1][1] = 1.0F;
+    m_covariance[2][2] = 1.0F;
+    m_lastMicros = micros;
+    m_started = true;
+  }
+
+  /** Predict: x = F x, P = F P F' + Q, for the time since the last sample. */
+  void advanceTo(unsigned long micros) noexcept {
+    float dt = (micros - m_lastMicros) * 1e-6F;
+    m_lastMicros = micros;
+    if (dt <= 0.0F) {
+      return;
+    }
+
+    float halfDt2 = 0.5F * dt * dt;
+    m_state[0] += m_state[1] * dt + m_state[2] * halfDt2;
+    m_state[1] += m_state[2] * dt;
+
+    const float F[3][3] = {
+      {1.0F, dt, halfDt2},
+      {0.0F, 1.0F, dt},
+      {0.0F, 0.0F, 1.0F},
+    };
+    float fp[3][3];
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) {
+        fp[i][j] = F[i][0] * m_covariance[0][j] + F[i][1] * m_covariance[1][j] + F[i][2] * m_covariance[2][j];
+      }
+    }
+    // Continuous white-noise jerk, integrated over dt
+    float dt2 = dt * dt;
+    float dt3 = dt2 * dt;
+    const float Q[3][3] = {
+      {dt3 * dt2 / 20.0F, dt2 * dt2 / 8.0F, dt3 / 6.0F},
+      {dt2 * dt2 / 8.0F, dt3 / 3.0F, dt2 / 2.0F},
+      {dt3 / 6.0F, dt2 / 2.0F, dt},
+    };
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) {
+        m_covariance[i][j] = fp[i][0] * F[j][0] + fp[i][1] * F[j][1] + fp[i][2] * F[j][2]
+          + m_jerkDensity * Q[i][j];
+      }
+    }
+  }
+
+  /** Update with a direct measurement of state `index`. */
+  void correct(int index, float measurement, float variance) noexcept {
+    float innovation = measurement - m_state[index];
+    float s = m_covariance[index][index] + variance;
+    float gain[3];
+    float row[3];
+    for (int i = 0; i < 3; ++i) {
+      gain[i] = m_covariance[i][index] / s;
+      row[i] = m_covariance[index][i];
+    }
+    for (int i = 0; i < 3; ++i) {
+      m_state[i] += gain[i] * innovation;
+      for (int j = 0; j < 3; ++j) {
+        m_covariance[i][j] -= gain[i] * row[j];
+      }
+    }
+    if (m_state[1] > ARM_VELOCITY) {
+      m_armed = true;
+    }
+  }
+};
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * An orientation as a unit quaternion: the rotation from the capsule's axes (the IMU's X, Y and Z)
+ * to the ground's, Z up. The ground's X and Y are wherever the capsule pointed when it started,
+ * since nothing on board measures heading.
+ */
+struct Quaternion {
+  float w;
+  float x;
+  float y;
+  float z;
+};
+
+/**
+ * A first guess at 1/sqrt(value) from the bits of a float, good to 3.5%. The SAMD21 has no FPU, so
+ * this and two Newton steps (fastInvSqrt()) cost a fraction of sqrtf() and a division.
+ */
+inline float invSqrtSeed(float value) noexcept {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof bits);
+  bits = 0x5F375A86 - (bits >> 1);
+  float seed;
+  memcpy(&seed, &bits, sizeof seed);
+  return seed;
+}
+
+/** 1/sqrt(value) for value > 0, to about 5 parts per million, in multiplications only. */
+template <typename T>
+T fastInvSqrt(T value) noexcept {
+  T half = value * 0.5F;
+  T y = T(invSqrtSeed(static_cast<float>(value)));
+  y = y * (1.5F - half * y * y);
+  y = y * (1.5F - half * y * y);
+  return y;
+}
+
+// The angles of an attitude, radians, as the Z-Y-X sequence: turn about Z, then about the new Y,
+// then about the newest X. The capsule's long axis is Z.
+
+/** About X, -pi to pi */
+inline float angleAboutX(const Quaternion& q) noexcept {
+  return atan2f(2.0F * (q.w * q.x + q.y * q.z), 1.0F - 2.0F * (q.x * q.x + q.y * q.y));
+}
+
+/** About Y, -pi/2 to pi/2 */
+inline float angleAboutY(const Quaternion& q) noexcept {
+  float sine = 2.0F * (q.w * q.y - q.z * q.x);
+  return asinf(sine > 1.0F ? 1.0F : sine < -1.0F ? -1.0F : sine);
+}
+
+/** About Z, -pi to pi */
+inline float angleAboutZ(const Quaternion& q) noexcept {
+  return atan2f(2.0F * (q.w * q.z + q.x * q.y), 1.0F - 2.0F * (q.y * q.y + q.z * q.z));
+}
+
+/**
+ * Attitude from the IMU's gyroscope and accelerometer: a quaternion complementary filter (Mahony's).
+ * Each sample turns the attitude by the gyroscope's rates, corrected toward the accelerometer's
+ * "up" with a proportional and an integral term; the integral is the estimated gyroscope bias.
+ *
+ * The accelerometer only shows "up" when it reads about 1 g, so the correction is skipped outside
+ * 0.85-1.15 g: under thrust, in free fall after burnout and through the ejection jolt the attitude
+ * comes from the gyroscope alone, with the bias learned on the pad and under the parachute.
+ *
+ * The SAMD21 has no FPU and every float operation is a library call, so an update is kept to about
+ * 50 multiplications and 40 additions, with no division, square root or trigonometry: the
+ * accelerometer isn't normalized (inside the window that only moves the gains by 15%) and the
+ * quaternion, which only drifts from unit length by rounding, is renormalized to first order.
+ * HostHarness/bench/AttitudeBenchmark.cpp counts them. T is float on the board; the benchmark
+ * instantiates it with a type that counts its operations.
+ */
+template <typename T>
+class BasicAttitudeFilter {
+public:
+  /** Standard gravity, m/s^2 */
+  static constexpr float GRAVITY = 9.80665F;
+  /** The accelerometer corrects the attitude between these many g */
+  static constexpr float LOWEST_G = 0.85F;
+  static constexpr float HIGHEST_G = 1.15F;
+  /** A longer step between samples (the IMU restarted) doesn't turn the attitude */
+  static constexpr float LONGEST_STEP = 0.5F;
+
+  /**
+   * @param[in] proportionalGain How fast the attitude follows the accelerometer, 1/s.
+   * @param[in] integralGain How fast the gyroscope bias estimate follows it, 1/s^2.
+   */
+  BasicAttitudeFilter(float proportionalGain = 1.0F, float integralGain = 0.05F) noexcept :
+    m_q{T(1.0F), T(0.0F), T(0.0F), T(0.0F)},
+    m_bias{T(0.0F), T(0.0F), T(0.0F)},
+    m_kp(proportionalGain / GRAVITY),
+    m_ki(integralGain / GRAVITY),
+    m_started(false) {}
+
+  /**
+   * Add one IMU sample. The first one only sets the tilt, from the accelerometer.
+   * @param[in] gx, gy, gz Angular rates in rad/s, as IMU reports them.
+   * @param[in] ax, ay, az Acceleration in m/s^2, as IMU reports it.
+   * @param[in] dt Seconds since the previous sample.
+   */
+  void update(T gx, T gy, T gz, T ax, T ay, T az, T dt) noexcept {
+    T norm2 = ax * ax + ay * ay + az * az;
+    if (!m_started) {
+      if (norm2 > 0.0F) {
+        start(ax, ay, az, norm2);
+      }
+      return;
+    }
+    if (!(dt > 0.0F) || dt > LONGEST_STEP) {
+      return;
+    }
+
+    const float LOWEST = LOWEST_G * LOWEST_G * GRAVITY * GRAVITY;
+    const float HIGHEST = HIGHEST_G * HIGHEST_G * GRAVITY * GRAVITY;
+    if (norm2 > LOWEST && norm2 < HIGHEST) {
+      // "Up" in the capsule's axes as the attitude has it: the third row of its rotation matrix
+      T ux = 2.0F * (m_q[1] * m_q[3] - m_q[0] * m_q[2]);
+      T uy = 2.0F * (m_q[0] * m_q[1] + m_q[2] * m_q[3]);
+      T uz = m_q[0] * m_q[0] - m_q[1] * m_q[1] - m_q[2] * m_q[2] + m_q[3] * m_q[3];
+
+      // The turn from there to the measured "up", in g (the gains are per g)
+      T ex = ay * uz - az * uy;
+      T ey = az * ux - ax * uz;
+      T ez = ax * uy - ay * ux;
+
+      T integralStep = dt * m_ki;
+      m_bias[0] = m_bias[0] + ex * integralStep;
+      m_bias[1] = m_bias[1] + ey * integralStep;
+      m_bias[2] = m_bias[2] + ez * integralStep;
+      gx = gx + ex * m_kp;
+      gy = gy + ey * m_kp;
+      gz = gz + ez * m_kp;
+    }
+
+    // q += q * (0, g + bias) * dt / 2
+    T half = dt * 0.5F;
+    gx = (gx + m_bias[0]) * half;
+    gy = (gy + m_bias[1]) * half;
+    gz = (gz + m_bias[2]) * half;
+    T w = m_q[0] - m_q[1] * gx - m_q[2] * gy - m_q[3] * gz;
+    T x = m_q[1] + m_q[0] * gx + m_q[2] * gz - m_q[3] * gy;
+    T y = m_q[2] + m_q[0] * gy - m_q[1] * gz + m_q[3] * gx;
+    T z = m_q[3] + m_q[0] * gz + m_q[1] * gy - m_q[2] * gx;
+
+    // One step changes the squared length by (rate * dt / 2)^2. Within 1% of 1, 1/sqrt(n) is
+    // (3 - n) / 2 to 4 parts in 10^5 and the next step takes out the rest; a long step at a high
+    // rate gets the full fastInvSqrt().
+    T length2 = w * w + x * x + y * y + z * z;
+    T scale = length2 > 0.99F && length2 < 1.01F ? 1.5F - 0.5F * length2 : fastInvSqrt(length2);
+    m_q[0] = w * scale;
+    m_q[1] = x * scale;
+    m_q[2] = y * scale;
+    m_q[3] = z * scale;
+  }
+
+  /** Whether there has been a sample to start from */
+  bool started() const noexcept {
+    return m_started;
+  }
+
+  Quaternion attitude() const noexcept {
+    Quaternion q = {
+      static_cast<float>(m_q[0]), static_cast<float>(m_q[1]), static_cast<float>(m_q[2]), static_cast<float>(m_q[3])
+    };
+    return q;
+  }
+
+  /** The gyroscope bias learned so far, rad/s, as the correction added to each axis */
+  void getBias(float* x, float* y, float* z) const noexcept {
+    *x = static_cast<float>(m_bias[0]);
+    *y = static_cast<float>(m_bias[1]);
+    *z = static_cast<float>(m_bias[2]);
+  }
+
+private:
+  /** w, x, y, z */
+  T m_q[4];
+  T m_bias[3];
+  /** The gains, per g of acceleration */
+  float m_kp;
+  float m_ki;
+  bool m_started;
+
+  /** The smallest turn that takes the capsule's Z axis to "up" as the accelerometer reads it. */
+  void start(T ax, T ay, T az, T norm2) noexcept {
+    T scale = fastInvSqrt(norm2);
+    az = az * scale;
+    T w = 1.0F + az, x = ay * scale, y = T(0.0F) - ax * scale;
+    if (az < -0.999F) {
+      // Upside down: half a turn about X
+      w = T(0.0F);
+      x = T(1.0F);
+      y = T(0.0F);
+    }
+    scale = fastInvSqrt(w * w + x * x + y * y);
+    m_q[0] = w * scale;
+    m_q[1] = x * scale;
+    m_q[2] = y * scale;
+    m_q[3] = T(0.0F);
+    m_started = true;
+  }
+};
+
+typedef BasicAttitudeFilter<float> AttitudeFilter;
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "TelemetrySchema.h"
+
+/*
+Layout of the binary SD log, written by SDCard when SD_BINARY_LOG is true. Everything is
+little-endian with no padding, so the same definitions read the file back on a PC
+(AnalysesFolder/binaryLog/DecodeBinaryLog.cpp turns it back into the CSV layout).
+
+A file is a BinaryLogHeader, then `columnsLength` bytes of column names (the same text as the CSV
+header line), then records back to back: each one Telemetry::LogSchema<capsule>::pack()'s fields,
+in the order of the CSV columns.
+
+Bump BINARY_LOG_VERSION whenever a record layout changes.
+*/
+
+const uint8_t BINARY_LOG_VERSION = 3;
+
+struct __attribute__((packed)) BinaryLogHeader {
+  /** Always "BSCL" */
+  char magic[4];
+  uint8_t version;
+  /** 1 or 2, selecting the record layout */
+  uint8_t capsule;
+  uint16_t recordSize;
+  uint16_t columnsLength;
+};
+
+static_assert(sizeof(BinaryLogHeader) == 10, "BinaryLogHeader must not be padded");
+// Version 3 layouts
+static_assert(Telemetry::LogSchema<1>::SIZE == 69, "capsule 1 records changed: bump BINARY_LOG_VERSION");
+static_assert(Telemetry::LogSchema<2>::SIZE == 79, "capsule 2 records changed: bump BINARY_LOG_VERSION");
@@ -4,49 +4,109 @@
 #define BUFFER_SIZE 200
 #endif
 
+static_assert(BUFFER_SIZE >= 2, "Buffer needs at least two samples to compare");
+
+/**
+ * The last BUFFER_SIZE altitude samples. Everything is updated incrementally in addPoint(), so
+ * isDecreasing(), maximum() and minimum() cost the same no matter how large the window is.
+ */
 class Buffer {
 public:
-  constexpr Buffer() noexcept : m_data{0}, m_lastIndex(0) {}
+  constexpr Buffer() noexcept :
+    m_data{0},
+    m_lastIndex(0),
+    m_decCount(0),
+    // The window starts out as all zeroes, and the newest of equal values is the one kept
+    m_maxQueue(BUFFER_SIZE - 1),
+    m_minQueue(BUFFER_SIZE - 1) {}
 
   void addPoint(float value) noexcept {
-    m_data[m_lastIndex] = value;
-    m_lastIndex = (m_lastIndex + 1) % BUFFER_SIZE;
+    // m_lastIndex is the oldest sample, which the new value replaces
+    int oldestIndex = m_lastIndex;
+    int secondIndex = next(oldestIndex);
+    int newestIndex = previous(oldestIndex);
+
+    // The pair (oldest, second oldest) leaves the window and (newest, value) enters it
+    m_decCount += (m_data[newestIndex] > value) - (m_data[oldestIndex] > m_data[secondIndex]);
+
+    // Monotonic queues: drop the outgoing sample if it is the current extreme, then drop every
+    // sample the new value dominates, since none of them can be the extreme again
+    if (m_maxQueue.front() == oldestIndex) {
+      m_maxQueue.popFront();
+    }
+    while (!m_maxQueue.empty() && m_data[m_maxQueue.back()] <= value) {
+      m_maxQueue.popBack();
+    }
+    m_maxQueue.pushBack(oldestIndex);
+
+    if (m_minQueue.front() == oldestIndex) {
+      m_minQueue.popFront();
+    }
+    while (!m_minQueue.empty() && m_data[m_minQueue.back()] >= value) {
+      m_minQueue.popBack();
+    }
+    m_minQueue.pushBack(oldestIndex);
+
+    m_data[oldestIndex] = value;
+    m_lastIndex = secondIndex;
   }
 
   bool isDecreasing() const noexcept {
-    int firstIndex = (m_lastIndex + 1) % BUFFER_SIZE;
-    int prevIndex = firstIndex;
-    int decCount = 0;
-    for (int i = 1; i < BUFFER_SIZE; ++i) {
-      int nextIndex = (firstIndex + i) % BUFFER_SIZE;
-      if (m_data[prevIndex] > m_data[nextIndex]) {
-        ++decCount;
-      }
-      prevIndex = nextIndex;
-    }
+    // Same pairs the original full scan compared: each sample from the second oldest to the newest
+    // against its successor, plus the newest against the oldest.
+    int oldestIndex = m_lastIndex;
+    int secondIndex = next(oldestIndex);
+    int newestIndex = previous(oldestIndex);
+    int decCount = m_decCount
+      - (m_data[oldestIndex] > m_data[secondIndex])
+      + (m_data[newestIndex] > m_data[oldestIndex]);
     return decCount > BUFFER_SIZE/2;
   }
+
   float maximum() const noexcept {
-    float currMax = -INFINITY;
-    for (int i = 0; i < BUFFER_SIZE; ++i) {
-      if (m_data[i] > currMax) {
-        currMax = m_data[i];
-      }
-    }
-    return currMax;
+    return m_data[m_maxQueue.front()];
   }
 
   float minimum() const noexcept {
-    float currMin = INFINITY;
-    for (int i = 0; i < BUFFER_SIZE; ++i) {
-      if (m_data[i] < currMin) {
-        currMin = m_data[i];
-      }
-    }
-    return currMin;
+    return m_data[m_minQueue.front()];
   }
 
 private:
+  // Fixed-capacity double-ended queue of indices into m_data
+  class IndexQueue {
+  public:
+    constexpr explicit IndexQueue(int initial) noexcept : m_indices{initial}, m_head(0), m_count(1) {}
+
+    bool empty() const noexcept { return m_count == 0; }
+    int front() const noexcept { return m_count == 0 ? -1 : m_indices[m_head]; }
+    int back() const noexcept { return m_indices[wrap(m_head + m_count - 1)]; }
+
+    void popFront() noexcept {
+      m_head = wrap(m_head + 1);
+      --m_count;
+    }
+    void popBack() noexcept { --m_count; }
+    void pushBack(int index) noexcept {
+      m_indices[wrap(m_head + m_count)] = index;
+      ++m_count;
+    }
+
+  private:
+    static int wrap(int i) noexcept { return i >= BUFFER_SIZE ? i - BUFFER_SIZE : i; }
+
+    int m_indices[BUFFER_SIZE];
+    int m_head;
+    int m_count;
+  };
+
+  static int next(int i) noexcept { return i == BUFFER_SIZE - 1 ? 0 : i + 1; }
+  static int previous(int i) noexcept { return i == 0 ? BUFFER_SIZE - 1 : i - 1; }
+
   float m_data[BUFFER_SIZE];
+  // Index of the oldest sample, i.e. the next one to be overwritten
   int m_lastIndex;
+  // Number of decreasing neighbour pairs, in order from the oldest sample to the newest
+  int m_decCount;
+  IndexQueue m_maxQueue;
+  IndexQueue m_minQueue;
 };
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * Reads newline-terminated commands from a Stream (the radio) without allocating or waiting. Bytes
+ * are collected into a fixed buffer as they arrive, and a finished line is looked up in the
+ * sketch's table of command names. A partial line just stays in the buffer until the rest comes
+ * in, unlike readStringUntil(), which waits up to the stream timeout for it.
+ *
+ * Lines longer than MAX_LINE_LENGTH can't be a command, so they are discarded and reported as
+ * UNKNOWN. A '\r' just before the '\n' is ignored; one anywhere else is part of the line.
+ */
+class CommandReader {
+public:
+  /** poll() found no complete line. */
+  static const int NONE = -1;
+  /** poll() found a line that isn't in the table. */
+  static const int UNKNOWN = -2;
+  static const size_t MAX_LINE_LENGTH = 15;
+
+  /**
+   * @param[in] stream Where commands arrive. Must be valid for the whole lifetime of the reader.
+   * @param[in] commands Names of the commands; poll() returns their indices. Must be valid for the
+   * whole lifetime of the reader.
+   * @param[in] count Number of entries in `commands`.
+   */
+  CommandReader(Stream& stream, const char* const* commands, size_t count) noexcept :
+    m_stream(stream),
+    m_commands(commands),
+    m_count(count),
+    m_line{0},
+    m_length(0),
+    m_overflow(false) {}
+
+  /**
+   * Take what has arrived, up to the end of the first complete line.
+   * @return The index of the line's command, UNKNOWN if it isn't one, or NONE if no line is
+   * complete yet. Call again for the lines after it.
+   */
+  int poll() {
+    while (m_stream.available() > 0) {
+      int c = m_stream.read();
+      if (c < 0) {
+        break;
+      } else if (c == '\n') {
+        if (m_length > 0 && m_line[m_length - 1] == '\r') {
+          --m_length;
+        }
+        int command = m_overflow || m_length > MAX_LINE_LENGTH ? UNKNOWN : find();
+        m_length = 0;
+        m_overflow = false;
+        return command;
+      } else if (m_length < MAX_LINE_LENGTH + 1) {
+        // One past the longest command, for a '\r' before the '\n'
+        m_line[m_length++] = (char)c;
+      } else {
+        m_overflow = true;
+      }
+    }
+    return NONE;
+  }
+
+  /**
+   * Handle every complete line waiting, for loops that only listen for one command.
+   * @return true if any of them was `command`.
+   */
+  bool received(int command) {
+    bool found = false;
+    int next;
+    while ((next = poll()) != NONE) {
+      found = found || next == command;
+    }
+    return found;
+  }
+
+private:
+  int find() noexcept {
+    m_line[m_length] = '\0';
+    for (size_t i = 0; i < m_count; ++i) {
+      if (strcmp(m_line, m_commands[i]) == 0) {
+        return (int)i;
+      }
+    }
+    return UNKNOWN;
+  }
+
+  Stream& m_stream;
+  const char* const* m_commands;
+  size_t m_count;
+  char m_line[MAX_LINE_LENGTH + 2];
+  size_t m_length;
+  bool m_overflow;
+};
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "TelemetrySchema.h"
+
+/*
+Layout of the compressed SD log, written by SDCard when SD_COMPRESSED_LOG is true. Consecutive rows
+barely change, so instead of whole records this stores how much each value changed.
+
+Each field of Telemetry::LogSchema<capsule> is a channel of integers (Telemetry::Channel): integer
+fields as stored, floats at the resolution their CSV column shows, e.g. hundredths for "%.2f". A
+file is a CompressedLogHeader, then `columnsLength` bytes of column names (the same text as the
+CSV header line), then records:
+- every `keyframeInterval`-th record, starting with the first, is a keyframe: KEYFRAME_MARKER, the
+  record's index in the file as a little-endian uint32, then every channel's value
+- the records in between hold each channel's change since the record before
+Values and changes are zigzag-encoded, so small negative numbers stay small, then written as
+varints: 7 bits per byte, lowest first, with the top bit set on every byte but the last. A
+channel that didn't change costs one byte.
+
+A decoder that loses its place (a corrupted or missing sector) skips ahead to the next keyframe,
+whose index tells it how many records were lost, so one bad sector costs at most the records up to
+the next keyframe, not the rest of the flight (AnalysesFolder/binaryLog/binaryLogDecoder.h).
+
+Bump COMPRESSED_LOG_VERSION whenever the channels or the encoding change.
+*/
+
+const uint8_t COMPRESSED_LOG_VERSION = 3;
+
+struct __attribute__((packed)) CompressedLogHeader {
+  /** Always "BSCZ" */
+  char magic[4];
+  uint8_t version;
+  /** 1 or 2, selecting the channels */
+  uint8_t capsule;
+  uint16_t keyframeInterval;
+  uint16_t columnsLength;
+};
+
+static_assert(sizeof(CompressedLogHeader) == 10, "CompressedLogHeader must not be padded");
+// Version 3 channels
+static_assert(Telemetry::LogSchema<1>::COUNT == 18, "capsule 1 channels changed: bump COMPRESSED_LOG_VERSION");
+static_assert(Telemetry::LogSchema<2>::COUNT == 21, "capsule 2 channels changed: bump COMPRESSED_LOG_VERSION");
+
+namespace CompressedLog {
+
+const uint8_t KEYFRAME_MARKER[4] = { 'B', 'S', 'K', 'F' };
+/** Longest varint of a uint32_t */
+const size_t MAX_VARINT_SIZE = 5;
+
+inline uint32_t zigzag(int32_t value) noexcept {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+inline int32_t unzigzag(uint32_t value) noexcept {
+  return (int32_t)((value >> 1) ^ (0U - (value & 1)));
+}
+
+/** Write `value` as a varint. @return Bytes written, 1 to MAX_VARINT_SIZE. */
+inline size_t putVarint(uint8_t* out, uint32_t value) noexcept {
+  size_t length = 0;
+  while (value >= 0x80) {
+    out[length++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  out[length++] = (uint8_t)value;
+  return length;
+}
+
+/**
+ * Read a varint from `data`, which has `available` bytes.
+ * @return Bytes read, or 0 if it runs past the end or is longer than MAX_VARINT_SIZE.
+ */
+inline size_t getVarint(const uint8_t* data, size_t available, uint32_t* value) noexcept {
+  uint32_t result = 0;
+  for (size_t i = 0; i < available && i < MAX_VARINT_SIZE; ++i) {
+    result |= (uint32_t)(data[i] & 0x7F) << (7 * i);
+    if ((data[i] & 0x80) == 0) {
+      *value = result;
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+/** Turns rows into records, keeping the previous row's channels. */
+template <int capsule>
+class Encoder {
+public:
+  typedef Telemetry::LogSchema<capsule> Schema;
+  static const size_t CHANNELS = Schema::COUNT;
+  /** Longest encode() output: a keyframe with every channel at full length */
+  static const size_t MAX_RECORD_SIZE = sizeof KEYFRAME_MARKER + 4 + CHANNELS * MAX_VARINT_SIZE;
+
+  /**
+   * @param[in] keyframeInterval Records from one keyframe to the next. Longer intervals compress
+   * better; shorter ones lose less to a bad sector.
+   */
+  explicit Encoder(uint16_t keyframeInterval) noexcept :
+    m_keyframeInterval(keyframeInterval > 0 ? keyframeInterval : 1),
+    m_index(0),
+    m_previous{0} {}
+
+  uint16_t keyframeInterval() const noexcept {
+    return m_keyframeInterval;
+  }
+
+  /** Start a new file: the next record is a keyframe with index 0. */
+  void reset() noexcept {
+    m_index = 0;
+  }
+
+  /**
+   * Encode one row.
+   * @param[out] out At least MAX_RECORD_SIZE bytes.
+   * @return Bytes written.
+   */
+  size_t encode(const Telemetry::Snapshot& snapshot, uint8_t* out) noexcept {
+    int32_t channels[CHANNELS];
+    Schema::quantize(snapshot, channels);
+
+    size_t length = 0;
+    bool keyframe = m_index % m_keyframeInterval == 0;
+    if (keyframe) {
+      memcpy(out, KEYFRAME_MARKER, sizeof KEYFRAME_MARKER);
+      length += sizeof KEYFRAME_MARKER;
+      for (int i = 0; i < 4; ++i) {
+        out[length++] = (uint8_t)(m_index >> (8 * i));
+      }
+    }
+    for (size_t i = 0; i < CHANNELS; ++i) {
+      // Unsigned, so the change wraps around instead of overflowing
+      uint32_t value = keyframe ? (uint32_t)channels[i] : (uint32_t)channels[i] - (uint32_t)m_previous[i];
+      length += putVarint(out + length, zigzag((int32_t)value));
+      m_previous[i] = channels[i];
+    }
+    ++m_index;
+    return length;
+  }
+
+private:
+  uint16_t m_keyframeInterval;
+  uint32_t m_index;
+  int32_t m_previous[CHANNELS];
+};
+
+} // namespace CompressedLog
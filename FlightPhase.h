@@ -0,0 +1,157 @@
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+#include "ApogeeFilter.h"
+
+/**
+ * Works out where in the flight the rocket is from barometer samples and, where there is an IMU,
+ * the magnitude of the acceleration it measures. Each sketch keeps its own table of what to do in
+ * each phase (sensor, SD and radio rates); this only decides the phase.
+ *
+ * The phases only move forward:
+ * - PAD until the IMU reads more than LAUNCH_ACCEL for LAUNCH_MICROS, or (without an IMU) the
+ *   estimated climb rate passes ApogeeFilter::ARM_VELOCITY
+ * - BOOST until the rocket, climbing faster than ApogeeFilter::ARM_VELOCITY, starts slowing
+ *   down, or the IMU reads less than BURNOUT_ACCEL: the motor has burnt out
+ * - COAST until ApogeeFilter says the rocket is past apogee
+ * - APOGEE for APOGEE_MICROS, covering ejection and the first part of the fall
+ * - DESCENT until the estimated vertical speed has stayed under LANDED_VELOCITY for LANDED_MICROS
+ * - LANDED
+ */
+class FlightPhase {
+public:
+  enum Phase : uint8_t {
+    PAD,
+    BOOST,
+    COAST,
+    APOGEE,
+    DESCENT,
+    LANDED,
+  };
+  static const uint8_t PHASE_COUNT = LANDED + 1;
+
+  /** Specific force (m/s^2) that counts as the motor firing: 3 g. */
+  static constexpr float LAUNCH_ACCEL = 29.4F;
+  static const unsigned long LAUNCH_MICROS = 50000;
+  /** Less than this (m/s^2) after launch means the motor has burnt out: 0.5 g. */
+  static constexpr float BURNOUT_ACCEL = 4.9F;
+  static const unsigned long APOGEE_MICROS = 2000000;
+  /** ft/s, faster than the filter's noise on the ground and slower than any parachute. */
+  static constexpr float LANDED_VELOCITY = 8.0F;
+  static const unsigned long LANDED_MICROS = 5000000;
+
+  FlightPhase() noexcept :
+    m_filter(),
+    m_phase(PAD),
+    m_phaseStart(0),
+    m_maxAltitude(-INFINITY),
+    m_launchAccelSince(0),
+    m_launchAccel(false),
+    m_stillSince(0),
+    m_still(false) {}
+
+  /**
+   * Add a barometer sample. Call with every new sample from the pad on, since the filter has to
+   * follow the whole flight.
+   * @param[in] altitude Feet, as Altimeter reports it.
+   * @param[in] micros When the sample was taken, from micros().
+   */
+  void addAltitude(float altitude, unsigned long micros) noexcept {
+    m_filter.addAltitude(altitude, micros);
+    if (altitude > m_maxAltitude) {
+      m_maxAltitude = altitude;
+    }
+
+    switch (m_phase) {
+    case PAD:
+      if (m_filter.velocity() > ApogeeFilter::ARM_VELOCITY) {
+        enter(BOOST, micros);
+      }
+      break;
+    case BOOST:
+      // Slowing down while still climbing fast, so it isn't noise on the pad after a bump
+      if (m_filter.velocity() > ApogeeFilter::ARM_VELOCITY && m_filter.acceleration() < 0.0F) {
+        enter(COAST, micros);
+      }
+      break;
+    case COAST:
+      if (m_filter.isPastApogee()) {
+        enter(APOGEE, micros);
+      }
+      break;
+    case APOGEE:
+      if (micros - m_phaseStart >= APOGEE_MICROS) {
+        enter(DESCENT, micros);
+      }
+      break;
+    case DESCENT:
+      if (fabsf(m_filter.velocity()) >= LANDED_VELOCITY) {
+        m_still = false;
+      } else if (!m_still) {
+        m_still = true;
+        m_stillSince = micros;
+      } else if (micros - m_stillSince >= LANDED_MICROS) {
+        enter(LANDED, micros);
+      }
+      break;
+    case LANDED:
+      break;
+    }
+  }
+
+  /**
+   * Add an IMU sample. Only its magnitude is used, so the IMU can be mounted any way round.
+   * @param[in] accelMagnitude m/s^2, as IMU::getMagnitude() reports it.
+   * @param[in] micros When the sample was taken, from micros().
+   */
+  void addAcceleration(float accelMagnitude, unsigned long micros) noexcept {
+    if (m_phase == PAD) {
+      if (accelMagnitude < LAUNCH_ACCEL) {
+        m_launchAccel = false;
+      } else if (!m_launchAccel) {
+        m_launchAccel = true;
+        m_launchAccelSince = micros;
+      } else if (micros - m_launchAccelSince >= LAUNCH_MICROS) {
+        enter(BOOST, micros);
+      }
+    } else if (m_phase == BOOST && accelMagnitude < BURNOUT_ACCEL) {
+      enter(COAST, micros);
+    }
+  }
+
+  Phase phase() const noexcept {
+    return m_phase;
+  }
+
+  /** Highest barometer sample so far, feet. */
+  float maxAltitude() const noexcept {
+    return m_maxAltitude;
+  }
+
+  /** The altitude and velocity estimates the phases are decided from. */
+  const ApogeeFilter& filter() const noexcept {
+    return m_filter;
+  }
+
+  static const char* name(Phase phase) noexcept {
+    static const char* const NAMES[PHASE_COUNT] = { "pad", "boost", "coast", "apogee", "descent", "landed" };
+    return phase < PHASE_COUNT ? NAMES[phase] : "?";
+  }
+
+private:
+  void enter(Phase phase, unsigned long micros) noexcept {
+    m_phase = phase;
+    m_phaseStart = micros;
+  }
+
+  ApogeeFilter m_filter;
+  Phase m_phase;
+  unsigned long m_phaseStart;
+  float m_maxAltitude;
+  unsigned long m_launchAccelSince;
+  bool m_launchAccel;
+  unsigned long m_stillSince;
+  bool m_still;
+};
@@ -0,0 +1,208 @@
+/*
+ * ApogeeBenchmark.cpp
+ *
+ * Replays a flight through the payload bay's apogee logic many times with fresh barometer noise,
+ * and compares Buffer::isDecreasing() against ApogeeFilter (barometer only, and barometer plus
+ * accelerometer). As in payload_bay_micro.ino, samples arrive at 100 Hz and a trigger only counts
+ * once an altitude sample has reached 5000 ft. For each detector it reports how long after the true
+ * apogee it fires (negative is before), how many runs fired while the rocket was still clearly
+ * climbing (false triggers) or never fired, and the host time per sample. Fails if ApogeeFilter
+ * ever false-triggers or misses.
+ *
+ * Usage: ApogeeBenchmark [runs] [trace.csv [row rate]]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "hostsim.h"
+
+#include "ApogeeFilter.h"
+#include "Buffer.h"
+
+namespace {
+
+const double SAMPLE_RATE = 100.0;
+const float WATCH_ALTITUDE = 5000.0F;
+// Accelerometer noise in the same units IMU reports, m/s^2
+const double ACCEL_NOISE = 0.5;
+// Firing this long before apogee counts as a false trigger. Half a second out, the rocket is still
+// climbing at 16 ft/s and is 4 ft below apogee; ejecting any closer than that makes no difference.
+const double FALSE_TRIGGER_SECONDS = 0.5;
+
+struct Sample {
+  unsigned long micros;
+  float altitude;
+  float accel;
+};
+
+enum Detector {
+  BUFFER,
+  FILTER_BARO,
+  FILTER_BARO_ACCEL,
+  DETECTOR_COUNT,
+};
+
+const char* const DETECTOR_NAMES[DETECTOR_COUNT] = {"Buffer", "ApogeeFilter baro", "ApogeeFilter baro+accel"};
+
+/** Seconds at which the detector fired, or NAN if it never did. */
+double detect(Detector detector, const std::vector<Sample>& samples) {
+  Buffer buffer;
+  ApogeeFilter filter;
+  bool watching = false;
+  for (const Sample& s : samples) {
+    if (detector == BUFFER) {
+      if (watching) {
+        buffer.addPoint(s.altitude);
+        if (buffer.isDecreasing()) {
+          return s.micros / 1e6;
+        }
+      }
+    } else {
+      filter.addAltitude(s.altitude, s.micros);
+      if (detector == FILTER_BARO_ACCEL) {
+        filter.addAcceleration(s.accel, s.micros);
+      }
+      if (watching && filter.isPastApogee()) {
+        return s.micros / 1e6;
+      }
+    }
+    watching = watching || s.altitude >= WATCH_ALTITUDE;
+  }
+  return NAN;
+}
+
+// Keep the optimizer from discarding the work being timed
+volatile bool g_sink;
+
+double nanosPerSample(Detector detector, const std::vector<Sample>& samples) {
+  auto start = std::chrono::steady_clock::now();
+  if (detector == BUFFER) {
+    Buffer buffer;
+    bool any = false;
+    for (const Sample& s : samples) {
+      buffer.addPoint(s.altitude);
+      any ^= buffer.isDecreasing();
+    }
+    g_sink = any;
+  } else {
+    ApogeeFilter filter;
+    bool any = false;
+    for (const Sample& s : samples) {
+      filter.addAltitude(s.altitude, s.micros);
+      if (detector == FILTER_BARO_ACCEL) {
+        filter.addAcceleration(s.accel, s.micros);
+      }
+      any ^= filter.isPastApogee();
+    }
+    g_sink = any;
+  }
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / samples.size();
+}
+
+double percentile(std::vector<double> values, double p) {
+  if (values.empty()) {
+    return NAN;
+  }
+  std::sort(values.begin(), values.end());
+  return values[static_cast<size_t>(p * (values.size() - 1))];
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const int RUNS = argc > 1 ? atoi(argv[1]) : 200;
+  if (argc > 2) {
+    hostsim::setTrace(hostsim::loadCsvTrace(argv[2], argc > 3 ? strtod(argv[3], nullptr) : 50.0));
+  } else {
+    hostsim::setTrace(hostsim::makeSyntheticFlight());
+  }
+  const hostsim::Trace& flight = hostsim::trace();
+
+  // True apogee, to the millisecond
+  double apogeeTime = 0.0;
+  double apogeeAltitude = -INFINITY;
+  for (double t = 0.0; t <= flight.duration(); t += 0.001) {
+    double altitude = flight.at(t).altitudeAGL;
+    if (altitude > apogeeAltitude) {
+      apogeeAltitude = altitude;
+      apogeeTime = t;
+    }
+  }
+  printf("Apogee %.0f ft at %.3f s; %d runs per noise level, %.0f Hz samples\n\n", apogeeAltitude, apogeeTime,
+    RUNS, SAMPLE_RATE);
+
+  std::vector<hostsim::FlightSample> truth;
+  for (double t = 0.0; t <= flight.duration(); t += 1.0 / SAMPLE_RATE) {
+    truth.push_back(flight.at(t));
+  }
+
+  // None, what ProcessFlightData injects, and the kind of jitter seen near transonic speeds
+  const float NOISE_LEVELS[] = {0.0F, 1.4432F, 5.0F, 15.0F};
+  std::mt19937 rng(12345);
+  std::normal_distribution<double> gauss(0.0, 1.0);
+  std::vector<Sample> samples(truth.size());
+  bool failed = false;
+
+  printf("%8s %-24s %10s %10s %10s %8s %8s %10s\n", "noise ft", "detector", "mean s", "min s", "max s",
+    "false", "missed", "ns/sample");
+  for (float noise : NOISE_LEVELS) {
+    std::vector<double> latencies[DETECTOR_COUNT];
+    int early[DETECTOR_COUNT] = {0}; // false triggers
+    int missed[DETECTOR_COUNT] = {0};
+    double nanos[DETECTOR_COUNT] = {0.0};
+
+    for (int run = 0; run < RUNS; ++run) {
+      for (size_t i = 0; i < truth.size(); ++i) {
+        samples[i].micros = static_cast<unsigned long>(std::llround(i * 1e6 / SAMPLE_RATE));
+        samples[i].altitude = static_cast<float>(truth[i].altitudeAGL + noise * gauss(rng));
+        samples[i].accel = static_cast<float>(truth[i].accel[2] + ACCEL_NOISE * gauss(rng));
+      }
+      for (int d = 0; d < DETECTOR_COUNT; ++d) {
+        double fired = detect(static_cast<Detector>(d), samples);
+        if (std::isnan(fired)) {
+          ++missed[d];
+        } else {
+          if (fired < apogeeTime - FALSE_TRIGGER_SECONDS) {
+            ++early[d];
+          }
+          latencies[d].push_back(fired - apogeeTime);
+        }
+      }
+      if (run == 0) {
+        for (int d = 0; d < DETECTOR_COUNT; ++d) {
+          nanos[d] = nanosPerSample(static_cast<Detector>(d), samples);
+        }
+      }
+    }
+
+    for (int d = 0; d < DETECTOR_COUNT; ++d) {
+      const std::vector<double>& l = latencies[d];
+      double mean = 0.0;
+      for (double x : l) {
+        mean += x;
+      }
+      mean = l.empty() ? NAN : mean / l.size();
+      printf("%8.2f %-24s %10.3f %10.3f %10.3f %8d %8d %10.1f\n", noise, DETECTOR_NAMES[d], mean,
+        percentile(l, 0.0), percentile(l, 1.0), early[d], missed[d], nanos[d]);
+      // The filter must never false-trigger; Buffer is only reported
+      if (d != BUFFER && (early[d] != 0 || missed[d] != 0)) {
+        failed = true;
+      }
+    }
+    printf("\n");
+  }
+
+  if (failed) {
+    printf("FAIL: ApogeeFilter fired well before apogee or not at all\n");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,431 @@
+/*
+ * AttitudeBenchmark.cpp
+ *
+ * Flies AttitudeFilter (Attitude.h) through a flight whose attitude is known: on the rail, boost,
+ * coast, the ejection tumble, swinging under the parachute and lying on the ground, each at the IMU
+ * rate sketch_oct9a.ino uses for that phase. The gyroscope reads the true rates plus a bias and
+ * noise and the accelerometer the true specific force plus noise, both quantized like the LSM9DS1.
+ * For each phase it reports the worst tilt error (the angle between the true and estimated "up"),
+ * over many runs, for the filter and for the filter without its bias estimate (integral gain 0).
+ *
+ * Then it works out what an update costs the board. The SAMD21's Cortex-M0+ has no FPU, so every
+ * float operation is a libgcc call; the filter is run once more with a scalar type that counts them,
+ * and the counts are priced with per-call cycle estimates (M0P_CYCLES below). That, the host time per
+ * update and the radio's angle conversion are compared with loop()'s deadline for one FIFO drain at
+ * 952 Hz.
+ *
+ * Also checks angleAboutX/Y/Z against the angles of the rotation matrix in double precision.
+ * Fails if the filter's tilt error goes past its limit in any phase, if the angles are off, or if
+ * a full FIFO's updates wouldn't fit.
+ *
+ * Usage: AttitudeBenchmark [runs]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "Attitude.h"
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+const double G = 9.80665;
+const double DEGREES = 180.0 / PI;
+
+// LSM9DS1 at the full scales IMU::initialize() sets
+const double GYRO_LSB = 0.070 / DEGREES;
+const double ACCEL_LSB = 0.732e-3 * G;
+const double GYRO_NOISE = 0.005;
+const double ACCEL_NOISE = 0.05;
+// Turn-on bias, rad/s, well inside the datasheet's +/-30 dps
+const double GYRO_BIAS[3] = {0.020, -0.015, 0.010};
+
+// loop() drains IMU::FIFO_DEPTH samples per pass
+const size_t FIFO_DEPTH = 32;
+const double FULL_RATE = 952.0;
+const double CPU_HZ = 48e6;
+// Reading the FIFO at 400 kHz: a status byte, then 6 bytes per sample from each sensor, 9 bit times
+// per byte with the acknowledge, plus the address and register bytes of the three transactions
+const double FIFO_TRANSFER_SECONDS = (FIFO_DEPTH * 12 + 1 + 3 * 3) * 9 / 400e3;
+// The estimates below are a guess within maybe half again either way; the budget check uses the
+// pessimistic end
+const double ESTIMATE_MARGIN = 1.5;
+// Leave a quarter of the deadline for the altimeter, FlightPhase, the queue and capsule 2's sensors
+const double BUDGET_SHARE = 0.75;
+
+/**
+ * Rough cycles per call of libgcc's single-precision routines on a Cortex-M0+ (Thumb-1, with only a
+ * 32x32->32 multiply), including the call and its operand shuffling.
+ */
+struct M0pCycles {
+  double add;
+  double mul;
+  double compare;
+  // invSqrtSeed(): a shift and a subtraction
+  double seed;
+  // Loads, stores and branches around the calls, and the sketch working out the step (a conversion
+  // and a multiplication), per update
+  double overhead;
+};
+const M0pCycles M0P_CYCLES = {110, 120, 45, 8, 350};
+
+struct Vec {
+  double x, y, z;
+};
+
+struct Quat {
+  double w, x, y, z;
+
+  Quat operator*(const Quat& o) const {
+    return {w * o.w - x * o.x - y * o.y - z * o.z, w * o.x + x * o.w + y * o.z - z * o.y,
+      w * o.y - x * o.z + y * o.w + z * o.x, w * o.z + x * o.y - y * o.x + z * o.w};
+  }
+
+  Quat normalized() const {
+    double n = std::sqrt(w * w + x * x + y * y + z * z);
+    return {w / n, x / n, y / n, z / n};
+  }
+
+  /** A vector in the capsule's axes, in the ground's */
+  Vec rotate(const Vec& v) const {
+    Quat r = *this * Quat{0.0, v.x, v.y, v.z} * Quat{w, -x, -y, -z};
+    return {r.x, r.y, r.z};
+  }
+
+  /** A vector in the ground's axes, in the capsule's */
+  Vec unrotate(const Vec& v) const {
+    return Quat{w, -x, -y, -z}.rotate(v);
+  }
+
+  /** Turned by `rate` (capsule axes, rad/s) for `seconds` */
+  Quat turned(const Vec& rate, double seconds) const {
+    double angle = std::sqrt(rate.x * rate.x + rate.y * rate.y + rate.z * rate.z) * seconds;
+    if (angle < 1e-12) {
+      return *this;
+    }
+    double s = std::sin(angle / 2) * seconds / angle;
+    return (*this * Quat{std::cos(angle / 2), rate.x * s, rate.y * s, rate.z * s}).normalized();
+  }
+};
+
+double dot(const Vec& a, const Vec& b) {
+  return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+/** Degrees between the "up" of two attitudes */
+double tiltError(const Quat& truth, const Quaternion& estimate) {
+  Vec up = truth.unrotate({0, 0, 1});
+  Quat e = {estimate.w, estimate.x, estimate.y, estimate.z};
+  Vec estimatedUp = e.normalized().unrotate({0, 0, 1});
+  return std::acos(std::max(-1.0, std::min(1.0, dot(up, estimatedUp)))) * DEGREES;
+}
+
+enum Phase {
+  PAD,
+  BOOST,
+  COAST,
+  EJECTION,
+  DESCENT,
+  LANDED,
+  PHASE_COUNT,
+};
+
+struct PhaseSpec {
+  const char* name;
+  double seconds;
+  // PHASE_RATES in sketch_oct9a.ino
+  double imuHz;
+  // Worst tilt error allowed, degrees
+  double limit;
+};
+
+// Long enough on the pad for the bias to settle, as it has while the capsule waits for launch. The
+// pad's worst is the first seconds, before it has.
+const PhaseSpec PHASES[PHASE_COUNT] = {
+  {"pad", 120.0, 119.0, 2.0},
+  {"boost", 3.0, 952.0, 2.0},
+  {"coast", 24.0, 952.0, 3.0},
+  {"ejection", 1.0, 952.0, 5.0},
+  {"descent", 60.0, 238.0, 5.0},
+  {"landed", 20.0, 14.9, 3.0},
+};
+
+/**
+ * What the capsule is doing `t` seconds into `phase`: its rates (capsule axes, rad/s) and the
+ * specific force (ground axes, m/s^2; only Z, along the body, where X and Y are NaN)
+ */
+void motion(Phase phase, double t, Vec& rate, Vec& force) {
+  switch (phase) {
+  case PAD:
+    rate = {0, 0, 0};
+    force = {0, 0, G};
+    break;
+  case BOOST:
+    // Spinning up on the fins and weathercocking a little, 8 g of thrust along the body
+    rate = {0.05 * std::sin(3.0 * t), 0.04, 2.0 * t / 3.0};
+    force = {NAN, NAN, 8.0 * G};
+    break;
+  case COAST:
+    // Turning over toward apogee; drag along the body fading out
+    rate = {0.04, 0.015 * std::cos(0.5 * t), 2.0 * std::exp(-t / 10.0)};
+    force = {NAN, NAN, -1.5 * std::exp(-t / 6.0)};
+    break;
+  case EJECTION:
+    // Tumbling, with jolts from the shock cord
+    rate = {3.0 * std::sin(7.0 * t), 2.5 * std::cos(5.0 * t), 4.0 * std::sin(3.0 * t)};
+    force = {20.0 * std::sin(11.0 * t), 15.0 * std::cos(13.0 * t), 30.0 * std::sin(9.0 * t)};
+    break;
+  case DESCENT:
+    // Swinging under the canopy and slowly turning
+    rate = {0.6 * std::cos(2.0 * t), 0.4 * std::sin(1.3 * t), 0.3};
+    force = {0.3 * std::sin(2.0 * t), 0.3 * std::cos(1.3 * t), G};
+    break;
+  case LANDED:
+  default:
+    // Tipping over onto its side
+    rate = {0, t < 1.0 ? 1.4 : 0.0, 0};
+    force = {0, 0, G};
+    break;
+  }
+}
+
+/** One IMU sample, as the sketch hands it to the filter */
+struct Sample {
+  Phase phase;
+  float gyro[3];
+  float accel[3];
+  float dt;
+  Quat truth;
+};
+
+float quantize(double value, double lsb) {
+  return static_cast<float>(std::round(value / lsb) * lsb);
+}
+
+std::vector<Sample> fly(std::mt19937& rng) {
+  std::normal_distribution<double> gauss(0.0, 1.0);
+  std::vector<Sample> samples;
+  // Leaning 4 degrees on the rail
+  Quat truth = Quat{std::cos(2.0 / DEGREES), std::sin(2.0 / DEGREES), 0.0, 0.0};
+  for (int p = 0; p < PHASE_COUNT; ++p) {
+    Phase phase = static_cast<Phase>(p);
+    double dt = 1.0 / PHASES[p].imuHz;
+    for (double t = 0.0; t < PHASES[p].seconds; t += dt) {
+      Vec rate, force;
+      // The rate halfway through the step turns it exactly
+      motion(phase, t + dt / 2, rate, force);
+      truth = truth.turned(rate, dt);
+      motion(phase, t + dt, rate, force);
+      // Thrust and drag are along the body; the rest is given in ground axes
+      Vec bodyForce = std::isnan(force.x) ? Vec{0, 0, force.z} : truth.unrotate(force);
+
+      Sample s;
+      s.phase = phase;
+      double rates[3] = {rate.x, rate.y, rate.z};
+      double forces[3] = {bodyForce.x, bodyForce.y, bodyForce.z};
+      for (int k = 0; k < 3; ++k) {
+        s.gyro[k] = quantize(rates[k] + GYRO_BIAS[k] + GYRO_NOISE * gauss(rng), GYRO_LSB);
+        s.accel[k] = quantize(forces[k] + ACCEL_NOISE * gauss(rng), ACCEL_LSB);
+      }
+      s.dt = static_cast<float>(dt);
+      s.truth = truth;
+      samples.push_back(s);
+    }
+  }
+  return samples;
+}
+
+/** Worst tilt error in each phase */
+void worstErrors(AttitudeFilter filter, const std::vector<Sample>& samples, double* worst) {
+  for (const Sample& s : samples) {
+    filter.update(s.gyro[0], s.gyro[1], s.gyro[2], s.accel[0], s.accel[1], s.accel[2], s.dt);
+    worst[s.phase] = std::max(worst[s.phase], tiltError(s.truth, filter.attitude()));
+  }
+}
+
+// ---------------------------------------------------------------------------------------------
+// Counting float operations
+
+struct OpCount {
+  uint64_t add;
+  uint64_t mul;
+  uint64_t compare;
+  uint64_t seed;
+
+  double cycles() const {
+    return add * M0P_CYCLES.add + mul * M0P_CYCLES.mul + compare * M0P_CYCLES.compare + seed * M0P_CYCLES.seed
+      + M0P_CYCLES.overhead;
+  }
+};
+
+OpCount g_ops;
+
+/** A float that counts what is done with it */
+class Counted {
+public:
+  Counted(float value = 0.0F) : m_value(value) {}
+
+  // Only fastInvSqrt() takes the float back out, for invSqrtSeed()
+  explicit operator float() const {
+    ++g_ops.seed;
+    return m_value;
+  }
+
+  friend Counted operator+(Counted a, Counted b) {
+    ++g_ops.add;
+    return a.m_value + b.m_value;
+  }
+  friend Counted operator-(Counted a, Counted b) {
+    ++g_ops.add;
+    return a.m_value - b.m_value;
+  }
+  friend Counted operator*(Counted a, Counted b) {
+    ++g_ops.mul;
+    return a.m_value * b.m_value;
+  }
+  friend bool operator<(Counted a, Counted b) {
+    ++g_ops.compare;
+    return a.m_value < b.m_value;
+  }
+  friend bool operator>(Counted a, Counted b) {
+    ++g_ops.compare;
+    return a.m_value > b.m_value;
+  }
+
+private:
+  float m_value;
+};
+
+// ---------------------------------------------------------------------------------------------
+
+/** Largest difference, degrees, between angleAboutX/Y/Z and the rotation matrix's angles */
+double angleError(std::mt19937& rng, size_t count) {
+  std::normal_distribution<double> gauss(0.0, 1.0);
+  double worst = 0.0;
+  for (size_t i = 0; i < count; ++i) {
+    Quat q = Quat{gauss(rng), gauss(rng), gauss(rng), gauss(rng)}.normalized();
+    // Columns of the rotation matrix: the capsule's axes in the ground's
+    Vec xAxis = q.rotate({1, 0, 0});
+    Vec yAxis = q.rotate({0, 1, 0});
+    Vec zAxis = q.rotate({0, 0, 1});
+    double aboutY = -std::asin(std::max(-1.0, std::min(1.0, xAxis.z)));
+    if (std::fabs(aboutY) > 89.5 / DEGREES) {
+      // Gimbal lock: X and Z turn about the same axis and only their sum is defined
+      continue;
+    }
+    double expected[3] = {std::atan2(yAxis.z, zAxis.z), aboutY, std::atan2(xAxis.y, xAxis.x)};
+    Quaternion f = {static_cast<float>(q.w), static_cast<float>(q.x), static_cast<float>(q.y), static_cast<float>(q.z)};
+    double got[3] = {angleAboutX(f), angleAboutY(f), angleAboutZ(f)};
+    for (int k = 0; k < 3; ++k) {
+      double difference = std::fabs(std::remainder(got[k] - expected[k], 2 * PI)) * DEGREES;
+      worst = std::max(worst, difference);
+    }
+  }
+  return worst;
+}
+
+// Keep the optimizer from discarding the work being timed
+volatile float g_sink;
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const int RUNS = argc > 1 ? atoi(argv[1]) : 20;
+  std::mt19937 rng(2024);
+  bool failed = false;
+
+  // Accuracy
+  double filterWorst[PHASE_COUNT] = {0.0};
+  double unbiasedWorst[PHASE_COUNT] = {0.0};
+  std::vector<Sample> samples;
+  for (int run = 0; run < RUNS; ++run) {
+    samples = fly(rng);
+    worstErrors(AttitudeFilter(), samples, filterWorst);
+    worstErrors(AttitudeFilter(1.0F, 0.0F), samples, unbiasedWorst);
+  }
+  printf("Worst tilt error over %d runs, degrees (gyro bias %.3f %.3f %.3f rad/s)\n\n", RUNS, GYRO_BIAS[0],
+    GYRO_BIAS[1], GYRO_BIAS[2]);
+  printf("%-10s %8s %8s %12s %12s %8s\n", "phase", "seconds", "IMU Hz", "filter", "no bias est", "limit");
+  for (int p = 0; p < PHASE_COUNT; ++p) {
+    bool over = filterWorst[p] > PHASES[p].limit;
+    printf("%-10s %8.0f %8.1f %12.2f %12.2f %8.1f%s\n", PHASES[p].name, PHASES[p].seconds, PHASES[p].imuHz,
+      filterWorst[p], unbiasedWorst[p], PHASES[p].limit, over ? "  FAIL" : "");
+    failed = failed || over;
+  }
+
+  // Operations per update, on the last run's samples
+  BasicAttitudeFilter<Counted> counted;
+  OpCount worst = {0, 0, 0, 0};
+  OpCount total = {0, 0, 0, 0};
+  for (const Sample& s : samples) {
+    g_ops = OpCount{0, 0, 0, 0};
+    counted.update(s.gyro[0], s.gyro[1], s.gyro[2], s.accel[0], s.accel[1], s.accel[2], s.dt);
+    if (g_ops.cycles() > worst.cycles()) {
+      worst = g_ops;
+    }
+    total.add += g_ops.add;
+    total.mul += g_ops.mul;
+    total.compare += g_ops.compare;
+    total.seed += g_ops.seed;
+  }
+  double n = static_cast<double>(samples.size());
+  double meanCycles = total.add / n * M0P_CYCLES.add + total.mul / n * M0P_CYCLES.mul
+    + total.compare / n * M0P_CYCLES.compare + total.seed / n * M0P_CYCLES.seed + M0P_CYCLES.overhead;
+  printf("\nFloat operations per update (libgcc calls on the board)\n\n");
+  printf("%-8s %8s %8s %8s %8s %14s\n", "", "add/sub", "mul", "compare", "seed", "M0+ cycles");
+  printf("%-8s %8.1f %8.1f %8.1f %8.2f %14.0f\n", "mean", total.add / n, total.mul / n, total.compare / n,
+    total.seed / n, meanCycles);
+  printf("%-8s %8llu %8llu %8llu %8llu %14.0f\n", "worst", (unsigned long long)worst.add,
+    (unsigned long long)worst.mul, (unsigned long long)worst.compare, (unsigned long long)worst.seed,
+    worst.cycles());
+
+  // Host time
+  AttitudeFilter filter;
+  auto start = std::chrono::steady_clock::now();
+  for (const Sample& s : samples) {
+    filter.update(s.gyro[0], s.gyro[1], s.gyro[2], s.accel[0], s.accel[1], s.accel[2], s.dt);
+  }
+  double updateNanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+  g_sink = filter.attitude().w;
+  start = std::chrono::steady_clock::now();
+  float angles = 0.0F;
+  for (const Sample& s : samples) {
+    Quaternion q = {static_cast<float>(s.truth.w), static_cast<float>(s.truth.x), static_cast<float>(s.truth.y),
+      static_cast<float>(s.truth.z)};
+    angles += angleAboutX(q) + angleAboutY(q) + angleAboutZ(q);
+  }
+  double angleNanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+  g_sink = angles;
+  printf("\nHost: %.1f ns per update, %.1f ns for a radio packet's three angles\n", updateNanos, angleNanos);
+
+  // Budget: one loop() pass drains a full FIFO at the full rate
+  double deadline = FIFO_DEPTH / FULL_RATE;
+  double drain = FIFO_DEPTH * worst.cycles() / CPU_HZ;
+  double pessimistic = drain * ESTIMATE_MARGIN;
+  double budget = deadline * BUDGET_SHARE - FIFO_TRANSFER_SECONDS;
+  printf("\nloop() at %.0f Hz: %.1f ms to drain %zu samples; the I2C transfer takes %.1f ms\n", FULL_RATE,
+    deadline * 1e3, FIFO_DEPTH, FIFO_TRANSFER_SECONDS * 1e3);
+  printf("Attitude updates: %.1f ms at %.0f MHz (%.1f ms with x%.1f margin), %.1f%% of the deadline; "
+    "budget %.1f ms\n", drain * 1e3, CPU_HZ / 1e6, pessimistic * 1e3, ESTIMATE_MARGIN, 100.0 * drain / deadline,
+    budget * 1e3);
+  if (pessimistic > budget) {
+    printf("FAIL: a full FIFO's updates don't fit\n");
+    failed = true;
+  }
+
+  // Angle conversion
+  double angleWorst = angleError(rng, 100000);
+  printf("\nangleAboutX/Y/Z: worst %.4f degrees from the rotation matrix's angles\n", angleWorst);
+  if (angleWorst > 0.01) {
+    printf("FAIL: angles are off\n");
+    failed = true;
+  }
+
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,317 @@
+/*
+ * CardRecoveryBenchmark.cpp
+ *
+ * What a power cut costs, with and without SD_BLOCK_LOG. Logs the synthetic flight through SDCard
+ * in each format on the simulated card, syncing every 2 s (every gps_and_save_loop() pass) or every
+ * 30 s, and notes after each of gps_and_save_loop()'s card calls how much of the log is on the card
+ * and how much of it the directory entry covers.
+ *
+ * The power is then cut at a series of those points. A plain log keeps what the directory entry
+ * covers. For a block log, the benchmark makes a card image as the card would be: the log's blocks
+ * scattered cluster by cluster among the blocks of an older, deleted log, garbage and empty space,
+ * with the block being written torn partway through. Then it recovers the log from the image with
+ * AnalysesFolder/cardRecovery. Fails unless every recovered log is exactly the plain log up to the
+ * torn block (less a partial last CSV row), the older log is kept apart, the whole file recovers to
+ * the plain log byte for byte, and syncing every 30 s with blocks loses fewer rows than syncing
+ * every 2 s without.
+ *
+ * Usage: CardRecoveryBenchmark [samples]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "hostsim.h"
+#include "binaryLogDecoder.h"
+#include "cardRecovery.h"
+#include "cardRecoveryBenchmark.h"
+#include "sdLogBenchmark.h"
+
+std::vector<CardRecoveryRunner>& cardRecoveryRunners() {
+  static std::vector<CardRecoveryRunner> runners;
+  return runners;
+}
+
+namespace {
+
+// Power cuts per run, spread over the flight
+const size_t CUTS = 16;
+// FAT clusters of 4 KB, the usual size for cards of a few GB
+const size_t CLUSTER_SECTORS = 8;
+
+std::string readFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+const char* formatName(CardRecoveryRun::Format format) {
+  return format == CardRecoveryRun::CSV ? "csv" : format == CardRecoveryRun::BINARY ? "binary" : "compressed";
+}
+
+/** Rows in the start of a log (CSV, binary or compressed) */
+size_t rowsIn(CardRecoveryRun::Format format, const std::string& log) {
+  if (format == CardRecoveryRun::CSV) {
+    size_t lines = std::count(log.begin(), log.end(), '\n');
+    // Less the header
+    return lines > 0 ? lines - 1 : 0;
+  }
+  FILE* in = tmpfile();
+  FILE* out = tmpfile();
+  fwrite(log.data(), 1, log.size(), in);
+  rewind(in);
+  BinaryLogDecodeResult result = decodeBinaryLog(in, out);
+  fclose(in);
+  fclose(out);
+  return result.ok ? result.records : 0;
+}
+
+/** The log carried by the first `count` blocks of a block log file */
+std::string unframe(const std::string& blocks, size_t count) {
+  std::string log;
+  for (size_t i = 0; i < count; ++i) {
+    LogBlockHeader header;
+    memcpy(&header, blocks.data() + i * LogBlock::SIZE, sizeof header);
+    log.append(blocks, i * LogBlock::SIZE + sizeof header, header.length);
+  }
+  return log;
+}
+
+/**
+ * A card on which the power went while block `cut` of the block log `file` was being written:
+ * blocks 0 to cut - 1 and half of block `cut`, a cluster at a time at random places, among an
+ * older log's blocks, garbage and never-written sectors.
+ */
+std::string cardImage(const std::string& file, size_t cut, std::mt19937& rng) {
+  const size_t CLUSTER = CLUSTER_SECTORS * LogBlock::SIZE;
+  size_t fileBlocks = file.size() / LogBlock::SIZE;
+  size_t written = std::min(cut + 1, fileBlocks);
+  size_t fileClusters = (written + CLUSTER_SECTORS - 1) / CLUSTER_SECTORS;
+  size_t staleClusters = std::min(fileClusters, (fileBlocks + CLUSTER_SECTORS - 1) / CLUSTER_SECTORS);
+  size_t junkClusters = fileClusters / 2 + 1;
+  size_t clusters = 2 * fileClusters + staleClusters + junkClusters;
+  std::string image(clusters * CLUSTER, '\0');
+
+  std::vector<size_t> slots(clusters);
+  for (size_t i = 0; i < clusters; ++i) {
+    slots[i] = i;
+  }
+  std::shuffle(slots.begin(), slots.end(), rng);
+  size_t next = 0;
+  auto random = [&](char* data, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+      data[i] = static_cast<char>(rng());
+    }
+  };
+
+  // An earlier flight's log, deleted but never overwritten: same blocks under another file id
+  for (size_t c = 0; c < staleClusters; ++c) {
+    char* cluster = &image[slots[next++] * CLUSTER];
+    for (size_t s = 0; s < CLUSTER_SECTORS && c * CLUSTER_SECTORS + s < fileBlocks; ++s) {
+      uint8_t* sector = reinterpret_cast<uint8_t*>(cluster + s * LogBlock::SIZE);
+      memcpy(sector, file.data() + (c * CLUSTER_SECTORS + s) * LogBlock::SIZE, LogBlock::SIZE);
+      LogBlockHeader header;
+      memcpy(&header, sector, sizeof header);
+      header.fileId ^= 0x5EED;
+      header.crc = LogBlock::checksum(header, sector + sizeof header);
+      memcpy(sector, &header, sizeof header);
+    }
+  }
+  // Garbage, some of it starting like a block
+  for (size_t c = 0; c < junkClusters; ++c) {
+    char* cluster = &image[slots[next++] * CLUSTER];
+    random(cluster, CLUSTER);
+    memcpy(cluster, "BSCB", 4);
+  }
+  // The log
+  for (size_t c = 0; c < fileClusters; ++c) {
+    char* cluster = &image[slots[next++] * CLUSTER];
+    for (size_t s = 0; s < CLUSTER_SECTORS; ++s) {
+      size_t block = c * CLUSTER_SECTORS + s;
+      char* sector = cluster + s * LogBlock::SIZE;
+      if (block < cut) {
+        memcpy(sector, file.data() + block * LogBlock::SIZE, LogBlock::SIZE);
+      } else if (block == cut && block < fileBlocks) {
+        // Torn: the new block over whatever was there, up to halfway through its log bytes (a
+        // block padded at a sync may carry only a few)
+        const char* written = file.data() + block * LogBlock::SIZE;
+        LogBlockHeader header;
+        memcpy(&header, written, sizeof header);
+        size_t torn = sizeof header + header.length / 2;
+        random(sector, LogBlock::SIZE);
+        memcpy(sector, written, torn);
+        sector[torn] = static_cast<char>(~written[torn]);
+      }
+    }
+  }
+  return image;
+}
+
+struct Recovery {
+  bool ok;
+  std::string log;
+  size_t logsFound;
+};
+
+/** Recover the log with the file id of `file`'s first block from `image`. */
+Recovery recover(const std::string& file, const std::string& image, double* scanSeconds) {
+  Recovery recovery = {false, "", 0};
+  LogBlockHeader first;
+  memcpy(&first, file.data(), sizeof first);
+
+  auto start = std::chrono::steady_clock::now();
+  CardRecovery::Scanner scanner;
+  scanner.scan(reinterpret_cast<const uint8_t*>(image.data()), image.size(), 0);
+  std::vector<CardRecovery::FoundLog>& logs = scanner.finish();
+  *scanSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  recovery.logsFound = logs.size();
+
+  for (const CardRecovery::FoundLog& log : logs) {
+    if (log.fileId != first.fileId) {
+      continue;
+    }
+    FILE* out = tmpfile();
+    auto read = [&](uint64_t offset, uint8_t* sector) {
+      memcpy(sector, image.data() + offset, LogBlock::SIZE);
+      return true;
+    };
+    CardRecovery::RebuildResult result = CardRecovery::rebuild(log, read, out);
+    rewind(out);
+    char chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof chunk, out)) > 0) {
+      recovery.log.append(chunk, n);
+    }
+    fclose(out);
+    recovery.ok = result.ok && log.stranded == 0 && log.conflicts == 0;
+  }
+  return recovery;
+}
+
+/** A CSV log up to its last complete row */
+std::string wholeRows(CardRecoveryRun::Format format, const std::string& log) {
+  if (format != CardRecoveryRun::CSV) {
+    return log;
+  }
+  size_t end = log.rfind('\n');
+  return end == std::string::npos ? "" : log.substr(0, end + 1);
+}
+
+struct Losses {
+  size_t total;
+  size_t worst;
+  size_t directoryTotal;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const size_t SAMPLES = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20000;
+  // Also what SDCard's self-test reads its random seed from
+  hostsim::setTrace(hostsim::makeSyntheticFlight());
+  std::vector<Telemetry::Snapshot> samples = syntheticFlight(SAMPLES);
+  std::string directory = (std::filesystem::temp_directory_path() / "card_recovery_bench").string();
+
+  std::vector<CardRecoveryRun> runs;
+  for (CardRecoveryRunner runner : cardRecoveryRunners()) {
+    for (unsigned every : {1U, 15U}) {
+      runs.push_back(runner(samples, every, directory));
+    }
+  }
+  std::sort(runs.begin(), runs.end(), [](const CardRecoveryRun& a, const CardRecoveryRun& b) {
+    return a.format != b.format ? a.format < b.format
+      : a.blocks != b.blocks ? a.blocks < b.blocks : a.syncEveryPasses < b.syncEveryPasses;
+  });
+
+  printf("%zu samples, %zu power cuts per log\n\n", samples.size(), CUTS);
+  printf("%11s %7s %6s %9s %17s %16s %16s %20s\n", "format", "log", "sync", "card us", "worst upkeep us",
+    "rows lost (avg)", "rows lost (max)", "without RecoverLog");
+  std::mt19937 rng(24);
+  bool failed = false;
+  double scanSeconds = 0.0;
+  uint64_t scanBytes = 0;
+  size_t plainWorst[3] = {0, 0, 0};
+  size_t blocksWorst[3] = {0, 0, 0};
+  for (const CardRecoveryRun& run : runs) {
+    const CardRecoveryRun* plain = nullptr;
+    for (const CardRecoveryRun& other : runs) {
+      plain = !other.blocks && other.format == run.format && !other.path.empty() ? &other : plain;
+    }
+    if (run.path.empty() || plain == nullptr || run.checkpoints.empty()) {
+      printf("%11s: NO CARD\n", formatName(run.format));
+      failed = true;
+      continue;
+    }
+    std::string file = readFile(run.path);
+    std::string reference = readFile(plain->path);
+
+    Losses losses = {0, 0, 0};
+    bool exact = true;
+    for (size_t c = 1; c <= CUTS; ++c) {
+      const CardRecoveryRun::Checkpoint& at = run.checkpoints[c * (run.checkpoints.size() - 1) / CUTS];
+      size_t kept, directoryKept;
+      if (!run.blocks) {
+        kept = directoryKept = rowsIn(run.format, file.substr(0, at.directoryBytes));
+      } else {
+        size_t cut = at.fileBytes / LogBlock::SIZE;
+        std::string image = cardImage(file, cut, rng);
+        scanBytes += image.size();
+        Recovery recovery = recover(file, image, &scanSeconds);
+        std::string expected = wholeRows(run.format, unframe(file, cut));
+        bool same = recovery.ok && recovery.logsFound >= 2 && recovery.log == expected
+          && reference.compare(0, expected.size(), expected) == 0;
+        if (!same) {
+          printf("%11s: recovery after %zu blocks doesn't match the plain log\n", formatName(run.format), cut);
+        }
+        exact = exact && same;
+        kept = rowsIn(run.format, recovery.log);
+        directoryKept = rowsIn(run.format, unframe(file, at.directoryBytes / LogBlock::SIZE));
+      }
+      size_t lost = at.samples - std::min(at.samples, kept);
+      losses.total += lost;
+      losses.worst = std::max(losses.worst, lost);
+      losses.directoryTotal += at.samples - std::min(at.samples, directoryKept);
+    }
+    if (run.blocks) {
+      // The whole file, as copied off the card after a clean landing
+      Recovery whole = recover(file, file, &scanSeconds);
+      exact = exact && whole.ok && whole.log == reference;
+      if (!exact) {
+        printf("%11s: recovered block log differs from the plain log\n", formatName(run.format));
+      }
+      failed |= !exact;
+    }
+    if (run.syncEveryPasses == 1 && !run.blocks) {
+      plainWorst[run.format] = losses.worst;
+    } else if (run.syncEveryPasses != 1 && run.blocks) {
+      blocksWorst[run.format] = losses.worst;
+    }
+
+    char without[32] = "-";
+    if (run.blocks) {
+      snprintf(without, sizeof without, "%.1f", double(losses.directoryTotal) / CUTS);
+    }
+    printf("%11s %7s %5us %9.1f %17.0f %16.1f %16zu %20s\n", formatName(run.format), run.blocks ? "blocks" : "plain",
+      run.syncEveryPasses * 2, run.cardMicros, run.worstUpkeepMicros, double(losses.total) / CUTS, losses.worst,
+      without);
+  }
+  for (int format = 0; format < 3; ++format) {
+    failed |= blocksWorst[format] >= plainWorst[format];
+  }
+  printf("\nscanned %.0f MB of card images at %.0f MB/s\n", scanBytes / 1e6, scanBytes / 1e6 / scanSeconds);
+  std::filesystem::remove_all(directory);
+
+  if (failed) {
+    printf("\nFAIL\n");
+    return EXIT_FAILURE;
+  }
+  printf("\nPASS\n");
+  return EXIT_SUCCESS;
+}
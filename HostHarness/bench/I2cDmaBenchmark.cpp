@@ -0,0 +1,351 @@
+/*
+ * I2cDmaBenchmark.cpp
+ *
+ * Capsule 2's sensor reads, one pass per loop(): the blocking Wire reads one bus after another,
+ * against I2cDma.h's transactions, started on all three buses at once and then collected (the
+ * sketch's I2C_DMA). Measures how long each pass waits on the sensors, and how much of the time
+ * the asynchronous transactions keep two or more buses busy at once. Both runs start from the
+ * same sensor state, forked after setup. Fails if the transactions never overlap, the passes
+ * aren't faster, or the readings differ: every IMU sample by sequence number, with none missing,
+ * and every altitude.
+ *
+ * Usage: I2cDmaBenchmark [seconds]
+ */
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#include <Arduino.h>
+
+#include "I2cDma.h"
+#include "altimeter.h"
+#include "humidity.h"
+#include "imu.h"
+
+#include "hostsim.h"
+
+namespace {
+
+// The sketch's loop() takes about this long when the sensors don't hold it up
+const uint64_t PASS_MICROS = 4000;
+// Shortly before launch, so the run covers the boost
+const uint64_t START_MICROS = 9000000;
+
+TwoWire altI2C(&sercom3, 0, 1);
+TwoWire humidityI2C(&sercom1, 8, 9);
+
+Altimeter alt;
+IMU imu(&Wire);
+HumiditySensor hum(&humidityI2C);
+
+I2CBus imuBus(&Wire, 0, 0);
+I2CBus altBus(&altI2C, 3, 1);
+I2CBus humidityBus(&humidityI2C, 1, 2);
+
+struct Run {
+  uint64_t passes = 0;
+  uint64_t totalMicros = 0;
+  uint64_t maxMicros = 0;
+  // Asynchronous runs only: time the transactions held a bus, summed over the buses, and time
+  // two or more buses were busy together
+  uint64_t busMicros = 0;
+  uint64_t overlapMicros = 0;
+  uint32_t failed = 0;
+  std::vector<IMU::Sample> samples;
+  std::vector<float> altitudes;
+  std::vector<float> humidities;
+};
+
+/** Time in `transfers` when at least two buses were busy. */
+uint64_t overlap(const std::vector<hostsim::I2cDmaTransfer>& transfers) {
+  std::vector<std::pair<uint64_t, int>> edges;
+  for (const hostsim::I2cDmaTransfer& transfer : transfers) {
+    edges.emplace_back(transfer.start, 1);
+    edges.emplace_back(transfer.end, -1);
+  }
+  // Ends before starts at the same instant
+  std::sort(edges.begin(), edges.end());
+  uint64_t total = 0;
+  int busy = 0;
+  uint64_t last = 0;
+  for (const auto& edge : edges) {
+    if (busy >= 2) {
+      total += edge.first - last;
+    }
+    busy += edge.second;
+    last = edge.first;
+  }
+  return total;
+}
+
+/** The sketch's reads as they are without I2C_DMA: pollValues(), readFifo(), readAltitude(). */
+void blockingPass(Run& run) {
+  float humidity;
+  if (hum.pollValues(&humidity, nullptr)) {
+    run.humidities.push_back(humidity);
+  }
+  if (!hum.isMeasuring()) {
+    hum.startMeasurement();
+  }
+  IMU::Sample samples[IMU::FIFO_DEPTH];
+  size_t count = imu.readFifo(samples, IMU::FIFO_DEPTH);
+  run.samples.insert(run.samples.end(), samples, samples + count);
+  float altitude;
+  if (alt.readAltitude(&altitude)) {
+    run.altitudes.push_back(altitude);
+  }
+}
+
+/** requestSensorReads(), then the collect calls readAtmospheric() and readAltIMU() make. */
+void asyncPass(Run& run) {
+  hum.requestValues(humidityBus);
+  imu.requestFifo(imuBus, IMU::FIFO_DEPTH);
+  alt.requestAltitude(altBus);
+
+  float humidity;
+  if (hum.collectValues(&humidity, nullptr)) {
+    run.humidities.push_back(humidity);
+  }
+  IMU::Sample samples[IMU::FIFO_DEPTH];
+  size_t count = imu.collectFifo(samples, IMU::FIFO_DEPTH);
+  run.samples.insert(run.samples.end(), samples, samples + count);
+  float altitude;
+  if (alt.collectAltitude(&altitude)) {
+    run.altitudes.push_back(altitude);
+  }
+}
+
+Run runPasses(bool async, uint64_t passes) {
+  Run run;
+  if (async) {
+    imuBus.begin();
+    altBus.begin();
+    humidityBus.begin();
+  }
+  uint64_t next = hostsim::now();
+  for (uint64_t i = 0; i < passes; ++i) {
+    hostsim::advanceTo(next);
+    uint64_t start = hostsim::now();
+    if (async) {
+      asyncPass(run);
+    } else {
+      blockingPass(run);
+    }
+    uint64_t took = hostsim::now() - start;
+    run.totalMicros += took;
+    run.maxMicros = std::max(run.maxMicros, took);
+    ++run.passes;
+    next += PASS_MICROS;
+  }
+  std::vector<hostsim::I2cDmaTransfer> transfers = hostsim::takeI2cDmaTransfers();
+  for (const hostsim::I2cDmaTransfer& transfer : transfers) {
+    run.busMicros += transfer.end - transfer.start;
+  }
+  run.overlapMicros = overlap(transfers);
+  run.failed = imuBus.failed() + altBus.failed();
+  return run;
+}
+
+// Runs go through a pipe from the child that made them
+void writeAll(int fd, const void* data, size_t length) {
+  const char* bytes = static_cast<const char*>(data);
+  while (length > 0) {
+    ssize_t written = write(fd, bytes, length);
+    if (written <= 0) {
+      exit(1);
+    }
+    bytes += written;
+    length -= written;
+  }
+}
+
+bool readAll(int fd, void* data, size_t length) {
+  char* bytes = static_cast<char*>(data);
+  while (length > 0) {
+    ssize_t got = read(fd, bytes, length);
+    if (got <= 0) {
+      return false;
+    }
+    bytes += got;
+    length -= got;
+  }
+  return true;
+}
+
+template <typename T>
+void writeVector(int fd, const std::vector<T>& values) {
+  uint64_t size = values.size();
+  writeAll(fd, &size, sizeof size);
+  writeAll(fd, values.data(), size * sizeof(T));
+}
+
+template <typename T>
+bool readVector(int fd, std::vector<T>& values) {
+  uint64_t size;
+  if (!readAll(fd, &size, sizeof size)) {
+    return false;
+  }
+  values.resize(size);
+  return readAll(fd, values.data(), size * sizeof(T));
+}
+
+/** Run the passes in a child process, so every run starts from the sensors as they are now. */
+bool runForked(bool async, uint64_t passes, Run& run) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return false;
+  }
+  pid_t child = fork();
+  if (child < 0) {
+    return false;
+  }
+  if (child == 0) {
+    close(fds[0]);
+    Run result = runPasses(async, passes);
+    const uint64_t counters[] = {result.passes, result.totalMicros, result.maxMicros, result.busMicros,
+      result.overlapMicros, result.failed};
+    writeAll(fds[1], counters, sizeof counters);
+    writeVector(fds[1], result.samples);
+    writeVector(fds[1], result.altitudes);
+    writeVector(fds[1], result.humidities);
+    _exit(0);
+  }
+  close(fds[1]);
+  uint64_t counters[6];
+  bool ok = readAll(fds[0], counters, sizeof counters) && readVector(fds[0], run.samples)
+    && readVector(fds[0], run.altitudes) && readVector(fds[0], run.humidities);
+  close(fds[0]);
+  int status;
+  waitpid(child, &status, 0);
+  run.passes = counters[0];
+  run.totalMicros = counters[1];
+  run.maxMicros = counters[2];
+  run.busMicros = counters[3];
+  run.overlapMicros = counters[4];
+  run.failed = (uint32_t)counters[5];
+  return ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/** Every sample in sequence, none missing, and the same as the blocking run's with that number. */
+bool checkSamples(const Run& blocking, const Run& async) {
+  for (size_t i = 1; i < async.samples.size(); ++i) {
+    if (async.samples[i].sequence != async.samples[i - 1].sequence + 1) {
+      fprintf(stderr, "IMU samples %lu to %lu missing\n", (unsigned long)async.samples[i - 1].sequence + 1,
+        (unsigned long)async.samples[i].sequence - 1);
+      return false;
+    }
+  }
+  size_t compared = 0;
+  for (const IMU::Sample& sample : async.samples) {
+    auto match = std::lower_bound(blocking.samples.begin(), blocking.samples.end(), sample.sequence,
+      [](const IMU::Sample& s, uint32_t sequence) { return s.sequence < sequence; });
+    if (match == blocking.samples.end() || match->sequence != sample.sequence) {
+      continue;
+    }
+    for (int i = 0; i < 3; ++i) {
+      if (match->accel.data[i] != sample.accel.data[i] || match->gyro.data[i] != sample.gyro.data[i]) {
+        fprintf(stderr, "IMU sample %lu differs\n", (unsigned long)sample.sequence);
+        return false;
+      }
+    }
+    ++compared;
+  }
+  // The async run may end a pass's samples short of the blocking run, never more
+  if (compared + 2 * IMU::FIFO_DEPTH < blocking.samples.size()) {
+    fprintf(stderr, "only %lu of %lu IMU samples to compare\n", (unsigned long)compared,
+      (unsigned long)blocking.samples.size());
+    return false;
+  }
+  return true;
+}
+
+void printRun(const char* name, const Run& run, double seconds) {
+  printf("%-12s %8lu %10.1f %8lu %8lu %10.1f %8lu %8lu\n", name, (unsigned long)run.passes,
+    run.passes > 0 ? (double)run.totalMicros / run.passes : 0.0, (unsigned long)run.maxMicros,
+    (unsigned long)run.samples.size(), run.samples.size() / seconds, (unsigned long)run.altitudes.size(),
+    (unsigned long)run.humidities.size());
+}
+
+} // namespace
+
+// On the board the sketch forwards the DMAC interrupt; here, the host simulation raises it
+extern "C" void DMAC_Handler(void) {
+  I2CBus::onDmaInterrupt();
+}
+
+int main(int argc, char** argv) {
+  double seconds = argc > 1 ? atof(argv[1]) : 10.0;
+  uint64_t passes = (uint64_t)(seconds * 1e6 / PASS_MICROS);
+
+  hostsim::setTrace(hostsim::makeSyntheticFlight());
+  hostsim::advanceTo(START_MICROS);
+  // The sketch's setup: FIFO at the boost rate, altimeter in continuous mode at 100 Hz
+  imu.initialize();
+  imu.startFifo(IMU::ODR_952_HZ);
+  alt.initialize(&altI2C);
+  alt.startContinuous(BMP3_OVERSAMPLING_2X, BMP3_NO_OVERSAMPLING, BMP3_IIR_FILTER_COEFF_1, BMP3_ODR_100_HZ);
+  hum.initialize();
+  if (imu.getStatus() != IMU::ACTIVE || !imu.isFifo() || !alt.isContinuous()
+    || hum.getStatus() != HumiditySensor::ACTIVE) {
+    fprintf(stderr, "sensors didn't start\n");
+    return 1;
+  }
+  // The FIFO overflowed while the others started. Drain it here, so both runs start with it
+  // empty and number the samples the same way
+  IMU::Sample discard[IMU::FIFO_DEPTH];
+  imu.readFifo(discard, IMU::FIFO_DEPTH);
+  float altitude;
+  alt.readAltitude(&altitude);
+
+  Run blocking;
+  Run async;
+  if (!runForked(false, passes, blocking) || !runForked(true, passes, async)) {
+    fprintf(stderr, "a run didn't finish\n");
+    return 1;
+  }
+
+  printf("%-12s %8s %10s %8s %8s %10s %8s %8s\n", "reads", "passes", "mean us", "max us", "IMU", "IMU Hz",
+    "alt", "humid");
+  printRun("blocking", blocking, seconds);
+  printRun("DMA", async, seconds);
+  double meanBlocking = (double)blocking.totalMicros / blocking.passes;
+  double meanAsync = (double)async.totalMicros / async.passes;
+  printf("\nsensor wait per pass: %.0f%% of blocking\n", 100.0 * meanAsync / meanBlocking);
+  printf("DMA bus time %.1f us per pass, %.1f us of it with two or more buses busy\n",
+    (double)async.busMicros / async.passes, (double)async.overlapMicros / async.passes);
+
+  bool ok = true;
+  if (async.overlapMicros == 0) {
+    fprintf(stderr, "no two transactions ran at once\n");
+    ok = false;
+  }
+  if (meanAsync >= meanBlocking || async.totalMicros >= async.busMicros) {
+    fprintf(stderr, "DMA passes waited no less than the reads one after another\n");
+    ok = false;
+  }
+  if (async.failed > 0) {
+    fprintf(stderr, "%lu IMU or altimeter transactions failed\n", (unsigned long)async.failed);
+    ok = false;
+  }
+  ok = checkSamples(blocking, async) && ok;
+  if (async.altitudes != blocking.altitudes) {
+    fprintf(stderr, "altitudes differ: %lu read with DMA, %lu blocking\n", (unsigned long)async.altitudes.size(),
+      (unsigned long)blocking.altitudes.size());
+    ok = false;
+  }
+  if (async.humidities.empty()
+    || std::llabs((long long)async.humidities.size() - (long long)blocking.humidities.size()) > 1) {
+    fprintf(stderr, "%lu humidity measurements with DMA, %lu blocking\n", (unsigned long)async.humidities.size(),
+      (unsigned long)blocking.humidities.size());
+    ok = false;
+  }
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,299 @@
+/*
+ * NumberFormatBenchmark.cpp
+ *
+ * Checks NumberFormat.h against snprintf, byte for byte, on the same inputs:
+ * - every conversion the SD log and radio use (%.1f, %.2f, %.3f, %.5g, %d, %u, %0NX), and the rest of
+ *   NumberFormat's range (%.0f to %.9f, %.1g to %.9g)
+ * - edge cases: zeros, infinities, NaNs, subnormals, FLT_MAX, exact ties and carries
+ * - random bit patterns over the whole float range, and random readings in the sensors' ranges
+ * - whole CSV rows from Telemetry::LogSchema, against the snprintf call SDCard used to make
+ * Then times each conversion and each row both ways. Fails on any mismatch.
+ *
+ * Usage: NumberFormatBenchmark [random inputs per conversion]
+ */
+
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "NumberFormat.h"
+#include "TelemetrySchema.h"
+#include "randomSnapshot.h"
+
+namespace {
+
+// Keep the optimizer from discarding the work being timed
+volatile size_t g_sink;
+
+enum Kind { FIXED, GENERAL };
+
+struct Conversion {
+  Kind kind;
+  unsigned precision;
+};
+
+std::string viaPrintf(const Conversion& c, float value) {
+  char text[64];
+  snprintf(text, sizeof text, c.kind == FIXED ? "%.*f" : "%.*g", (int)c.precision, (double)value);
+  return text;
+}
+
+size_t viaNumberFormat(const Conversion& c, float value, char* out) {
+  return c.kind == FIXED ? NumberFormat::fixed(out, value, c.precision) : NumberFormat::general(out, value, c.precision);
+}
+
+std::string viaNumberFormat(const Conversion& c, float value) {
+  char text[NumberFormat::MAX_FIXED_LENGTH];
+  return std::string(text, viaNumberFormat(c, value, text));
+}
+
+std::string name(const Conversion& c) {
+  return std::string("%.") + std::to_string(c.precision) + (c.kind == FIXED ? "f" : "g");
+}
+
+float fromBits(uint32_t bits) {
+  float value;
+  memcpy(&value, &bits, sizeof value);
+  return value;
+}
+
+std::vector<float> edgeCases() {
+  std::vector<float> values = {
+    0.0F, -0.0F, INFINITY, -INFINITY, NAN, -NAN, FLT_MIN, -FLT_MIN, FLT_MAX, -FLT_MAX,
+    fromBits(1), fromBits(0x80000001), fromBits(0x007FFFFF), FLT_EPSILON,
+    0.5F, 1.5F, 2.5F, 0.125F, 0.375F, 0.0625F, 0.03125F, 9.995F, 9.9995F, 0.05F, 0.005F, 0.0005F,
+    99999.5F, 999995.0F, 9999.95F, 0.999995F, 99.995F, 1e-4F, 9.99995e-5F, 1e-5F, 123456.0F,
+    16777216.0F, 16777217.0F, 4294967296.0F, 9.2233720e18F, 1.8446744e19F, 1e38F, 3.0e38F,
+    9.80665F, -9.81F, 0.001F, -0.0004F, -0.0049F, -0.005F, 5000.0F, 10000.55F, 1e-38F, 1e-45F,
+  };
+  // Powers of two and ten, and the floats either side of them, across the whole range
+  for (int e = -149; e <= 127; ++e) {
+    float p = std::ldexp(1.0F, e);
+    values.push_back(p);
+    values.push_back(std::nextafter(p, 0.0F));
+    values.push_back(std::nextafter(p, INFINITY));
+  }
+  for (int e = -45; e <= 38; ++e) {
+    float p = strtof(("1e" + std::to_string(e)).c_str(), nullptr);
+    values.push_back(p);
+    values.push_back(std::nextafter(p, 0.0F));
+    values.push_back(std::nextafter(p, INFINITY));
+  }
+  return values;
+}
+
+/** Values exactly halfway between two outputs of %.<decimals>f: odd multiples of 2^-(decimals+1) */
+std::vector<float> ties(unsigned decimals, size_t count, std::mt19937& rng) {
+  std::vector<float> values;
+  std::uniform_int_distribution<uint32_t> odd(0, (1U << 22) - 1);
+  for (size_t i = 0; i < count; ++i) {
+    float value = std::ldexp(static_cast<float>(2 * odd(rng) + 1), -(int)decimals - 1);
+    values.push_back(i % 2 == 0 ? value : -value);
+  }
+  return values;
+}
+
+std::vector<float> randomBits(size_t count, std::mt19937& rng) {
+  std::vector<float> values;
+  for (size_t i = 0; i < count; ++i) {
+    values.push_back(fromBits(static_cast<uint32_t>(rng())));
+  }
+  return values;
+}
+
+/** What the logs actually hold: accelerations, rates, altitudes, humidity and temperature */
+std::vector<float> readings(size_t count, std::mt19937& rng) {
+  const double RANGES[][2] = {{-160, 160}, {-3, 3}, {-200, 40000}, {0, 100}, {-40, 85}};
+  std::vector<float> values;
+  for (size_t i = 0; i < count; ++i) {
+    const double* range = RANGES[i % 5];
+    values.push_back(static_cast<float>(std::uniform_real_distribution<double>(range[0], range[1])(rng)));
+  }
+  return values;
+}
+
+long compareFloats(const Conversion& c, const std::vector<float>& values) {
+  long mismatches = 0;
+  for (float value : values) {
+    std::string expected = viaPrintf(c, value);
+    std::string got = viaNumberFormat(c, value);
+    if (expected != got) {
+      if (mismatches < 5) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof bits);
+        printf("  %s of 0x%08X: snprintf \"%s\", NumberFormat \"%s\"\n", name(c).c_str(), bits, expected.c_str(),
+               got.c_str());
+      }
+      ++mismatches;
+    }
+  }
+  return mismatches;
+}
+
+long compareIntegers(size_t count, std::mt19937& rng) {
+  long mismatches = 0;
+  std::vector<uint32_t> values = {0, 1, 9, 10, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFF};
+  for (size_t i = 0; i < count; ++i) {
+    uint32_t value = static_cast<uint32_t>(rng());
+    values.push_back(value >> (i % 32));
+  }
+  for (uint32_t value : values) {
+    char expected[32], got[32];
+    snprintf(expected, sizeof expected, "%d", (int)value);
+    got[NumberFormat::decimal(got, (int32_t)value)] = '\0';
+    mismatches += strcmp(expected, got) != 0;
+    for (unsigned width = 1; width <= 8; ++width) {
+      snprintf(expected, sizeof expected, "%0*X", (int)width, (unsigned)value);
+      got[NumberFormat::hex(got, value, width)] = '\0';
+      mismatches += strcmp(expected, got) != 0;
+    }
+  }
+  return mismatches;
+}
+
+/**
+ * SDCard::writeToCSV()'s row as the one snprintf it was before TelemetrySchema.h, with the sample
+ * columns added since in front, in the same 192-byte buffer
+ */
+template <int capsule>
+void printfRow(const Telemetry::Snapshot& s, char* out, size_t size) {
+  if (capsule == 1) {
+    snprintf(out, size, "%lu,%lu,%d,%d,%.5g,%hu,%u:%u:%u:%u,%.2f,%.2f,%.2f,%.2f,%.3f,%.3f,%.3f,%.4f,%.4f,%.4f,%.4f",
+      (unsigned long)s.sample, (unsigned long)s.sampleMicros, (int)s.latitude, (int)s.longitude, (double)s.altitudeMSL, (unsigned short)s.numSatellites,
+      Telemetry::timestampHours(s.timestamp), Telemetry::timestampMinutes(s.timestamp),
+      Telemetry::timestampSeconds(s.timestamp), Telemetry::timestampMilliseconds(s.timestamp),
+      (double)s.accelX, (double)s.accelY, (double)s.accelZ, (double)s.altitude,
+      (double)s.gyroX, (double)s.gyroY, (double)s.gyroZ,
+      (double)s.attitude.w, (double)s.attitude.x, (double)s.attitude.y, (double)s.attitude.z);
+  } else {
+    snprintf(out, size, "%lu,%lu,%d,%d,%.5g,%hu,%u:%u:%u:%u,%.2f,%.2f,%.2f,%.2f,%d,%.2f,%.1f,%.3f,%.3f,%.3f,%.4f,%.4f,%.4f,%.4f",
+      (unsigned long)s.sample, (unsigned long)s.sampleMicros, (int)s.latitude, (int)s.longitude, (double)s.altitudeMSL, (unsigned short)s.numSatellites,
+      Telemetry::timestampHours(s.timestamp), Telemetry::timestampMinutes(s.timestamp),
+      Telemetry::timestampSeconds(s.timestamp), Telemetry::timestampMilliseconds(s.timestamp),
+      (double)s.accelX, (double)s.accelY, (double)s.accelZ, (double)s.altitude,
+      s.vocReading, (double)s.humidity, (double)s.temperature,
+      (double)s.gyroX, (double)s.gyroY, (double)s.gyroZ,
+      (double)s.attitude.w, (double)s.attitude.x, (double)s.attitude.y, (double)s.attitude.z);
+  }
+}
+
+template <int capsule>
+size_t schemaRow(const Telemetry::Snapshot& s, char* out, size_t size) {
+  Telemetry::TextWriter row(out, size);
+  Telemetry::LogSchema<capsule>::write(row, s);
+  return row.finish();
+}
+
+template <typename F>
+double nanosPer(size_t count, F work) {
+  auto start = std::chrono::steady_clock::now();
+  work();
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+}
+
+template <int capsule>
+bool rows(size_t count, std::mt19937& rng) {
+  std::vector<Telemetry::Snapshot> snapshots(count);
+  for (auto& s : snapshots) {
+    s = randomSnapshot(rng);
+  }
+  long mismatches = 0;
+  for (const auto& s : snapshots) {
+    char expected[192], got[192];
+    printfRow<capsule>(s, expected, sizeof expected);
+    schemaRow<capsule>(s, got, sizeof got);
+    mismatches += strcmp(expected, got) != 0;
+  }
+
+  size_t sink = 0;
+  double printfNanos = nanosPer(count, [&] {
+    for (const auto& s : snapshots) {
+      char line[192];
+      printfRow<capsule>(s, line, sizeof line);
+      sink += line[0];
+    }
+  });
+  double schemaNanos = nanosPer(count, [&] {
+    for (const auto& s : snapshots) {
+      char line[192];
+      sink += schemaRow<capsule>(s, line, sizeof line);
+    }
+  });
+  g_sink = sink;
+
+  std::string label = "capsule " + std::to_string(capsule) + " CSV row";
+  printf("%-18s %12.1f %14.1f %8.1fx %10ld\n", label.c_str(), printfNanos, schemaNanos, printfNanos / schemaNanos,
+         mismatches);
+  return mismatches == 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const size_t COUNT = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200000;
+  std::mt19937 rng(15);
+
+  std::vector<Conversion> conversions;
+  for (unsigned p = 0; p <= NumberFormat::MAX_DECIMALS; ++p) {
+    conversions.push_back({FIXED, p});
+  }
+  for (unsigned p = 1; p <= NumberFormat::MAX_PRECISION; ++p) {
+    conversions.push_back({GENERAL, p});
+  }
+  // The ones the firmware uses get the full count of random inputs; the others a tenth
+  auto used = [](const Conversion& c) {
+    return (c.kind == FIXED && c.precision >= 1 && c.precision <= 3) || (c.kind == GENERAL && c.precision == 5);
+  };
+
+  printf("%zu random inputs per conversion\n\n", COUNT);
+  printf("%-18s %12s %14s %9s %10s\n", "conversion", "snprintf ns", "NumberFormat ns", "speedup", "mismatches");
+  bool ok = true;
+  std::vector<float> edges = edgeCases();
+  for (const Conversion& c : conversions) {
+    size_t count = used(c) ? COUNT : COUNT / 10;
+    std::vector<float> sensorValues = readings(count, rng);
+    long mismatches = compareFloats(c, edges) + compareFloats(c, randomBits(count, rng))
+      + compareFloats(c, sensorValues) + compareFloats(c, ties(c.precision, count / 10, rng));
+    ok = ok && mismatches == 0;
+    if (!used(c) && mismatches == 0) {
+      continue;
+    }
+
+    size_t sink = 0;
+    double printfNanos = nanosPer(sensorValues.size(), [&] {
+      for (float value : sensorValues) {
+        char text[64];
+        sink += snprintf(text, sizeof text, c.kind == FIXED ? "%.*f" : "%.*g", (int)c.precision, (double)value);
+      }
+    });
+    double ownNanos = nanosPer(sensorValues.size(), [&] {
+      for (float value : sensorValues) {
+        char text[NumberFormat::MAX_FIXED_LENGTH];
+        sink += viaNumberFormat(c, value, text);
+      }
+    });
+    g_sink = sink;
+    printf("%-18s %12.1f %14.1f %8.1fx %10ld\n", name(c).c_str(), printfNanos, ownNanos, printfNanos / ownNanos,
+           mismatches);
+  }
+
+  long integerMismatches = compareIntegers(COUNT, rng);
+  printf("%-18s %12s %14s %9s %10ld\n", "%d and %0NX", "-", "-", "-", integerMismatches);
+  ok = ok && integerMismatches == 0;
+
+  ok = rows<1>(COUNT / 4, rng) && ok;
+  ok = rows<2>(COUNT / 4, rng) && ok;
+
+  if (!ok) {
+    printf("\nFAIL: NumberFormat differs from snprintf\n");
+    return EXIT_FAILURE;
+  }
+  printf("\nOther conversions (%%.0f-%%.9f, %%.1g-%%.9g): all identical\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,180 @@
+/*
+ * SdBootBenchmark.cpp
+ *
+ * Time from SDCard::initialize() to the first logged sample being on the card, with more and more
+ * earlier logs already on it. SDCard picks its file name from the sequence number it saved on the
+ * card (CAPS_SEQ), or, on a card without one, with a doubling then halving search over the names.
+ * Both are compared against the names being tried one by one, as SDCard used to, which cost one
+ * linear directory search per existing log. That figure only times the search itself, so the old
+ * time to the first sample was at least this much. Also times a second initialize() after the file
+ * is closed, as when the card drops out in flight. Fails if a log would overwrite an existing file.
+ *
+ * Usage: SdBootBenchmark [max existing logs]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+
+#include "SD_Card.h"
+
+#include "hostsim.h"
+
+namespace {
+
+const char* DIR = "sdboot_bench";
+
+/** The name of the n-th log, as SDCard numbers them: CAPS_INF, CAPS_IN0, ..., CAPS_I10, ... */
+std::string logName(uint32_t n) {
+  char name[13] = "CAPS_INF";
+  if (n > 0) {
+    char digits[9];
+    int length = snprintf(digits, sizeof digits, "%lu", (unsigned long)(n - 1));
+    memcpy(name + 8 - length, digits, length);
+  }
+  return std::string(name) + ".CSV";
+}
+
+/** A fresh card holding `count` logs, plus the sequence file SDCard would have left, if asked for. */
+void prepareCard(uint32_t count, bool withSequenceFile) {
+  std::filesystem::remove_all(DIR);
+  std::filesystem::create_directories(DIR);
+  for (uint32_t n = 0; n < count; ++n) {
+    std::ofstream(std::string(DIR) + "/" + logName(n)) << "old\r\n";
+  }
+  if (withSequenceFile) {
+    char digits[21]; // any unsigned long, though SDCard's are 9 digits
+    snprintf(digits, sizeof digits, "%09lu", (unsigned long)count);
+    std::ofstream(std::string(DIR) + "/CAPS_SEQ") << digits;
+  }
+}
+
+/** SDCard's old findFileName(): try every name in order until one is free. */
+void probeOneByOne(char* fileName) {
+  strcpy(fileName, "CAPS_INF.CSV");
+  if (!SD.exists(fileName)) {
+    return;
+  }
+  for (unsigned long i = 0; i < 100000000; ++i) {
+    strcpy(fileName, "CAPS_INF");
+    char numberBuffer[9];
+    sprintf(numberBuffer, "%lu", i);
+    strcpy(fileName + strlen(fileName) - strlen(numberBuffer), numberBuffer);
+    strcat(fileName, ".CSV");
+    if (!SD.exists(fileName)) {
+      return;
+    }
+  }
+}
+
+struct Cost {
+  double millis;
+  uint64_t lookups;
+};
+
+/** Virtual time and directory searches from initialize() until the first sample is synced. */
+Cost firstSample(SDCard& card, const Telemetry::Snapshot& sample) {
+  uint64_t start = hostsim::now();
+  uint64_t lookups = hostsim::sdStats().lookups;
+  card.initialize();
+  card.writeToCSV(sample);
+  card.writePending();
+  card.sync();
+  return {(hostsim::now() - start) / 1000.0, hostsim::sdStats().lookups - lookups};
+}
+
+/** Did the new log land on the first free name, leaving every old log as it was? */
+bool checkCard(uint32_t count, uint32_t logsWritten) {
+  for (uint32_t n = 0; n < count; ++n) {
+    std::ifstream file(std::string(DIR) + "/" + logName(n));
+    std::string line;
+    if (!std::getline(file, line) || line != "old\r") {
+      fprintf(stderr, "%s was overwritten\n", logName(n).c_str());
+      return false;
+    }
+  }
+  for (uint32_t n = count; n < count + logsWritten; ++n) {
+    if (!std::filesystem::exists(std::string(DIR) + "/" + logName(n))) {
+      fprintf(stderr, "expected a new log in %s\n", logName(n).c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  uint32_t maxCount = argc > 1 ? (uint32_t)strtoul(argv[1], nullptr, 10) : 3000;
+  std::vector<uint32_t> counts;
+  for (uint32_t count : {0U, 10U, 100U, 1000U, 3000U, 10000U}) {
+    if (count <= maxCount) {
+      counts.push_back(count);
+    }
+  }
+
+  // SDCard's self-test seeds random() from an analog pin, which reads the flight
+  hostsim::setTrace(hostsim::makeSyntheticFlight());
+  hostsim::mutableOptions().sdDir = DIR;
+  Telemetry::Snapshot sample = {};
+  sample.altitude = 1234.5F;
+  bool ok = true;
+
+  printf("%-8s %13s %9s %13s %9s %13s %9s %15s %9s\n", "logs", "counter ms", "lookups", "no counter ms",
+    "lookups", "re-init ms", "lookups", "one by one ms", "lookups");
+  for (uint32_t count : counts) {
+    Cost cost[3];
+
+    // Normal boot: the card has the sequence file from the last flight. Then the card drops out
+    // and the sketch starts the next log.
+    prepareCard(count, true);
+    {
+      SDCard card;
+      cost[0] = firstSample(card, sample);
+      card.closeFile();
+      cost[2] = firstSample(card, sample);
+      card.closeFile();
+      SD.end();
+    }
+    ok = checkCard(count, 2) && ok;
+
+    // First boot after the update, or a card written by something else: no sequence file
+    prepareCard(count, false);
+    {
+      SDCard card;
+      cost[1] = firstSample(card, sample);
+      card.closeFile();
+      SD.end();
+    }
+    ok = checkCard(count, 1) && ok;
+
+    prepareCard(count, false);
+    SD.begin(SDCARD_SS_PIN);
+    uint64_t start = hostsim::now();
+    uint64_t lookups = hostsim::sdStats().lookups;
+    char fileName[13];
+    probeOneByOne(fileName);
+    Cost old = {(hostsim::now() - start) / 1000.0, hostsim::sdStats().lookups - lookups};
+    SD.end();
+    if (fileName != logName(count)) {
+      fprintf(stderr, "one-by-one search picked %s, expected %s\n", fileName, logName(count).c_str());
+      ok = false;
+    }
+
+    printf("%-8u %13.1f %9llu %13.1f %9llu %13.1f %9llu %15.1f %9llu\n", count,
+      cost[0].millis, (unsigned long long)cost[0].lookups, cost[1].millis, (unsigned long long)cost[1].lookups,
+      cost[2].millis, (unsigned long long)cost[2].lookups, old.millis, (unsigned long long)old.lookups);
+  }
+  std::filesystem::remove_all(DIR);
+
+  if (!ok) {
+    fprintf(stderr, "FAIL\n");
+    return 1;
+  }
+  return 0;
+}
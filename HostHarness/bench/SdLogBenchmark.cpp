@@ -0,0 +1,322 @@
+/*
+ * SdLogBenchmark.cpp
+ *
+ * Logs the same flight through SDCard in CSV, binary and compressed mode for both capsules, on the
+ * simulated card, with the same periodic upkeep gps_and_save_loop() does. Reports bytes per sample
+ * (and as a share of the CSV log), host time per writeToCSV(), simulated card time per sample and
+ * the longest single card call on either loop. Fails unless DecodeBinaryLog's output is the CSV log:
+ * byte for byte from the binary log, and from the compressed log every value within one unit of
+ * the last digit its column shows (the compressed log keeps each value at that resolution, and the
+ * "%.5g" altitude is rounded twice).
+ *
+ * The flight is the synthetic one sampled at 100 Hz with noise, or a CAPS_INF.CSV logged by either
+ * capsule (e.g. by capsule2_sim), replayed row by row. The compressed logs are also decoded with one
+ * sector in the middle overwritten with garbage, which must cost no more than two keyframe
+ * intervals of rows.
+ *
+ * Usage: SdLogBenchmark [samples] [CAPS_INF.CSV]
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "hostsim.h"
+#include "sdLogBenchmark.h"
+#include "binaryLogDecoder.h"
+#include "flightLogReader.h"
+
+std::vector<SdLogBenchRunner>& sdLogBenchRunners() {
+  static std::vector<SdLogBenchRunner> runners;
+  return runners;
+}
+
+namespace {
+
+std::string readFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+std::string decodeToString(const std::string& path, BinaryLogDecodeResult* decodeResult = nullptr) {
+  FILE* in = fopen(path.c_str(), "rb");
+  if (in == nullptr) {
+    return "";
+  }
+  FILE* out = tmpfile();
+  BinaryLogDecodeResult result = decodeBinaryLog(in, out);
+  if (decodeResult != nullptr) {
+    *decodeResult = result;
+  }
+  fclose(in);
+  std::string text;
+  if (result.ok) {
+    rewind(out);
+    char chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof chunk, out)) > 0) {
+      text.append(chunk, n);
+    }
+  }
+  fclose(out);
+  return text;
+}
+
+/**
+ * Up to `count` rows of a CSV log, matched to Snapshot by column name. Columns the log doesn't
+ * have (capsule 2's sensors in a capsule 1 log) stay zero.
+ */
+std::vector<Telemetry::Snapshot> recordedFlight(const char* path, size_t count) {
+  std::vector<Telemetry::Snapshot> samples;
+  MappedFile file;
+  if (!file.open(path)) {
+    perror(path);
+    return samples;
+  }
+  CsvReader csv(file.data(), file.size());
+  CsvField field;
+  std::vector<std::string> columns;
+  if (csv.nextRow()) {
+    while (csv.nextField(field)) {
+      columns.emplace_back(field.begin, field.end);
+    }
+  }
+
+  while (samples.size() < count && csv.nextRow()) {
+    Telemetry::Snapshot s = {};
+    for (size_t column = 0; column < columns.size() && csv.nextField(field); ++column) {
+      const std::string& name = columns[column];
+      double number = 0.0;
+      field.toDouble(number);
+      if (name == "Sample") {
+        s.sample = static_cast<uint32_t>(number);
+      } else if (name == "Sample Time (us)") {
+        s.sampleMicros = static_cast<uint32_t>(number);
+      } else if (name == "Latitude") {
+        s.latitude = static_cast<int32_t>(number);
+      } else if (name == "Longitude") {
+        s.longitude = static_cast<int32_t>(number);
+      } else if (name == "Altitude (MSL)") {
+        field.toFloat(s.altitudeMSL);
+      } else if (name == "Satellites") {
+        s.numSatellites = static_cast<uint8_t>(number);
+      } else if (name == "Timestamp") {
+        // h:m:s:ms, as Telemetry::ClockTime writes it
+        unsigned parts[4] = {0, 0, 0, 0};
+        sscanf(std::string(field.begin, field.end).c_str(), "%u:%u:%u:%u", &parts[0], &parts[1], &parts[2], &parts[3]);
+        s.timestamp = parts[3] | parts[2] << 10 | parts[1] << 16 | parts[0] << 22;
+      } else if (name == "Accel X") {
+        field.toFloat(s.accelX);
+      } else if (name == "Accel Y") {
+        field.toFloat(s.accelY);
+      } else if (name == "Accel Z") {
+        field.toFloat(s.accelZ);
+      } else if (name == "Altitude (AGL)") {
+        field.toFloat(s.altitude);
+      } else if (name == "VOC Reading") {
+        s.vocReading = static_cast<int>(number);
+      } else if (name == "Humidity") {
+        field.toFloat(s.humidity);
+      } else if (name == "Temperature") {
+        field.toFloat(s.temperature);
+      } else if (name == "Gyro X") {
+        field.toFloat(s.gyroX);
+      } else if (name == "Gyro Y") {
+        field.toFloat(s.gyroY);
+      } else if (name == "Gyro Z") {
+        field.toFloat(s.gyroZ);
+      } else if (name == "Attitude W") {
+        field.toFloat(s.attitude.w);
+      } else if (name == "Attitude X") {
+        field.toFloat(s.attitude.x);
+      } else if (name == "Attitude Y") {
+        field.toFloat(s.attitude.y);
+      } else if (name == "Attitude Z") {
+        field.toFloat(s.attitude.z);
+      }
+    }
+    samples.push_back(s);
+  }
+  return samples;
+}
+
+std::vector<std::string> split(const std::string& text, char separator) {
+  std::vector<std::string> parts;
+  std::istringstream in(text);
+  std::string part;
+  while (std::getline(in, part, separator)) {
+    parts.push_back(part);
+  }
+  return parts;
+}
+
+/**
+ * Is every field of the row `decoded` the same as in `expected`, or a number within one unit of
+ * the last digit `expected` shows? "-0.00" and "0.00" count as the same.
+ */
+bool sameRowWithinResolution(const std::string& decoded, const std::string& expected) {
+  std::vector<std::string> decodedFields = split(decoded, ',');
+  std::vector<std::string> expectedFields = split(expected, ',');
+  if (decodedFields.size() != expectedFields.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < expectedFields.size(); ++i) {
+    const std::string& a = decodedFields[i];
+    const std::string& b = expectedFields[i];
+    if (a == b) {
+      continue;
+    }
+    char* aEnd;
+    char* bEnd;
+    double x = strtod(a.c_str(), &aEnd);
+    double y = strtod(b.c_str(), &bEnd);
+    if (aEnd == a.c_str() || bEnd == b.c_str()) {
+      return false;
+    }
+    size_t point = b.find('.');
+    size_t digitsEnd = point == std::string::npos ? point : b.find_first_not_of("0123456789", point + 1);
+    int decimals = point == std::string::npos ? 0 : int((digitsEnd == std::string::npos ? b.size() : digitsEnd) - point - 1);
+    if (std::fabs(x - y) > std::pow(10.0, -decimals) * (1.0 + 1e-6)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/** sameRowWithinResolution() for every row */
+bool sameWithinResolution(const std::string& decoded, const std::string& expected) {
+  std::vector<std::string> decodedLines = split(decoded, '\n');
+  std::vector<std::string> expectedLines = split(expected, '\n');
+  if (decodedLines.size() != expectedLines.size()) {
+    return false;
+  }
+  for (size_t line = 0; line < expectedLines.size(); ++line) {
+    if (!sameRowWithinResolution(decodedLines[line], expectedLines[line])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Fill one sector in the middle of a copy of the compressed log at `path` with random bytes and
+ * decode it. The rows before and after the damage must still match the CSV log `expected`.
+ * @param[out] keyframeInterval From the log's header.
+ * @return How many of the CSV's rows are missing or wrong, or -1 if the copy didn't decode.
+ */
+long rowsLostToBadSector(const std::string& path, const std::string& expected, unsigned* keyframeInterval) {
+  const size_t SECTOR = 512;
+  std::string data = readFile(path);
+  CompressedLogHeader header;
+  memcpy(&header, data.data(), sizeof header);
+  *keyframeInterval = header.keyframeInterval;
+  size_t sector = data.size() / 2 / SECTOR * SECTOR;
+  uint32_t noise = 12345;
+  for (size_t i = sector; i < sector + SECTOR && i < data.size(); ++i) {
+    noise = noise * 1103515245 + 12345;
+    data[i] = (char)(noise >> 16);
+  }
+  std::string damagedPath = path + ".damaged";
+  std::ofstream(damagedPath, std::ios::binary) << data;
+
+  BinaryLogDecodeResult result;
+  std::string decoded = decodeToString(damagedPath, &result);
+  if (!result.ok) {
+    return -1;
+  }
+  std::vector<std::string> decodedLines = split(decoded, '\n');
+  std::vector<std::string> expectedLines = split(expected, '\n');
+  size_t head = 0;
+  while (head < decodedLines.size() && head < expectedLines.size()
+      && sameRowWithinResolution(decodedLines[head], expectedLines[head])) {
+    ++head;
+  }
+  size_t tail = 0;
+  while (tail < decodedLines.size() - head && tail < expectedLines.size() - head
+      && sameRowWithinResolution(decodedLines[decodedLines.size() - 1 - tail], expectedLines[expectedLines.size() - 1 - tail])) {
+    ++tail;
+  }
+  return (long)(expectedLines.size() - head - tail);
+}
+
+const char* formatName(SdLogBenchResult::Format format) {
+  return format == SdLogBenchResult::CSV ? "csv" : format == SdLogBenchResult::BINARY ? "binary" : "compressed";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const size_t SAMPLES = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20000;
+  // Also what SDCard's self-test reads its random seed from
+  hostsim::setTrace(hostsim::makeSyntheticFlight());
+  std::vector<Telemetry::Snapshot> samples = argc > 2 ? recordedFlight(argv[2], SAMPLES) : syntheticFlight(SAMPLES);
+  if (samples.empty()) {
+    fprintf(stderr, "no samples\n");
+    return EXIT_FAILURE;
+  }
+
+  std::vector<SdLogBenchResult> results;
+  for (SdLogBenchRunner runner : sdLogBenchRunners()) {
+    results.push_back(runner(samples));
+  }
+  std::sort(results.begin(), results.end(), [](const SdLogBenchResult& a, const SdLogBenchResult& b) {
+    return a.capsule != b.capsule ? a.capsule < b.capsule : a.format < b.format;
+  });
+
+  printf("%zu samples%s%s\n\n", samples.size(), argc > 2 ? " from " : "", argc > 2 ? argv[2] : "");
+  printf("%8s %11s %14s %8s %10s %10s %16s %17s %14s\n", "capsule", "format", "bytes/sample", "of csv",
+         "host ns", "card us", "worst write us", "worst upkeep us", "round trip");
+  bool failed = false;
+  std::vector<std::string> recovery;
+  for (const SdLogBenchResult& r : results) {
+    auto text = std::find_if(results.begin(), results.end(), [&](const SdLogBenchResult& other) {
+      return other.capsule == r.capsule && other.format == SdLogBenchResult::CSV;
+    });
+    const char* roundTrip = "-";
+    if (r.path.empty() || text->path.empty()) {
+      roundTrip = "NO CARD";
+      failed = true;
+    } else if (r.format == SdLogBenchResult::BINARY) {
+      bool same = decodeToString(r.path) == readFile(text->path);
+      roundTrip = same ? "identical" : "MISMATCH";
+      failed |= !same;
+    } else if (r.format == SdLogBenchResult::COMPRESSED) {
+      bool same = sameWithinResolution(decodeToString(r.path), readFile(text->path));
+      roundTrip = same ? "to last digit" : "MISMATCH";
+      failed |= !same;
+
+      unsigned interval;
+      long lost = rowsLostToBadSector(r.path, readFile(text->path), &interval);
+      char line[128];
+      if (lost < 0) {
+        snprintf(line, sizeof line, "capsule %d: damaged log didn't decode", r.capsule);
+      } else {
+        snprintf(line, sizeof line, "capsule %d: one damaged sector cost %ld of %zu rows (keyframe every %u)",
+          r.capsule, lost, samples.size(), interval);
+      }
+      recovery.push_back(line);
+      // A sector holds far fewer records than a keyframe interval
+      failed |= lost < 0 || lost > 2 * (long)interval;
+    }
+    printf("%8d %11s %14.1f %7.1f%% %10.1f %10.1f %16.0f %17.0f %14s\n", r.capsule, formatName(r.format),
+           r.bytesPerSample, 100.0 * r.bytesPerSample / text->bytesPerSample, r.hostNanos, r.cardMicros,
+           r.worstWriteMicros, r.worstUpkeepMicros, roundTrip);
+  }
+
+  printf("\n");
+  for (const std::string& line : recovery) {
+    printf("%s\n", line.c_str());
+  }
+
+  if (failed) {
+    printf("\nFAIL: decoded log differs from the CSV log\n");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
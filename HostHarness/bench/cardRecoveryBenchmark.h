@@ -0,0 +1,40 @@
+/*
+ * cardRecoveryBenchmark.h
+ *
+ * Shared declarations for CardRecoveryBenchmark. cardRecoveryBenchmarkVariant.cpp is compiled once
+ * per log format, with and without SD_BLOCK_LOG (see ../CMakeLists.txt), and registers a runner
+ * for it.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "TelemetrySchema.h"
+
+struct CardRecoveryRun {
+  enum Format { CSV, BINARY, COMPRESSED };
+
+  /** Where the card stands after one of gps_and_save_loop()'s card calls */
+  struct Checkpoint {
+    size_t samples;     // rows handed to writeToCSV() so far
+    uint64_t fileBytes; // on the card
+    uint64_t directoryBytes; // what the directory entry says: the file size at the last sync
+  };
+
+  Format format;
+  bool blocks;        // SD_BLOCK_LOG
+  unsigned syncEveryPasses;
+  std::string path;   // log file written on the simulated card
+  std::vector<Checkpoint> checkpoints;
+  double cardMicros;  // simulated SD time per sample, including the periodic card upkeep
+  double worstUpkeepMicros;
+};
+
+typedef CardRecoveryRun (*CardRecoveryRunner)(const std::vector<Telemetry::Snapshot>& samples,
+  unsigned syncEveryPasses, const std::string& directory);
+
+/** Registry filled by the per-variant translation units at static initialization. */
+std::vector<CardRecoveryRunner>& cardRecoveryRunners();
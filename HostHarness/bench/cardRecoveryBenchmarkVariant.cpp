@@ -0,0 +1,87 @@
+/*
+ * cardRecoveryBenchmarkVariant.cpp
+ *
+ * Compiled once per log format, with and without SD_BLOCK_LOG. SDCard's layout depends on those
+ * macros, so the build renames the class for each copy to keep the definitions from colliding at
+ * link time.
+ */
+
+#include <algorithm>
+#include <filesystem>
+
+#include <Arduino.h>
+
+#include "SD_Card.h"
+
+#include "hostsim.h"
+#include "cardRecoveryBenchmark.h"
+
+namespace {
+
+// As in SdLogBenchmark: about four rows per GPS read, and 36 GPS reads to a gps_and_save_loop() pass
+const size_t SAMPLES_PER_GPS_READ = 4;
+const size_t GPS_READS_PER_PASS = 36;
+
+#if SD_COMPRESSED_LOG
+const CardRecoveryRun::Format FORMAT = CardRecoveryRun::COMPRESSED;
+const char* const EXTENSION = ".BSZ";
+#elif SD_BINARY_LOG
+const CardRecoveryRun::Format FORMAT = CardRecoveryRun::BINARY;
+const char* const EXTENSION = ".BIN";
+#else
+const CardRecoveryRun::Format FORMAT = CardRecoveryRun::CSV;
+const char* const EXTENSION = ".CSV";
+#endif
+
+CardRecoveryRun run(const std::vector<Telemetry::Snapshot>& samples, unsigned syncEveryPasses,
+    const std::string& directory) {
+  CardRecoveryRun result{FORMAT, SD_BLOCK_LOG, syncEveryPasses, "", {}, 0.0, 0.0};
+
+  // Each run gets a fresh card so they all log to CAPS_INF.*
+  std::string dir = directory + "/card_" + std::to_string(FORMAT) + (SD_BLOCK_LOG ? "_blocks_" : "_plain_")
+    + std::to_string(syncEveryPasses);
+  std::filesystem::remove_all(dir);
+  hostsim::mutableOptions().sdDir = dir;
+
+  SDCard card;
+  card.initialize();
+  if (card.getStatus() != SDCard::ACTIVE) {
+    return result;
+  }
+  result.path = dir + "/CAPS_INF" + EXTENSION;
+
+  // The log is the only file written from here on (the simulated card's own file only catches up
+  // when flushed)
+  uint64_t writtenBefore = hostsim::sdStats().bytesWritten;
+  uint64_t directoryBytes = 0;
+  uint64_t cardStart = hostsim::now();
+  uint64_t worstUpkeep = 0;
+  for (size_t i = 0; i < samples.size(); ++i) {
+    card.writeToCSV(samples[i]);
+    if (i % SAMPLES_PER_GPS_READ != SAMPLES_PER_GPS_READ - 1) {
+      continue;
+    }
+    // What gps_and_save_loop() does to the card after each GPS read
+    uint64_t before = hostsim::now();
+    card.writePending();
+    size_t read = i / SAMPLES_PER_GPS_READ;
+    bool sync = read % (GPS_READS_PER_PASS * syncEveryPasses) == GPS_READS_PER_PASS * syncEveryPasses - 1;
+    if (sync) {
+      card.sync();
+    }
+    worstUpkeep = std::max(worstUpkeep, hostsim::now() - before);
+    uint64_t fileBytes = hostsim::sdStats().bytesWritten - writtenBefore;
+    directoryBytes = sync ? fileBytes : directoryBytes;
+    result.checkpoints.push_back({i + 1, fileBytes, directoryBytes});
+  }
+  uint64_t cardEnd = hostsim::now();
+  card.closeFile();
+
+  result.cardMicros = double(cardEnd - cardStart) / samples.size();
+  result.worstUpkeepMicros = worstUpkeep;
+  return result;
+}
+
+const bool REGISTERED = (cardRecoveryRunners().push_back(run), true);
+
+} // namespace
@@ -0,0 +1,72 @@
+/*
+ * sdLogBenchmark.h
+ *
+ * Shared declarations for SdLogBenchmark. sdLogBenchmarkVariant.cpp is compiled once per capsule
+ * and log format (CSV, SD_BINARY_LOG or SD_COMPRESSED_LOG; see ../CMakeLists.txt) and registers a
+ * runner for it. CardRecoveryBenchmark logs the same synthetic flight.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Attitude.h"
+#include "TelemetrySchema.h"
+#include "hostsim.h"
+
+struct SdLogBenchResult {
+  enum Format { CSV, BINARY, COMPRESSED };
+
+  int capsule;
+  Format format;
+  std::string path;       // log file written on the simulated card
+  double bytesPerSample;  // excluding the header
+  double hostNanos;       // host time per writeToCSV()
+  double cardMicros;      // simulated SD time per sample, including the periodic card upkeep
+  double worstWriteMicros;  // longest single writeToCSV() (what loop() waits for)
+  double worstUpkeepMicros; // longest single upkeep call made from gps_and_save_loop()
+};
+
+typedef SdLogBenchResult (*SdLogBenchRunner)(const std::vector<Telemetry::Snapshot>& samples);
+
+/** Registry filled by the per-variant translation units at static initialization. */
+std::vector<SdLogBenchRunner>& sdLogBenchRunners();
+
+/**
+ * Sample the synthetic flight at 100 Hz with a little noise so the digits vary like real data, with
+ * the attitude AttitudeFilter makes of it
+ */
+inline std::vector<Telemetry::Snapshot> syntheticFlight(size_t count) {
+  const hostsim::Trace& flight = hostsim::trace();
+  std::vector<Telemetry::Snapshot> samples(count);
+  AttitudeFilter attitude;
+  for (size_t i = 0; i < count; ++i) {
+    double t = std::fmod(i / 100.0, flight.duration());
+    hostsim::FlightSample truth = flight.at(t);
+    Telemetry::Snapshot& s = samples[i];
+    s.sample = static_cast<uint32_t>(i);
+    s.sampleMicros = static_cast<uint32_t>(i * 10000);
+    s.latitude = truth.latitude;
+    s.longitude = truth.longitude;
+    s.altitudeMSL = static_cast<float>(truth.altitudeMSL);
+    s.numSatellites = static_cast<uint8_t>(truth.satellites);
+    uint32_t ms = static_cast<uint32_t>(i * 10);
+    s.timestamp = (ms % 1000) | (ms / 1000 % 60) << 10 | (ms / 60000 % 60) << 16 | (17u << 22);
+    float* accel[3] = {&s.accelX, &s.accelY, &s.accelZ};
+    float* gyro[3] = {&s.gyroX, &s.gyroY, &s.gyroZ};
+    for (int k = 0; k < 3; ++k) {
+      *accel[k] = static_cast<float>(truth.accel[k] + 0.05 * hostsim::gaussian());
+      *gyro[k] = static_cast<float>(truth.gyro[k] + 0.01 * hostsim::gaussian());
+    }
+    attitude.update(s.gyroX, s.gyroY, s.gyroZ, s.accelX, s.accelY, s.accelZ, 0.01F);
+    s.attitude = attitude.attitude();
+    s.altitude = static_cast<float>(truth.altitudeAGL + 1.5 * hostsim::gaussian());
+    s.vocReading = truth.voc;
+    s.humidity = static_cast<float>(truth.humidity);
+    s.temperature = static_cast<float>(truth.temperature);
+  }
+  return samples;
+}
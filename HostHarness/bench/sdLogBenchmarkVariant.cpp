@@ -0,0 +1,95 @@
+/*
+ * sdLogBenchmarkVariant.cpp
+ *
+ * Compiled once per CAPSULE and log format. SDCard's layout depends on those macros, so the build
+ * renames the class for each copy to keep the definitions from colliding at link time.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+
+#include <Arduino.h>
+
+#include "SD_Card.h"
+
+#include "hostsim.h"
+#include "sdLogBenchmark.h"
+
+namespace {
+
+const size_t SAMPLES_PER_GPS_READ = 4;
+const size_t GPS_READS_PER_SYNC = 36;
+
+/** What gps_and_save_loop() does to the card between GPS reads. */
+void upkeep(SDCard& card, bool durabilityPoint) {
+  card.writePending();
+  if (durabilityPoint) {
+    card.sync();
+  }
+}
+
+#if SD_COMPRESSED_LOG
+const SdLogBenchResult::Format FORMAT = SdLogBenchResult::COMPRESSED;
+const char* const SUFFIX = "_bsz";
+const char* const EXTENSION = ".BSZ";
+#elif SD_BINARY_LOG
+const SdLogBenchResult::Format FORMAT = SdLogBenchResult::BINARY;
+const char* const SUFFIX = "_bin";
+const char* const EXTENSION = ".BIN";
+#else
+const SdLogBenchResult::Format FORMAT = SdLogBenchResult::CSV;
+const char* const SUFFIX = "_csv";
+const char* const EXTENSION = ".CSV";
+#endif
+
+SdLogBenchResult run(const std::vector<Telemetry::Snapshot>& samples) {
+  SdLogBenchResult result{CAPSULE, FORMAT, "", 0.0, 0.0, 0.0, 0.0, 0.0};
+
+  // Each variant gets a fresh card so they all log to CAPS_INF.*
+  std::string dir = "sdlog_bench_c" + std::to_string(CAPSULE) + SUFFIX;
+  std::filesystem::remove_all(dir);
+  hostsim::mutableOptions().sdDir = dir;
+
+  SDCard card;
+  card.initialize();
+  if (card.getStatus() != SDCard::ACTIVE) {
+    return result;
+  }
+  result.path = dir + "/CAPS_INF" + EXTENSION;
+  uint64_t headerBytes = std::filesystem::file_size(result.path);
+
+  uint64_t cardStart = hostsim::now();
+  uint64_t worstWrite = 0;
+  uint64_t worstUpkeep = 0;
+  double hostNanos = 0.0;
+  for (size_t i = 0; i < samples.size(); ++i) {
+    uint64_t before = hostsim::now();
+    auto start = std::chrono::steady_clock::now();
+    card.writeToCSV(samples[i]);
+    hostNanos += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    worstWrite = std::max(worstWrite, hostsim::now() - before);
+
+    // The capsule's loop() runs at roughly 4x the GPS loop's 18 Hz, and gps_and_save_loop()
+    // reaches its durability point every 36 GPS reads
+    if (i % SAMPLES_PER_GPS_READ == SAMPLES_PER_GPS_READ - 1) {
+      before = hostsim::now();
+      bool durabilityPoint = (i / SAMPLES_PER_GPS_READ) % GPS_READS_PER_SYNC == GPS_READS_PER_SYNC - 1;
+      upkeep(card, durabilityPoint);
+      worstUpkeep = std::max(worstUpkeep, hostsim::now() - before);
+    }
+  }
+  uint64_t cardEnd = hostsim::now();
+  card.closeFile();
+
+  result.bytesPerSample = double(std::filesystem::file_size(result.path) - headerBytes) / samples.size();
+  result.hostNanos = hostNanos / samples.size();
+  result.cardMicros = double(cardEnd - cardStart) / samples.size();
+  result.worstWriteMicros = worstWrite;
+  result.worstUpkeepMicros = worstUpkeep;
+  return result;
+}
+
+const bool REGISTERED = (sdLogBenchRunners().push_back(run), true);
+
+} // namespace
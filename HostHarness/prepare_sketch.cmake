@@ -0,0 +1,36 @@
+# Turns an Arduino sketch into a C++ translation unit for the host simulation, doing the parts of
+# the Arduino build that matter for these sketches:
+#  - force the sketch's `#if true`/`#if false` upload guard on
+#  - include Arduino.h and forward-declare the Scheduler loops the sketch starts before defining
+#  - register the loop names so the simulation can label its report
+#
+# Usage: cmake -DINPUT=<sketch.ino> -DOUTPUT=<generated.cpp> -P prepare_sketch.cmake
+
+file(READ "${INPUT}" SKETCH)
+
+string(REGEX REPLACE "(^|\n)#if (true|false)" "\\1#if true" SKETCH "${SKETCH}")
+
+string(REGEX MATCHALL "startLoop\\([A-Za-z_][A-Za-z0-9_]*\\)" STARTED "${SKETCH}")
+set(PROTOTYPES "")
+set(NAMES "")
+foreach(CALL IN LISTS STARTED)
+  string(REGEX REPLACE "startLoop\\(([A-Za-z0-9_]+)\\)" "\\1" LOOP "${CALL}")
+  string(APPEND PROTOTYPES "void ${LOOP}();\n")
+  string(APPEND NAMES "  hostsim::nameLoop(${LOOP}, \"${LOOP}\"),\n")
+endforeach()
+
+set(GENERATED "// Generated from ${INPUT} by prepare_sketch.cmake. Do not edit.\n")
+string(APPEND GENERATED "#include <Arduino.h>\n${PROTOTYPES}#line 1 \"${INPUT}\"\n${SKETCH}\n")
+if(NAMES)
+  string(APPEND GENERATED
+    "namespace hostsim { void nameLoop(void (*task)(), const char* name); }\n"
+    "static const bool HOSTSIM_LOOPS_NAMED = (\n${NAMES}  true);\n")
+endif()
+
+# Only touch the output when it changes, so unrelated edits don't force a rebuild
+if(EXISTS "${OUTPUT}")
+  file(READ "${OUTPUT}" PREVIOUS)
+endif()
+if(NOT "${PREVIOUS}" STREQUAL "${GENERATED}")
+  file(WRITE "${OUTPUT}" "${GENERATED}")
+endif()
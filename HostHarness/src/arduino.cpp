@@ -0,0 +1,329 @@
+#include <cinttypes>
+#include <cstdio>
+
+#include "hostsim.h"
+
+#include "Arduino.h"
+#include "SPI.h"
+#include "wiring_private.h"
+
+// Core functions, Print/Stream, the UART and the MKR variant's peripheral instances.
+
+namespace {
+
+// The SAMD core's analogRead() with default settings (prescaler and settling) takes about 425 us.
+const uint64_t ANALOG_READ_MICROS = 425;
+// Reading a peripheral status register while polling
+const uint64_t REGISTER_POLL_MICROS = 1;
+
+uint32_t g_pinLevels[64] = {0};
+unsigned long g_randomState = 1;
+
+} // namespace
+
+SERCOM sercom0(0);
+SERCOM sercom1(1);
+SERCOM sercom2(2);
+SERCOM sercom3(3);
+SERCOM sercom4(4);
+SERCOM sercom5(5);
+
+// MKR variant: Serial1 is on sercom5 (pins 13/14)
+Uart Serial1(&sercom5, 13, 14, SERCOM_RX_PAD_3, UART_TX_PAD_2);
+SPIClass SPI;
+
+extern "C" {
+// Sketches install their own handlers for the SERCOMs they use
+__attribute__((weak)) void SERCOM0_Handler(void) {}
+__attribute__((weak)) void SERCOM1_Handler(void) {}
+__attribute__((weak)) void SERCOM2_Handler(void) {}
+__attribute__((weak)) void SERCOM3_Handler(void) {}
+__attribute__((weak)) void SERCOM4_Handler(void) {}
+__attribute__((weak)) void DMAC_Handler(void) {}
+void SERCOM5_Handler(void) {
+  Serial1.IrqHandler();
+}
+
+unsigned long millis(void) {
+  return static_cast<unsigned long>(hostsim::now() / 1000);
+}
+
+unsigned long micros(void) {
+  return static_cast<unsigned long>(hostsim::now());
+}
+
+void delayMicroseconds(unsigned int us) {
+  hostsim::advance(us);
+}
+} // extern "C"
+
+namespace hostsim {
+
+void serviceInterrupts() {
+  static bool servicing = false;
+  if (servicing) {
+    return;
+  }
+  servicing = true;
+
+  static void (*const HANDLERS[6])(void) = {
+    SERCOM0_Handler, SERCOM1_Handler, SERCOM2_Handler,
+    SERCOM3_Handler, SERCOM4_Handler, SERCOM5_Handler,
+  };
+  for (int i = 0; i < 6; ++i) {
+    UartPort& port = uartPort(i);
+    if (!port.device || port.baud == 0) {
+      continue;
+    }
+    while (port.device->nextDue() <= now()) {
+      uint64_t before = port.bytesReceived;
+      HANDLERS[i]();
+      if (port.bytesReceived == before) {
+        // Nobody serviced the interrupt: the byte is lost
+        uint8_t dropped;
+        port.device->pop(dropped);
+        ++port.bytesReceived;
+        ++port.rxOverruns;
+      }
+    }
+  }
+
+  serviceI2cDma();
+
+  servicing = false;
+}
+
+UartPort& uartPort(int sercomIndex) {
+  static UartPort ports[6];
+  return ports[sercomIndex];
+}
+
+} // namespace hostsim
+
+void pinMode(uint32_t /*pin*/, uint32_t /*mode*/) {}
+
+void digitalWrite(uint32_t pin, uint32_t value) {
+  value = value ? HIGH : LOW;
+  if (pin < 64 && g_pinLevels[pin] != value) {
+    g_pinLevels[pin] = value;
+    hostsim::pinChanged(pin, value);
+  }
+}
+
+int digitalRead(uint32_t pin) {
+  return pin < 64 ? g_pinLevels[pin] : LOW;
+}
+
+int analogRead(uint32_t pin) {
+  if (pin < A0) {
+    pin += A0;
+  }
+  hostsim::advance(ANALOG_READ_MICROS);
+
+  const hostsim::FlightSample& state = hostsim::truth();
+  switch (pin) {
+  case A0:
+    // Floating pin, used to seed the RNG
+    return static_cast<int>(512 + 40 * hostsim::gaussian()) & 1023;
+  case A2: {
+    // Payload bay tank transducer: 0.5 V = 0 MPa, 4.5 V = 3 MPa, read against a 5 V reference
+    const double PSI_PER_MPA = 145.03774;
+    double volts = 0.5 + state.tankPressure / PSI_PER_MPA / 3.0 * 4.0;
+    return static_cast<int>(constrain(volts / 5.0 * 1023.0, 0.0, 1023.0));
+  }
+  case A6:
+    return state.voc;
+  default:
+    return 0;
+  }
+}
+
+void analogReference(eAnalogReference /*mode*/) {}
+void analogReadResolution(int /*bits*/) {}
+
+int pinPeripheral(uint32_t /*pin*/, EPioType /*peripheral*/) {
+  return 0;
+}
+
+void randomSeed(unsigned long seed) {
+  if (seed != 0) {
+    g_randomState = seed;
+  }
+}
+
+long random(long howBig) {
+  if (howBig == 0) {
+    return 0;
+  }
+  g_randomState = g_randomState * 1103515245UL + 12345UL;
+  return static_cast<long>((g_randomState >> 8) % static_cast<unsigned long>(howBig));
+}
+
+long random(long howSmall, long howBig) {
+  if (howSmall >= howBig) {
+    return howSmall;
+  }
+  return random(howBig - howSmall) + howSmall;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Print and Stream
+
+size_t Print::print(long n) {
+  char buf[24];
+  snprintf(buf, sizeof buf, "%ld", n);
+  return write(buf);
+}
+
+size_t Print::print(unsigned long n) {
+  char buf[24];
+  snprintf(buf, sizeof buf, "%lu", n);
+  return write(buf);
+}
+
+size_t Print::print(double n, int digits) {
+  char buf[48];
+  snprintf(buf, sizeof buf, "%.*f", digits, n);
+  return write(buf);
+}
+
+int Stream::timedRead() {
+  unsigned long start = millis();
+  do {
+    int c = read();
+    if (c >= 0) {
+      return c;
+    }
+    // The core spins on millis() here without yielding
+    hostsim::advance(REGISTER_POLL_MICROS * 100);
+  } while (millis() - start < m_timeout);
+  return -1;
+}
+
+String Stream::readStringUntil(char terminator) {
+  String result;
+  int c = timedRead();
+  while (c >= 0 && c != terminator) {
+    result += static_cast<char>(c);
+    c = timedRead();
+  }
+  return result;
+}
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+  size_t count = 0;
+  while (count < length) {
+    int c = timedRead();
+    if (c < 0) {
+      break;
+    }
+    buffer[count++] = static_cast<char>(c);
+  }
+  return count;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Uart
+
+Uart::Uart(SERCOM* sercom, uint8_t /*rxPin*/, uint8_t /*txPin*/, SercomRXPad /*rxPad*/,
+           SercomUartTXPad /*txPad*/) noexcept :
+  m_sercom(sercom),
+  m_rxBuffer(),
+  m_baud(0) {}
+
+void Uart::begin(unsigned long baudRate) {
+  begin(baudRate, SERIAL_8N1);
+}
+
+void Uart::begin(unsigned long baudRate, uint16_t config) {
+  m_baud = baudRate;
+  hostsim::UartPort& port = hostsim::uartPort(m_sercom->index());
+  port.baud = baudRate;
+  // start bit + 8 data bits + 1 or 2 stop bits
+  port.bitsPerByte = config == SERIAL_8N2 ? 11 : 10;
+  if (port.device) {
+    port.device->onBegin(baudRate);
+  }
+}
+
+void Uart::end() {
+  hostsim::uartPort(m_sercom->index()).baud = 0;
+  m_baud = 0;
+  m_rxBuffer.clear();
+}
+
+int Uart::available() {
+  hostsim::serviceInterrupts();
+  if (m_rxBuffer.available() == 0) {
+    // Polling an empty port still costs a register read, so busy-wait loops make progress
+    hostsim::advance(REGISTER_POLL_MICROS);
+  }
+  return m_rxBuffer.available();
+}
+
+int Uart::availableForWrite() {
+  hostsim::UartPort& port = hostsim::uartPort(m_sercom->index());
+  if (port.baud == 0) {
+    return 0;
+  }
+  uint64_t byteMicros = 1000000ULL * port.bitsPerByte / port.baud;
+  uint64_t backlog = port.txBusyUntil > hostsim::now() ? port.txBusyUntil - hostsim::now() : 0;
+  int queued = static_cast<int>(backlog / (byteMicros == 0 ? 1 : byteMicros));
+  return queued >= SERIAL_BUFFER_SIZE ? 0 : SERIAL_BUFFER_SIZE - queued;
+}
+
+int Uart::peek() {
+  hostsim::serviceInterrupts();
+  return m_rxBuffer.peek();
+}
+
+int Uart::read() {
+  hostsim::serviceInterrupts();
+  return m_rxBuffer.read_char();
+}
+
+void Uart::flush() {
+  hostsim::advanceTo(hostsim::uartPort(m_sercom->index()).txBusyUntil);
+}
+
+size_t Uart::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t Uart::write(const uint8_t* buffer, size_t size) {
+  hostsim::UartPort& port = hostsim::uartPort(m_sercom->index());
+  if (port.baud == 0 || size == 0) {
+    return 0;
+  }
+
+  // Bytes queue in the TX ring and shift out at the baud rate. Once the ring is full, write()
+  // spins until there is room, blocking the calling task.
+  uint64_t byteMicros = 1000000ULL * port.bitsPerByte / port.baud;
+  uint64_t start = port.txBusyUntil > hostsim::now() ? port.txBusyUntil : hostsim::now();
+  port.txBusyUntil = start + byteMicros * size;
+  port.bytesSent += size;
+  if (port.device) {
+    port.device->receive(buffer, size, port.txBusyUntil);
+  }
+
+  uint64_t ringMicros = byteMicros * SERIAL_BUFFER_SIZE;
+  uint64_t backlog = port.txBusyUntil - hostsim::now();
+  if (backlog > ringMicros) {
+    port.txStallMicros += backlog - ringMicros;
+    hostsim::advance(backlog - ringMicros);
+  }
+  return size;
+}
+
+void Uart::IrqHandler() {
+  hostsim::UartPort& port = hostsim::uartPort(m_sercom->index());
+  uint8_t c;
+  if (port.device && port.device->nextDue() <= hostsim::now() && port.device->pop(c)) {
+    ++port.bytesReceived;
+    if (m_rxBuffer.isFull()) {
+      ++port.rxOverruns;
+    } else {
+      m_rxBuffer.store_char(c);
+    }
+  }
+}
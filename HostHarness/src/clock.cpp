@@ -0,0 +1,54 @@
+#include "hostsim.h"
+
+namespace hostsim {
+
+namespace {
+
+uint64_t g_now = 0;
+uint64_t g_endOfRun = UINT64_MAX;
+
+void afterTick() {
+  serviceInterrupts();
+  if (g_now >= g_endOfRun) {
+    finish();
+  }
+}
+
+/**
+ * Move the clock to `when`, stopping at every DMA completion on the way: its interrupt comes when
+ * the transfer ends, even in the middle of a blocking call, and may start the next transfer.
+ */
+void moveTo(uint64_t when) {
+  uint64_t due;
+  // A completion that is already due is one an interrupt handler on the stack hasn't taken yet
+  while ((due = nextI2cDmaDue()) > g_now && due < when) {
+    g_now = due;
+    afterTick();
+  }
+  if (when > g_now) {
+    g_now = when;
+  }
+  afterTick();
+}
+
+} // namespace
+
+uint64_t now() noexcept {
+  return g_now;
+}
+
+void setEndOfRun(uint64_t when) noexcept {
+  g_endOfRun = when;
+}
+
+void advance(uint64_t us) {
+  moveTo(g_now + us);
+}
+
+void advanceTo(uint64_t when) {
+  if (when > g_now) {
+    moveTo(when);
+  }
+}
+
+} // namespace hostsim
@@ -0,0 +1,349 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "hostsim.h"
+
+namespace hostsim {
+
+namespace {
+
+std::string withChecksum(const std::string& body) {
+  uint8_t checksum = 0;
+  for (char c : body) {
+    checksum ^= static_cast<uint8_t>(c);
+  }
+  char tail[8];
+  snprintf(tail, sizeof tail, "*%02X\r\n", checksum);
+  return "$" + body + tail;
+}
+
+std::string degreesMinutes(int32_t e7, int degreeWidth, char positive, char negative) {
+  double value = std::fabs(e7 / 1e7);
+  int degrees = static_cast<int>(value);
+  double minutes = (value - degrees) * 60.0;
+  char buf[32];
+  snprintf(buf, sizeof buf, "%0*d%07.4f,%c", degreeWidth, degrees, minutes, e7 < 0 ? negative : positive);
+  return buf;
+}
+
+/**
+ * MTK-style receiver (PA1010D/PA6H family). Powers up at 9600 baud and 1 Hz, emitting GGA, GSA, GSV,
+ * RMC and VTG each epoch, and takes the PMTK commands that change that: 251 (baud rate), 220 (fix
+ * interval) and 314 (which sentences to send). Characters are paced at the receiver's baud rate;
+ * if the MCU listens at a different one, it only sees garbage.
+ */
+class GpsReceiver : public UartDevice {
+public:
+  GpsReceiver(const std::string& nmeaPath, bool txWired) :
+    m_baud(9600),
+    m_hostBaud(0),
+    m_intervalMicros(1000000),
+    m_nextEpochMicros(FIRST_FIX_MICROS),
+    m_epoch(0),
+    m_txWired(txWired) {
+    for (bool& on : m_enabled) {
+      on = true;
+    }
+    if (!nmeaPath.empty()) {
+      loadEpochs(nmeaPath);
+    }
+  }
+
+  void onBegin(unsigned long baud) override {
+    m_hostBaud = baud;
+    m_command.clear();
+  }
+
+  uint64_t nextDue() override {
+    if (m_pending.empty()) {
+      queueEpoch();
+    }
+    return m_pending.empty() ? UINT64_MAX : m_pending.front().first;
+  }
+
+  bool pop(uint8_t& c) override {
+    if (m_pending.empty()) {
+      return false;
+    }
+    c = m_pending.front().second;
+    m_pending.pop_front();
+    if (m_hostBaud != m_baud) {
+      // Framing errors and misread bits; never a '$' or printable text
+      c = static_cast<uint8_t>(c * 37 + 11) | 0x80;
+    }
+    return true;
+  }
+
+  void receive(const uint8_t* data, size_t length, uint64_t when) override {
+    if (!m_txWired || m_hostBaud != m_baud) {
+      return;
+    }
+    for (size_t i = 0; i < length; ++i) {
+      char c = static_cast<char>(data[i]);
+      if (c == '$') {
+        m_command.clear();
+      }
+      m_command += c;
+      if (c == '\n') {
+        command(m_command, when);
+        m_command.clear();
+      }
+    }
+  }
+
+private:
+  // Sentence types PMTK314 can turn on and off, in its field order
+  enum Sentence { GLL, RMC, VTG, GGA, GSA, GSV, SENTENCE_COUNT };
+
+  uint64_t byteMicros() const { return 10000000ULL / m_baud; }
+
+  void queueEpoch() {
+    std::string text;
+    uint64_t epochStart;
+    do {
+      epochStart = m_nextEpochMicros;
+      m_nextEpochMicros += m_intervalMicros;
+      // A receiver that can't get a whole epoch out before the next fix skips it
+    } while (m_nextEpochMicros <= m_lastDue);
+    if (!m_recorded.empty()) {
+      if (m_epoch >= m_recorded.size()) {
+        return;
+      }
+      text = m_recorded[m_epoch];
+    } else {
+      text = synthesize(epochStart);
+    }
+    ++m_epoch;
+
+    uint64_t due = epochStart > m_lastDue ? epochStart : m_lastDue;
+    for (char c : text) {
+      due += byteMicros();
+      m_pending.emplace_back(due, static_cast<uint8_t>(c));
+    }
+    m_lastDue = due;
+  }
+
+  /** Act on one PMTK command from the MCU and acknowledge it. */
+  void command(const std::string& line, uint64_t when) {
+    size_t star = line.find('*');
+    if (line.size() < 8 || line.compare(0, 5, "$PMTK") != 0 || star == std::string::npos) {
+      return;
+    }
+    std::string body = line.substr(1, star - 1);
+    uint8_t checksum = 0;
+    for (char c : body) {
+      checksum ^= static_cast<uint8_t>(c);
+    }
+    if (strtoul(line.c_str() + star + 1, nullptr, 16) != checksum) {
+      return;
+    }
+    std::vector<long> args;
+    for (size_t comma = body.find(','); comma != std::string::npos; comma = body.find(',', comma + 1)) {
+      args.push_back(strtol(body.c_str() + comma + 1, nullptr, 10));
+    }
+    int type = atoi(body.c_str() + 4);
+    bool ok = true;
+    if (type == 251 && args.size() == 1 && args[0] > 0) {
+      // Whatever was still going out is cut off; the acknowledgement goes at the old rate
+      m_pending.clear();
+      m_lastDue = when;
+      acknowledge(type, when);
+      m_baud = static_cast<unsigned long>(args[0]);
+      return;
+    } else if (type == 220 && args.size() == 1 && args[0] >= 100) {
+      m_intervalMicros = static_cast<uint64_t>(args[0]) * 1000;
+    } else if (type == 314 && args.size() >= SENTENCE_COUNT) {
+      for (int i = 0; i < SENTENCE_COUNT; ++i) {
+        m_enabled[i] = args[i] != 0;
+      }
+    } else {
+      ok = false;
+    }
+    if (ok) {
+      acknowledge(type, when);
+    }
+  }
+
+  void acknowledge(int type, uint64_t when) {
+    char body[24];
+    snprintf(body, sizeof body, "PMTK001,%d,3", type);
+    uint64_t due = std::max(when, m_lastDue);
+    for (char c : withChecksum(body)) {
+      due += byteMicros();
+      m_pending.emplace_back(due, static_cast<uint8_t>(c));
+    }
+    m_lastDue = due;
+  }
+
+  std::string synthesize(uint64_t when) const {
+    FlightSample s = trace().at(when / 1e6);
+    uint64_t utcHundredths = START_OF_DAY_HUNDREDTHS + when / 10000;
+    char time[16];
+    snprintf(time, sizeof time, "%02u%02u%02u.%02u",
+      static_cast<unsigned>(utcHundredths / 360000 % 24), static_cast<unsigned>(utcHundredths / 6000 % 60),
+      static_cast<unsigned>(utcHundredths / 100 % 60), static_cast<unsigned>(utcHundredths % 100));
+    std::string lat = degreesMinutes(s.latitude, 2, 'N', 'S');
+    std::string lon = degreesMinutes(s.longitude, 3, 'E', 'W');
+    const double METERS_PER_FOOT = 0.3048;
+    char buf[128];
+
+    std::string out;
+    if (m_enabled[GGA]) {
+      snprintf(buf, sizeof buf, "GPGGA,%s,%s,%s,1,%02d,0.92,%.1f,M,-23.4,M,,", time, lat.c_str(), lon.c_str(),
+        s.satellites, s.altitudeMSL * METERS_PER_FOOT);
+      out += withChecksum(buf);
+    }
+    if (m_enabled[GSA]) {
+      out += withChecksum("GPGSA,A,3,10,32,27,08,21,14,01,22,16,,,,1.24,0.92,0.83");
+    }
+    if (m_enabled[GSV] && m_epoch % 5 == 0) {
+      out += withChecksum("GPGSV,3,1,11,10,63,137,17,07,61,098,15,05,59,290,20,08,54,157,30");
+      out += withChecksum("GPGSV,3,2,11,02,39,223,19,13,28,070,17,26,23,252,,04,14,186,14");
+      out += withChecksum("GPGSV,3,3,11,29,09,301,24,16,09,020,,36,,,");
+    }
+    if (m_enabled[RMC]) {
+      snprintf(buf, sizeof buf, "GPRMC,%s,A,%s,%s,0.13,309.62,150524,,,A", time, lat.c_str(), lon.c_str());
+      out += withChecksum(buf);
+    }
+    if (m_enabled[VTG]) {
+      out += withChecksum("GPVTG,309.62,T,,M,0.13,N,0.24,K,A");
+    }
+    if (m_enabled[GLL]) {
+      snprintf(buf, sizeof buf, "GPGLL,%s,%s,%s,A,A", lat.c_str(), lon.c_str(), time);
+      out += withChecksum(buf);
+    }
+    return out;
+  }
+
+  void loadEpochs(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+      throw std::runtime_error("cannot open NMEA file " + path);
+    }
+    std::string line;
+    std::string firstId;
+    while (std::getline(in, line)) {
+      while (!line.empty() && (line.back() == '\r' || line.back() == '\n')) {
+        line.pop_back();
+      }
+      if (line.size() < 7 || line[0] != '$') {
+        continue;
+      }
+      // An epoch starts at every repeat of the first sentence type in the file
+      std::string id = line.substr(3, 3);
+      if (firstId.empty()) {
+        firstId = id;
+      }
+      if (id == firstId || m_recorded.empty()) {
+        m_recorded.emplace_back();
+      }
+      m_recorded.back() += line + "\r\n";
+    }
+  }
+
+  static const uint64_t FIRST_FIX_MICROS = 1000000;
+  static const uint64_t START_OF_DAY_HUNDREDTHS = 18ULL * 360000;
+
+  unsigned long m_baud;
+  unsigned long m_hostBaud;
+  uint64_t m_intervalMicros;
+  uint64_t m_nextEpochMicros;
+  uint64_t m_epoch;
+  uint64_t m_lastDue = 0;
+  bool m_txWired;
+  bool m_enabled[SENTENCE_COUNT];
+  std::string m_command;
+  std::vector<std::string> m_recorded;
+  std::deque<std::pair<uint64_t, uint8_t>> m_pending;
+};
+
+/** Ground station side of the radio link. */
+class Radio : public UartDevice {
+public:
+  Radio(const std::string& commandsPath, const std::string& outputPath) : m_baud(230400), m_output(nullptr) {
+    if (commandsPath.empty()) {
+      m_commands.emplace_back(1000000, "start\n");
+    } else {
+      std::ifstream in(commandsPath);
+      if (!in) {
+        throw std::runtime_error("cannot open radio command file " + commandsPath);
+      }
+      // Each line: <seconds> <command>
+      double seconds;
+      std::string command;
+      while (in >> seconds >> command) {
+        m_commands.emplace_back(static_cast<uint64_t>(seconds * 1e6), command + "\n");
+      }
+    }
+    if (!outputPath.empty()) {
+      m_output = fopen(outputPath.c_str(), "wb");
+      if (m_output == nullptr) {
+        throw std::runtime_error("cannot open radio output " + outputPath);
+      }
+    }
+  }
+
+  ~Radio() override {
+    if (m_output != nullptr) {
+      fclose(m_output);
+    }
+  }
+
+  void onBegin(unsigned long baud) override {
+    m_baud = baud;
+  }
+
+  uint64_t nextDue() override {
+    while (m_pending.empty() && m_next < m_commands.size()) {
+      uint64_t due = m_commands[m_next].first;
+      for (char c : m_commands[m_next].second) {
+        due += 10000000ULL / m_baud;
+        m_pending.emplace_back(due, static_cast<uint8_t>(c));
+      }
+      ++m_next;
+    }
+    return m_pending.empty() ? UINT64_MAX : m_pending.front().first;
+  }
+
+  bool pop(uint8_t& c) override {
+    if (m_pending.empty()) {
+      return false;
+    }
+    c = m_pending.front().second;
+    m_pending.pop_front();
+    return true;
+  }
+
+  void receive(const uint8_t* data, size_t length, uint64_t /*when*/) override {
+    if (m_output != nullptr) {
+      fwrite(data, 1, length, m_output);
+    }
+  }
+
+private:
+  unsigned long m_baud;
+  FILE* m_output;
+  std::vector<std::pair<uint64_t, std::string>> m_commands;
+  size_t m_next = 0;
+  std::deque<std::pair<uint64_t, uint8_t>> m_pending;
+};
+
+} // namespace
+
+std::unique_ptr<UartDevice> makeGpsReceiver(const std::string& nmeaPath, bool txWired) {
+  return std::unique_ptr<UartDevice>(new GpsReceiver(nmeaPath, txWired));
+}
+
+std::unique_ptr<UartDevice> makeRadio(const std::string& commandsPath, const std::string& outputPath) {
+  return std::unique_ptr<UartDevice>(new Radio(commandsPath, outputPath));
+}
+
+} // namespace hostsim
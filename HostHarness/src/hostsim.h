@@ -0,0 +1,258 @@
+#pragma once
+
+// Internal interface of the host simulation. Not visible to the firmware: sketches only see the
+// Arduino-style headers in ../stubs.
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+class SERCOM;
+
+namespace hostsim {
+
+// ---------------------------------------------------------------------------------------------
+// Virtual clock
+
+/** Current virtual time in microseconds since power-on. */
+uint64_t now() noexcept;
+
+/**
+ * Spend `us` microseconds of busy time on the current task (a blocking peripheral transfer or a
+ * spin-wait). Other Scheduler loops do not run meanwhile, exactly as on the board.
+ */
+void advance(uint64_t us);
+
+/** Move the clock forward to `when` if it is in the future. Used by the scheduler when idle. */
+void advanceTo(uint64_t when);
+
+/** The run ends (and finish() is called) once the clock reaches this time. */
+void setEndOfRun(uint64_t when) noexcept;
+
+/** Deliver any UART bytes and DMA completions that have become due through their interrupt handlers. */
+void serviceInterrupts();
+
+// ---------------------------------------------------------------------------------------------
+// Scheduler
+
+/** Record a human-readable name for a Scheduler loop, used in the report. */
+void nameLoop(void (*task)(), const char* name);
+
+struct LoopStats {
+  std::string name;
+  uint64_t iterations = 0;
+  uint64_t firstStart = UINT64_MAX;
+  uint64_t lastEnd = 0;
+  uint64_t maxDuration = 0;
+
+  void record(uint64_t start, uint64_t end) noexcept {
+    ++iterations;
+    if (start < firstStart) {
+      firstStart = start;
+    }
+    lastEnd = end;
+    if (end - start > maxDuration) {
+      maxDuration = end - start;
+    }
+  }
+};
+
+/** Stats of every loop: the sketch's loop() first, then each Scheduler.startLoop task. */
+std::vector<const LoopStats*> loopStats();
+
+/** Stats of the sketch's own loop(), updated by the main entry point. */
+LoopStats& mainLoopStats();
+
+/** Index of the running task: 0 for setup()/loop(), then Scheduler tasks in start order. */
+size_t currentTask() noexcept;
+
+struct FunctionStats {
+  std::string name;
+  uint64_t calls = 0;
+  uint64_t totalMicros = 0;
+  uint64_t maxMicros = 0;
+
+  void record(uint64_t micros) noexcept {
+    ++calls;
+    totalMicros += micros;
+    if (micros > maxMicros) {
+      maxMicros = micros;
+    }
+  }
+};
+
+/**
+ * Time calls to the named sketch functions (comma-separated, without parameters) on the virtual
+ * clock. Includes time spent in other tasks if the function yields.
+ */
+void profileFunctions(const std::string& names);
+
+/** Stats of every profiled function that has been called. */
+std::vector<const FunctionStats*> functionStats();
+
+// ---------------------------------------------------------------------------------------------
+// Flight model
+
+/** True state of the vehicle and its environment at one instant. */
+struct FlightSample {
+  double altitudeAGL = 0.0;   // ft
+  double altitudeMSL = 0.0;   // ft
+  double accel[3] = {0.0, 0.0, 9.80665}; // m/s^2, sensor frame
+  double gyro[3] = {0.0, 0.0, 0.0};      // rad/s
+  double humidity = 40.0;     // %RH
+  double temperature = 20.0;  // deg C
+  int voc = 300;              // raw ADC counts
+  double tankPressure = 0.0;  // psi
+  int32_t latitude = 0;       // 10^-7 deg
+  int32_t longitude = 0;      // 10^-7 deg
+  int satellites = 9;
+};
+
+class Trace {
+public:
+  virtual ~Trace() = default;
+  /** State at `seconds` after power-on. */
+  virtual FlightSample at(double seconds) const = 0;
+  /** Time at which the recording ends, in seconds. */
+  virtual double duration() const = 0;
+};
+
+/** A built-in ~10,000 ft flight: pad, 3 s boost, coast, drogue and main descent, landing. */
+std::unique_ptr<Trace> makeSyntheticFlight();
+
+/**
+ * A recorded flight in CSV form. Columns are matched by header name and use the repo's log names
+ * ("Altitude (AGL)", "Accel X", ..., "Gyro Z", "Humidity", "Temperature", "VOC Reading", "Latitude",
+ * "Longitude", "Altitude (MSL)", "Satellites"), plus an optional time column in seconds ("Time",
+ * "Time (s)"). Without a time column, rows are `rowRate` Hz apart. Quoted numbers may contain
+ * thousands separators ("12,345").
+ */
+std::unique_ptr<Trace> loadCsvTrace(const std::string& path, double rowRate);
+
+// ---------------------------------------------------------------------------------------------
+// Devices
+
+/** Something attached to a SERCOM UART: the GPS receiver or the radio. */
+class UartDevice {
+public:
+  virtual ~UartDevice() = default;
+  /** Called when the MCU opens the port. */
+  virtual void onBegin(unsigned long /*baud*/) {}
+  /** Virtual time at which the next byte for the MCU is on the wire, or UINT64_MAX. */
+  virtual uint64_t nextDue() = 0;
+  /** Take the next due byte. */
+  virtual bool pop(uint8_t& c) = 0;
+  /** Bytes transmitted by the MCU, fully shifted out at `when`. */
+  virtual void receive(const uint8_t* /*data*/, size_t /*length*/, uint64_t /*when*/) {}
+};
+
+struct UartPort {
+  std::unique_ptr<UartDevice> device;
+  unsigned long baud = 0;
+  uint32_t bitsPerByte = 10;
+  uint64_t txBusyUntil = 0;
+  uint64_t bytesSent = 0;
+  uint64_t bytesReceived = 0;
+  uint64_t rxOverruns = 0;
+  uint64_t txStallMicros = 0;
+};
+
+UartPort& uartPort(int sercomIndex);
+
+/** Something on an I2C bus, addressed with register-level transactions through TwoWire. */
+class I2cDevice {
+public:
+  virtual ~I2cDevice() = default;
+  /** The master wrote `length` bytes in one transaction (usually a register address first). */
+  virtual void write(const uint8_t* data, size_t length) = 0;
+  /** The master reads `length` bytes. */
+  virtual void read(uint8_t* data, size_t length) = 0;
+  /** Whether the device acknowledges a read now. Some parts NACK their address while busy. */
+  virtual bool acknowledgesRead() { return true; }
+};
+
+/** The device answering at `address` on the given bus, or nullptr if nothing would ACK. */
+I2cDevice* i2cDevice(const SERCOM* bus, uint8_t address);
+
+/** One asynchronous I2C transaction (I2cDma.h), as it occupied its bus. */
+struct I2cDmaTransfer {
+  int sercom;
+  uint64_t start;
+  uint64_t end;
+  bool acknowledged;
+};
+
+/** Every asynchronous transaction finished since the last call, in the order they finished. */
+std::vector<I2cDmaTransfer> takeI2cDmaTransfers();
+
+/** When the next asynchronous transaction still on a bus finishes, or UINT64_MAX. */
+uint64_t nextI2cDmaDue() noexcept;
+
+/** Finish the transactions that are due and raise DMAC_Handler for them. */
+void serviceI2cDma();
+
+/**
+ * GPS receiver emitting NMEA epochs, either synthesized from the trace or replayed from a file. It
+ * obeys PMTK configuration commands only if `txWired` (the MCU's TX reaches it).
+ */
+std::unique_ptr<UartDevice> makeGpsReceiver(const std::string& nmeaPath, bool txWired);
+
+/** Ground radio: delivers scheduled commands and optionally records what the MCU transmits. */
+std::unique_ptr<UartDevice> makeRadio(const std::string& commandsPath, const std::string& outputPath);
+
+struct SdStats {
+  uint64_t bytesWritten = 0;
+  uint64_t writeCalls = 0;
+  uint64_t blockWrites = 0;
+  uint64_t opens = 0;
+  uint64_t closes = 0;
+  uint64_t flushes = 0;
+  uint64_t lookups = 0;
+  uint64_t busyMicros = 0;
+};
+SdStats& sdStats();
+
+// ---------------------------------------------------------------------------------------------
+// Options and world
+
+struct Options {
+  std::string tracePath;
+  std::string nmeaPath;
+  std::string radioInPath;
+  std::string radioOutPath;
+  std::string sdDir = "sdcard";
+  double rowRate = 50.0;
+  double duration = -1.0;       // seconds; < 0 means "until the trace ends"
+  double baroNoise = 0.0;       // ft, 1 sigma
+  double padPressure = 1000.0;  // hPa
+  uint32_t seed = 1;
+  std::string profile;          // comma-separated sketch functions to time
+  bool gpsTxWired = true;       // whether PMTK commands reach the GPS receiver
+  bool quiet = false;
+};
+
+const Options& options();
+Options& mutableOptions();
+
+/** Install the flight the sensors will observe. */
+void setTrace(std::unique_ptr<Trace> trace);
+const Trace& trace();
+
+/** Truth at the current virtual time. */
+const FlightSample& truth();
+
+/** Standard normal deviate from the simulation's seeded generator. */
+double gaussian();
+
+/** Record a digital pin level change for the report. */
+void pinChanged(uint32_t pin, uint32_t value);
+
+/** Restart the host-time measurement used by the summary. */
+void startWallClock();
+
+/** Print the run summary and exit. Called when the virtual clock reaches the end of the run. */
+[[noreturn]] void finish();
+
+} // namespace hostsim
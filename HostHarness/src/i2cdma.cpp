@@ -0,0 +1,159 @@
+#include <vector>
+
+#include "hostsim.h"
+
+#include "I2cDma.h"
+
+extern "C" void DMAC_Handler(void);
+
+// Stand-in for the SAMD21 half of I2cDma.h (I2cDmaSamd.h). A transaction holds its bus for the
+// time its bytes take at the bus's clock (TwoWire::busMicros), starting when it is started, and
+// the device sees it when it ends. Then DMAC_Handler runs, as the DMA's transfer-complete
+// interrupt does on the board; there, write-only and failed transactions end in the SERCOM's
+// interrupt instead, which takes about as long. Only CPU time is charged to whoever runs: the
+// register writes that start a transaction and the interrupts.
+
+namespace {
+
+// Setting up the DMA channel and writing the address register
+const uint64_t START_MICROS = 3;
+// One interrupt: each byte of the register address (SERCOM), then the completion (DMAC)
+const uint64_t INTERRUPT_MICROS = 2;
+
+struct BusState {
+  I2CBus* bus;
+  I2CTransaction* transaction = nullptr;
+  uint64_t start = 0;
+  uint64_t due = 0;
+  bool acknowledged = false;
+  // Moved and waiting for DMAC_Handler
+  bool finished = false;
+};
+
+std::vector<BusState>& buses() {
+  static std::vector<BusState> buses;
+  return buses;
+}
+
+BusState& stateOf(I2CBus* bus) {
+  for (BusState& state : buses()) {
+    if (state.bus == bus) {
+      return state;
+    }
+  }
+  buses().push_back(BusState());
+  buses().back().bus = bus;
+  return buses().back();
+}
+
+std::vector<hostsim::I2cDmaTransfer>& transfers() {
+  static std::vector<hostsim::I2cDmaTransfer> transfers;
+  return transfers;
+}
+
+/** The transaction reaches its device, as TwoWire::endTransmission() and requestFrom() do. */
+void move(BusState& state) {
+  I2CTransaction& transaction = *state.transaction;
+  const SERCOM* sercom = state.bus->wire()->sercom();
+  hostsim::I2cDevice* device = hostsim::i2cDevice(sercom, transaction.address);
+  if (!state.acknowledged) {
+    if (device != nullptr && transaction.writeLength > 0) {
+      device->write(transaction.writeData, transaction.writeLength);
+    }
+  } else {
+    if (transaction.writeLength > 0) {
+      device->write(transaction.writeData, transaction.writeLength);
+    }
+    if (transaction.readLength > 0) {
+      device->read(transaction.readData, transaction.readLength);
+    }
+  }
+  transfers().push_back({sercom->index(), state.start, state.due, state.acknowledged});
+}
+
+} // namespace
+
+void I2CBus::hardwareBegin() {
+  stateOf(this);
+}
+
+void I2CBus::hardwareStart(I2CTransaction& transaction) {
+  hostsim::advance(START_MICROS);
+  BusState& state = stateOf(this);
+  hostsim::I2cDevice* device = hostsim::i2cDevice(m_wire->sercom(), transaction.address);
+  // Whether the device acknowledges its read address is up to it when the read starts
+  state.acknowledged = device != nullptr && (transaction.readLength == 0 || device->acknowledgesRead());
+  uint32_t bus;
+  if (device == nullptr) {
+    // Only the address byte goes out before the NACK
+    bus = m_wire->busMicros(0, 0);
+  } else if (!state.acknowledged) {
+    bus = m_wire->busMicros(transaction.writeLength, 0) + (transaction.writeLength > 0 ? m_wire->busMicros(0, 0) : 0);
+  } else {
+    bus = m_wire->busMicros(transaction.writeLength, transaction.readLength);
+  }
+  state.transaction = &transaction;
+  state.start = hostsim::now();
+  state.due = state.start + bus;
+  state.finished = false;
+}
+
+void I2CBus::onService() {}
+
+void I2CBus::onDmaInterrupt() {
+  for (BusState& state : buses()) {
+    if (!state.finished) {
+      continue;
+    }
+    state.finished = false;
+    I2CTransaction* transaction = state.transaction;
+    state.transaction = nullptr;
+    hostsim::advance(INTERRUPT_MICROS * (1 + transaction->writeLength));
+    // finish() may start the next transaction on this bus, which takes over `state`
+    state.bus->finish(state.acknowledged ? I2CTransaction::DONE : I2CTransaction::NACK);
+  }
+}
+
+void I2CBus::waitForInterrupt() {
+  uint64_t due = hostsim::nextI2cDmaDue();
+  if (due == UINT64_MAX) {
+    // Nothing running: the SysTick interrupt comes within a millisecond
+    due = hostsim::now() + 1000;
+  }
+  // Already due if it finished while another interrupt was being handled
+  hostsim::advance(due > hostsim::now() ? due - hostsim::now() : 0);
+}
+
+namespace hostsim {
+
+std::vector<I2cDmaTransfer> takeI2cDmaTransfers() {
+  std::vector<I2cDmaTransfer> taken;
+  taken.swap(transfers());
+  return taken;
+}
+
+uint64_t nextI2cDmaDue() noexcept {
+  uint64_t next = UINT64_MAX;
+  for (const BusState& state : buses()) {
+    if (state.transaction != nullptr && !state.finished && state.due < next) {
+      next = state.due;
+    }
+  }
+  return next;
+}
+
+void serviceI2cDma() {
+  bool raised = false;
+  for (BusState& state : buses()) {
+    if (state.transaction != nullptr && !state.finished && state.due <= now()) {
+      move(state);
+      state.finished = true;
+      raised = true;
+    }
+  }
+  if (raised) {
+    DMAC_Handler();
+  }
+}
+
+} // namespace hostsim
@@ -0,0 +1,99 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include "hostsim.h"
+
+// Entry point of a simulated board: parse options, install the flight and devices, then run the
+// sketch's setup() and loop() on the virtual clock until the flight is over.
+
+void setup();
+void loop();
+
+namespace {
+
+void usage(const char* program) {
+  fprintf(stderr,
+    "usage: %s [options]\n"
+    "  --trace FILE       flight CSV (default: built-in synthetic flight)\n"
+    "  --rate HZ          row rate of a trace without a time column (default 50)\n"
+    "  --nmea FILE        NMEA log to replay from the GPS (default: synthesized from the trace)\n"
+    "  --gps-no-tx        the GPS ignores configuration commands, as if its RX pin weren't wired\n"
+    "  --radio-in FILE    radio commands, one '<seconds> <command>' per line (default: '1 start')\n"
+    "  --radio-out FILE   write everything the board transmits over the radio to FILE\n"
+    "  --sd-dir DIR       host directory backing the SD card (default: ./sdcard)\n"
+    "  --duration S       stop after S simulated seconds (default: end of trace)\n"
+    "  --baro-noise FT    1-sigma barometer noise in feet (default 0)\n"
+    "  --pad-pressure HPA static pressure at the pad (default 1000)\n"
+    "  --seed N           seed for simulated noise (default 1)\n"
+    "  --profile F[,F...] report virtual time spent per call in these sketch functions\n"
+    "  --quiet            only print the summary table\n",
+    program);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  hostsim::Options& opts = hostsim::mutableOptions();
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    auto value = [&]() -> const char* {
+      if (i + 1 >= argc) {
+        fprintf(stderr, "%s needs a value\n", arg.c_str());
+        std::exit(EXIT_FAILURE);
+      }
+      return argv[++i];
+    };
+    if (arg == "--trace") opts.tracePath = value();
+    else if (arg == "--rate") opts.rowRate = atof(value());
+    else if (arg == "--nmea") opts.nmeaPath = value();
+    else if (arg == "--gps-no-tx") opts.gpsTxWired = false;
+    else if (arg == "--radio-in") opts.radioInPath = value();
+    else if (arg == "--radio-out") opts.radioOutPath = value();
+    else if (arg == "--sd-dir") opts.sdDir = value();
+    else if (arg == "--duration") opts.duration = atof(value());
+    else if (arg == "--baro-noise") opts.baroNoise = atof(value());
+    else if (arg == "--pad-pressure") opts.padPressure = atof(value());
+    else if (arg == "--seed") opts.seed = static_cast<uint32_t>(strtoul(value(), nullptr, 10));
+    else if (arg == "--profile") opts.profile = value();
+    else if (arg == "--quiet") opts.quiet = true;
+    else {
+      usage(argv[0]);
+      return arg == "--help" ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+
+  try {
+    if (opts.tracePath.empty()) {
+      hostsim::setTrace(hostsim::makeSyntheticFlight());
+    } else {
+      hostsim::setTrace(hostsim::loadCsvTrace(opts.tracePath, opts.rowRate));
+    }
+    hostsim::uartPort(0).device = hostsim::makeGpsReceiver(opts.nmeaPath, opts.gpsTxWired);
+    hostsim::uartPort(5).device = hostsim::makeRadio(opts.radioInPath, opts.radioOutPath);
+  } catch (const std::exception& e) {
+    fprintf(stderr, "%s\n", e.what());
+    return EXIT_FAILURE;
+  }
+
+  hostsim::profileFunctions(opts.profile);
+
+  double duration = opts.duration >= 0.0 ? opts.duration : hostsim::trace().duration();
+  hostsim::setEndOfRun(static_cast<uint64_t>(duration * 1e6));
+  hostsim::startWallClock();
+
+  setup();
+  hostsim::LoopStats& stats = hostsim::mainLoopStats();
+  while (true) {
+    uint64_t start = hostsim::now();
+    loop();
+    if (hostsim::now() == start) {
+      // The core's main() does a little bookkeeping between iterations
+      hostsim::advance(1);
+    }
+    stats.record(start, hostsim::now());
+  }
+}
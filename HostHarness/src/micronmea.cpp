@@ -0,0 +1,245 @@
+#include <climits>
+
+#include "MicroNMEA.h"
+
+namespace {
+
+int hexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+const char* skipField(const char* s) {
+  if (s == nullptr) {
+    return nullptr;
+  }
+  while (*s != '\0' && *s != ',' && *s != '*') {
+    ++s;
+  }
+  return *s == ',' ? s + 1 : nullptr;
+}
+
+unsigned int parseUnsignedInt(const char* s, uint8_t len) {
+  unsigned int r = 0;
+  while (len-- > 0 && *s >= '0' && *s <= '9') {
+    r = 10 * r + (*s++ - '0');
+  }
+  return r;
+}
+
+/** Parse a decimal number into an integer scaled by 10^log10Multiplier. */
+long parseFloat(const char* s, uint8_t log10Multiplier) {
+  bool negative = *s == '-';
+  if (negative) {
+    ++s;
+  }
+  long r = 0;
+  while (*s >= '0' && *s <= '9') {
+    r = 10 * r + (*s++ - '0');
+  }
+  for (uint8_t i = 0; i < log10Multiplier; ++i) {
+    r *= 10;
+  }
+  if (*s == '.') {
+    ++s;
+    long scale = 1;
+    for (uint8_t i = 0; i < log10Multiplier; ++i) {
+      scale *= 10;
+    }
+    while (*s >= '0' && *s <= '9') {
+      scale /= 10;
+      r += (*s++ - '0') * scale;
+    }
+  }
+  return negative ? -r : r;
+}
+
+/** Parse (d)ddmm.mmmm into millionths of a degree. */
+long parseDegreeMinute(const char* s, uint8_t degWidth) {
+  if (*s == ',' || *s == '\0') {
+    return 0;
+  }
+  long degrees = parseUnsignedInt(s, degWidth);
+  long minutesMillionths = parseFloat(s + degWidth, 6);
+  return degrees * 1000000L + (minutesMillionths + 30) / 60;
+}
+
+} // namespace
+
+bool MicroNMEA::testChecksum(const char* s) {
+  if (*s != '$') {
+    return false;
+  }
+  uint8_t checksum = 0;
+  ++s;
+  while (*s != '\0' && *s != '*') {
+    checksum ^= static_cast<uint8_t>(*s++);
+  }
+  if (*s != '*') {
+    return false;
+  }
+  int high = hexDigit(s[1]);
+  int low = hexDigit(s[2]);
+  return high >= 0 && low >= 0 && checksum == ((high << 4) | low);
+}
+
+MicroNMEA::MicroNMEA() noexcept : MicroNMEA(nullptr, 0) {}
+
+MicroNMEA::MicroNMEA(void* buffer, uint8_t len) noexcept :
+  m_badChecksumHandler(nullptr),
+  m_unknownSentenceHandler(nullptr),
+  m_talkerID('\0'),
+  m_messageID{0} {
+  setBuffer(buffer, len);
+  clear();
+}
+
+void MicroNMEA::setBuffer(void* buffer, uint8_t len) noexcept {
+  m_buffer = static_cast<char*>(buffer);
+  m_bufferLen = len;
+  m_ptr = m_buffer;
+  if (m_buffer != nullptr && m_bufferLen > 0) {
+    m_buffer[0] = '\0';
+  }
+}
+
+void MicroNMEA::clear() noexcept {
+  m_navSystem = '\0';
+  m_numSat = 0;
+  m_hdop = 255;
+  m_isValid = false;
+  m_latitude = 999000000L;
+  m_longitude = 999000000L;
+  m_altitude = m_speed = m_course = LONG_MIN;
+  m_altitudeValid = false;
+  m_year = m_month = m_day = 0;
+  m_hour = m_minute = m_second = 99;
+  m_hundredths = 0;
+}
+
+bool MicroNMEA::process(char c) {
+  if (m_buffer == nullptr || m_bufferLen == 0) {
+    return false;
+  }
+  if (c == '\0' || c == '\n' || c == '\r') {
+    *m_ptr = '\0';
+    m_ptr = m_buffer;
+    if (*m_buffer == '$' && testChecksum(m_buffer)) {
+      const char* data;
+      if (m_buffer[1] == 'G') {
+        m_talkerID = m_buffer[2];
+        data = m_buffer + 3;
+      } else {
+        m_talkerID = '\0';
+        data = m_buffer + 1;
+      }
+      size_t i = 0;
+      while (i + 1 < sizeof m_messageID && data[i] != ',' && data[i] != '\0') {
+        m_messageID[i] = data[i];
+        ++i;
+      }
+      m_messageID[i] = '\0';
+      data = skipField(data);
+
+      if (data != nullptr && strcmp(m_messageID, "GGA") == 0) {
+        return processGGA(data);
+      } else if (data != nullptr && strcmp(m_messageID, "RMC") == 0) {
+        return processRMC(data);
+      } else if (m_unknownSentenceHandler != nullptr) {
+        m_unknownSentenceHandler(*this);
+      }
+    } else if (m_badChecksumHandler != nullptr && *m_buffer != '\0') {
+      m_badChecksumHandler(*this);
+    }
+    // A complete, non-empty sentence counts even if it was not one we parse
+    return *m_buffer != '\0';
+  }
+
+  *m_ptr = c;
+  if (m_ptr < m_buffer + m_bufferLen - 1) {
+    ++m_ptr;
+  }
+  return false;
+}
+
+bool MicroNMEA::processGGA(const char* s) {
+  m_navSystem = m_talkerID;
+  // UTC time
+  if (*s != ',') {
+    m_hour = parseUnsignedInt(s, 2);
+    m_minute = parseUnsignedInt(s + 2, 2);
+    m_second = parseUnsignedInt(s + 4, 2);
+    m_hundredths = s[6] == '.' ? parseUnsignedInt(s + 7, 2) : 0;
+  }
+  s = skipField(s);
+  if (s == nullptr) return false;
+  m_latitude = parseDegreeMinute(s, 2);
+  s = skipField(s);
+  if (s == nullptr) return false;
+  if (*s == 'S') m_latitude = -m_latitude;
+  s = skipField(s);
+  if (s == nullptr) return false;
+  m_longitude = parseDegreeMinute(s, 3);
+  s = skipField(s);
+  if (s == nullptr) return false;
+  if (*s == 'W') m_longitude = -m_longitude;
+  s = skipField(s);
+  if (s == nullptr) return false;
+  m_isValid = *s >= '1' && *s <= '5';
+  s = skipField(s);
+  if (s == nullptr) return false;
+  m_numSat = parseUnsignedInt(s, 3);
+  s = skipField(s);
+  if (s == nullptr) return false;
+  m_hdop = static_cast<uint8_t>(parseFloat(s, 1));
+  s = skipField(s);
+  if (s == nullptr) return false;
+  if (*s != ',') {
+    m_altitude = parseFloat(s, 3);
+    m_altitudeValid = true;
+  } else {
+    m_altitudeValid = false;
+  }
+  return true;
+}
+
+bool MicroNMEA::processRMC(const char* s) {
+  m_navSystem = m_talkerID;
+  if (*s != ',') {
+    m_hour = parseUnsignedInt(s, 2);
+    m_minute = parseUnsignedInt(s + 2, 2);
+    m_second = parseUnsignedInt(s + 4, 2);
+    m_hundredths = s[6] == '.' ? parseUnsignedInt(s + 7, 2) : 0;
+  }
+  s = skipField(s);
+  if (s == nullptr) return false;
+  m_isValid = *s == 'A';
+  s = skipField(s);
+  if (s == nullptr) return false;
+  m_latitude = parseDegreeMinute(s, 2);
+  s = skipField(s);
+  if (s == nullptr) return false;
+  if (*s == 'S') m_latitude = -m_latitude;
+  s = skipField(s);
+  if (s == nullptr) return false;
+  m_longitude = parseDegreeMinute(s, 3);
+  s = skipField(s);
+  if (s == nullptr) return false;
+  if (*s == 'W') m_longitude = -m_longitude;
+  s = skipField(s);
+  if (s == nullptr) return false;
+  m_speed = parseFloat(s, 3);
+  s = skipField(s);
+  if (s == nullptr) return false;
+  m_course = parseFloat(s, 3);
+  s = skipField(s);
+  if (s == nullptr) return false;
+  if (*s != ',') {
+    m_day = parseUnsignedInt(s, 2);
+    m_month = parseUnsignedInt(s + 2, 2);
+    m_year = 2000 + parseUnsignedInt(s + 4, 2);
+  }
+  return true;
+}
@@ -0,0 +1,130 @@
+#include <cxxabi.h>
+#include <dlfcn.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "hostsim.h"
+
+// Per-function virtual-time profile. The sketch is compiled with -finstrument-functions, so the
+// compiler calls the hooks below on entry to and exit from every sketch function; the ones named
+// with --profile are timed on the virtual clock. Each Scheduler task has its own call stack, since
+// a task can be switched out in the middle of a function.
+
+namespace hostsim {
+
+namespace {
+
+struct Frame {
+  FunctionStats* stats; // nullptr if the function isn't profiled
+  uint64_t start;
+};
+
+struct Profile {
+  std::vector<std::string> wanted;
+  std::unordered_map<void*, FunctionStats*> byAddress;
+  std::vector<std::unique_ptr<FunctionStats>> functions;
+  std::vector<std::vector<Frame>> stacks;
+};
+
+// Never destroyed: the sketch's global destructors are instrumented too, and run during exit()
+Profile* g_profile = nullptr;
+
+/** Profiled stats for the function at `address`, or nullptr. Resolves each address once. */
+FunctionStats* lookup(void* address) {
+  auto it = g_profile->byAddress.find(address);
+  if (it != g_profile->byAddress.end()) {
+    return it->second;
+  }
+
+  FunctionStats* stats = nullptr;
+  Dl_info info;
+  if (dladdr(address, &info) != 0 && info.dli_sname != nullptr) {
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+    std::string name = status == 0 ? demangled : info.dli_sname;
+    free(demangled);
+    name = name.substr(0, name.find('('));
+    for (const std::string& wanted : g_profile->wanted) {
+      if (name == wanted) {
+        g_profile->functions.emplace_back(new FunctionStats{name});
+        stats = g_profile->functions.back().get();
+        break;
+      }
+    }
+  }
+  g_profile->byAddress.emplace(address, stats);
+  return stats;
+}
+
+} // namespace
+
+void profileFunctions(const std::string& names) {
+  if (names.empty()) {
+    return;
+  }
+  if (g_profile == nullptr) {
+    g_profile = new Profile();
+  }
+  size_t start = 0;
+  while (start <= names.size()) {
+    size_t end = names.find(',', start);
+    if (end == std::string::npos) {
+      end = names.size();
+    }
+    if (end > start) {
+      g_profile->wanted.push_back(names.substr(start, end - start));
+    }
+    start = end + 1;
+  }
+}
+
+std::vector<const FunctionStats*> functionStats() {
+  std::vector<const FunctionStats*> result;
+  if (g_profile != nullptr) {
+    for (const auto& stats : g_profile->functions) {
+      result.push_back(stats.get());
+    }
+  }
+  return result;
+}
+
+} // namespace hostsim
+
+using namespace hostsim;
+
+extern "C" {
+
+__attribute__((no_instrument_function))
+void __cyg_profile_func_enter(void* function, void* /*callSite*/) {
+  if (g_profile == nullptr) {
+    return;
+  }
+  size_t task = currentTask();
+  if (task >= g_profile->stacks.size()) {
+    g_profile->stacks.resize(task + 1);
+  }
+  g_profile->stacks[task].push_back(Frame{lookup(function), now()});
+}
+
+__attribute__((no_instrument_function))
+void __cyg_profile_func_exit(void* /*function*/, void* /*callSite*/) {
+  if (g_profile == nullptr || currentTask() >= g_profile->stacks.size()) {
+    return;
+  }
+  std::vector<Frame>& stack = g_profile->stacks[currentTask()];
+  if (stack.empty()) {
+    return;
+  }
+  Frame frame = stack.back();
+  stack.pop_back();
+  if (frame.stats != nullptr) {
+    frame.stats->record(now() - frame.start);
+  }
+}
+
+} // extern "C"
@@ -0,0 +1,100 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "hostsim.h"
+
+// End-of-run summary of a simulated board.
+
+namespace hostsim {
+
+namespace {
+
+std::chrono::steady_clock::time_point g_wallStart = std::chrono::steady_clock::now();
+
+struct PinEvent {
+  uint64_t when;
+  uint32_t pin;
+  uint32_t value;
+};
+std::vector<PinEvent> g_pinEvents;
+
+double perSecond(uint64_t count, double seconds) {
+  return seconds > 0.0 ? count / seconds : 0.0;
+}
+
+} // namespace
+
+void startWallClock() {
+  g_wallStart = std::chrono::steady_clock::now();
+}
+
+void pinChanged(uint32_t pin, uint32_t value) {
+  g_pinEvents.push_back(PinEvent{now(), pin, value});
+}
+
+void finish() {
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - g_wallStart).count();
+  double simulated = now() / 1e6;
+
+  printf("Simulated %.2f s in %.3f s of host time (%.1fx real time)\n\n", simulated, wall,
+    wall > 0.0 ? simulated / wall : 0.0);
+  printf("%-20s %12s %12s %14s %16s\n", "loop", "iterations", "per sim s", "per host s", "max period ms");
+  for (const LoopStats* stats : loopStats()) {
+    double span = stats->iterations == 0 ? 0.0 : (stats->lastEnd - stats->firstStart) / 1e6;
+    printf("%-20s %12llu %12.1f %14.0f %16.3f\n", stats->name.c_str(),
+      static_cast<unsigned long long>(stats->iterations), perSecond(stats->iterations, span),
+      perSecond(stats->iterations, wall), stats->maxDuration / 1e3);
+  }
+
+  std::vector<const FunctionStats*> functions = functionStats();
+  if (!functions.empty()) {
+    printf("\n%-20s %12s %12s %12s\n", "function", "calls", "mean us", "max us");
+    for (const FunctionStats* f : functions) {
+      printf("%-20s %12llu %12.1f %12llu\n", f->name.c_str(), static_cast<unsigned long long>(f->calls),
+        f->calls == 0 ? 0.0 : static_cast<double>(f->totalMicros) / f->calls,
+        static_cast<unsigned long long>(f->maxMicros));
+    }
+  }
+
+  if (!options().quiet) {
+    printf("\n");
+    const char* const PORT_NAMES[6] = {"sercom0", "sercom1", "sercom2", "sercom3", "sercom4", "sercom5"};
+    for (int i = 0; i < 6; ++i) {
+      const UartPort& port = uartPort(i);
+      if (port.baud == 0) {
+        continue;
+      }
+      printf("UART %s @ %lu: %llu B sent (%.0f B/s), %llu B received, %llu RX overruns, %.3f s TX stall\n",
+        PORT_NAMES[i], port.baud, static_cast<unsigned long long>(port.bytesSent),
+        perSecond(port.bytesSent, simulated), static_cast<unsigned long long>(port.bytesReceived),
+        static_cast<unsigned long long>(port.rxOverruns), port.txStallMicros / 1e6);
+    }
+
+    const SdStats& sd = sdStats();
+    printf("SD: %llu B in %llu writes, %llu block writes, %llu opens, %llu closes, %llu flushes, "
+           "%llu lookups, %.3f s busy\n",
+      static_cast<unsigned long long>(sd.bytesWritten), static_cast<unsigned long long>(sd.writeCalls),
+      static_cast<unsigned long long>(sd.blockWrites), static_cast<unsigned long long>(sd.opens),
+      static_cast<unsigned long long>(sd.closes), static_cast<unsigned long long>(sd.flushes),
+      static_cast<unsigned long long>(sd.lookups), sd.busyMicros / 1e6);
+
+    // Only report pins that change rarely (relays, not blinking LEDs)
+    std::vector<int> changes(64, 0);
+    for (const PinEvent& e : g_pinEvents) {
+      ++changes[e.pin];
+    }
+    for (const PinEvent& e : g_pinEvents) {
+      if (changes[e.pin] <= 4) {
+        printf("pin %u -> %s at %.3f s\n", e.pin, e.value ? "HIGH" : "LOW", e.when / 1e6);
+      }
+    }
+  }
+
+  fflush(stdout);
+  std::exit(EXIT_SUCCESS);
+}
+
+} // namespace hostsim
+
@@ -0,0 +1,182 @@
+#include <ucontext.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "hostsim.h"
+
+#include "Scheduler.h"
+
+// Cooperative scheduler on ucontext. Task 0 is the sketch's setup()/loop(); every
+// Scheduler.startLoop() call adds a task with its own stack. As in the Arduino library, control
+// only changes hands inside yield(). When every task is waiting in delay(), the virtual clock jumps
+// straight to the earliest deadline, which is what lets a flight replay faster than real time.
+
+SchedulerClass Scheduler;
+
+namespace hostsim {
+
+namespace {
+
+struct Task {
+  ucontext_t context;
+  std::vector<char> stack;
+  SchedulerTask loop = nullptr;
+  SchedulerParametricTask parametric = nullptr;
+  void* data = nullptr;
+  bool repeat = false;
+  bool finished = false;
+  uint64_t wake = 0;
+  LoopStats stats;
+};
+
+// Simulated tasks get far more stack than the board's 1 KiB default, because host code (printf,
+// file I/O in the stand-ins) is much hungrier than the firmware itself.
+const size_t HOST_STACK_SIZE = 256 * 1024;
+
+std::vector<std::unique_ptr<Task>> g_tasks;
+size_t g_current = 0;
+LoopStats g_mainStats{"loop"};
+
+// Function-local so sketches can register names from static initializers
+std::map<void (*)(), std::string>& loopNames() {
+  static std::map<void (*)(), std::string> names;
+  return names;
+}
+
+void ensureMainTask() {
+  if (g_tasks.empty()) {
+    g_tasks.emplace_back(new Task());
+  }
+}
+
+void taskEntry(int index) {
+  Task& task = *g_tasks[index];
+  if (task.repeat) {
+    while (true) {
+      uint64_t start = now();
+      task.loop();
+      task.stats.record(start, now());
+    }
+  } else if (task.parametric != nullptr) {
+    task.parametric(task.data);
+  } else {
+    task.loop();
+  }
+  task.finished = true;
+  while (true) {
+    yield();
+  }
+}
+
+bool runnable(const Task& task) {
+  return !task.finished && task.wake <= now();
+}
+
+void switchTo(size_t next) {
+  if (next == g_current) {
+    return;
+  }
+  size_t previous = g_current;
+  g_current = next;
+  swapcontext(&g_tasks[previous]->context, &g_tasks[next]->context);
+}
+
+void startTask(std::unique_ptr<Task> task) {
+  ensureMainTask();
+  task->stack.resize(HOST_STACK_SIZE);
+  getcontext(&task->context);
+  task->context.uc_stack.ss_sp = task->stack.data();
+  task->context.uc_stack.ss_size = task->stack.size();
+  task->context.uc_link = nullptr;
+  int index = static_cast<int>(g_tasks.size());
+  auto name = loopNames().find(task->loop);
+  task->stats.name = name != loopNames().end() ? name->second : "task " + std::to_string(index);
+  makecontext(&task->context, reinterpret_cast<void (*)()>(taskEntry), 1, index);
+  g_tasks.push_back(std::move(task));
+}
+
+} // namespace
+
+void nameLoop(void (*task)(), const char* name) {
+  loopNames()[task] = name;
+}
+
+LoopStats& mainLoopStats() {
+  return g_mainStats;
+}
+
+size_t currentTask() noexcept {
+  return g_current;
+}
+
+std::vector<const LoopStats*> loopStats() {
+  std::vector<const LoopStats*> result{&g_mainStats};
+  for (size_t i = 1; i < g_tasks.size(); ++i) {
+    if (g_tasks[i]->repeat) {
+      result.push_back(&g_tasks[i]->stats);
+    }
+  }
+  return result;
+}
+
+} // namespace hostsim
+
+using namespace hostsim;
+
+void SchedulerClass::startLoop(SchedulerTask task, uint32_t /*stackSize*/) {
+  std::unique_ptr<Task> t(new Task());
+  t->loop = task;
+  t->repeat = true;
+  startTask(std::move(t));
+}
+
+void SchedulerClass::start(SchedulerTask task, uint32_t /*stackSize*/) {
+  std::unique_ptr<Task> t(new Task());
+  t->loop = task;
+  startTask(std::move(t));
+}
+
+void SchedulerClass::start(SchedulerParametricTask task, void* data, uint32_t /*stackSize*/) {
+  std::unique_ptr<Task> t(new Task());
+  t->parametric = task;
+  t->data = data;
+  startTask(std::move(t));
+}
+
+extern "C" void yield(void) {
+  ensureMainTask();
+  serviceInterrupts();
+
+  size_t count = g_tasks.size();
+  while (true) {
+    // Round robin, starting after the current task and coming back to it last
+    for (size_t i = 1; i <= count; ++i) {
+      size_t candidate = (g_current + i) % count;
+      if (runnable(*g_tasks[candidate])) {
+        switchTo(candidate);
+        return;
+      }
+    }
+
+    // Everyone is asleep: jump to the earliest deadline
+    uint64_t earliest = UINT64_MAX;
+    for (const auto& task : g_tasks) {
+      if (!task->finished && task->wake < earliest) {
+        earliest = task->wake;
+      }
+    }
+    advanceTo(earliest);
+  }
+}
+
+extern "C" void delay(unsigned long ms) {
+  ensureMainTask();
+  Task& self = *g_tasks[g_current];
+  self.wake = now() + 1000ULL * ms;
+  while (now() < self.wake) {
+    yield();
+  }
+  self.wake = 0;
+}
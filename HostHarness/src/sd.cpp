@@ -0,0 +1,334 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "hostsim.h"
+
+#include "SD.h"
+
+// The simulated card is a host directory. Costs are charged to the virtual clock with a simple
+// model of the SD library on SPI: writes land in the library's 512-byte block cache and cost a
+// block program each time the cache fills; open/exists scan the directory; close and flush update
+// the directory entry and FAT.
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const uint64_t CALL_OVERHEAD_MICROS = 12;
+const uint64_t BLOCK_WRITE_MICROS = 1100;
+const uint64_t DIRECTORY_ENTRY_MICROS = 30;
+const uint64_t OPEN_MICROS = 1500;
+const uint64_t SYNC_MICROS = 3200;
+const size_t BLOCK_SIZE = 512;
+
+struct OpenFile {
+  FILE* fp = nullptr;
+  std::string name;
+  bool writable = false;
+  bool directory = false;
+  std::vector<std::string> entries;
+  size_t nextEntry = 0;
+};
+
+std::vector<OpenFile> g_files;
+bool g_begun = false;
+
+hostsim::SdStats& stats() {
+  return hostsim::sdStats();
+}
+
+void charge(uint64_t us) {
+  stats().busyMicros += us;
+  hostsim::advance(us);
+}
+
+std::string upper(const char* path) {
+  std::string s(path == nullptr ? "" : path);
+  while (!s.empty() && s.front() == '/') {
+    s.erase(s.begin());
+  }
+  std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::toupper(c); });
+  return s;
+}
+
+fs::path hostPath(const std::string& name) {
+  return fs::path(hostsim::options().sdDir) / name;
+}
+
+/** Cost of finding a name in its directory: FAT directories are searched linearly. */
+void chargeLookup(const std::string& name) {
+  ++stats().lookups;
+  fs::path dir = hostPath(name).parent_path();
+  uint64_t entries = 0;
+  std::error_code ec;
+  for (auto it = fs::directory_iterator(dir, ec); !ec && it != fs::directory_iterator(); it.increment(ec)) {
+    ++entries;
+  }
+  charge(CALL_OVERHEAD_MICROS + DIRECTORY_ENTRY_MICROS * entries);
+}
+
+OpenFile* lookup(int handle) {
+  if (handle < 0 || static_cast<size_t>(handle) >= g_files.size()) {
+    return nullptr;
+  }
+  OpenFile& file = g_files[handle];
+  return (file.fp != nullptr || file.directory) ? &file : nullptr;
+}
+
+int allocate(OpenFile file) {
+  for (size_t i = 0; i < g_files.size(); ++i) {
+    if (!g_files[i].fp && !g_files[i].directory) {
+      g_files[i] = std::move(file);
+      return static_cast<int>(i);
+    }
+  }
+  g_files.push_back(std::move(file));
+  return static_cast<int>(g_files.size() - 1);
+}
+
+} // namespace
+
+namespace hostsim {
+
+SdStats& sdStats() {
+  static SdStats s;
+  return s;
+}
+
+} // namespace hostsim
+
+SDClass SD;
+
+bool SDClass::begin(uint8_t /*csPin*/) {
+  std::error_code ec;
+  fs::create_directories(hostsim::options().sdDir, ec);
+  // Card initialization and reading the volume boot record
+  charge(20000);
+  g_begun = !ec;
+  return g_begun;
+}
+
+void SDClass::end() {
+  g_begun = false;
+}
+
+bool SDClass::exists(const char* path) {
+  if (!g_begun) {
+    return false;
+  }
+  std::string name = upper(path);
+  chargeLookup(name);
+  return fs::exists(hostPath(name));
+}
+
+bool SDClass::mkdir(const char* path) {
+  if (!g_begun) {
+    return false;
+  }
+  std::error_code ec;
+  charge(SYNC_MICROS);
+  return fs::create_directories(hostPath(upper(path)), ec) || fs::is_directory(hostPath(upper(path)));
+}
+
+bool SDClass::remove(const char* path) {
+  if (!g_begun) {
+    return false;
+  }
+  std::string name = upper(path);
+  chargeLookup(name);
+  charge(SYNC_MICROS);
+  std::error_code ec;
+  return fs::remove(hostPath(name), ec);
+}
+
+bool SDClass::rmdir(const char* path) {
+  return remove(path);
+}
+
+File SDClass::open(const char* path, uint8_t mode) {
+  if (!g_begun) {
+    return File();
+  }
+  std::string name = upper(path);
+  chargeLookup(name);
+  charge(OPEN_MICROS);
+  ++stats().opens;
+
+  OpenFile file;
+  file.name = name;
+  fs::path host = hostPath(name);
+  if (fs::is_directory(host)) {
+    file.directory = true;
+    for (const auto& entry : fs::directory_iterator(host)) {
+      file.entries.push_back(entry.path().filename().string());
+    }
+    std::sort(file.entries.begin(), file.entries.end());
+    return File(allocate(std::move(file)));
+  }
+
+  if (mode & O_WRITE) {
+    file.fp = fopen(host.c_str(), (mode & O_APPEND) ? "a+b" : "r+b");
+    if (file.fp == nullptr && (mode & O_CREAT)) {
+      file.fp = fopen(host.c_str(), "w+b");
+    }
+    file.writable = true;
+  } else {
+    file.fp = fopen(host.c_str(), "rb");
+  }
+  if (file.fp == nullptr) {
+    return File();
+  }
+  if (mode & O_APPEND) {
+    fseek(file.fp, 0, SEEK_END);
+  }
+  return File(allocate(std::move(file)));
+}
+
+File::operator bool() const {
+  return lookup(m_handle) != nullptr;
+}
+
+size_t File::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+  OpenFile* file = lookup(m_handle);
+  if (file == nullptr || !file->writable) {
+    return 0;
+  }
+  long before = ftell(file->fp);
+  size_t written = fwrite(buffer, 1, size, file->fp);
+  long after = before + static_cast<long>(written);
+
+  ++stats().writeCalls;
+  stats().bytesWritten += written;
+  uint64_t blocks = static_cast<uint64_t>(after) / BLOCK_SIZE - static_cast<uint64_t>(before) / BLOCK_SIZE;
+  stats().blockWrites += blocks;
+  charge(CALL_OVERHEAD_MICROS + written / 16 + blocks * BLOCK_WRITE_MICROS);
+  return written;
+}
+
+int File::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek() {
+  OpenFile* file = lookup(m_handle);
+  if (file == nullptr || file->fp == nullptr) {
+    return -1;
+  }
+  int c = fgetc(file->fp);
+  if (c != EOF) {
+    ungetc(c, file->fp);
+  }
+  return c == EOF ? -1 : c;
+}
+
+int File::available() {
+  OpenFile* file = lookup(m_handle);
+  if (file == nullptr || file->fp == nullptr) {
+    return 0;
+  }
+  long position = ftell(file->fp);
+  fseek(file->fp, 0, SEEK_END);
+  long end = ftell(file->fp);
+  fseek(file->fp, position, SEEK_SET);
+  return static_cast<int>(end - position);
+}
+
+int File::read(void* buffer, uint16_t length) {
+  OpenFile* file = lookup(m_handle);
+  if (file == nullptr || file->fp == nullptr) {
+    return -1;
+  }
+  fflush(file->fp);
+  size_t n = fread(buffer, 1, length, file->fp);
+  charge(CALL_OVERHEAD_MICROS + ((n + BLOCK_SIZE - 1) / BLOCK_SIZE) * BLOCK_WRITE_MICROS / 2);
+  return static_cast<int>(n);
+}
+
+void File::flush() {
+  OpenFile* file = lookup(m_handle);
+  if (file == nullptr || file->fp == nullptr) {
+    return;
+  }
+  fflush(file->fp);
+  ++stats().flushes;
+  charge(SYNC_MICROS + BLOCK_WRITE_MICROS);
+}
+
+bool File::seek(uint32_t position) {
+  OpenFile* file = lookup(m_handle);
+  if (file == nullptr || file->fp == nullptr) {
+    return false;
+  }
+  charge(CALL_OVERHEAD_MICROS);
+  return fseek(file->fp, position, SEEK_SET) == 0;
+}
+
+uint32_t File::position() {
+  OpenFile* file = lookup(m_handle);
+  return file == nullptr || file->fp == nullptr ? 0 : static_cast<uint32_t>(ftell(file->fp));
+}
+
+uint32_t File::size() {
+  OpenFile* file = lookup(m_handle);
+  if (file == nullptr || file->fp == nullptr) {
+    return 0;
+  }
+  long position = ftell(file->fp);
+  fseek(file->fp, 0, SEEK_END);
+  long end = ftell(file->fp);
+  fseek(file->fp, position, SEEK_SET);
+  return static_cast<uint32_t>(end);
+}
+
+void File::close() {
+  OpenFile* file = lookup(m_handle);
+  if (file == nullptr) {
+    return;
+  }
+  if (file->fp != nullptr) {
+    fclose(file->fp);
+    if (file->writable) {
+      // Flush the partial block, then update the directory entry and FAT
+      charge(SYNC_MICROS + BLOCK_WRITE_MICROS);
+    }
+  }
+  ++stats().closes;
+  *file = OpenFile();
+  m_handle = -1;
+}
+
+const char* File::name() {
+  OpenFile* file = lookup(m_handle);
+  return file == nullptr ? "" : file->name.c_str();
+}
+
+bool File::isDirectory() {
+  OpenFile* file = lookup(m_handle);
+  return file != nullptr && file->directory;
+}
+
+File File::openNextFile(uint8_t mode) {
+  OpenFile* dir = lookup(m_handle);
+  if (dir == nullptr || !dir->directory || dir->nextEntry >= dir->entries.size()) {
+    return File();
+  }
+  std::string path = dir->name.empty() ? "" : dir->name + "/";
+  path += dir->entries[dir->nextEntry++];
+  return SD.open(path.c_str(), mode);
+}
+
+void File::rewindDirectory() {
+  OpenFile* dir = lookup(m_handle);
+  if (dir != nullptr) {
+    dir->nextEntry = 0;
+  }
+}
@@ -0,0 +1,767 @@
+#include <array>
+#include <cmath>
+#include <deque>
+#include <map>
+#include <memory>
+#include <utility>
+
+#include "hostsim.h"
+
+#include "Adafruit_BMP3XX.h"
+#include "Adafruit_LSM9DS1.h"
+#include "Adafruit_SHT4x.h"
+
+namespace {
+
+const double METERS_PER_FOOT = 0.3048;
+
+/** Static pressure (Pa) at the given altitude, with optional barometer noise. */
+double simulatedPressure(double altitudeAGL) {
+  const hostsim::Options& opts = hostsim::options();
+  double feet = altitudeAGL + opts.baroNoise * hostsim::gaussian();
+  double meters = feet * METERS_PER_FOOT;
+  // Inverse of the driver's readAltitude() formula, so AGL round-trips exactly without noise
+  return opts.padPressure * 100.0 * pow(1.0 - meters / 44330.0, 1.0 / 0.1903);
+}
+
+double simulatedPressure() {
+  return simulatedPressure(hostsim::truth().altitudeAGL);
+}
+
+float quantize(double value, double step, double fullScale) {
+  double clamped = value > fullScale ? fullScale : (value < -fullScale ? -fullScale : value);
+  return static_cast<float>(std::round(clamped / step) * step);
+}
+
+/** Forced-mode (and normal-mode) measurement time from the BMP388 datasheet, section 3.9.2. */
+uint64_t bmpConversionMicros(uint8_t pressureOversampling, uint8_t temperatureOversampling) {
+  return 234 + (392 + (2020u << pressureOversampling)) + (163 + (2020u << temperatureOversampling));
+}
+
+/**
+ * Register-level BMP388, for firmware that drives the sensor directly instead of through the
+ * driver: power modes, oversampling, ODR, IIR filter, data-ready status and the calibration NVM.
+ * Raw readings are produced by inverting the datasheet's compensation formulas for this part's
+ * calibration, so firmware compensation code is exercised for real.
+ */
+class Bmp388 : public hostsim::I2cDevice {
+public:
+  Bmp388() { reset(); }
+
+  void reset() {
+    m_registers.fill(0);
+    m_registers[0x00] = 0x50; // CHIP_ID
+    m_registers[0x03] = 0x10; // cmd_rdy
+    m_registers[0x1C] = 0x02; // OSR: 4x pressure, 1x temperature
+    m_registers[0x1D] = 0x00;
+    m_registers[0x1F] = 0x00;
+    for (size_t i = 0; i < sizeof NVM; ++i) {
+      m_registers[0x31 + i] = NVM[i];
+    }
+    m_pointer = 0;
+    m_conversions = 0;
+    m_filtered[0] = m_filtered[1] = NAN;
+  }
+
+  /** The driver's forced-mode reads end with the sensor back asleep. */
+  void enterSleep() {
+    m_registers[0x1B] &= 0x0F;
+  }
+
+  void write(const uint8_t* data, size_t length) override {
+    if (length == 0) {
+      return;
+    }
+    m_pointer = data[0];
+    // Multi-byte writes interleave register addresses and values
+    for (size_t i = 0; i + 1 < length; i += 2) {
+      writeRegister(data[i], data[i + 1]);
+    }
+  }
+
+  void read(uint8_t* data, size_t length) override {
+    update();
+    for (size_t i = 0; i < length; ++i) {
+      uint8_t reg = m_pointer++;
+      data[i] = m_registers[reg];
+      // Reading a data register clears its data-ready flag
+      if (reg >= 0x04 && reg <= 0x06) {
+        m_registers[0x03] &= ~0x20;
+      } else if (reg >= 0x07 && reg <= 0x09) {
+        m_registers[0x03] &= ~0x40;
+      }
+    }
+  }
+
+private:
+  // Calibration NVM (0x31-0x45): T1, T2 (u16), T3 (s8), P1, P2 (s16), P3, P4 (s8), P5, P6 (u16),
+  // P7, P8 (s8), P9 (s16), P10, P11 (s8). Values are in the range of real parts.
+  static constexpr uint8_t NVM[21] = {
+    0x78, 0x69,       // T1 = 27000
+    0x38, 0x4A,       // T2 = 19000
+    0xF9,             // T3 = -7
+    0x0E, 0x6D,       // P1 = 27918
+    0x80, 0x3E,       // P2 = 16000
+    0x05,             // P3 = 5
+    0x00,             // P4 = 0
+    0xDC, 0x05,       // P5 = 1500
+    0x2C, 0x01,       // P6 = 300
+    0xFB,             // P7 = -5
+    0xF6,             // P8 = -10
+    0xB8, 0x0B,       // P9 = 3000
+    0x0A,             // P10 = 10
+    0xEC,             // P11 = -20
+  };
+
+  struct Calibration {
+    double t1, t2, t3, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11;
+  };
+
+  static Calibration calibration() {
+    auto u16 = [](int i) { return static_cast<double>(NVM[i] | (NVM[i + 1] << 8)); };
+    auto s16 = [](int i) { return static_cast<double>(static_cast<int16_t>(NVM[i] | (NVM[i + 1] << 8))); };
+    auto s8 = [](int i) { return static_cast<double>(static_cast<int8_t>(NVM[i])); };
+    return Calibration{
+      u16(0) * 256.0, u16(2) / std::ldexp(1.0, 30), s8(4) / std::ldexp(1.0, 48),
+      (s16(5) - 16384.0) / std::ldexp(1.0, 20), (s16(7) - 16384.0) / std::ldexp(1.0, 29),
+      s8(9) / std::ldexp(1.0, 32), s8(10) / std::ldexp(1.0, 37), u16(11) * 8.0, u16(13) / 64.0,
+      s8(15) / 256.0, s8(16) / 32768.0, s16(17) / std::ldexp(1.0, 48), s8(19) / std::ldexp(1.0, 48),
+      s8(20) / std::ldexp(1.0, 65),
+    };
+  }
+
+  static double compensatePressure(const Calibration& c, double raw, double t) {
+    double out1 = c.p5 + c.p6 * t + c.p7 * t * t + c.p8 * t * t * t;
+    double out2 = raw * (c.p1 + c.p2 * t + c.p3 * t * t + c.p4 * t * t * t);
+    return out1 + out2 + raw * raw * (c.p9 + c.p10 * t) + raw * raw * raw * c.p11;
+  }
+
+  /** Raw temperature and pressure ADC values that compensate to `celsius` and `pascals`. */
+  static std::pair<double, double> uncompensate(double celsius, double pascals) {
+    const Calibration c = calibration();
+    // t = (raw - t1) * t2 + (raw - t1)^2 * t3
+    double d = celsius / c.t2;
+    for (int i = 0; i < 4; ++i) {
+      d -= (d * c.t2 + d * d * c.t3 - celsius) / (c.t2 + 2.0 * d * c.t3);
+    }
+    double raw = (pascals - compensatePressure(c, 0.0, celsius)) / c.p1;
+    for (int i = 0; i < 6; ++i) {
+      double f = compensatePressure(c, raw, celsius) - pascals;
+      double slope = (compensatePressure(c, raw + 1.0, celsius) - compensatePressure(c, raw - 1.0, celsius)) / 2.0;
+      raw -= f / slope;
+    }
+    return {d + c.t1, raw};
+  }
+
+  void writeRegister(uint8_t reg, uint8_t value) {
+    if (reg == 0x7E) {
+      if (value == 0xB6) {
+        reset();
+      }
+      return;
+    }
+    bool wasNormal = mode() == 3;
+    m_registers[reg] = value;
+    if (reg == 0x1B && mode() == 3 && !wasNormal) {
+      startNormalMode();
+    }
+  }
+
+  uint8_t mode() const {
+    return (m_registers[0x1B] >> 4) & 0x03;
+  }
+
+  uint64_t period() const {
+    return 5000ULL << (m_registers[0x1D] & 0x1F);
+  }
+
+  uint64_t measurementMicros() const {
+    return bmpConversionMicros(m_registers[0x1C] & 0x07, (m_registers[0x1C] >> 3) & 0x07);
+  }
+
+  void startNormalMode() {
+    if (measurementMicros() > period() || (m_registers[0x1D] & 0x1F) > 0x11) {
+      // The part refuses a configuration it cannot keep up with and stays asleep
+      m_registers[0x02] |= 0x04;
+      m_registers[0x1B] &= 0x0F;
+      return;
+    }
+    m_registers[0x02] &= ~0x04;
+    m_normalStart = hostsim::now();
+    m_conversions = 0;
+  }
+
+  /** Run every conversion that has finished since the last register access. */
+  void update() {
+    if (mode() != 3) {
+      return;
+    }
+    uint64_t measurement = measurementMicros();
+    uint8_t coefficient = (1 << ((m_registers[0x1F] >> 1) & 0x07)) - 1;
+    while (m_normalStart + m_conversions * period() + measurement <= hostsim::now()) {
+      uint64_t finished = m_normalStart + m_conversions * period() + measurement;
+      ++m_conversions;
+      hostsim::FlightSample state = hostsim::trace().at(finished / 1e6);
+      std::pair<double, double> raw = uncompensate(state.temperature, simulatedPressure(state.altitudeAGL));
+      double sample[2] = {raw.first, raw.second};
+      for (int i = 0; i < 2; ++i) {
+        m_filtered[i] = std::isnan(m_filtered[i]) ? sample[i]
+          : (m_filtered[i] * coefficient + sample[i]) / (coefficient + 1);
+      }
+      storeRaw(0x07, m_filtered[0]);
+      storeRaw(0x04, m_filtered[1]);
+      m_registers[0x03] |= 0x60;
+    }
+  }
+
+  void storeRaw(uint8_t reg, double value) {
+    uint32_t raw = static_cast<uint32_t>(std::lround(value < 0.0 ? 0.0 : (value > 16777215.0 ? 16777215.0 : value)));
+    m_registers[reg] = raw & 0xFF;
+    m_registers[reg + 1] = (raw >> 8) & 0xFF;
+    m_registers[reg + 2] = (raw >> 16) & 0xFF;
+  }
+
+  std::array<uint8_t, 256> m_registers;
+  uint8_t m_pointer;
+  uint64_t m_normalStart = 0;
+  uint64_t m_conversions;
+  double m_filtered[2];
+};
+
+constexpr uint8_t Bmp388::NVM[21];
+
+/**
+ * Register-level LSM9DS1 accelerometer/gyroscope, for the FIFO: samples are taken from the flight
+ * at the configured ODR and queued (32 deep, continuous mode overwrites the oldest and sets OVRN).
+ * With the FIFO enabled, a burst read of the gyroscope or accelerometer outputs rolls over from
+ * the Z high byte back to X low and moves on to the next sample, as on ST's other FIFO parts.
+ */
+class Lsm9ds1 : public hostsim::I2cDevice {
+public:
+  Lsm9ds1() { reset(); }
+
+  /** State after the driver's begin(): both at 952 Hz, 245 dps and 2 g, FIFO off. */
+  void reset() {
+    m_registers.fill(0);
+    m_registers[0x0F] = 0x68; // WHO_AM_I
+    m_registers[0x10] = 0xC0; // CTRL_REG1_G
+    m_registers[0x20] = 0xC0; // CTRL_REG6_XL
+    m_registers[0x22] = 0x04; // CTRL_REG8: IF_ADD_INC
+    m_pointer = 0;
+    m_fifo.clear();
+    m_gyroRead = m_accelRead = 0;
+    m_overrun = false;
+  }
+
+  void write(const uint8_t* data, size_t length) override {
+    if (length == 0) {
+      return;
+    }
+    update();
+    m_pointer = data[0];
+    // Multi-byte writes go to consecutive registers
+    for (size_t i = 1; i < length; ++i) {
+      writeRegister(m_pointer++, data[i]);
+    }
+  }
+
+  void read(uint8_t* data, size_t length) override {
+    update();
+    for (size_t i = 0; i < length; ++i) {
+      uint8_t reg = m_pointer;
+      if (fifoEnabled() && reg >= 0x18 && reg <= 0x1D) {
+        data[i] = outputByte(m_gyroRead, 0, reg - 0x18);
+        m_pointer = reg == 0x1D ? 0x18 : reg + 1;
+        if (reg == 0x1D) {
+          // Reading past the end repeats the last sample without consuming another
+          if (m_gyroRead < m_fifo.size()) {
+            ++m_gyroRead;
+          }
+          pop();
+        }
+      } else if (fifoEnabled() && reg >= 0x28 && reg <= 0x2D) {
+        data[i] = outputByte(m_accelRead, 1, reg - 0x28);
+        m_pointer = reg == 0x2D ? 0x28 : reg + 1;
+        if (reg == 0x2D) {
+          if (m_accelRead < m_fifo.size()) {
+            ++m_accelRead;
+          }
+          pop();
+        }
+      } else {
+        data[i] = reg == 0x2F ? fifoSource() : m_registers[reg];
+        m_pointer = reg + 1;
+      }
+    }
+  }
+
+private:
+  static const size_t FIFO_DEPTH = 32;
+
+  struct Slot {
+    int16_t axes[2][3]; // gyroscope, accelerometer
+  };
+
+  void writeRegister(uint8_t reg, uint8_t value) {
+    if (reg == 0x22 && (value & 0x01)) {
+      reset();
+      return;
+    }
+    bool wasSampling = sampling();
+    m_registers[reg] = value;
+    if (sampling() && !wasSampling) {
+      m_fifo.clear();
+      m_gyroRead = m_accelRead = 0;
+      m_overrun = false;
+      m_nextSample = hostsim::now() + period();
+    }
+  }
+
+  bool fifoEnabled() const {
+    return (m_registers[0x23] & 0x02) != 0;
+  }
+
+  bool sampling() const {
+    return fifoEnabled() && (m_registers[0x2E] >> 5) != 0 && odr() != 0;
+  }
+
+  uint8_t odr() const {
+    return m_registers[0x10] >> 5;
+  }
+
+  uint64_t period() const {
+    static const double RATES_HZ[8] = {0.0, 14.9, 59.5, 119.0, 238.0, 476.0, 952.0, 0.0};
+    return static_cast<uint64_t>(std::llround(1e6 / RATES_HZ[odr()]));
+  }
+
+  /** Queue every sample taken since the last register access. */
+  void update() {
+    if (!sampling()) {
+      return;
+    }
+    uint64_t step = period();
+    // Nothing older than a full FIFO can survive, so don't generate it
+    if (hostsim::now() >= m_nextSample + FIFO_DEPTH * step) {
+      uint64_t skipped = (hostsim::now() - m_nextSample) / step - FIFO_DEPTH;
+      m_nextSample += skipped * step;
+      m_fifo.clear();
+      m_gyroRead = m_accelRead = 0;
+      m_overrun = true;
+    }
+    static const double ACCEL_MG_PER_LSB[4] = {0.061, 0.732, 0.122, 0.244};
+    static const double GYRO_DPS_PER_LSB[4] = {0.00875, 0.0175, 0.0, 0.07};
+    double scales[2] = {
+      GYRO_DPS_PER_LSB[(m_registers[0x10] >> 3) & 0x03] * SENSORS_DPS_TO_RADS,
+      ACCEL_MG_PER_LSB[(m_registers[0x20] >> 3) & 0x03] / 1000.0 * SENSORS_GRAVITY_STANDARD,
+    };
+    while (m_nextSample <= hostsim::now()) {
+      hostsim::FlightSample state = hostsim::trace().at(m_nextSample / 1e6);
+      Slot slot;
+      for (int i = 0; i < 3; ++i) {
+        slot.axes[0][i] = toRaw(state.gyro[i], scales[0]);
+        slot.axes[1][i] = toRaw(state.accel[i], scales[1]);
+      }
+      if (m_fifo.size() == FIFO_DEPTH) {
+        m_fifo.pop_front();
+        m_gyroRead = m_gyroRead > 0 ? m_gyroRead - 1 : 0;
+        m_accelRead = m_accelRead > 0 ? m_accelRead - 1 : 0;
+        m_overrun = true;
+      }
+      m_fifo.push_back(slot);
+      m_nextSample += step;
+    }
+  }
+
+  static int16_t toRaw(double value, double scale) {
+    double raw = std::round(value / scale);
+    return static_cast<int16_t>(raw > 32767.0 ? 32767.0 : (raw < -32768.0 ? -32768.0 : raw));
+  }
+
+  uint8_t outputByte(size_t index, int sensor, int offset) const {
+    if (m_fifo.empty()) {
+      return 0;
+    }
+    // Past the end, the last sample repeats
+    const Slot& slot = m_fifo[index < m_fifo.size() ? index : m_fifo.size() - 1];
+    uint16_t value = static_cast<uint16_t>(slot.axes[sensor][offset / 2]);
+    return offset % 2 == 0 ? value & 0xFF : value >> 8;
+  }
+
+  /** Discard a sample once both halves have been read. */
+  void pop() {
+    while (m_gyroRead > 0 && m_accelRead > 0 && !m_fifo.empty()) {
+      m_fifo.pop_front();
+      --m_gyroRead;
+      --m_accelRead;
+      m_overrun = false;
+    }
+  }
+
+  /** FIFO_SRC: OVRN and the number of unread samples. */
+  uint8_t fifoSource() const {
+    size_t read = m_gyroRead < m_accelRead ? m_gyroRead : m_accelRead;
+    size_t unread = m_fifo.size() > read ? m_fifo.size() - read : 0;
+    return (m_overrun ? 0x40 : 0x00) | static_cast<uint8_t>(unread);
+  }
+
+  std::array<uint8_t, 256> m_registers;
+  uint8_t m_pointer;
+  std::deque<Slot> m_fifo;
+  size_t m_gyroRead;
+  size_t m_accelRead;
+  bool m_overrun;
+  uint64_t m_nextSample = 0;
+};
+
+/**
+ * Command-level SHT4x, for firmware that starts measurements and reads them back later instead of
+ * waiting in the driver: the part NACKs reads until the measurement is done, then returns
+ * temperature and humidity ticks, each followed by its CRC-8.
+ */
+class Sht4x : public hostsim::I2cDevice {
+public:
+  void write(const uint8_t* data, size_t length) override {
+    if (length == 0) {
+      return;
+    }
+    uint64_t duration = measurementMicros(data[0]);
+    if (duration == 0) {
+      // Soft reset, serial number and anything else the driver sends
+      return;
+    }
+    m_readyAt = hostsim::now() + duration;
+    m_measuring = true;
+  }
+
+  bool acknowledgesRead() override {
+    return !m_measuring || hostsim::now() >= m_readyAt;
+  }
+
+  void read(uint8_t* data, size_t length) override {
+    uint8_t out[6] = {0};
+    if (m_measuring) {
+      m_measuring = false;
+      hostsim::FlightSample state = hostsim::trace().at(m_readyAt / 1e6);
+      // Inverse of the datasheet's conversion formulas
+      store(out, (state.temperature + 45.0) / 175.0);
+      store(out + 3, (state.humidity + 6.0) / 125.0);
+    }
+    for (size_t i = 0; i < length; ++i) {
+      data[i] = i < sizeof out ? out[i] : 0xFF;
+    }
+  }
+
+private:
+  /** Maximum measurement times from the datasheet, or 0 if `command` isn't a measurement. */
+  static uint64_t measurementMicros(uint8_t command) {
+    switch (command) {
+    case 0xFD: return 8300;    // high precision
+    case 0xF6: return 4500;    // medium precision
+    case 0xE0: return 1600;    // low precision
+    case 0x39: case 0x2F: case 0x1E: return 1100000; // 1 s heater, then a high-precision measurement
+    case 0x32: case 0x24: case 0x15: return 110000;  // 0.1 s heater
+    default: return 0;
+    }
+  }
+
+  static void store(uint8_t* out, double fraction) {
+    double clamped = fraction < 0.0 ? 0.0 : (fraction > 1.0 ? 1.0 : fraction);
+    uint16_t ticks = static_cast<uint16_t>(std::lround(clamped * 65535.0));
+    out[0] = ticks >> 8;
+    out[1] = ticks & 0xFF;
+    uint8_t crc = 0xFF;
+    for (int i = 0; i < 2; ++i) {
+      crc ^= out[i];
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc & 0x80) ? static_cast<uint8_t>((crc << 1) ^ 0x31) : static_cast<uint8_t>(crc << 1);
+      }
+    }
+    out[2] = crc;
+  }
+
+  uint64_t m_readyAt = 0;
+  bool m_measuring = false;
+};
+
+/** Devices by bus and address, created the first time the firmware talks to them. */
+std::map<std::pair<const SERCOM*, uint8_t>, std::unique_ptr<hostsim::I2cDevice>>& i2cDevices() {
+  static std::map<std::pair<const SERCOM*, uint8_t>, std::unique_ptr<hostsim::I2cDevice>> devices;
+  return devices;
+}
+
+} // namespace
+
+namespace hostsim {
+
+I2cDevice* i2cDevice(const SERCOM* bus, uint8_t address) {
+  auto& devices = i2cDevices();
+  auto key = std::make_pair(bus, address);
+  auto it = devices.find(key);
+  if (it != devices.end()) {
+    return it->second.get();
+  }
+  std::unique_ptr<I2cDevice> device;
+  if (address == BMP3XX_DEFAULT_ADDRESS) {
+    device.reset(new Bmp388());
+  } else if (address == LSM9DS1_ADDRESS_ACCELGYRO) {
+    device.reset(new Lsm9ds1());
+  } else if (address == SHT4x_DEFAULT_ADDR) {
+    device.reset(new Sht4x());
+  }
+  if (!device) {
+    return nullptr;
+  }
+  return devices.emplace(key, std::move(device)).first->second.get();
+}
+
+} // namespace hostsim
+
+// ---------------------------------------------------------------------------------------------
+// BMP3XX
+
+Adafruit_BMP3XX::Adafruit_BMP3XX() noexcept :
+  temperature(NAN),
+  pressure(NAN),
+  m_i2c(nullptr),
+  m_address(BMP3XX_DEFAULT_ADDRESS),
+  m_tempOversampling(BMP3_NO_OVERSAMPLING),
+  m_pressOversampling(BMP3_NO_OVERSAMPLING),
+  m_iirCoeff(BMP3_IIR_FILTER_DISABLE),
+  m_odr(BMP3_ODR_25_HZ) {}
+
+bool Adafruit_BMP3XX::begin_I2C(uint8_t addr, TwoWire* theWire) {
+  m_i2c = theWire;
+  m_address = addr;
+  static_cast<Bmp388*>(hostsim::i2cDevice(theWire->sercom(), addr))->reset();
+  // chip ID, soft reset, calibration block, default settings
+  m_i2c->transfer(1, 1);
+  m_i2c->transfer(2, 0);
+  hostsim::advance(2000);
+  m_i2c->transfer(1, 21);
+  m_i2c->transfer(2, 0);
+  return true;
+}
+
+uint8_t Adafruit_BMP3XX::chipID() {
+  return 0x50;
+}
+
+bool Adafruit_BMP3XX::setTemperatureOversampling(uint8_t os) {
+  m_tempOversampling = os;
+  return true;
+}
+
+bool Adafruit_BMP3XX::setPressureOversampling(uint8_t os) {
+  m_pressOversampling = os;
+  return true;
+}
+
+bool Adafruit_BMP3XX::setIIRFilterCoeff(uint8_t fs) {
+  m_iirCoeff = fs;
+  return true;
+}
+
+bool Adafruit_BMP3XX::setOutputDataRate(uint8_t odr) {
+  m_odr = odr;
+  return true;
+}
+
+bool Adafruit_BMP3XX::performReading() {
+  if (m_i2c == nullptr) {
+    return false;
+  }
+  // The driver rewrites the oversampling, ODR and filter settings, then the power mode
+  m_i2c->transfer(3, 0);
+  m_i2c->transfer(2, 0);
+  m_i2c->transfer(2, 0);
+  m_i2c->transfer(2, 0);
+  hostsim::advance(bmpConversionMicros(m_pressOversampling, m_tempOversampling));
+  m_i2c->transfer(1, 1);
+  m_i2c->transfer(1, 6);
+  static_cast<Bmp388*>(hostsim::i2cDevice(m_i2c->sercom(), m_address))->enterSleep();
+
+  pressure = simulatedPressure();
+  temperature = hostsim::truth().temperature;
+  return true;
+}
+
+float Adafruit_BMP3XX::readTemperature() {
+  if (!performReading()) {
+    return NAN;
+  }
+  return static_cast<float>(temperature);
+}
+
+float Adafruit_BMP3XX::readPressure() {
+  if (!performReading()) {
+    return NAN;
+  }
+  return static_cast<float>(pressure);
+}
+
+float Adafruit_BMP3XX::readAltitude(float seaLevel) {
+  // Same formula as the driver
+  float atmospheric = readPressure() / 100.0F;
+  return 44330.0F * (1.0F - powf(atmospheric / seaLevel, 0.1903F));
+}
+
+// ---------------------------------------------------------------------------------------------
+// LSM9DS1
+
+Adafruit_LSM9DS1::Adafruit_LSM9DS1(int32_t sensorID) noexcept : Adafruit_LSM9DS1(&Wire, sensorID) {}
+
+Adafruit_LSM9DS1::Adafruit_LSM9DS1(TwoWire* wireBus, int32_t /*sensorID*/) noexcept :
+  accelData{0, 0, 0},
+  gyroData{0, 0, 0},
+  magData{0, 0, 0},
+  temperature(0),
+  m_i2c(wireBus),
+  m_accelMgPerLsb(0.061F),
+  m_gyroDpsPerDigit(0.00875F) {}
+
+bool Adafruit_LSM9DS1::begin() {
+  static_cast<Lsm9ds1*>(hostsim::i2cDevice(m_i2c->sercom(), LSM9DS1_ADDRESS_ACCELGYRO))->reset();
+  // WHO_AM_I for both dies, soft reset, and the default configuration writes
+  m_i2c->transfer(1, 1);
+  m_i2c->transfer(1, 1);
+  m_i2c->transfer(2, 0);
+  hostsim::advance(10000);
+  for (int i = 0; i < 6; ++i) {
+    m_i2c->transfer(2, 0);
+  }
+  return true;
+}
+
+void Adafruit_LSM9DS1::setupAccel(lsm9ds1AccelRange_t range) {
+  m_i2c->transfer(1, 1);
+  m_i2c->transfer(2, 0);
+  uint8_t ctrl[2] = {0x20, static_cast<uint8_t>(0xC0 | range)};
+  hostsim::i2cDevice(m_i2c->sercom(), LSM9DS1_ADDRESS_ACCELGYRO)->write(ctrl, sizeof ctrl);
+  switch (range) {
+  case LSM9DS1_ACCELRANGE_2G: m_accelMgPerLsb = 0.061F; break;
+  case LSM9DS1_ACCELRANGE_4G: m_accelMgPerLsb = 0.122F; break;
+  case LSM9DS1_ACCELRANGE_8G: m_accelMgPerLsb = 0.244F; break;
+  case LSM9DS1_ACCELRANGE_16G: m_accelMgPerLsb = 0.732F; break;
+  }
+}
+
+void Adafruit_LSM9DS1::setupGyro(lsm9ds1GyroScale_t scale) {
+  m_i2c->transfer(1, 1);
+  m_i2c->transfer(2, 0);
+  uint8_t ctrl[2] = {0x10, static_cast<uint8_t>(0xC0 | scale)};
+  hostsim::i2cDevice(m_i2c->sercom(), LSM9DS1_ADDRESS_ACCELGYRO)->write(ctrl, sizeof ctrl);
+  switch (scale) {
+  case LSM9DS1_GYROSCALE_245DPS: m_gyroDpsPerDigit = 0.00875F; break;
+  case LSM9DS1_GYROSCALE_500DPS: m_gyroDpsPerDigit = 0.01750F; break;
+  case LSM9DS1_GYROSCALE_2000DPS: m_gyroDpsPerDigit = 0.07000F; break;
+  }
+}
+
+void Adafruit_LSM9DS1::read() {
+  // The driver reads accel, mag, gyro and temperature as four separate register bursts
+  m_i2c->transfer(1, 6);
+  m_i2c->transfer(1, 6);
+  m_i2c->transfer(1, 6);
+  m_i2c->transfer(1, 2);
+
+  const hostsim::FlightSample& state = hostsim::truth();
+  double accelStep = m_accelMgPerLsb / 1000.0 * SENSORS_GRAVITY_STANDARD;
+  double gyroStep = m_gyroDpsPerDigit * SENSORS_DPS_TO_RADS;
+  accelData.x = quantize(state.accel[0], accelStep, 32767 * accelStep);
+  accelData.y = quantize(state.accel[1], accelStep, 32767 * accelStep);
+  accelData.z = quantize(state.accel[2], accelStep, 32767 * accelStep);
+  gyroData.x = quantize(state.gyro[0], gyroStep, 32767 * gyroStep);
+  gyroData.y = quantize(state.gyro[1], gyroStep, 32767 * gyroStep);
+  gyroData.z = quantize(state.gyro[2], gyroStep, 32767 * gyroStep);
+  temperature = static_cast<int16_t>((state.temperature - 25.0) * 16.0);
+}
+
+bool Adafruit_LSM9DS1::getEvent(sensors_event_t* accel, sensors_event_t* mag, sensors_event_t* gyro,
+                                sensors_event_t* temp) {
+  read();
+  if (accel != nullptr) {
+    *accel = sensors_event_t();
+    accel->acceleration.x = accelData.x;
+    accel->acceleration.y = accelData.y;
+    accel->acceleration.z = accelData.z;
+  }
+  if (mag != nullptr) {
+    *mag = sensors_event_t();
+  }
+  if (gyro != nullptr) {
+    *gyro = sensors_event_t();
+    gyro->gyro.x = gyroData.x;
+    gyro->gyro.y = gyroData.y;
+    gyro->gyro.z = gyroData.z;
+  }
+  if (temp != nullptr) {
+    *temp = sensors_event_t();
+    temp->temperature = 25.0F + temperature / 16.0F;
+  }
+  return true;
+}
+
+// ---------------------------------------------------------------------------------------------
+// SHT4x
+
+Adafruit_SHT4x::Adafruit_SHT4x() noexcept :
+  m_i2c(nullptr),
+  m_precision(SHT4X_HIGH_PRECISION),
+  m_heater(SHT4X_NO_HEATER) {}
+
+bool Adafruit_SHT4x::begin(TwoWire* theWire) {
+  m_i2c = theWire;
+  if (!reset()) {
+    return false;
+  }
+  // serial number
+  m_i2c->transfer(1, 0);
+  delay(10);
+  m_i2c->transfer(0, 6);
+  return true;
+}
+
+bool Adafruit_SHT4x::reset() {
+  m_i2c->transfer(1, 0);
+  delay(1);
+  return true;
+}
+
+bool Adafruit_SHT4x::getEvent(sensors_event_t* humidity, sensors_event_t* temp) {
+  if (m_i2c == nullptr) {
+    return false;
+  }
+
+  // Measurement durations used by the driver (which waits with delay(), not a busy loop)
+  unsigned long duration;
+  switch (m_heater) {
+  case SHT4X_HIGH_HEATER_1S:
+  case SHT4X_MED_HEATER_1S:
+  case SHT4X_LOW_HEATER_1S:
+    duration = 1100;
+    break;
+  case SHT4X_HIGH_HEATER_100MS:
+  case SHT4X_MED_HEATER_100MS:
+  case SHT4X_LOW_HEATER_100MS:
+    duration = 110;
+    break;
+  default:
+    duration = m_precision == SHT4X_HIGH_PRECISION ? 10 : (m_precision == SHT4X_MED_PRECISION ? 5 : 2);
+    break;
+  }
+
+  m_i2c->transfer(1, 0);
+  delay(duration);
+  m_i2c->transfer(0, 6);
+
+  const hostsim::FlightSample& state = hostsim::truth();
+  if (humidity != nullptr) {
+    *humidity = sensors_event_t();
+    humidity->relative_humidity = quantize(state.humidity, 0.01, 100.0);
+  }
+  if (temp != nullptr) {
+    *temp = sensors_event_t();
+    temp->temperature = quantize(state.temperature, 0.01, 125.0);
+  }
+  return true;
+}
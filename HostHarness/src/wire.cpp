@@ -0,0 +1,125 @@
+#include <algorithm>
+
+#include "hostsim.h"
+
+#include "Wire.h"
+
+namespace {
+
+// Software overhead of one Wire transaction in the SAMD core (buffer setup, SERCOM state machine)
+const uint32_t TRANSACTION_OVERHEAD_MICROS = 15;
+
+} // namespace
+
+// MKR variant: Wire is on sercom0 (pins 11/12)
+TwoWire Wire(&sercom0, 11, 12);
+
+TwoWire::TwoWire(SERCOM* sercom, uint8_t /*sdaPin*/, uint8_t /*sclPin*/) noexcept :
+  m_sercom(sercom),
+  m_clock(100000),
+  m_txAddress(0),
+  m_txBuffer{0},
+  m_txLength(0),
+  m_transmitting(false),
+  m_repeatedStart(false),
+  m_rxBuffer{0},
+  m_rxLength(0),
+  m_rxIndex(0) {}
+
+void TwoWire::begin() {}
+void TwoWire::end() {}
+void TwoWire::onService() {}
+
+uint32_t TwoWire::bitsMicros(uint64_t bits) const noexcept {
+  return static_cast<uint32_t>((bits * 1000000ULL + m_clock - 1) / m_clock);
+}
+
+uint32_t TwoWire::transferMicros(size_t bytesWritten, size_t bytesRead) const noexcept {
+  // Every byte (including the address byte) is 8 bits plus ACK. Start and stop conditions are about
+  // one bit time each; a read after a write needs a repeated start and a second address byte.
+  uint64_t bits = 1 + 9 * (1 + bytesWritten) + 1;
+  if (bytesRead > 0) {
+    bits += 1 + 9 * (1 + bytesRead);
+  }
+  return bitsMicros(bits) + TRANSACTION_OVERHEAD_MICROS;
+}
+
+uint32_t TwoWire::busMicros(size_t bytesWritten, size_t bytesRead) const noexcept {
+  uint64_t bits = 1 + 1;
+  if (bytesWritten > 0 || bytesRead == 0) {
+    bits += 9 * (1 + bytesWritten);
+  }
+  if (bytesRead > 0) {
+    bits += (bytesWritten > 0 ? 1 : 0) + 9 * (1 + bytesRead);
+  }
+  return bitsMicros(bits);
+}
+
+void TwoWire::transfer(size_t bytesWritten, size_t bytesRead) {
+  hostsim::advance(transferMicros(bytesWritten, bytesRead));
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+  m_txAddress = address;
+  m_txLength = 0;
+  m_transmitting = true;
+}
+
+size_t TwoWire::write(uint8_t data) {
+  return write(&data, 1);
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t quantity) {
+  if (!m_transmitting) {
+    return 0;
+  }
+  size_t n = std::min(quantity, BUFFER_SIZE - m_txLength);
+  std::copy(data, data + n, m_txBuffer + m_txLength);
+  m_txLength += n;
+  return n;
+}
+
+uint8_t TwoWire::endTransmission(bool stopBit) {
+  m_transmitting = false;
+  hostsim::I2cDevice* device = hostsim::i2cDevice(m_sercom, m_txAddress);
+  if (device == nullptr) {
+    // Only the address byte goes out before the NACK
+    hostsim::advance(bitsMicros(1 + 9 + 1) + TRANSACTION_OVERHEAD_MICROS);
+    m_repeatedStart = false;
+    return 2;
+  }
+  hostsim::advance(bitsMicros(1 + 9 * (1 + m_txLength) + (stopBit ? 1 : 0)) + TRANSACTION_OVERHEAD_MICROS);
+  device->write(m_txBuffer, m_txLength);
+  m_repeatedStart = !stopBit;
+  return 0;
+}
+
+size_t TwoWire::requestFrom(uint8_t address, size_t quantity, bool /*stopBit*/) {
+  quantity = std::min(quantity, BUFFER_SIZE);
+  uint32_t overhead = m_repeatedStart ? 0 : TRANSACTION_OVERHEAD_MICROS;
+  m_repeatedStart = false;
+  m_rxIndex = 0;
+  m_rxLength = 0;
+
+  hostsim::I2cDevice* device = hostsim::i2cDevice(m_sercom, address);
+  if (device == nullptr || !device->acknowledgesRead()) {
+    hostsim::advance(bitsMicros(1 + 9 + 1) + overhead);
+    return 0;
+  }
+  hostsim::advance(bitsMicros(1 + 9 * (1 + quantity) + 1) + overhead);
+  device->read(m_rxBuffer, quantity);
+  m_rxLength = quantity;
+  return quantity;
+}
+
+int TwoWire::available() {
+  return static_cast<int>(m_rxLength - m_rxIndex);
+}
+
+int TwoWire::read() {
+  return m_rxIndex < m_rxLength ? m_rxBuffer[m_rxIndex++] : -1;
+}
+
+int TwoWire::peek() {
+  return m_rxIndex < m_rxLength ? m_rxBuffer[m_rxIndex] : -1;
+}
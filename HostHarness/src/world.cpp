@@ -0,0 +1,322 @@
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "hostsim.h"
+
+namespace hostsim {
+
+namespace {
+
+const double G = 9.80665;
+const double FEET_PER_METER = 3.28084;
+
+class SyntheticFlight : public Trace {
+public:
+  FlightSample at(double seconds) const override {
+    FlightSample s;
+    double h = 0.0; // m AGL
+    double az = G;  // specific force along the body axis
+    double spin = 0.0;
+
+    double t = seconds - PAD_TIME;
+    double coastTime = BURNOUT_VELOCITY / G;
+    double fallTime = DROGUE_RATE / G;
+    if (t < 0.0) {
+      // on the pad
+    } else if (t < BURN_TIME) {
+      h = 0.5 * BOOST_ACCEL * t * t;
+      az = BOOST_ACCEL + G;
+      spin = 0.6 * t;
+    } else if (t < BURN_TIME + coastTime) {
+      // coasting (drag ignored), so the accelerometer reads free fall
+      double tc = t - BURN_TIME;
+      h = burnoutAltitude() + BURNOUT_VELOCITY * tc - 0.5 * G * tc * tc;
+      az = 0.0;
+      spin = 1.8;
+    } else {
+      double td = t - BURN_TIME - coastTime;
+      if (td < fallTime) {
+        // falling until the drogue reaches its descent rate
+        h = apogee() - 0.5 * G * td * td;
+        az = 0.0;
+      } else if (td < drogueEnd()) {
+        h = apogee() - 0.5 * G * fallTime * fallTime - DROGUE_RATE * (td - fallTime);
+      } else {
+        h = MAIN_DEPLOY - MAIN_RATE * (td - drogueEnd());
+      }
+      if (h <= 0.0) {
+        h = 0.0;
+        az = G;
+      } else {
+        // swinging under the parachute
+        spin = 0.3 * sin(2.0 * td);
+      }
+    }
+
+    s.altitudeAGL = h * FEET_PER_METER;
+    s.altitudeMSL = PAD_MSL + s.altitudeAGL;
+    s.accel[0] = 0.05 * sin(7.0 * seconds);
+    s.accel[1] = 0.05 * cos(5.0 * seconds);
+    s.accel[2] = az;
+    s.gyro[0] = 0.1 * spin;
+    s.gyro[1] = -0.05 * spin;
+    s.gyro[2] = spin;
+    s.temperature = 25.0 - 0.00198 * s.altitudeAGL;
+    s.humidity = 35.0 - 0.001 * s.altitudeAGL;
+    s.voc = 300 + static_cast<int>(20.0 * sin(0.1 * seconds));
+    s.tankPressure = t < BURN_TIME + coastTime ? 800.0 : 0.0;
+    double drift = t > 0.0 ? t : 0.0;
+    s.latitude = PAD_LATITUDE + static_cast<int32_t>(50.0 * drift);
+    s.longitude = PAD_LONGITUDE + static_cast<int32_t>(450.0 * drift);
+    s.satellites = 9;
+    return s;
+  }
+
+  double duration() const override {
+    return PAD_TIME + BURN_TIME + BURNOUT_VELOCITY / G + drogueEnd() + MAIN_DEPLOY / MAIN_RATE + 20.0;
+  }
+
+private:
+  static constexpr double PAD_TIME = 10.0;
+  static constexpr double BURN_TIME = 3.0;
+  static constexpr double BOOST_ACCEL = 80.0;
+  static constexpr double BURNOUT_VELOCITY = BOOST_ACCEL * BURN_TIME;
+  static constexpr double DROGUE_RATE = 25.0;
+  static constexpr double MAIN_RATE = 6.0;
+  static constexpr double MAIN_DEPLOY = 304.8;
+  static constexpr double PAD_MSL = 4600.0;
+  static constexpr int32_t PAD_LATITUDE = 329903000;
+  static constexpr int32_t PAD_LONGITUDE = -1069750000;
+
+  static double burnoutAltitude() { return 0.5 * BOOST_ACCEL * BURN_TIME * BURN_TIME; }
+  static double apogee() { return burnoutAltitude() + BURNOUT_VELOCITY * BURNOUT_VELOCITY / (2.0 * G); }
+  /** Time from apogee until the main parachute opens. */
+  static double drogueEnd() {
+    double fallTime = DROGUE_RATE / G;
+    return fallTime + (apogee() - 0.5 * G * fallTime * fallTime - MAIN_DEPLOY) / DROGUE_RATE;
+  }
+};
+
+// ---------------------------------------------------------------------------------------------
+
+std::vector<std::string> splitCsvLine(const std::string& line) {
+  std::vector<std::string> fields;
+  std::string field;
+  bool quoted = false;
+  for (char c : line) {
+    if (c == '"') {
+      quoted = !quoted;
+    } else if (c == ',' && !quoted) {
+      fields.push_back(field);
+      field.clear();
+    } else if (c == ',' && quoted) {
+      // thousands separator inside a quoted number
+    } else if (c != '\r' && c != '\n') {
+      field += c;
+    }
+  }
+  fields.push_back(field);
+  return fields;
+}
+
+std::string trim(const std::string& s) {
+  size_t begin = s.find_first_not_of(" \t");
+  size_t end = s.find_last_not_of(" \t");
+  return begin == std::string::npos ? "" : s.substr(begin, end - begin + 1);
+}
+
+bool parseNumber(const std::string& s, double& out) {
+  std::string t = trim(s);
+  if (t.empty()) {
+    return false;
+  }
+  char* end;
+  out = strtod(t.c_str(), &end);
+  return *end == '\0';
+}
+
+class CsvTrace : public Trace {
+public:
+  CsvTrace(const std::string& path, double rowRate) {
+    std::ifstream in(path);
+    if (!in) {
+      throw std::runtime_error("cannot open trace " + path);
+    }
+
+    enum Column {
+      TIME, ALT_AGL, ALT_MSL, ACCEL_X, ACCEL_Y, ACCEL_Z, GYRO_X, GYRO_Y, GYRO_Z,
+      HUMIDITY, TEMPERATURE, VOC, TANK, LATITUDE, LONGITUDE, SATELLITES, COLUMN_COUNT
+    };
+    const char* const NAMES[COLUMN_COUNT] = {
+      "Time", "Altitude (AGL)", "Altitude (MSL)", "Accel X", "Accel Y", "Accel Z", "Gyro X", "Gyro Y",
+      "Gyro Z", "Humidity", "Temperature", "VOC Reading", "Tank Pressure", "Latitude", "Longitude",
+      "Satellites",
+    };
+    int index[COLUMN_COUNT];
+    for (int& i : index) {
+      i = -1;
+    }
+
+    std::string line;
+    std::getline(in, line);
+    std::vector<std::string> header = splitCsvLine(line);
+    bool named = false;
+    for (size_t i = 0; i < header.size(); ++i) {
+      std::string name = trim(header[i]);
+      if (name == "Time (s)" || name == "time") {
+        name = "Time";
+      }
+      for (int c = 0; c < COLUMN_COUNT; ++c) {
+        if (name == NAMES[c]) {
+          index[c] = static_cast<int>(i);
+          named = true;
+        }
+      }
+    }
+    std::vector<std::string> pending;
+    double probe;
+    if (!named && !header.empty() && parseNumber(header[0], probe)) {
+      // Headerless "time,altitude" export, as consumed by ProcessFlightData
+      index[TIME] = 0;
+      index[ALT_AGL] = 1;
+      pending.push_back(line);
+    }
+
+    auto consume = [&](const std::string& row) {
+      std::vector<std::string> fields = splitCsvLine(row);
+      auto get = [&](int column, double& out) {
+        return index[column] >= 0 && static_cast<size_t>(index[column]) < fields.size()
+          && parseNumber(fields[index[column]], out);
+      };
+      FlightSample s;
+      double value;
+      double time = m_times.size() / rowRate;
+      if (get(TIME, value)) time = value;
+      if (get(ALT_AGL, value)) s.altitudeAGL = value;
+      s.altitudeMSL = get(ALT_MSL, value) ? value : s.altitudeAGL;
+      if (get(ACCEL_X, value)) s.accel[0] = value;
+      if (get(ACCEL_Y, value)) s.accel[1] = value;
+      if (get(ACCEL_Z, value)) s.accel[2] = value;
+      if (get(GYRO_X, value)) s.gyro[0] = value;
+      if (get(GYRO_Y, value)) s.gyro[1] = value;
+      if (get(GYRO_Z, value)) s.gyro[2] = value;
+      if (get(HUMIDITY, value)) s.humidity = value;
+      if (get(TEMPERATURE, value)) s.temperature = value;
+      if (get(VOC, value)) s.voc = static_cast<int>(value);
+      if (get(TANK, value)) s.tankPressure = value;
+      if (get(LATITUDE, value)) s.latitude = static_cast<int32_t>(value);
+      if (get(LONGITUDE, value)) s.longitude = static_cast<int32_t>(value);
+      if (get(SATELLITES, value)) s.satellites = static_cast<int>(value);
+      m_times.push_back(time);
+      m_samples.push_back(s);
+    };
+
+    for (const std::string& row : pending) {
+      consume(row);
+    }
+    while (std::getline(in, line)) {
+      if (!trim(line).empty()) {
+        consume(line);
+      }
+    }
+    if (m_samples.empty()) {
+      throw std::runtime_error("trace " + path + " has no rows");
+    }
+  }
+
+  FlightSample at(double seconds) const override {
+    if (seconds <= m_times.front()) {
+      return m_samples.front();
+    }
+    if (seconds >= m_times.back()) {
+      return m_samples.back();
+    }
+    // Rows are in time order; remember where the last lookup was, since time only moves forward
+    while (m_cursor + 1 < m_times.size() && m_times[m_cursor + 1] <= seconds) {
+      ++m_cursor;
+    }
+    while (m_cursor > 0 && m_times[m_cursor] > seconds) {
+      --m_cursor;
+    }
+    const FlightSample& a = m_samples[m_cursor];
+    const FlightSample& b = m_samples[m_cursor + 1];
+    double span = m_times[m_cursor + 1] - m_times[m_cursor];
+    double f = span > 0.0 ? (seconds - m_times[m_cursor]) / span : 0.0;
+    auto lerp = [f](double x, double y) { return x + (y - x) * f; };
+
+    FlightSample s = a;
+    s.altitudeAGL = lerp(a.altitudeAGL, b.altitudeAGL);
+    s.altitudeMSL = lerp(a.altitudeMSL, b.altitudeMSL);
+    for (int i = 0; i < 3; ++i) {
+      s.accel[i] = lerp(a.accel[i], b.accel[i]);
+      s.gyro[i] = lerp(a.gyro[i], b.gyro[i]);
+    }
+    s.humidity = lerp(a.humidity, b.humidity);
+    s.temperature = lerp(a.temperature, b.temperature);
+    s.tankPressure = lerp(a.tankPressure, b.tankPressure);
+    return s;
+  }
+
+  double duration() const override {
+    return m_times.back();
+  }
+
+private:
+  std::vector<double> m_times;
+  std::vector<FlightSample> m_samples;
+  mutable size_t m_cursor = 0;
+};
+
+Options g_options;
+std::unique_ptr<Trace> g_trace;
+std::mt19937 g_rng;
+
+} // namespace
+
+std::unique_ptr<Trace> makeSyntheticFlight() {
+  return std::unique_ptr<Trace>(new SyntheticFlight());
+}
+
+std::unique_ptr<Trace> loadCsvTrace(const std::string& path, double rowRate) {
+  return std::unique_ptr<Trace>(new CsvTrace(path, rowRate));
+}
+
+const Options& options() {
+  return g_options;
+}
+
+Options& mutableOptions() {
+  return g_options;
+}
+
+void setTrace(std::unique_ptr<Trace> trace) {
+  g_trace = std::move(trace);
+  g_rng.seed(g_options.seed);
+}
+
+const Trace& trace() {
+  return *g_trace;
+}
+
+const FlightSample& truth() {
+  static uint64_t cachedAt = UINT64_MAX;
+  static FlightSample cached;
+  if (cachedAt != now()) {
+    cachedAt = now();
+    cached = g_trace->at(now() / 1e6);
+  }
+  return cached;
+}
+
+double gaussian() {
+  static std::normal_distribution<double> normal(0.0, 1.0);
+  return normal(g_rng);
+}
+
+} // namespace hostsim
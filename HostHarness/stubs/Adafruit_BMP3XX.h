@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Arduino.h"
+#include "Wire.h"
+
+#define BMP3XX_DEFAULT_ADDRESS 0x77
+
+#define BMP3_NO_OVERSAMPLING 0x00
+#define BMP3_OVERSAMPLING_2X 0x01
+#define BMP3_OVERSAMPLING_4X 0x02
+#define BMP3_OVERSAMPLING_8X 0x03
+#define BMP3_OVERSAMPLING_16X 0x04
+#define BMP3_OVERSAMPLING_32X 0x05
+
+#define BMP3_IIR_FILTER_DISABLE 0x00
+#define BMP3_IIR_FILTER_COEFF_1 0x01
+#define BMP3_IIR_FILTER_COEFF_3 0x02
+#define BMP3_IIR_FILTER_COEFF_7 0x03
+#define BMP3_IIR_FILTER_COEFF_15 0x04
+#define BMP3_IIR_FILTER_COEFF_31 0x05
+#define BMP3_IIR_FILTER_COEFF_63 0x06
+#define BMP3_IIR_FILTER_COEFF_127 0x07
+
+#define BMP3_ODR_200_HZ 0x00
+#define BMP3_ODR_100_HZ 0x01
+#define BMP3_ODR_50_HZ 0x02
+#define BMP3_ODR_25_HZ 0x03
+#define BMP3_ODR_12_5_HZ 0x04
+#define BMP3_ODR_6_25_HZ 0x05
+#define BMP3_ODR_3_1_HZ 0x06
+#define BMP3_ODR_1_5_HZ 0x07
+#define BMP3_ODR_0_78_HZ 0x08
+
+/**
+ * Stand-in for the BMP388/BMP390 driver. Pressure comes from the simulated flight; each forced-mode
+ * reading blocks for the datasheet conversion time of the configured oversampling.
+ */
+class Adafruit_BMP3XX {
+public:
+  Adafruit_BMP3XX() noexcept;
+
+  bool begin_I2C(uint8_t addr = BMP3XX_DEFAULT_ADDRESS, TwoWire* theWire = &Wire);
+  uint8_t chipID();
+
+  float readTemperature();
+  float readPressure();
+  float readAltitude(float seaLevel);
+
+  bool setTemperatureOversampling(uint8_t os);
+  bool setPressureOversampling(uint8_t os);
+  bool setIIRFilterCoeff(uint8_t fs);
+  bool setOutputDataRate(uint8_t odr);
+
+  bool performReading();
+
+  double temperature;
+  double pressure;
+
+private:
+  TwoWire* m_i2c;
+  uint8_t m_address;
+  uint8_t m_tempOversampling;
+  uint8_t m_pressOversampling;
+  uint8_t m_iirCoeff;
+  uint8_t m_odr;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Arduino.h"
+#include "Wire.h"
+#include "Adafruit_Sensor.h"
+
+#define LSM9DS1_ADDRESS_ACCELGYRO 0x6B
+#define LSM9DS1_ADDRESS_MAG 0x1E
+
+/**
+ * Stand-in for the LSM9DS1 driver. Values come from the simulated flight, quantized to the selected
+ * range; every read is charged the I2C time of the real driver's register reads.
+ */
+class Adafruit_LSM9DS1 {
+public:
+  typedef enum {
+    LSM9DS1_ACCELRANGE_2G = (0b00 << 3),
+    LSM9DS1_ACCELRANGE_16G = (0b01 << 3),
+    LSM9DS1_ACCELRANGE_4G = (0b10 << 3),
+    LSM9DS1_ACCELRANGE_8G = (0b11 << 3),
+  } lsm9ds1AccelRange_t;
+
+  typedef enum {
+    LSM9DS1_GYROSCALE_245DPS = (0b00 << 3),
+    LSM9DS1_GYROSCALE_500DPS = (0b01 << 3),
+    LSM9DS1_GYROSCALE_2000DPS = (0b11 << 3),
+  } lsm9ds1GyroScale_t;
+
+  typedef struct {
+    float x;
+    float y;
+    float z;
+  } lsm9ds1Vector_t;
+
+  explicit Adafruit_LSM9DS1(int32_t sensorID = 0) noexcept;
+  explicit Adafruit_LSM9DS1(TwoWire* wireBus, int32_t sensorID = 0) noexcept;
+
+  bool begin();
+  void read();
+  bool getEvent(sensors_event_t* accel, sensors_event_t* mag, sensors_event_t* gyro, sensors_event_t* temp);
+
+  void setupAccel(lsm9ds1AccelRange_t range);
+  void setupGyro(lsm9ds1GyroScale_t scale);
+
+  lsm9ds1Vector_t accelData;
+  lsm9ds1Vector_t gyroData;
+  lsm9ds1Vector_t magData;
+  int16_t temperature;
+
+private:
+  TwoWire* m_i2c;
+  float m_accelMgPerLsb;
+  float m_gyroDpsPerDigit;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Arduino.h"
+#include "Wire.h"
+#include "Adafruit_Sensor.h"
+
+#define SHT4x_DEFAULT_ADDR 0x44
+
+typedef enum {
+  SHT4X_HIGH_PRECISION,
+  SHT4X_MED_PRECISION,
+  SHT4X_LOW_PRECISION,
+} sht4x_precision_t;
+
+typedef enum {
+  SHT4X_NO_HEATER,
+  SHT4X_HIGH_HEATER_1S,
+  SHT4X_HIGH_HEATER_100MS,
+  SHT4X_MED_HEATER_1S,
+  SHT4X_MED_HEATER_100MS,
+  SHT4X_LOW_HEATER_1S,
+  SHT4X_LOW_HEATER_100MS,
+} sht4x_heater_t;
+
+/**
+ * Stand-in for the SHT4x driver. Like the real driver, getEvent() sends the measurement command and
+ * then calls delay() for the measurement duration, so other Scheduler loops run meanwhile.
+ */
+class Adafruit_SHT4x {
+public:
+  Adafruit_SHT4x() noexcept;
+
+  bool begin(TwoWire* theWire = &Wire);
+  bool reset();
+  void setPrecision(sht4x_precision_t prec) noexcept { m_precision = prec; }
+  sht4x_precision_t getPrecision() const noexcept { return m_precision; }
+  void setHeater(sht4x_heater_t heat) noexcept { m_heater = heat; }
+  sht4x_heater_t getHeater() const noexcept { return m_heater; }
+
+  bool getEvent(sensors_event_t* humidity, sensors_event_t* temp);
+
+private:
+  TwoWire* m_i2c;
+  sht4x_precision_t m_precision;
+  sht4x_heater_t m_heater;
+};
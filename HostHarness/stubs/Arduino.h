@@ -0,0 +1,95 @@
+#pragma once
+
+// Host stand-in for the subset of the ArduinoCore-samd API used by the firmware.
+// Only C headers are included here: the sketches declare globals such as `time` that would clash
+// with the declarations pulled in by most C++ standard headers.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#define HIGH 0x1
+#define LOW  0x0
+
+enum PinMode {
+  INPUT = 0x0,
+  OUTPUT = 0x1,
+  INPUT_PULLUP = 0x2,
+  INPUT_PULLDOWN = 0x3,
+};
+
+enum eAnalogReference {
+  AR_DEFAULT,
+  AR_INTERNAL,
+  AR_EXTERNAL,
+};
+#define DEFAULT AR_DEFAULT
+#define EXTERNAL AR_EXTERNAL
+
+// MKR pin numbering
+#define A0 15
+#define A1 16
+#define A2 17
+#define A3 18
+#define A4 19
+#define A5 20
+#define A6 21
+
+#define SDCARD_SS_PIN 28
+
+#define PI 3.1415926535897932384626433832795
+#define HALF_PI 1.5707963267948966192313216916398
+#define TWO_PI 6.283185307179586476925286766559
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+
+#define radians(deg) ((deg)*DEG_TO_RAD)
+#define degrees(rad) ((rad)*RAD_TO_DEG)
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+#define sq(x) ((x)*(x))
+
+// Same as the SAMD core: replace stdlib's abs with a macro that works on any arithmetic type
+#ifdef abs
+#undef abs
+#endif
+#define abs(x) ((x)>0?(x):-(x))
+
+template <typename T>
+constexpr const T& min(const T& a, const T& b) noexcept { return (b < a) ? b : a; }
+template <typename T>
+constexpr const T& max(const T& a, const T& b) noexcept { return (a < b) ? b : a; }
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+extern "C" {
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield(void);
+} // extern "C"
+
+// Interrupt handlers only run between the sketch's calls into the simulation, so there is nothing
+// to mask
+inline void noInterrupts() noexcept {}
+inline void interrupts() noexcept {}
+
+void pinMode(uint32_t pin, uint32_t mode);
+void digitalWrite(uint32_t pin, uint32_t value);
+int digitalRead(uint32_t pin);
+int analogRead(uint32_t pin);
+void analogReference(eAnalogReference mode);
+void analogReadResolution(int bits);
+
+void randomSeed(unsigned long seed);
+long random(long howBig);
+long random(long howSmall, long howBig);
+
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+#include "Uart.h"
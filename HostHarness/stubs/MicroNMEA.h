@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Arduino.h"
+
+/**
+ * Host reimplementation of the MicroNMEA parser API used by gps.h. Handles GGA and RMC sentences,
+ * with the same validity and return-value rules as the library.
+ */
+class MicroNMEA {
+public:
+  static bool testChecksum(const char* s);
+
+  MicroNMEA() noexcept;
+  MicroNMEA(void* buffer, uint8_t len) noexcept;
+
+  void setBuffer(void* buffer, uint8_t len) noexcept;
+  void setUnknownSentenceHandler(void (*handler)(MicroNMEA& nmea)) noexcept { m_unknownSentenceHandler = handler; }
+  void setBadChecksumHandler(void (*handler)(MicroNMEA& nmea)) noexcept { m_badChecksumHandler = handler; }
+
+  char getNavSystem() const noexcept { return m_navSystem; }
+  uint8_t getNumSatellites() const noexcept { return m_numSat; }
+  uint8_t getHDOP() const noexcept { return m_hdop; }
+  bool isValid() const noexcept { return m_isValid; }
+  long getLatitude() const noexcept { return m_latitude; }
+  long getLongitude() const noexcept { return m_longitude; }
+  bool getAltitude(long& alt) const noexcept {
+    if (m_altitudeValid) {
+      alt = m_altitude;
+    }
+    return m_altitudeValid;
+  }
+  uint16_t getYear() const noexcept { return m_year; }
+  uint8_t getMonth() const noexcept { return m_month; }
+  uint8_t getDay() const noexcept { return m_day; }
+  uint8_t getHour() const noexcept { return m_hour; }
+  uint8_t getMinute() const noexcept { return m_minute; }
+  uint8_t getSecond() const noexcept { return m_second; }
+  uint8_t getHundredths() const noexcept { return m_hundredths; }
+  long getSpeed() const noexcept { return m_speed; }
+  long getCourse() const noexcept { return m_course; }
+
+  const char* getSentence() const noexcept { return m_buffer; }
+  char getTalkerID() const noexcept { return m_talkerID; }
+  const char* getMessageID() const noexcept { return m_messageID; }
+
+  void clear() noexcept;
+  bool process(char c);
+
+private:
+  bool processGGA(const char* s);
+  bool processRMC(const char* s);
+
+  char* m_buffer;
+  uint8_t m_bufferLen;
+  char* m_ptr;
+  void (*m_badChecksumHandler)(MicroNMEA& nmea);
+  void (*m_unknownSentenceHandler)(MicroNMEA& nmea);
+
+  char m_talkerID;
+  char m_messageID[6];
+  char m_navSystem;
+  bool m_isValid;
+  long m_latitude;
+  long m_longitude;
+  long m_altitude;
+  bool m_altitudeValid;
+  long m_speed;
+  long m_course;
+  uint16_t m_year;
+  uint8_t m_month;
+  uint8_t m_day;
+  uint8_t m_hour;
+  uint8_t m_minute;
+  uint8_t m_second;
+  uint8_t m_hundredths;
+  uint8_t m_numSat;
+  uint8_t m_hdop;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+class Print {
+public:
+  virtual ~Print() = default;
+
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size-- > 0 && write(*buffer++) == 1) {
+      ++n;
+    }
+    return n;
+  }
+
+  size_t write(const char* str) {
+    return str == nullptr ? 0 : write(reinterpret_cast<const uint8_t*>(str), strlen(str));
+  }
+  size_t write(const char* buffer, size_t size) {
+    return write(reinterpret_cast<const uint8_t*>(buffer), size);
+  }
+
+  size_t print(const char* str) { return write(str); }
+  size_t print(char c) { return write(static_cast<uint8_t>(c)); }
+  size_t print(long n);
+  size_t print(unsigned long n);
+  size_t print(int n) { return print(static_cast<long>(n)); }
+  size_t print(unsigned int n) { return print(static_cast<unsigned long>(n)); }
+  size_t print(double n, int digits = 2);
+
+  size_t println() { return write("\r\n"); }
+  template <typename T>
+  size_t println(T value) {
+    size_t n = print(value);
+    return n + println();
+  }
+};
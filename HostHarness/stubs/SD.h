@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Arduino.h"
+
+#define O_READ 0x01
+#define O_WRITE 0x02
+#define O_APPEND 0x04
+#define O_CREAT 0x10
+
+#define FILE_READ O_READ
+#define FILE_WRITE (O_READ | O_WRITE | O_CREAT | O_APPEND)
+
+/**
+ * Handle to a file on the simulated card. Copies share the underlying open file, as they do in the
+ * SD library. The card is backed by a host directory (see `--sd-dir`).
+ */
+class File : public Stream {
+public:
+  File() noexcept : m_handle(-1) {}
+  explicit File(int handle) noexcept : m_handle(handle) {}
+
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+
+  int read() override;
+  int peek() override;
+  int available() override;
+  int read(void* buffer, uint16_t length);
+  void flush();
+  bool seek(uint32_t position);
+  uint32_t position();
+  uint32_t size();
+  void close();
+  const char* name();
+  bool isDirectory();
+  File openNextFile(uint8_t mode = O_READ);
+  void rewindDirectory();
+
+  operator bool() const;
+
+private:
+  int m_handle;
+};
+
+class SDClass {
+public:
+  bool begin(uint8_t csPin = SDCARD_SS_PIN);
+  void end();
+  File open(const char* path, uint8_t mode = FILE_READ);
+  bool exists(const char* path);
+  bool mkdir(const char* path);
+  bool remove(const char* path);
+  bool rmdir(const char* path);
+};
+
+extern SDClass SD;
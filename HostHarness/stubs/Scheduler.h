@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Arduino.h"
+
+typedef void (*SchedulerTask)(void);
+typedef void (*SchedulerParametricTask)(void*);
+
+/**
+ * Cooperative scheduler with the same semantics as the Arduino Scheduler library: tasks only switch
+ * inside yield(), and delay() yields until its deadline passes on the virtual clock.
+ */
+class SchedulerClass {
+public:
+  static void startLoop(SchedulerTask task, uint32_t stackSize = 1024);
+  static void start(SchedulerTask task, uint32_t stackSize = 1024);
+  static void start(SchedulerParametricTask task, void* data, uint32_t stackSize = 1024);
+
+  static void yield() { ::yield(); }
+};
+
+extern SchedulerClass Scheduler;
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Print.h"
+#include "WString.h"
+
+class Stream : public Print {
+public:
+  Stream() noexcept : m_timeout(1000) {}
+
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long timeout) noexcept { m_timeout = timeout; }
+  unsigned long getTimeout() const noexcept { return m_timeout; }
+
+  /** Same semantics as the Arduino core: waits up to the stream timeout for each character. */
+  String readStringUntil(char terminator);
+  size_t readBytes(char* buffer, size_t length);
+
+protected:
+  int timedRead();
+
+  unsigned long m_timeout;
+};
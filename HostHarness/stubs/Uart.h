@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdint.h>
+#include "Stream.h"
+
+// Matches ArduinoCore-samd's RingBuffer.h
+#define SERIAL_BUFFER_SIZE 350
+
+#define SERIAL_8N1 0x0400
+#define SERIAL_8N2 0x0500
+
+enum SercomRXPad {
+  SERCOM_RX_PAD_0 = 0,
+  SERCOM_RX_PAD_1,
+  SERCOM_RX_PAD_2,
+  SERCOM_RX_PAD_3,
+};
+
+enum SercomUartTXPad {
+  UART_TX_PAD_0 = 0x0,
+  UART_TX_PAD_2 = 0x1,
+  UART_TX_RTS_CTS_PAD_0_2_3 = 0x2,
+};
+
+/** Identifies one of the six SAMD21 serial communication modules. */
+class SERCOM {
+public:
+  explicit constexpr SERCOM(int index) noexcept : m_index(index) {}
+  constexpr int index() const noexcept { return m_index; }
+
+private:
+  int m_index;
+};
+
+extern SERCOM sercom0;
+extern SERCOM sercom1;
+extern SERCOM sercom2;
+extern SERCOM sercom3;
+extern SERCOM sercom4;
+extern SERCOM sercom5;
+
+template <int N>
+class RingBufferN {
+public:
+  RingBufferN() noexcept : m_head(0), m_tail(0), m_count(0) {}
+
+  void store_char(uint8_t c) noexcept {
+    if (m_count < N) {
+      m_buffer[m_head] = c;
+      m_head = (m_head + 1) % N;
+      ++m_count;
+    }
+  }
+  int read_char() noexcept {
+    if (m_count == 0) {
+      return -1;
+    }
+    uint8_t c = m_buffer[m_tail];
+    m_tail = (m_tail + 1) % N;
+    --m_count;
+    return c;
+  }
+  int peek() const noexcept { return m_count == 0 ? -1 : m_buffer[m_tail]; }
+  int available() const noexcept { return m_count; }
+  int availableForStore() const noexcept { return N - m_count; }
+  bool isFull() const noexcept { return m_count == N; }
+  void clear() noexcept { m_head = m_tail = m_count = 0; }
+
+private:
+  uint8_t m_buffer[N];
+  int m_head;
+  int m_tail;
+  int m_count;
+};
+
+/**
+ * UART on a SERCOM. The host simulation attaches a device (GPS receiver, radio) to the SERCOM; bytes
+ * from the device arrive through the SERCOMn_Handler interrupt exactly as they do on the board.
+ */
+class Uart : public Stream {
+public:
+  Uart(SERCOM* sercom, uint8_t rxPin, uint8_t txPin, SercomRXPad rxPad, SercomUartTXPad txPad) noexcept;
+
+  void begin(unsigned long baudRate);
+  void begin(unsigned long baudRate, uint16_t config);
+  void end();
+
+  int available() override;
+  int availableForWrite();
+  int peek() override;
+  int read() override;
+  void flush();
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+
+  void IrqHandler();
+
+  explicit operator bool() const noexcept { return true; }
+
+private:
+  SERCOM* m_sercom;
+  RingBufferN<SERIAL_BUFFER_SIZE> m_rxBuffer;
+  unsigned long m_baud;
+};
+
+extern Uart Serial1;
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+
+/** Minimal heap-backed String, enough for the command parsing in the sketches. */
+class String {
+public:
+  String() noexcept : m_buffer(nullptr), m_length(0) {}
+  String(const char* str) : String() { assign(str, strlen(str)); }
+  String(const String& other) : String() { assign(other.c_str(), other.m_length); }
+  String(String&& other) noexcept : m_buffer(other.m_buffer), m_length(other.m_length) {
+    other.m_buffer = nullptr;
+    other.m_length = 0;
+  }
+  ~String() { free(m_buffer); }
+
+  String& operator=(const String& other) {
+    if (this != &other) {
+      assign(other.c_str(), other.m_length);
+    }
+    return *this;
+  }
+  String& operator=(String&& other) noexcept {
+    if (this != &other) {
+      free(m_buffer);
+      m_buffer = other.m_buffer;
+      m_length = other.m_length;
+      other.m_buffer = nullptr;
+      other.m_length = 0;
+    }
+    return *this;
+  }
+
+  String& operator+=(char c) {
+    char* grown = static_cast<char*>(realloc(m_buffer, m_length + 2));
+    if (grown != nullptr) {
+      m_buffer = grown;
+      m_buffer[m_length++] = c;
+      m_buffer[m_length] = '\0';
+    }
+    return *this;
+  }
+
+  const char* c_str() const noexcept { return m_buffer == nullptr ? "" : m_buffer; }
+  unsigned int length() const noexcept { return m_length; }
+
+  bool equals(const char* other) const noexcept { return strcmp(c_str(), other) == 0; }
+  bool operator==(const char* other) const noexcept { return equals(other); }
+  bool operator!=(const char* other) const noexcept { return !equals(other); }
+  bool operator==(const String& other) const noexcept { return equals(other.c_str()); }
+
+private:
+  void assign(const char* str, unsigned int length) {
+    char* copy = static_cast<char*>(malloc(length + 1));
+    if (copy != nullptr) {
+      memcpy(copy, str, length);
+      copy[length] = '\0';
+    }
+    free(m_buffer);
+    m_buffer = copy;
+    m_length = copy == nullptr ? 0 : length;
+  }
+
+  char* m_buffer;
+  unsigned int m_length;
+};
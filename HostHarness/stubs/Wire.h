@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Arduino.h"
+
+/**
+ * I2C master. Sketch code talks to devices byte by byte, as with the real library; transactions go
+ * to the simulated device at that address on this sercom (see hostsim::i2cDevice) and their bus
+ * time is charged to the virtual clock. The sensor library stand-ins don't move real bytes: they
+ * report the size of each transaction with transfer().
+ */
+class TwoWire : public Stream {
+public:
+  TwoWire(SERCOM* sercom, uint8_t sdaPin, uint8_t sclPin) noexcept;
+
+  void begin();
+  void end();
+  void setClock(uint32_t frequency) noexcept { m_clock = frequency; }
+  uint32_t getClock() const noexcept { return m_clock; }
+
+  void beginTransmission(uint8_t address);
+  /** 0 on success, 2 if no device acknowledged the address. */
+  uint8_t endTransmission(bool stopBit = true);
+  size_t requestFrom(uint8_t address, size_t quantity, bool stopBit = true);
+
+  size_t write(uint8_t data) override;
+  size_t write(const uint8_t* data, size_t quantity) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int peek() override;
+
+  void onService();
+
+  /**
+   * Charge a complete write-then-read transaction (start, address, register writes, repeated
+   * start, reads, stop) to the virtual clock. Blocks the calling task, as the Wire library does.
+   */
+  void transfer(size_t bytesWritten, size_t bytesRead);
+
+  /** Time a transaction of the given size takes through the Wire library, in microseconds. */
+  uint32_t transferMicros(size_t bytesWritten, size_t bytesRead) const noexcept;
+
+  /**
+   * Time the bytes alone occupy the bus: start, address, the bytes written, then a repeated start,
+   * the address and the bytes read, and a stop. No bytes written means a plain read.
+   */
+  uint32_t busMicros(size_t bytesWritten, size_t bytesRead) const noexcept;
+
+  SERCOM* sercom() const noexcept { return m_sercom; }
+
+private:
+  // Same sizes as the SAMD core's RingBuffer
+  static const size_t BUFFER_SIZE = 256;
+
+  uint32_t bitsMicros(uint64_t bits) const noexcept;
+
+  SERCOM* m_sercom;
+  uint32_t m_clock;
+  uint8_t m_txAddress;
+  uint8_t m_txBuffer[BUFFER_SIZE];
+  size_t m_txLength;
+  bool m_transmitting;
+  // A write ended without a stop condition, so the next request is a repeated start
+  bool m_repeatedStart;
+  uint8_t m_rxBuffer[BUFFER_SIZE];
+  size_t m_rxLength;
+  size_t m_rxIndex;
+};
+
+extern TwoWire Wire;
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Arduino.h"
+
+enum EPioType {
+  PIO_NOT_A_PIN = -1,
+  PIO_EXTINT = 0,
+  PIO_ANALOG,
+  PIO_SERCOM,
+  PIO_SERCOM_ALT,
+  PIO_TIMER,
+  PIO_TIMER_ALT,
+  PIO_COM,
+  PIO_AC_CLK,
+  PIO_DIGITAL,
+  PIO_INPUT,
+  PIO_INPUT_PULLUP,
+  PIO_OUTPUT,
+};
+
+int pinPeripheral(uint32_t pin, EPioType peripheral);
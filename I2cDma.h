@@ -0,0 +1,264 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+
+/*
+Asynchronous I2C transactions, one queue per bus, so the IMU, altimeter and humidity sensor can be
+read at the same time instead of one Wire call after another. A transaction writes a few bytes
+(usually a register address) and then reads, after a repeated start, into the caller's buffer. On
+the board the bytes read are moved by the DMA controller and the register address by the SERCOM's
+interrupt (I2cDmaSamd.h); the host simulation stands in for both with its bus timing model
+(HostHarness/src/i2cdma.cpp).
+
+Submitting never waits. A transaction can be polled (pending(), succeeded()), waited for (wait()),
+or given a callback, which runs in the interrupt once it finishes and may submit more
+transactions. Nothing is allocated: transactions and their buffers belong to the caller and must
+stay put until they finish.
+
+The sensor drivers still set the buses up and use them with blocking Wire calls. Those must not be
+made on a bus while it has transactions pending.
+*/
+
+struct I2CTransaction {
+  enum Status : uint8_t {
+    /** Not submitted */
+    IDLE,
+    /** Waiting for the bus */
+    QUEUED,
+    /** On the bus */
+    ACTIVE,
+    /** Finished; the bytes read are in `readData` */
+    DONE,
+    /** The device didn't acknowledge its address or a byte written */
+    NACK,
+    /** Bus error, lost arbitration or a DMA error */
+    BUS_ERROR,
+  };
+
+  /** Most bytes written before the read */
+  static const uint8_t MAX_WRITE = 4;
+
+  uint8_t address;
+  uint8_t writeLength;
+  uint8_t writeData[MAX_WRITE];
+  /** Where the bytes read go. Up to 255 (the SERCOM's transfer length). */
+  uint8_t* readData;
+  uint8_t readLength;
+  volatile Status status;
+  /** Called from the interrupt when the transaction finishes, whatever its status */
+  void (*callback)(I2CTransaction& transaction);
+  /** For the callback */
+  void* context;
+  /** The next one queued on the same bus */
+  I2CTransaction* next;
+
+  I2CTransaction() noexcept :
+    address(0),
+    writeLength(0),
+    writeData(),
+    readData(nullptr),
+    readLength(0),
+    status(IDLE),
+    callback(nullptr),
+    context(nullptr),
+    next(nullptr) {}
+
+  /** Set up a read of `length` bytes starting at register `reg`. */
+  void setRead(uint8_t deviceAddress, uint8_t reg, uint8_t* data, uint8_t length) noexcept {
+    address = deviceAddress;
+    writeData[0] = reg;
+    writeLength = 1;
+    readData = data;
+    readLength = length;
+  }
+
+  /** Set up a read of `length` bytes without writing a register address first. */
+  void setRead(uint8_t deviceAddress, uint8_t* data, uint8_t length) noexcept {
+    address = deviceAddress;
+    writeLength = 0;
+    readData = data;
+    readLength = length;
+  }
+
+  /** Set up a write of `length` bytes (at most MAX_WRITE), with nothing read back. */
+  void setWrite(uint8_t deviceAddress, const uint8_t* data, uint8_t length) noexcept {
+    address = deviceAddress;
+    writeLength = length < MAX_WRITE ? length : MAX_WRITE;
+    memcpy(writeData, data, writeLength);
+    readData = nullptr;
+    readLength = 0;
+  }
+
+  bool pending() const noexcept {
+    return status == QUEUED || status == ACTIVE;
+  }
+
+  bool succeeded() const noexcept {
+    return status == DONE;
+  }
+
+  /** Wait until it has finished, sleeping between interrupts. */
+  void wait() const;
+};
+
+/**
+ * One I2C bus (a TwoWire on its SERCOM) with its own DMA channel. Transactions run one at a time in
+ * the order submitted; different buses run at the same time.
+ */
+class I2CBus {
+public:
+  /** DMA channels used, one per bus: 0 to MAX_BUSES - 1 */
+  static const uint8_t MAX_BUSES = 3;
+
+  /**
+   * @param[in] theWire The bus. Must be valid for the lifetime of the I2CBus.
+   * @param[in] sercomIndex The SERCOM `theWire` is on: Wire is on sercom0 on the MKR boards.
+   * @param[in] dmaChannel Below MAX_BUSES, and different for every bus.
+   */
+  I2CBus(TwoWire* theWire, uint8_t sercomIndex, uint8_t dmaChannel) noexcept :
+    m_wire(theWire),
+    m_sercom(sercomIndex),
+    m_channel(dmaChannel),
+    m_begun(false),
+    m_head(nullptr),
+    m_tail(nullptr),
+    m_writeIndex(0),
+    m_completed(0),
+    m_failed(0) {}
+
+  /**
+   * Set up the DMA channel. Call once the sensor drivers have started the bus (their begin()).
+   * Does nothing after the first time.
+   */
+  void begin() {
+    if (m_begun || m_channel >= MAX_BUSES) {
+      return;
+    }
+    registered()[m_channel] = this;
+    hardwareBegin();
+    m_begun = true;
+  }
+
+  bool isBegun() const noexcept {
+    return m_begun;
+  }
+
+  /**
+   * Queue a transaction, starting it now if the bus is free.
+   * @return false if the bus hasn't begun or the transaction is already pending.
+   */
+  bool submit(I2CTransaction& transaction) {
+    if (!m_begun || transaction.pending()) {
+      return false;
+    }
+    transaction.next = nullptr;
+    transaction.status = I2CTransaction::QUEUED;
+    noInterrupts();
+    bool idle = m_head == nullptr;
+    if (idle) {
+      m_head = &transaction;
+    } else {
+      m_tail->next = &transaction;
+    }
+    m_tail = &transaction;
+    interrupts();
+    if (idle) {
+      start();
+    }
+    return true;
+  }
+
+  /** Has it got transactions queued or running? */
+  bool busy() const noexcept {
+    return m_head != nullptr;
+  }
+
+  /** Wait until every transaction queued, including those callbacks add meanwhile, has finished. */
+  void wait() const {
+    while (busy()) {
+      waitForInterrupt();
+    }
+  }
+
+  TwoWire* wire() const noexcept {
+    return m_wire;
+  }
+
+  /** Transactions finished, whatever their status */
+  uint32_t completed() const noexcept {
+    return m_completed;
+  }
+
+  /** Transactions that didn't finish DONE */
+  uint32_t failed() const noexcept {
+    return m_failed;
+  }
+
+  /** Call from the bus's SERCOMn_Handler, along with the TwoWire's onService(). */
+  void onService();
+
+  /** Call from DMAC_Handler. */
+  static void onDmaInterrupt();
+
+  /** Sleep until the next interrupt. */
+  static void waitForInterrupt();
+
+private:
+  TwoWire* m_wire;
+  uint8_t m_sercom;
+  uint8_t m_channel;
+  bool m_begun;
+  I2CTransaction* volatile m_head;
+  I2CTransaction* m_tail;
+  // Bytes of the running transaction's register address sent so far
+  uint8_t m_writeIndex;
+  uint32_t m_completed;
+  uint32_t m_failed;
+
+  /** Buses by DMA channel, for the interrupts */
+  static I2CBus** registered() noexcept {
+    static I2CBus* buses[MAX_BUSES] = {};
+    return buses;
+  }
+
+  void start() {
+    m_head->status = I2CTransaction::ACTIVE;
+    m_writeIndex = 0;
+    hardwareStart(*m_head);
+  }
+
+  /** From the interrupt: the transaction at the head of the queue has ended. */
+  void finish(I2CTransaction::Status status) {
+    I2CTransaction* transaction = m_head;
+    m_head = transaction->next;
+    if (m_head == nullptr) {
+      m_tail = nullptr;
+    } else {
+      start();
+    }
+    ++m_completed;
+    if (status != I2CTransaction::DONE) {
+      ++m_failed;
+    }
+    // Last, so the callback can resubmit it
+    transaction->status = status;
+    if (transaction->callback != nullptr) {
+      transaction->callback(*transaction);
+    }
+  }
+
+  // Defined by I2cDmaSamd.h on the board and by the host simulation
+  void hardwareBegin();
+  void hardwareStart(I2CTransaction& transaction);
+};
+
+inline void I2CTransaction::wait() const {
+  while (pending()) {
+    I2CBus::waitForInterrupt();
+  }
+}
+
+#ifdef ARDUINO_ARCH_SAMD
+#include "I2cDmaSamd.h"
+#endif
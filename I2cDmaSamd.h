@@ -0,0 +1,181 @@
+#pragma once
+
+// The SAMD21 half of I2cDma.h: included from there, don't include directly.
+
+/*
+Each transaction runs on the SERCOM's I2C master (datasheet section 28) like this:
+ 1. The address goes out as a write. Each time the master is done with a byte (MB), the interrupt
+    sends the next byte of the register address.
+ 2. Writing the address again for a read, with ADDR.LENEN and the length, makes a repeated start.
+    The DMA channel, triggered by the SERCOM's RX, takes every byte out of DATA. Smart mode
+    acknowledges each one, and after the last the master sends a NACK and a stop.
+ 3. The channel's transfer-complete interrupt finishes the transaction and starts the next one.
+A write-only transaction stops after step 1, and a read without a register address starts at 2. A
+NACK or a bus error (MB or ERROR with the STATUS bits) stops and ends it early.
+
+Interrupts are only enabled while a transaction runs, and smart mode is turned back off afterwards,
+so the Wire library's polled transfers still work between them. The DMAC interrupt runs at the
+same priority as the SERCOMs', so neither interrupts the other.
+*/
+
+namespace I2cDmaSamd {
+  /** I2CM STATUS.BUSSTATE when this master holds the bus */
+  const uint16_t BUS_OWNER = 2;
+  const uint8_t CMD_STOP = 3;
+
+  inline SercomI2cm& registers(uint8_t sercom) noexcept {
+    static Sercom* const SERCOMS[] = { SERCOM0, SERCOM1, SERCOM2, SERCOM3, SERCOM4, SERCOM5 };
+    return SERCOMS[sercom]->I2CM;
+  }
+
+  /** One descriptor and one write-back slot per channel, at the addresses the DMAC is given */
+  inline DmacDescriptor* descriptors() noexcept {
+    static DmacDescriptor descriptors[I2CBus::MAX_BUSES] __attribute__((aligned(16)));
+    return descriptors;
+  }
+
+  inline DmacDescriptor* writeBack() noexcept {
+    static DmacDescriptor writeBack[I2CBus::MAX_BUSES] __attribute__((aligned(16)));
+    return writeBack;
+  }
+
+  inline void synchronize(SercomI2cm& i2c) noexcept {
+    while (i2c.SYNCBUSY.reg & SERCOM_I2CM_SYNCBUSY_SYSOP) {}
+  }
+
+  inline void command(SercomI2cm& i2c, uint8_t command) noexcept {
+    i2c.CTRLB.reg |= SERCOM_I2CM_CTRLB_CMD(command);
+    synchronize(i2c);
+  }
+
+  inline void disableChannel(uint8_t channel) noexcept {
+    DMAC->CHID.reg = DMAC_CHID_ID(channel);
+    DMAC->CHCTRLA.reg &= ~DMAC_CHCTRLA_ENABLE;
+    while (DMAC->CHCTRLA.reg & DMAC_CHCTRLA_ENABLE) {}
+  }
+
+  /** Hand the bus back to the Wire library's way of working. */
+  inline void release(SercomI2cm& i2c, uint8_t channel) noexcept {
+    i2c.INTENCLR.reg = SERCOM_I2CM_INTENCLR_MB | SERCOM_I2CM_INTENCLR_ERROR;
+    i2c.CTRLB.reg &= ~SERCOM_I2CM_CTRLB_SMEN;
+    synchronize(i2c);
+    disableChannel(channel);
+  }
+
+  /** Step 2: arm the channel, then send the read address with the length. */
+  inline void startRead(SercomI2cm& i2c, uint8_t sercom, uint8_t channel, I2CTransaction& transaction) noexcept {
+    DmacDescriptor& descriptor = descriptors()[channel];
+    descriptor.BTCTRL.reg = DMAC_BTCTRL_VALID | DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_DSTINC;
+    descriptor.BTCNT.reg = transaction.readLength;
+    descriptor.SRCADDR.reg = (uint32_t)&i2c.DATA.reg;
+    // With DSTINC, the address just past the end
+    descriptor.DSTADDR.reg = (uint32_t)(transaction.readData + transaction.readLength);
+    descriptor.DESCADDR.reg = 0;
+
+    DMAC->CHID.reg = DMAC_CHID_ID(channel);
+    DMAC->CHCTRLB.reg = DMAC_CHCTRLB_LVL(0) | DMAC_CHCTRLB_TRIGSRC(SERCOM0_DMAC_ID_RX + 2 * sercom)
+      | DMAC_CHCTRLB_TRIGACT_BEAT;
+    DMAC->CHINTENSET.reg = DMAC_CHINTENSET_TCMPL | DMAC_CHINTENSET_TERR;
+    DMAC->CHCTRLA.reg |= DMAC_CHCTRLA_ENABLE;
+
+    i2c.ADDR.reg = SERCOM_I2CM_ADDR_ADDR((transaction.address << 1) | 1) | SERCOM_I2CM_ADDR_LENEN
+      | SERCOM_I2CM_ADDR_LEN(transaction.readLength);
+    synchronize(i2c);
+  }
+}
+
+inline void I2CBus::hardwareBegin() {
+  static bool dmacStarted = false;
+  if (!dmacStarted) {
+    PM->AHBMASK.reg |= PM_AHBMASK_DMAC;
+    PM->APBBMASK.reg |= PM_APBBMASK_DMAC;
+    DMAC->CTRL.reg &= ~DMAC_CTRL_DMAENABLE;
+    DMAC->CTRL.reg = DMAC_CTRL_SWRST;
+    while (DMAC->CTRL.reg & DMAC_CTRL_SWRST) {}
+    DMAC->BASEADDR.reg = (uint32_t)I2cDmaSamd::descriptors();
+    DMAC->WRBADDR.reg = (uint32_t)I2cDmaSamd::writeBack();
+    DMAC->CTRL.reg = DMAC_CTRL_DMAENABLE | DMAC_CTRL_LVLEN(0xF);
+    // The Wire library gives the SERCOMs the lowest priority; the same here
+    NVIC_SetPriority(DMAC_IRQn, (1 << __NVIC_PRIO_BITS) - 1);
+    NVIC_EnableIRQ(DMAC_IRQn);
+    dmacStarted = true;
+  }
+  DMAC->CHID.reg = DMAC_CHID_ID(m_channel);
+  DMAC->CHCTRLA.reg &= ~DMAC_CHCTRLA_ENABLE;
+  DMAC->CHCTRLA.reg = DMAC_CHCTRLA_SWRST;
+  while (DMAC->CHCTRLA.reg & DMAC_CHCTRLA_SWRST) {}
+}
+
+inline void I2CBus::hardwareStart(I2CTransaction& transaction) {
+  SercomI2cm& i2c = I2cDmaSamd::registers(m_sercom);
+  // Smart mode: reading DATA acknowledges the byte, which is what lets the DMA do the reading
+  i2c.CTRLB.reg |= SERCOM_I2CM_CTRLB_SMEN;
+  I2cDmaSamd::synchronize(i2c);
+  i2c.INTFLAG.reg = SERCOM_I2CM_INTFLAG_ERROR;
+  i2c.INTENSET.reg = SERCOM_I2CM_INTENSET_MB | SERCOM_I2CM_INTENSET_ERROR;
+  if (transaction.writeLength > 0) {
+    i2c.ADDR.reg = SERCOM_I2CM_ADDR_ADDR(transaction.address << 1);
+    I2cDmaSamd::synchronize(i2c);
+  } else {
+    I2cDmaSamd::startRead(i2c, m_sercom, m_channel, transaction);
+  }
+}
+
+inline void I2CBus::onService() {
+  if (m_head == nullptr) {
+    return;
+  }
+  SercomI2cm& i2c = I2cDmaSamd::registers(m_sercom);
+  uint8_t flags = i2c.INTFLAG.reg & i2c.INTENSET.reg;
+  if (flags == 0) {
+    return;
+  }
+  I2CTransaction& transaction = *m_head;
+  uint16_t status = i2c.STATUS.reg;
+
+  if ((flags & SERCOM_I2CM_INTFLAG_ERROR) || (status & (SERCOM_I2CM_STATUS_ARBLOST | SERCOM_I2CM_STATUS_BUSERR))) {
+    i2c.INTFLAG.reg = SERCOM_I2CM_INTFLAG_ERROR;
+    if ((status & SERCOM_I2CM_STATUS_BUSSTATE_Msk) == SERCOM_I2CM_STATUS_BUSSTATE(I2cDmaSamd::BUS_OWNER)) {
+      I2cDmaSamd::command(i2c, I2cDmaSamd::CMD_STOP);
+    }
+    I2cDmaSamd::release(i2c, m_channel);
+    finish(I2CTransaction::BUS_ERROR);
+    return;
+  }
+
+  // MB: the address or a byte written went out, acknowledged or not
+  if (status & SERCOM_I2CM_STATUS_RXNACK) {
+    I2cDmaSamd::command(i2c, I2cDmaSamd::CMD_STOP);
+    I2cDmaSamd::release(i2c, m_channel);
+    finish(I2CTransaction::NACK);
+  } else if (m_writeIndex < transaction.writeLength) {
+    i2c.DATA.reg = transaction.writeData[m_writeIndex++];
+    I2cDmaSamd::synchronize(i2c);
+  } else if (transaction.readLength > 0) {
+    I2cDmaSamd::startRead(i2c, m_sercom, m_channel, transaction);
+  } else {
+    I2cDmaSamd::command(i2c, I2cDmaSamd::CMD_STOP);
+    I2cDmaSamd::release(i2c, m_channel);
+    finish(I2CTransaction::DONE);
+  }
+}
+
+inline void I2CBus::onDmaInterrupt() {
+  while (DMAC->INTSTATUS.reg != 0) {
+    uint8_t channel = DMAC->INTPEND.reg & DMAC_INTPEND_ID_Msk;
+    DMAC->CHID.reg = DMAC_CHID_ID(channel);
+    uint8_t flags = DMAC->CHINTFLAG.reg;
+    DMAC->CHINTFLAG.reg = flags;
+    I2CBus* bus = channel < MAX_BUSES ? registered()[channel] : nullptr;
+    if (bus == nullptr || bus->m_head == nullptr || !(flags & (DMAC_CHINTFLAG_TCMPL | DMAC_CHINTFLAG_TERR))) {
+      continue;
+    }
+    // The master sends the NACK and stop after the last byte by itself (ADDR.LENEN)
+    I2cDmaSamd::release(I2cDmaSamd::registers(bus->m_sercom), channel);
+    bus->finish(flags & DMAC_CHINTFLAG_TERR ? I2CTransaction::BUS_ERROR : I2CTransaction::DONE);
+  }
+}
+
+inline void I2CBus::waitForInterrupt() {
+  __WFI();
+}
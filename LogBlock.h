@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Layout of the SD log's sectors when SD_BLOCK_LOG is true. SDCard always writes the log a whole
+sector at a time, on the file's sector boundaries, which are the card's. With SD_BLOCK_LOG each of
+those sectors starts with a LogBlockHeader, followed by `length` bytes of the log and zeros to the
+end of the sector. Strung together in `sequence` order, the blocks' bytes are exactly the log that
+would have been written without SD_BLOCK_LOG (CSV, binary or compressed).
+
+Every block says which file it belongs to and where it goes, and carries a CRC, so the log can be
+read back from a raw image of the card without the FAT or the directory entry, which are only
+brought up to date when the file is synced or closed
+(AnalysesFolder/cardRecovery/RecoverLog.cpp). A power cut then costs at most the block being
+written and what was still in SDCard's buffers.
+
+Everything is little-endian with no padding. Bump LOG_BLOCK_VERSION whenever the header changes.
+*/
+
+const uint8_t LOG_BLOCK_VERSION = 1;
+
+struct __attribute__((packed)) LogBlockHeader {
+  /** Always "BSCB" */
+  char magic[4];
+  uint8_t version;
+  /** LogBlock::Format of the log carried */
+  uint8_t format;
+  /** Bytes of the log in this block */
+  uint16_t length;
+  /** Picked at random when the file is created, so blocks of older logs left on the card can't mix in */
+  uint32_t fileId;
+  /** SDCard's number for the file: 0 is CAPS_INF, n is CAPS_IN<n - 1> and so on */
+  uint32_t logNumber;
+  /** The file's first block is 0 */
+  uint32_t sequence;
+  /** LogBlock::crc32() of the header before this field, then the `length` bytes of the log */
+  uint32_t crc;
+};
+
+static_assert(sizeof(LogBlockHeader) == 24, "LogBlockHeader must not be padded");
+
+namespace LogBlock {
+  const size_t SIZE = 512;
+  /** Most bytes of the log one block carries */
+  const size_t CAPACITY = SIZE - sizeof(LogBlockHeader);
+
+  enum Format {
+    CSV,
+    BINARY,
+    COMPRESSED,
+  };
+
+  /** CRC-32 (IEEE, as zlib), a nibble at a time: a 64-byte table instead of 1 KB. */
+  inline uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0) {
+    static const uint32_t NIBBLE_TABLE[16] = {
+      0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+      0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+    crc = ~crc;
+    while (length--) {
+      crc ^= *data++;
+      crc = (crc >> 4) ^ NIBBLE_TABLE[crc & 0x0F];
+      crc = (crc >> 4) ^ NIBBLE_TABLE[crc & 0x0F];
+    }
+    return ~crc;
+  }
+
+  /** The CRC a block with this header and log bytes must carry */
+  inline uint32_t checksum(const LogBlockHeader& header, const uint8_t* data) {
+    uint32_t crc = crc32(reinterpret_cast<const uint8_t*>(&header), offsetof(LogBlockHeader, crc));
+    return crc32(data, header.length, crc);
+  }
+}
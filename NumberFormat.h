@@ -0,0 +1,377 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+printf's number conversions without printf: %d, %0NX, %.Nf and %.Ng for floats, written with
+integer arithmetic only and no allocation. A float is taken apart into its mantissa and exponent
+and its exact decimal digits are produced one at a time, so the output is correctly rounded (half
+to even, like glibc and newlib) and matches snprintf byte for byte, "nan", "inf" and "-0.00"
+included. Keeps newlib's soft-float printf off the per-sample path.
+
+Every function writes into `out`, which must hold the MAX_*_LENGTH below, and returns the number of
+characters written. Nothing is null-terminated.
+*/
+
+namespace NumberFormat {
+
+/** Longest decimal() output: "-2147483648" */
+const size_t MAX_INTEGER_LENGTH = 11;
+
+const unsigned MAX_DECIMALS = 9;
+/** Longest fixed() output: sign, the 39 integer digits of FLT_MAX, point and MAX_DECIMALS */
+const size_t MAX_FIXED_LENGTH = 1 + 39 + 1 + MAX_DECIMALS;
+
+const unsigned MAX_PRECISION = 9;
+/** Longest general() output: "-1.2345678e-45", or "-0.0001" followed by MAX_PRECISION - 1 digits */
+const size_t MAX_GENERAL_LENGTH = MAX_PRECISION + 6;
+
+namespace detail {
+  /** A float as sign, class, and |value| = mantissa * 2^exponent */
+  struct Parts {
+    bool negative;
+    bool nan;
+    bool infinite;
+    uint32_t mantissa;
+    int exponent;
+  };
+
+  inline Parts split(float value) noexcept {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof bits);
+    Parts parts;
+    parts.negative = (bits >> 31) != 0;
+    uint32_t biased = (bits >> 23) & 0xFF;
+    uint32_t fraction = bits & 0x7FFFFF;
+    parts.nan = biased == 0xFF && fraction != 0;
+    parts.infinite = biased == 0xFF && fraction == 0;
+    if (biased == 0) {
+      // Zero or subnormal
+      parts.mantissa = fraction;
+      parts.exponent = -149;
+    } else {
+      parts.mantissa = fraction | 0x800000;
+      parts.exponent = (int)biased - 150;
+    }
+    return parts;
+  }
+
+  /**
+   * The exact decimal expansion of mantissa * 2^exponent: the integer part as text up front, then
+   * the fraction one digit at a time. Every float's fraction ends within 149 digits.
+   */
+  class Expansion {
+  public:
+    Expansion(uint32_t mantissa, int exponent) noexcept : m_integerLength(0), m_shift(0), m_fraction(0) {
+      memset(m_words, 0, sizeof m_words);
+      if (exponent >= 0) {
+        setInteger(mantissa, exponent);
+        return;
+      }
+      unsigned shift = -exponent;
+      uint32_t integer = shift < 32 ? mantissa >> shift : 0;
+      uint32_t fraction = shift < 32 ? mantissa & ((1UL << shift) - 1) : mantissa;
+      setInteger(integer, 0);
+      m_shift = shift;
+      if (shift <= NARROW_SHIFT) {
+        m_fraction = fraction;
+      } else {
+        // Scale the fraction to F / 2^160, so each digit is what multiplying by 10 carries out
+        unsigned offset = 160 - shift;
+        m_words[offset / 32] = fraction << (offset % 32);
+        if (offset % 32 != 0 && offset / 32 + 1 < WORDS) {
+          m_words[offset / 32 + 1] = fraction >> (32 - offset % 32);
+        }
+      }
+    }
+
+    /** Digits of the integer part, with no leading zeros: none at all if it is zero. */
+    const char* integerDigits() const noexcept { return m_integer; }
+    unsigned integerLength() const noexcept { return m_integerLength; }
+
+    /** The next digit after the decimal point */
+    uint8_t nextFractionDigit() noexcept {
+      if (m_shift <= 28) {
+        // Most sensor readings: the fraction times 10 still fits in 32 bits
+        uint32_t scaled = (uint32_t)m_fraction * 10;
+        m_fraction = scaled & ((1UL << m_shift) - 1);
+        return (uint8_t)(scaled >> m_shift);
+      } else if (m_shift <= NARROW_SHIFT) {
+        uint64_t scaled = m_fraction * 10;
+        m_fraction = scaled & ((1ULL << m_shift) - 1);
+        return (uint8_t)(scaled >> m_shift);
+      }
+      uint32_t carry = 0;
+      for (unsigned i = 0; i < WORDS; ++i) {
+        uint64_t product = (uint64_t)m_words[i] * 10 + carry;
+        m_words[i] = (uint32_t)product;
+        carry = (uint32_t)(product >> 32);
+      }
+      return (uint8_t)carry;
+    }
+
+    /** True once every remaining fraction digit is zero */
+    bool fractionIsZero() const noexcept {
+      if (m_shift <= NARROW_SHIFT) {
+        return m_fraction == 0;
+      }
+      for (unsigned i = 0; i < WORDS; ++i) {
+        if (m_words[i] != 0) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+  private:
+    // Fractions of up to this many bits are kept in m_fraction; longer ones (below about 1e-11)
+    // in m_words
+    static const unsigned NARROW_SHIFT = 60;
+    static const unsigned WORDS = 5;
+
+    void setInteger(uint32_t mantissa, unsigned shift) noexcept {
+      char reversed[40];
+      unsigned length = 0;
+      if (shift <= 39) {
+        uint64_t value = (uint64_t)mantissa << shift;
+        if (value <= 0xFFFFFFFF) {
+          for (uint32_t small = (uint32_t)value; small != 0; small /= 10) {
+            reversed[length++] = '0' + small % 10;
+          }
+        } else {
+          for (; value != 0; value /= 10) {
+            reversed[length++] = '0' + value % 10;
+          }
+        }
+      } else {
+        // Up to 128 bits: peel off nine digits at a time by long division
+        uint32_t words[WORDS] = {0};
+        words[shift / 32] = mantissa << (shift % 32);
+        if (shift % 32 != 0) {
+          words[shift / 32 + 1] = mantissa >> (32 - shift % 32);
+        }
+        bool nonzero = true;
+        while (nonzero) {
+          uint64_t remainder = 0;
+          nonzero = false;
+          for (unsigned i = WORDS; i-- > 0;) {
+            uint64_t current = (remainder << 32) | words[i];
+            words[i] = (uint32_t)(current / 1000000000);
+            remainder = current % 1000000000;
+            nonzero |= words[i] != 0;
+          }
+          uint32_t chunk = (uint32_t)remainder;
+          for (int digit = 0; digit < 9 && (nonzero || chunk != 0); ++digit) {
+            reversed[length++] = '0' + chunk % 10;
+            chunk /= 10;
+          }
+        }
+      }
+      m_integerLength = length;
+      for (unsigned i = 0; i < length; ++i) {
+        m_integer[i] = reversed[length - 1 - i];
+      }
+    }
+
+    char m_integer[40];
+    unsigned m_integerLength;
+    unsigned m_shift;
+    uint64_t m_fraction;
+    uint32_t m_words[WORDS];
+  };
+
+  /**
+   * Round the `length` digits in `digits` half to even, given the digit after them and whether
+   * anything nonzero follows that. Returns true if the digits rolled over from all nines to zeros.
+   */
+  inline bool round(char* digits, unsigned length, uint8_t next, bool sticky) noexcept {
+    bool odd = length > 0 && ((digits[length - 1] - '0') & 1) != 0;
+    if (next < 5 || (next == 5 && !sticky && !odd)) {
+      return false;
+    }
+    for (unsigned i = length; i-- > 0;) {
+      if (digits[i] != '9') {
+        ++digits[i];
+        return false;
+      }
+      digits[i] = '0';
+    }
+    return true;
+  }
+
+  /** "nan" or "inf" after the sign, as glibc writes them. Returns the length, or 0 if finite. */
+  inline size_t special(char* out, const Parts& parts) noexcept {
+    if (!parts.nan && !parts.infinite) {
+      return 0;
+    }
+    memcpy(out, parts.nan ? "nan" : "inf", 3);
+    return 3;
+  }
+}
+
+/** %<minDigits>u in base 10, or %0<minDigits>X in base 16 */
+inline size_t digits(char* out, uint32_t value, unsigned base = 10, unsigned minDigits = 1) noexcept {
+  static const char DIGITS[] = "0123456789ABCDEF";
+  char reversed[32];
+  unsigned length = 0;
+  do {
+    reversed[length++] = DIGITS[value % base];
+    value /= base;
+  } while (value != 0);
+  while (length < minDigits && length < sizeof reversed) {
+    reversed[length++] = '0';
+  }
+  for (unsigned i = 0; i < length; ++i) {
+    out[i] = reversed[length - 1 - i];
+  }
+  return length;
+}
+
+/** %d */
+inline size_t decimal(char* out, int32_t value) noexcept {
+  if (value < 0) {
+    *out = '-';
+    return 1 + digits(out + 1, 0U - (uint32_t)value);
+  }
+  return digits(out, (uint32_t)value);
+}
+
+/** %0<width>X */
+inline size_t hex(char* out, uint32_t value, unsigned width) noexcept {
+  return digits(out, value, 16, width);
+}
+
+/** %.<decimals>f, for decimals up to MAX_DECIMALS */
+inline size_t fixed(char* out, float value, unsigned decimals) noexcept {
+  detail::Parts parts = detail::split(value);
+  size_t length = 0;
+  if (parts.negative) {
+    out[length++] = '-';
+  }
+  size_t special = detail::special(out + length, parts);
+  if (special != 0) {
+    return length + special;
+  }
+
+  detail::Expansion expansion(parts.mantissa, parts.exponent);
+  char digits[40 + MAX_DECIMALS];
+  unsigned integerLength = expansion.integerLength();
+  if (integerLength == 0) {
+    digits[0] = '0';
+    integerLength = 1;
+  } else {
+    memcpy(digits, expansion.integerDigits(), integerLength);
+  }
+  unsigned count = integerLength;
+  for (unsigned i = 0; i < decimals; ++i) {
+    digits[count++] = '0' + expansion.nextFractionDigit();
+  }
+  uint8_t next = expansion.nextFractionDigit();
+  if (detail::round(digits, count, next, !expansion.fractionIsZero())) {
+    out[length++] = '1';
+  }
+  memcpy(out + length, digits, integerLength);
+  length += integerLength;
+  if (decimals > 0) {
+    out[length++] = '.';
+    memcpy(out + length, digits + integerLength, decimals);
+    length += decimals;
+  }
+  return length;
+}
+
+/** %.<precision>g, for precision 1 to MAX_PRECISION */
+inline size_t general(char* out, float value, unsigned precision) noexcept {
+  detail::Parts parts = detail::split(value);
+  size_t length = 0;
+  if (parts.negative) {
+    out[length++] = '-';
+  }
+  size_t special = detail::special(out + length, parts);
+  if (special != 0) {
+    return length + special;
+  }
+  if (parts.mantissa == 0) {
+    out[length++] = '0';
+    return length;
+  }
+
+  // The first `precision` significant digits, and the power of ten of the first
+  detail::Expansion expansion(parts.mantissa, parts.exponent);
+  char digits[MAX_PRECISION];
+  int exponent10;
+  uint8_t next;
+  bool sticky;
+  unsigned integerLength = expansion.integerLength();
+  if (integerLength > precision) {
+    const char* integer = expansion.integerDigits();
+    memcpy(digits, integer, precision);
+    next = integer[precision] - '0';
+    sticky = !expansion.fractionIsZero();
+    for (unsigned i = precision + 1; i < integerLength && !sticky; ++i) {
+      sticky = integer[i] != '0';
+    }
+    exponent10 = integerLength - 1;
+  } else {
+    unsigned count = integerLength;
+    if (count > 0) {
+      memcpy(digits, expansion.integerDigits(), count);
+      exponent10 = integerLength - 1;
+    } else {
+      uint8_t digit;
+      exponent10 = -1;
+      while ((digit = expansion.nextFractionDigit()) == 0) {
+        --exponent10;
+      }
+      digits[count++] = '0' + digit;
+    }
+    while (count < precision) {
+      digits[count++] = '0' + expansion.nextFractionDigit();
+    }
+    next = expansion.nextFractionDigit();
+    sticky = !expansion.fractionIsZero();
+  }
+  if (detail::round(digits, precision, next, sticky)) {
+    digits[0] = '1';
+    ++exponent10;
+  }
+
+  // %g drops trailing zeros, and the point if nothing follows it
+  unsigned significant = precision;
+  while (significant > 1 && digits[significant - 1] == '0') {
+    --significant;
+  }
+  if (exponent10 < -4 || exponent10 >= (int)precision) {
+    out[length++] = digits[0];
+    if (significant > 1) {
+      out[length++] = '.';
+      memcpy(out + length, digits + 1, significant - 1);
+      length += significant - 1;
+    }
+    out[length++] = 'e';
+    out[length++] = exponent10 < 0 ? '-' : '+';
+    length += NumberFormat::digits(out + length, exponent10 < 0 ? -exponent10 : exponent10, 10, 2);
+  } else if (exponent10 >= 0) {
+    unsigned integerDigits = exponent10 + 1;
+    memcpy(out + length, digits, integerDigits);
+    length += integerDigits;
+    if (significant > integerDigits) {
+      out[length++] = '.';
+      memcpy(out + length, digits + integerDigits, significant - integerDigits);
+      length += significant - integerDigits;
+    }
+  } else {
+    out[length++] = '0';
+    out[length++] = '.';
+    for (int i = -1; i > exponent10; --i) {
+      out[length++] = '0';
+    }
+    memcpy(out + length, digits, significant);
+    length += significant;
+  }
+  return length;
+}
+
+} // namespace NumberFormat
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include "TelemetrySchema.h"
+
+/*
+Radio telemetry, either as the original hex text line or as a binary frame (RADIO_BINARY_FRAMES).
+
+A binary frame is
+  schema (1) | sequence number (2) | telemetry | CRC-16/CCITT of everything before (2)
+with multi-byte values little-endian, COBS-encoded so that it contains no zero bytes, then
+terminated by a single zero byte. A receiver can resynchronize at any zero, throw away frames
+whose CRC fails, and count gaps in the sequence number as dropped packets.
+
+The telemetry is Telemetry::RadioSchema<capsule>::pack()'s fields, already scaled and truncated the
+way the text line shows them.
+
+The high nibble of the schema byte is RADIO_SCHEMA_VERSION and the low nibble is the capsule.
+Bump the version whenever a telemetry layout changes.
+*/
+
+const uint8_t RADIO_SCHEMA_VERSION = 2;
+
+// Version 2 layouts
+static_assert(Telemetry::RadioSchema<1>::SIZE == 27, "capsule 1 telemetry changed: bump RADIO_SCHEMA_VERSION");
+static_assert(Telemetry::RadioSchema<2>::SIZE == 31, "capsule 2 telemetry changed: bump RADIO_SCHEMA_VERSION");
+
+namespace RadioFrame {
+  /** Schema byte of the given capsule's frames */
+  constexpr uint8_t schema(int capsule) {
+    return (RADIO_SCHEMA_VERSION << 4) | capsule;
+  }
+
+  /** Bytes before COBS encoding: schema, sequence number, telemetry and CRC */
+  template <int capsule>
+  constexpr size_t rawSize() {
+    return 1 + 2 + Telemetry::RadioSchema<capsule>::SIZE + 2;
+  }
+
+  /** Largest encoded frame, including the zero terminator */
+  template <int capsule>
+  constexpr size_t maxSize() {
+    return rawSize<capsule>() + rawSize<capsule>() / 254 + 2;
+  }
+
+  /** CRC-16/CCITT-FALSE, a nibble at a time: a 32-byte table instead of 512, and no branches. */
+  inline uint16_t crc16(const uint8_t* data, size_t length, uint16_t crc = 0xFFFF) {
+    static const uint16_t NIBBLE_TABLE[16] = {
+      0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+      0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    };
+    while (length--) {
+      uint8_t byte = *data++;
+      crc = (crc << 4) ^ NIBBLE_TABLE[(crc >> 12) ^ (byte >> 4)];
+      crc = (crc << 4) ^ NIBBLE_TABLE[(crc >> 12) ^ (byte & 0x0F)];
+    }
+    return crc;
+  }
+
+  /** COBS-encode `length` bytes into `out` and append the zero terminator. Returns the bytes written. */
+  inline size_t cobsEncode(const uint8_t* data, size_t length, uint8_t* out) {
+    size_t codeIndex = 0;
+    size_t outIndex = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < length; ++i) {
+      if (data[i] != 0) {
+        out[outIndex++] = data[i];
+        ++code;
+      }
+      if (data[i] == 0 || code == 0xFF) {
+        out[codeIndex] = code;
+        code = 1;
+        codeIndex = outIndex++;
+      }
+    }
+    out[codeIndex] = code;
+    out[outIndex++] = 0;
+    return outIndex;
+  }
+
+  /**
+   * Decode one COBS block (without its zero terminator) into `out`, which holds `outSize` bytes.
+   * Returns the decoded length, or 0 if the block is malformed or too long.
+   */
+  inline size_t cobsDecode(const uint8_t* data, size_t length, uint8_t* out, size_t outSize) {
+    size_t outIndex = 0;
+    size_t i = 0;
+    while (i < length) {
+      uint8_t code = data[i++];
+      if (code == 0 || i + code - 1 > length || outIndex + code > outSize) {
+        return 0;
+      }
+      memcpy(out + outIndex, data + i, code - 1);
+      outIndex += code - 1;
+      i += code - 1;
+      if (code != 0xFF && i < length) {
+        out[outIndex++] = 0;
+      }
+    }
+    return outIndex;
+  }
+
+  /** Build the complete frame for one packet in `out` (at least maxSize<capsule>() bytes). */
+  template <int capsule>
+  size_t encode(const Telemetry::Snapshot& snapshot, uint16_t sequence, uint8_t* out) {
+    uint8_t raw[rawSize<capsule>()];
+    raw[0] = schema(capsule);
+    raw[1] = sequence & 0xFF;
+    raw[2] = sequence >> 8;
+    Telemetry::RadioSchema<capsule>::pack(snapshot, raw + 3);
+    uint16_t crc = crc16(raw, sizeof raw - 2);
+    raw[sizeof raw - 2] = crc & 0xFF;
+    raw[sizeof raw - 1] = crc >> 8;
+    return cobsEncode(raw, sizeof raw, out);
+  }
+
+  /** The original hex text line, newline included. `size` should be at least 79. */
+  template <int capsule>
+  int formatText(const Telemetry::Snapshot& snapshot, char* out, size_t size) {
+    Telemetry::TextWriter line(out, size);
+    Telemetry::RadioSchema<capsule>::write(line, snapshot);
+    line.put('\n');
+    return line.finish();
+  }
+
+  /** The text line of telemetry stored by encode() (as a decoder finds it in a frame). */
+  template <int capsule>
+  int formatStoredText(const uint8_t* telemetry, char* out, size_t size) {
+    Telemetry::TextWriter line(out, size);
+    Telemetry::RadioSchema<capsule>::writeStored(line, telemetry);
+    line.put('\n');
+    return line.finish();
+  }
+
+  /**
+   * The telemetry of a text line (`length` characters, without the newline) as encode() stores it,
+   * for a receiver. The line has no checksum, so it is only accepted if it is exactly what
+   * formatText() writes for what was read: every field there, no stray characters, canonical digits.
+   */
+  template <int capsule>
+  bool parseText(const char* text, size_t length, uint8_t* telemetry) {
+    Telemetry::TextReader in(text, length);
+    if (!Telemetry::RadioSchema<capsule>::readStored(in, telemetry) || !in.done()) {
+      return false;
+    }
+    char canonical[96];
+    return formatStoredText<capsule>(telemetry, canonical, sizeof canonical) == (int)length + 1
+      && memcmp(canonical, text, length) == 0;
+  }
+}
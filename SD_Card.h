@@ -1,8 +1,7 @@
 #include <SD.h>
 #include <SPI.h>
 
-#include "gps.h"
-#include "imu.h"
+#include "TelemetrySchema.h"
 
 #pragma once
 
@@ -16,6 +15,38 @@
 #pragma GCC error "Unexpected value for CAPSULE (expected 1 or 2)"
 #endif
 
+// Set to true to log packed binary records (see BinaryLog.h) instead of CSV text
+#ifndef SD_BINARY_LOG
+#define SD_BINARY_LOG false
+#endif
+
+// Set to true to log delta-compressed records (see CompressedLog.h) instead of CSV text or packed
+// binary records. Takes precedence over SD_BINARY_LOG.
+#ifndef SD_COMPRESSED_LOG
+#define SD_COMPRESSED_LOG false
+#endif
+
+// Records from one keyframe to the next in the compressed log: a bad sector loses at most this many
+#ifndef SD_KEYFRAME_INTERVAL
+#define SD_KEYFRAME_INTERVAL 256
+#endif
+
+// Set to true to frame every sector of the log with a sequence number and CRC (see LogBlock.h), so
+// it can be recovered from the card without the directory after a power cut
+#ifndef SD_BLOCK_LOG
+#define SD_BLOCK_LOG false
+#endif
+
+#if SD_COMPRESSED_LOG
+#include "CompressedLog.h"
+#elif SD_BINARY_LOG
+#include "BinaryLog.h"
+#endif
+
+#if SD_BLOCK_LOG
+#include "LogBlock.h"
+#endif
+
 class SDCard {
   private:
     File m_sdCardFile;
@@ -23,51 +54,211 @@ class SDCard {
     bool m_begun; // SPI communications have been established
     bool m_proven; // The self-test passed
 
+    // Rows are collected in two sector-sized buffers. writeToCSV() fills one while the other, once
+    // full, waits for writePending() to hand it to the card. Every write the
+    // card sees is a whole sector starting on a sector boundary of the file.
+    // With SD_BLOCK_LOG each buffer starts with a LogBlockHeader, and a buffer written before it is
+    // full is padded to the whole sector, so every sector of the file is one block.
+    static const size_t M_SECTOR_SIZE = 512;
+    uint8_t m_sectors[2][M_SECTOR_SIZE];
+    uint8_t m_fillIndex; // which buffer writeToCSV() is filling
+    size_t m_fillLength;
+    size_t m_fillCapacity; // bytes left until the file reaches the next sector boundary
+    bool m_pending; // the other buffer is full and not yet on the card
+    size_t m_pendingLength;
+
     static const int M_CHIP_SELECT = SDCARD_SS_PIN;
     static constexpr const char* M_FILE_NAME = "CAPS_INF";
+#if SD_COMPRESSED_LOG
+    static constexpr const char* M_FILE_EXT = ".BSZ";
+#elif SD_BINARY_LOG
+    static constexpr const char* M_FILE_EXT = ".BIN";
+#else
     static constexpr const char* M_FILE_EXT = ".CSV";
+#endif
 
-    static constexpr const char* M_HEADERS =
-      "Latitude,Longitude,Altitude (MSL),Satellites,Timestamp,Accel X,Accel Y,Accel Z,Altitude (AGL),"
-      // Fun C fact: if you have multiple string literals with nothing but comments and whitespace
-      // between them, the compiler treats them as one long string literal
-#if CAPSULE == 2
-      "VOC Reading,Humidity,Temperature,"
+    // Log files are numbered: 0 is CAPS_INF, then n is CAPS_INF with its end overwritten by n - 1
+    // (CAPS_IN0, CAPS_IN1, ..., CAPS_I10, ..., 99999999)
+    static const uint32_t M_LAST_LOG_NUMBER = 100000000;
+    // Holds the number the next log should get, so boot doesn't have to search for a free name
+    static constexpr const char* M_SEQUENCE_FILE_NAME = "CAPS_SEQ";
+    static const size_t M_SEQUENCE_DIGITS = 9;
+    static const uint32_t M_UNKNOWN = 0xFFFFFFFF;
+    uint32_t m_logNumber; // of m_fileName
+    uint32_t m_nextLogNumber; // M_UNKNOWN until read from the card
+#if SD_COMPRESSED_LOG
+    CompressedLog::Encoder<CAPSULE> m_encoder;
+#endif
+#if SD_BLOCK_LOG
+    static const size_t M_BLOCK_START = sizeof(LogBlockHeader);
+    uint32_t m_fileId;
+    uint32_t m_blockSequence; // of the next block written
+#else
+    static const size_t M_BLOCK_START = 0;
 #endif
-      "Gyro X,Gyro Y,Gyro Z";
 
-    // Finds an available filename and sets m_fileName accordingly.
-    void findFileName() {
-      // First, check if the base file name is available
+    void setFileName(uint32_t logNumber) {
       strcpy(m_fileName, M_FILE_NAME);
+      if (logNumber > 0) {
+        // Overwrite just the end of the filename with the number
+        // e.g. CAPS_INF + 13 => CAPS_I13
+        char digits[8];
+        size_t length = NumberFormat::digits(digits, logNumber - 1);
+        memcpy(m_fileName + strlen(M_FILE_NAME) - length, digits, length);
+      }
       strcat(m_fileName, M_FILE_EXT);
+      m_logNumber = logNumber;
+    }
+
+    /**
+     * Finds an available filename and sets m_fileName accordingly. Every SD.exists() is a linear
+     * search of the root directory, so this doesn't try names one by one: the number saved in
+     * M_SEQUENCE_FILE_NAME is normally free, and otherwise (no sequence file yet, or a card written
+     * by something else) a doubling then halving search finds a free one in O(log n) lookups.
+     */
+    void findFileName() {
+      if (m_nextLogNumber == M_UNKNOWN) {
+        m_nextLogNumber = readSequenceFile();
+      }
+      if (m_nextLogNumber > M_LAST_LOG_NUMBER) {
+        m_nextLogNumber = 0;
+      }
+      setFileName(m_nextLogNumber);
       if (!SD.exists(m_fileName)) {
         return;
       }
 
-      // Then, try it with numbers
-      const size_t BASENAME_LENGTH = strlen(M_FILE_NAME);
-      for (int i = 0; i <= 99999999; ++i) {
-        // Convert the number to a C-style string (= char[])
-        char buf[9];
-        sprintf(buf, "%d", i);
-        // Overwrite just the end of the filename with the number
-        // e.g. CAPS_INF + 13 => CAPS_I13
-        size_t bufLen = strlen(buf);
-        memcpy(m_fileName + BASENAME_LENGTH - bufLen, buf, bufLen);
+      // `used` is taken; take bigger and bigger steps until a `free` one turns up, then halve the
+      // gap until the two are neighbors
+      uint32_t used = m_nextLogNumber;
+      uint32_t free = used + 1;
+      uint32_t step = 1;
+      while (free <= M_LAST_LOG_NUMBER) {
+        setFileName(free);
         if (!SD.exists(m_fileName)) {
-          return;
+          break;
         }
+        used = free;
+        step *= 2;
+        free = used + step > M_LAST_LOG_NUMBER ? M_LAST_LOG_NUMBER + 1 : used + step;
+      }
+      while (free - used > 1) {
+        uint32_t middle = used + (free - used) / 2;
+        setFileName(middle);
+        if (SD.exists(m_fileName)) {
+          used = middle;
+        } else {
+          free = middle;
+        }
+      }
+      if (free <= M_LAST_LOG_NUMBER) {
+        setFileName(free);
+        return;
       }
 
       // We're out of filenames, somehow...
       // Do we really have a hundred million files?
       // Whatever, reset to the default and delete the file
-      strcpy(m_fileName, M_FILE_NAME);
-      strcat(m_fileName, M_FILE_EXT);
+      setFileName(0);
       SD.remove(m_fileName);
     }
 
+    /** The number saved by writeSequenceFile(), or 0 if there isn't one. */
+    uint32_t readSequenceFile() {
+      File sequence = SD.open(M_SEQUENCE_FILE_NAME, FILE_READ);
+      if (!sequence) {
+        return 0;
+      }
+      char digits[M_SEQUENCE_DIGITS];
+      int length = sequence.read(digits, sizeof digits);
+      sequence.close();
+      uint32_t number = 0;
+      for (int i = 0; i < length && digits[i] >= '0' && digits[i] <= '9'; ++i) {
+        number = number * 10 + (digits[i] - '0');
+      }
+      return number <= M_LAST_LOG_NUMBER ? number : 0;
+    }
+
+    /** Save the number the next log should get. Always the same width, so it overwrites the last one. */
+    void writeSequenceFile(uint32_t number) {
+      File sequence = SD.open(M_SEQUENCE_FILE_NAME, O_WRITE | O_CREAT);
+      if (sequence) {
+        char digits[M_SEQUENCE_DIGITS];
+        sequence.write((const uint8_t*)digits, NumberFormat::digits(digits, number, 10, sizeof digits));
+        sequence.close();
+      }
+    }
+
+    // Queue bytes for the card. Only touches the card itself if both buffers are full.
+    void append(const void* data, size_t length) {
+      const uint8_t* bytes = static_cast<const uint8_t*>(data);
+      while (length > 0) {
+        size_t n = min(length, m_fillCapacity - m_fillLength);
+        memcpy(m_sectors[m_fillIndex] + m_fillLength, bytes, n);
+        m_fillLength += n;
+        bytes += n;
+        length -= n;
+
+        if (m_fillLength == m_fillCapacity) {
+          if (m_pending) {
+            // writePending() hasn't caught up, so this row has to wait for the card this once
+            writePending();
+          }
+          m_pending = true;
+          m_pendingLength = sealBlock(m_sectors[m_fillIndex], m_fillLength);
+          m_fillIndex ^= 1;
+          m_fillLength = M_BLOCK_START;
+          m_fillCapacity = M_SECTOR_SIZE;
+        }
+      }
+    }
+
+    // Start filling from wherever the file ends, so that buffers line up with its sectors. (With
+    // SD_BLOCK_LOG the file is always whole sectors.)
+    void resetBuffers() {
+      m_fillLength = M_BLOCK_START;
+      m_fillCapacity = M_SECTOR_SIZE - m_sdCardFile.size() % M_SECTOR_SIZE;
+      m_pending = false;
+    }
+
+    /**
+     * Get a buffer filled to `length` ready for the card. With SD_BLOCK_LOG, fills in its header
+     * and pads it to a whole sector.
+     * @return The bytes to write.
+     */
+    size_t sealBlock(uint8_t* sector, size_t length) {
+#if SD_BLOCK_LOG
+      LogBlockHeader header;
+      memcpy(header.magic, "BSCB", sizeof header.magic);
+      header.version = LOG_BLOCK_VERSION;
+#if SD_COMPRESSED_LOG
+      header.format = LogBlock::COMPRESSED;
+#elif SD_BINARY_LOG
+      header.format = LogBlock::BINARY;
+#else
+      header.format = LogBlock::CSV;
+#endif
+      header.length = length - M_BLOCK_START;
+      header.fileId = m_fileId;
+      header.logNumber = m_logNumber;
+      header.sequence = m_blockSequence++;
+      header.crc = LogBlock::checksum(header, sector + M_BLOCK_START);
+      memcpy(sector, &header, sizeof header);
+      memset(sector + length, 0, M_SECTOR_SIZE - length);
+      return M_SECTOR_SIZE;
+#else
+      (void)sector;
+      return length;
+#endif
+    }
+
+    // Write the part of a row buffer that has been filled, e.g. to sync
+    void writeFilled() {
+      if (m_fillLength > M_BLOCK_START) {
+        m_sdCardFile.write(m_sectors[m_fillIndex], sealBlock(m_sectors[m_fillIndex], m_fillLength));
+      }
+    }
+
     // Write some random data to a file and see if we can read it back
     bool selfTest() {
       if (!m_begun) {
@@ -77,7 +268,7 @@ class SDCard {
       // Close the file for now to open a new one
       bool open = (bool)m_sdCardFile;
       if (open) {
-        m_sdCardFile.close();
+        closeFile();
       }
 
       // Perform the test:
@@ -123,12 +314,32 @@ class SDCard {
       // If the data file was open before, re-open it
       if (open) {
         m_sdCardFile = SD.open(m_fileName, FILE_WRITE);
+        resetBuffers();
       }
 
       return !areDifferent;
     }
   public:
-    SDCard() : m_sdCardFile(), m_fileName{0}, m_begun(false), m_proven(false) {}
+    SDCard() :
+      m_sdCardFile(),
+      m_fileName{0},
+      m_begun(false),
+      m_proven(false),
+      m_fillIndex(0),
+      m_fillLength(0),
+      m_fillCapacity(M_SECTOR_SIZE),
+      m_pending(false),
+      m_pendingLength(0),
+      m_logNumber(0),
+      m_nextLogNumber(M_UNKNOWN)
+#if SD_COMPRESSED_LOG
+      , m_encoder(SD_KEYFRAME_INTERVAL)
+#endif
+#if SD_BLOCK_LOG
+      , m_fileId(0)
+      , m_blockSequence(0)
+#endif
+      {}
 
     enum Status {
       /** SPI communications have not yet been established. */
@@ -155,51 +366,35 @@ class SDCard {
       return Status::ACTIVE;
     }
 
-    void writeToCSV( // this is equivalent to loop()
-      const volatile GPS::Coordinates& coords,
-      const volatile IMU::vector3& accel,
-      float altitude,
-#if CAPSULE == 2
-      int analogReading, // this is VOC
-      float humidity,
-      float temperature,
-#endif
-      const volatile IMU::vector3& gyro) {
+    /** Log one row. Its columns are Telemetry::LogSchema<CAPSULE>'s fields. */
+    void writeToCSV(const Telemetry::Snapshot& snapshot) {
         // checks if SD card is open and good to be written to 
         if (m_sdCardFile) {
-          char dataOutputString[126];
-          // 126 *should* be long enough for any valid data.
+#if SD_COMPRESSED_LOG
+          // The change in each value since the last row, a byte or two each
+          uint8_t record[CompressedLog::Encoder<CAPSULE>::MAX_RECORD_SIZE];
+          append(record, m_encoder.encode(snapshot, record));
+#elif SD_BINARY_LOG
+          // Same values as the CSV row, but copied as-is instead of formatted
+          uint8_t record[Telemetry::LogSchema<CAPSULE>::SIZE];
+          Telemetry::LogSchema<CAPSULE>::pack(snapshot, record);
+          append(record, sizeof record);
+#else
+          // Two extra bytes for the line ending
+          char dataOutputString[192 + 2];
+          // 192 *should* be long enough for any valid data.
           // However, unlike the radio packet, this isn't a fixed length.
-          // So, in case there's invalid data or I miscounted, use snprintf, which cuts off the output
+          // So, in case there's invalid data or I miscounted, the writer cuts off the output
           // instead of corrupting data if the string is too long.
-          snprintf(
-            dataOutputString,
-            sizeof dataOutputString,
-            "%d,%d,%.5g,%hu,%u:%u:%u:%u,%.2f,%.2f,%.2f,%.2f,"
-#if CAPSULE == 2
-            "%d,%.2f,%.1f,"
-#endif
-            "%.3f,%.3f,%.3f",
-            coords.latitude,
-            coords.longitude,
-            (double)coords.altitudeMSL,
-            (unsigned short)coords.numSatellites,
-            coords.timestamp.hours, coords.timestamp.minutes, coords.timestamp.seconds, coords.timestamp.milliseconds,
-            (double)accel.x,
-            (double)accel.y,
-            (double)accel.z,
-            (double)altitude,
-#if CAPSULE == 2
-            analogReading,
-            (double)humidity,
-            (double)temperature,
-#endif
-            (double)gyro.x,
-            (double)gyro.y,
-            (double)gyro.z
-          );
-
-          m_sdCardFile.println(dataOutputString);
+          Telemetry::TextWriter row(dataOutputString, sizeof dataOutputString - 2);
+          Telemetry::LogSchema<CAPSULE>::write(row, snapshot);
+          row.finish();
+
+          size_t length = strlen(dataOutputString);
+          dataOutputString[length] = '\r';
+          dataOutputString[length + 1] = '\n';
+          append(dataOutputString, length + 2);
+#endif
         }
       }
 
@@ -216,17 +411,84 @@ class SDCard {
         findFileName();
         m_sdCardFile = SD.open(m_fileName, FILE_WRITE);
         if (m_sdCardFile) {
-          m_sdCardFile.println(M_HEADERS);
+          // A later initialize() (e.g. after the card drops out in flight) starts a new file
+          // without touching the directory more than once
+          m_nextLogNumber = m_logNumber + 1;
+          writeSequenceFile(m_nextLogNumber);
+#if SD_BLOCK_LOG
+          // selfTest() seeded random(); the clock makes two boots with the same seed differ
+          m_fileId = ((uint32_t)random(0x10000) << 16 | (uint32_t)random(0x10000)) ^ micros();
+          m_blockSequence = 0;
+#endif
+          resetBuffers();
+          writeHeaders();
         }
       }
     }
 
     void writeHeaders(){
-      m_sdCardFile.println(M_HEADERS);
+      char columns[256];
+      Telemetry::TextWriter names(columns, sizeof columns);
+      Telemetry::LogSchema<CAPSULE>::writeNames(names);
+      names.finish();
+      // What fit, if the names ever outgrow the buffer
+      size_t columnsLength = strlen(columns);
+#if SD_COMPRESSED_LOG
+      CompressedLogHeader header;
+      memcpy(header.magic, "BSCZ", sizeof header.magic);
+      header.version = COMPRESSED_LOG_VERSION;
+      header.capsule = CAPSULE;
+      header.keyframeInterval = m_encoder.keyframeInterval();
+      header.columnsLength = columnsLength;
+      append(&header, sizeof header);
+      append(columns, columnsLength);
+      // A new file has to start from a keyframe
+      m_encoder.reset();
+#elif SD_BINARY_LOG
+      BinaryLogHeader header;
+      memcpy(header.magic, "BSCL", sizeof header.magic);
+      header.version = BINARY_LOG_VERSION;
+      header.capsule = CAPSULE;
+      header.recordSize = Telemetry::LogSchema<CAPSULE>::SIZE;
+      header.columnsLength = columnsLength;
+      append(&header, sizeof header);
+      append(columns, columnsLength);
+#else
+      append(columns, columnsLength);
+      append("\r\n", 2);
+#endif
+    }
+
+    /** Write the full buffer, if there is one. Costs at most one sector write. */
+    void writePending() {
+      if (m_pending) {
+        m_sdCardFile.write(m_sectors[m_fillIndex ^ 1], m_pendingLength);
+        m_pending = false;
+      }
+    }
+
+    /**
+     * Durability point: put everything logged so far on the card and update the directory entry,
+     * without closing the file. Costs up to two sector writes plus the directory update.
+     */
+    void sync() {
+      if (getStatus() != Status::ACTIVE) {
+        // The file was never opened in the first place. Make sure it's set up.
+        initialize();
+        return;
+      }
+
+      writePending();
+      writeFilled();
+      m_sdCardFile.flush();
+      resetBuffers();
     }
 
     void closeFile() {
+      writePending();
+      writeFilled();
       m_sdCardFile.close();
+      m_fillLength = 0;
     }
 
     /** Make sure data is saved to the SD card, then immediately re-open the file. */
@@ -237,7 +499,8 @@ class SDCard {
         return;
       }
 
-      m_sdCardFile.close();
+      closeFile();
       m_sdCardFile = SD.open(m_fileName, FILE_WRITE);
+      resetBuffers();
     }
 };
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A value written by one Scheduler loop (or interrupt) and read by others. Readers always get a
+ * whole value from a single store(), never a mix of two: each store() bumps a sequence count
+ * before and after writing, and load() retries if the count changed or was odd while it copied.
+ * So load() must not run in an interrupt that can preempt store().
+ */
+template <typename T>
+class LatestValue {
+public:
+  LatestValue() noexcept : m_value(), m_version(0) {}
+
+  void store(const T& value) noexcept {
+    m_version = m_version + 1;
+    barrier();
+    m_value = value;
+    barrier();
+    m_version = m_version + 1;
+  }
+
+  T load() const noexcept {
+    T copy;
+    uint32_t before;
+    do {
+      before = m_version;
+      barrier();
+      copy = m_value;
+      barrier();
+    } while ((before & 1) != 0 || before != m_version);
+    return copy;
+  }
+
+  /** Number of store() calls so far. */
+  uint32_t stores() const noexcept {
+    return m_version / 2;
+  }
+
+private:
+  // One core, so keeping the compiler from moving the copy past the count is enough
+  static void barrier() noexcept {
+    __asm__ __volatile__("" ::: "memory");
+  }
+
+  T m_value;
+  volatile uint32_t m_version;
+};
+
+/**
+ * Fixed-capacity queue of sample records from one producer to one consumer, plus the newest record
+ * for anyone who only wants the latest. push() never waits: if the consumer has fallen a whole
+ * queue behind, the new record is dropped and counted. pop() hands each queued record out once.
+ *
+ * @tparam T The record. Copied in and out, so keep it small and trivially copyable.
+ * @tparam CAPACITY Records the queue can hold. Must be a power of two.
+ */
+template <typename T, uint16_t CAPACITY>
+class SampleQueue {
+  static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of two");
+
+public:
+  SampleQueue() noexcept :
+    m_head(0),
+    m_tail(0),
+    m_pushed(0),
+    m_dropped(0),
+    m_maxDepth(0) {}
+
+  /** Producer only. @return false if the queue was full and `record` was dropped. */
+  bool push(const T& record) noexcept {
+    m_newest.store(record);
+    ++m_pushed;
+    uint16_t head = m_head;
+    if ((uint16_t)(head - m_tail) == CAPACITY) {
+      ++m_dropped;
+      return false;
+    }
+    m_records[head % CAPACITY] = record;
+    barrier();
+    m_head = head + 1;
+    uint16_t depth = size();
+    if (depth > m_maxDepth) {
+      m_maxDepth = depth;
+    }
+    return true;
+  }
+
+  /** Consumer only. @return false if there was nothing queued. */
+  bool pop(T& record) noexcept {
+    uint16_t tail = m_tail;
+    if (tail == m_head) {
+      return false;
+    }
+    barrier();
+    record = m_records[tail % CAPACITY];
+    barrier();
+    m_tail = tail + 1;
+    return true;
+  }
+
+  /** The last record pushed, whether or not it fit in the queue. @return false before the first. */
+  bool newest(T& record) const noexcept {
+    if (m_newest.stores() == 0) {
+      return false;
+    }
+    record = m_newest.load();
+    return true;
+  }
+
+  /** Records waiting for the consumer. */
+  uint16_t size() const noexcept {
+    return (uint16_t)(m_head - m_tail);
+  }
+
+  static constexpr uint16_t capacity() noexcept {
+    return CAPACITY;
+  }
+
+  uint16_t maxDepth() const noexcept {
+    return m_maxDepth;
+  }
+
+  uint32_t pushed() const noexcept {
+    return m_pushed;
+  }
+
+  uint32_t dropped() const noexcept {
+    return m_dropped;
+  }
+
+private:
+  static void barrier() noexcept {
+    __asm__ __volatile__("" ::: "memory");
+  }
+
+  T m_records[CAPACITY];
+  // Free-running counts of records pushed into and popped from the slots. They wrap together, so
+  // their difference is the depth as long as CAPACITY divides 65536.
+  volatile uint16_t m_head; // written by the producer only
+  volatile uint16_t m_tail; // written by the consumer only
+  uint32_t m_pushed;
+  uint32_t m_dropped;
+  uint16_t m_maxDepth;
+  LatestValue<T> m_newest;
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <Arduino.h>
+#include <stdio.h>
+
+/**
+ * Execution-time statistics for one Scheduler loop, cheap enough to leave on in flight: two
+ * micros() calls and a few adds per iteration, in fixed RAM.
+ *
+ * Wrap the work of each iteration in begin() and end(), outside any delay() that paces the loop,
+ * and call yield() through the timer so time spent in other tasks isn't charged to this one.
+ */
+class TaskTimer {
+public:
+  /** Histogram buckets: bucket 0 is under 2 us, bucket k is [2^k, 2^(k+1)) us, the last is open-ended. */
+  static const int BUCKETS = 20;
+
+  /**
+   * @param[in] name Shown in the report. Must outlive the timer.
+   * @param[in] deadlineMicros An iteration starting longer than this after the previous one counts
+   * as an overrun. 0 for no deadline.
+   * @param[in] targetHz The rate the loop is meant to run at, for the report. 0 if it has none.
+   */
+  TaskTimer(const char* name, unsigned long deadlineMicros, unsigned long targetHz) noexcept :
+    m_name(name),
+    m_deadlineMicros(deadlineMicros),
+    m_targetHz(targetHz),
+    m_histogram{0},
+    m_iterations(0),
+    m_overruns(0),
+    m_maxMicros(0),
+    m_maxPeriodMicros(0),
+    m_busyMicros(0),
+    m_yieldMicros(0),
+    m_firstStart(0),
+    m_lastStart(0),
+    m_start(0),
+    m_yieldedThisIteration(0) {}
+
+  void begin() noexcept {
+    unsigned long now = micros();
+    if (m_iterations == 0) {
+      m_firstStart = now;
+    } else {
+      unsigned long period = now - m_lastStart;
+      if (period > m_maxPeriodMicros) {
+        m_maxPeriodMicros = period;
+      }
+      if (m_deadlineMicros != 0 && period > m_deadlineMicros) {
+        ++m_overruns;
+      }
+    }
+    m_lastStart = now;
+    m_start = now;
+    m_yieldedThisIteration = 0;
+  }
+
+  void end() noexcept {
+    unsigned long elapsed = micros() - m_start - m_yieldedThisIteration;
+    ++m_iterations;
+    m_busyMicros += elapsed;
+    if (elapsed > m_maxMicros) {
+      m_maxMicros = elapsed;
+    }
+    int bucket = elapsed < 2 ? 0 : 31 - __builtin_clz((uint32_t)elapsed);
+    ++m_histogram[bucket < BUCKETS ? bucket : BUCKETS - 1];
+  }
+
+  /** yield(), with the time other tasks run excluded from this iteration's execution time. */
+  void yield() noexcept {
+    unsigned long start = micros();
+    ::yield();
+    unsigned long away = micros() - start;
+    m_yieldedThisIteration += away;
+    m_yieldMicros += away;
+  }
+
+  /** For loops whose rate changes, e.g. with the flight phase. Counts from the next iteration. */
+  void setDeadline(unsigned long deadlineMicros, unsigned long targetHz) noexcept {
+    m_deadlineMicros = deadlineMicros;
+    m_targetHz = targetHz;
+  }
+
+  /**
+   * Write the statistics as two text lines:
+   *   task,<name>,<iterations>,<rate mHz>,<target Hz>,<mean us>,<max us>,<max period us>,<overruns>,<yield ms>
+   *   hist,<name>,<bucket 0>,...,<bucket BUCKETS-1>
+   */
+  void print(Print& out) const {
+    char line[160];
+    unsigned long span = m_lastStart - m_firstStart;
+    unsigned long rateMilliHz = span == 0 ? 0 : (unsigned long)((m_iterations - 1) * 1000000000ULL / span);
+    snprintf(
+      line,
+      sizeof line,
+      "task,%s,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n",
+      m_name,
+      m_iterations,
+      rateMilliHz,
+      m_targetHz,
+      m_iterations == 0 ? 0UL : (unsigned long)(m_busyMicros / m_iterations),
+      m_maxMicros,
+      m_maxPeriodMicros,
+      m_overruns,
+      (unsigned long)(m_yieldMicros / 1000)
+    );
+    out.write(line);
+
+    int length = snprintf(line, sizeof line, "hist,%s", m_name);
+    for (int i = 0; i < BUCKETS && length > 0 && (size_t)length < sizeof line; ++i) {
+      length += snprintf(line + length, sizeof line - length, ",%lu", m_histogram[i]);
+    }
+    out.write(line);
+    out.write("\n");
+  }
+
+private:
+  const char* m_name;
+  unsigned long m_deadlineMicros;
+  unsigned long m_targetHz;
+  unsigned long m_histogram[BUCKETS];
+  unsigned long m_iterations;
+  unsigned long m_overruns;
+  unsigned long m_maxMicros;
+  unsigned long m_maxPeriodMicros;
+  // 64 bits so the totals survive hours on the pad
+  uint64_t m_busyMicros;
+  uint64_t m_yieldMicros;
+  unsigned long m_firstStart;
+  unsigned long m_lastStart;
+  unsigned long m_start;
+  unsigned long m_yieldedThisIteration;
+};
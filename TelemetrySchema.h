@@ -0,0 +1,580 @@
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "Attitude.h"
+#include "NumberFormat.h"
+
+/*
+The one description of every telemetry field: its column name, how it is stored (type and
+scaling) and how it is written as text. The SD log (CSV, BinaryLog.h records and CompressedLog.h
+channels) and the radio (RadioFrame.h text lines and binary frames) are each a Schema<...> of
+these fields, and the encoders and decoders for all of them are instantiated from it at compile
+time: no format string is parsed at run time, and each encoder is a straight run of per-field code.
+
+To add a sensor: add its value to Snapshot, define its field below (one line), and list the field
+in the schemas it belongs in. Changing a layout still needs BINARY_LOG_VERSION,
+COMPRESSED_LOG_VERSION or RADIO_SCHEMA_VERSION bumped.
+
+Everything here also compiles on a PC, so the ground-side decoders in AnalysesFolder use the same
+definitions. Stored values are little-endian, as on the board.
+*/
+
+namespace Telemetry {
+
+/** Everything the capsule reports at one instant, in the units the sensors give. */
+struct Snapshot {
+  /** IMU::Sample::sequence of the IMU sample, so a gap is a sample the FIFO lost */
+  uint32_t sample;
+  /** When the IMU took that sample, from micros() */
+  uint32_t sampleMicros;
+  /** 10^-7 degrees */
+  int32_t latitude;
+  int32_t longitude;
+  /** Feet above mean sea level */
+  float altitudeMSL;
+  uint8_t numSatellites;
+  /** GPS::Timestamp::rawValue */
+  uint32_t timestamp;
+  /** m/s^2 */
+  float accelX;
+  float accelY;
+  float accelZ;
+  /** Feet AGL */
+  float altitude;
+  /** Raw ADC reading (capsule 2) */
+  int vocReading;
+  /** %RH (capsule 2) */
+  float humidity;
+  /** Degrees C (capsule 2) */
+  float temperature;
+  /** rad/s */
+  float gyroX;
+  float gyroY;
+  float gyroZ;
+  /** AttitudeFilter's estimate */
+  Quaternion attitude;
+};
+
+/**
+ * Bounded text output with snprintf's contract: keeps at most size - 1 characters plus the null
+ * terminator, and finish() returns the length the whole text would have had.
+ */
+class TextWriter {
+public:
+  TextWriter(char* out, size_t size) noexcept : m_out(out), m_size(size), m_length(0) {}
+
+  void put(char c) noexcept {
+    if (m_length + 1 < m_size) {
+      m_out[m_length] = c;
+    }
+    ++m_length;
+  }
+
+  void put(const char* text, size_t length) noexcept {
+    for (size_t i = 0; i < length; ++i) {
+      put(text[i]);
+    }
+  }
+
+  size_t finish() noexcept {
+    if (m_size > 0) {
+      m_out[m_length < m_size ? m_length : m_size - 1] = '\0';
+    }
+    return m_length;
+  }
+
+private:
+  char* m_out;
+  size_t m_size;
+  size_t m_length;
+};
+
+/** Reads text back, a field at a time, for the ground side. Never reads past `length` characters. */
+class TextReader {
+public:
+  TextReader(const char* text, size_t length) noexcept : m_text(text), m_length(length), m_position(0) {}
+
+  /** Whether every character has been read */
+  bool done() const noexcept {
+    return m_position == m_length;
+  }
+
+  /** Skip `c` if it is next. */
+  bool take(char c) noexcept {
+    if (m_position < m_length && m_text[m_position] == c) {
+      ++m_position;
+      return true;
+    }
+    return false;
+  }
+
+  /** One to eight hex digits (either case). */
+  bool hex(uint32_t& value) noexcept {
+    uint32_t n = 0;
+    size_t start = m_position;
+    while (m_position < m_length && m_position - start < 9) {
+      char c = m_text[m_position];
+      unsigned digit = c >= '0' && c <= '9' ? c - '0' : c >= 'A' && c <= 'F' ? c - 'A' + 10
+        : c >= 'a' && c <= 'f' ? c - 'a' + 10 : 16;
+      if (digit == 16) {
+        break;
+      }
+      n = n << 4 | digit;
+      ++m_position;
+    }
+    value = n;
+    return m_position > start && m_position - start <= 8;
+  }
+
+private:
+  const char* m_text;
+  size_t m_length;
+  size_t m_position;
+};
+
+// GPS::Timestamp's bitfields, lowest bits first
+inline unsigned timestampMilliseconds(uint32_t raw) noexcept { return raw & 0x3FF; }
+inline unsigned timestampSeconds(uint32_t raw) noexcept { return (raw >> 10) & 0x3F; }
+inline unsigned timestampMinutes(uint32_t raw) noexcept { return (raw >> 16) & 0x3F; }
+inline unsigned timestampHours(uint32_t raw) noexcept { return (raw >> 22) & 0x1F; }
+
+// ---------------------------------------------------------------------------------------------
+// Scalings: Snapshot value -> stored value
+
+/** Stored with a plain conversion. */
+struct AsIs {
+  template <typename Stored, typename Source>
+  static Stored apply(Source value) noexcept {
+    return (Stored)value;
+  }
+};
+
+/** Multiplied by MULTIPLIER, truncated toward zero and clamped to the (signed) stored type. */
+template <long MULTIPLIER>
+struct Saturated {
+  template <typename Stored, typename Source>
+  static Stored apply(Source value) noexcept {
+    const long HIGHEST = (long)((1UL << (8 * sizeof(Stored) - 1)) - 1);
+    long scaled = (long)(value * MULTIPLIER);
+    return scaled > HIGHEST ? (Stored)HIGHEST : scaled < -HIGHEST - 1 ? (Stored)(-HIGHEST - 1) : (Stored)scaled;
+  }
+};
+
+/** One component of the attitude quaternion */
+template <float Quaternion::*COMPONENT>
+struct QuaternionComponent {
+  template <typename Stored>
+  static Stored apply(const Quaternion& attitude) noexcept {
+    return (Stored)(attitude.*COMPONENT);
+  }
+};
+
+/** One of the attitude's angles (Attitude.h), rounded to whole degrees */
+template <float (*ANGLE)(const Quaternion&)>
+struct RoundedDegrees {
+  template <typename Stored>
+  static Stored apply(const Quaternion& attitude) noexcept {
+    return (Stored)lroundf(ANGLE(attitude) * 57.29578F);
+  }
+};
+
+/** GPS::Timestamp::rawValue to milliseconds since midnight (GPS::getTotalMS()). */
+struct TotalMillis {
+  template <typename Stored>
+  static Stored apply(uint32_t raw) noexcept {
+    return (Stored)(((timestampHours(raw) * 60 + timestampMinutes(raw)) * 60 + timestampSeconds(raw)) * 1000
+      + timestampMilliseconds(raw));
+  }
+};
+
+// ---------------------------------------------------------------------------------------------
+// Text formats: stored value -> characters, each matching one printf conversion (NumberFormat.h)
+
+/** %d, for stored types that fit in an int32_t */
+struct Decimal {
+  template <typename T>
+  static void write(TextWriter& out, T value) noexcept {
+    char text[NumberFormat::MAX_INTEGER_LENGTH];
+    out.put(text, NumberFormat::decimal(text, (int32_t)value));
+  }
+};
+
+/** %u */
+struct Unsigned {
+  static void write(TextWriter& out, uint32_t value) noexcept {
+    char text[NumberFormat::MAX_INTEGER_LENGTH];
+    out.put(text, NumberFormat::digits(text, value));
+  }
+};
+
+/** %.<DECIMALS>f */
+template <unsigned DECIMALS>
+struct Fixed {
+  static void write(TextWriter& out, float value) noexcept {
+    char text[NumberFormat::MAX_FIXED_LENGTH];
+    out.put(text, NumberFormat::fixed(text, value, DECIMALS));
+  }
+};
+
+/** %.<DIGITS>g */
+template <unsigned DIGITS>
+struct General {
+  static void write(TextWriter& out, float value) noexcept {
+    char text[NumberFormat::MAX_GENERAL_LENGTH];
+    out.put(text, NumberFormat::general(text, value, DIGITS));
+  }
+};
+
+/** %0<WIDTH>X of a value capped to CAP */
+template <unsigned WIDTH, uint32_t CAP = 0xFFFFFFFF>
+struct Hex {
+  template <typename T>
+  static void write(TextWriter& out, T value) noexcept {
+    uint32_t n = (uint32_t)value;
+    char text[32];
+    out.put(text, NumberFormat::hex(text, n < CAP ? n : CAP, WIDTH));
+  }
+
+  template <typename T>
+  static bool read(TextReader& in, T& value) noexcept {
+    uint32_t n;
+    if (!in.hex(n)) {
+      return false;
+    }
+    value = (T)n;
+    return true;
+  }
+};
+
+/** %c%0<WIDTH>X: '+' or '-', then the magnitude in hex */
+template <unsigned WIDTH>
+struct SignedHex {
+  template <typename T>
+  static void write(TextWriter& out, T value) noexcept {
+    char text[32];
+    text[0] = value < 0 ? '-' : '+';
+    uint32_t magnitude = value < 0 ? 0U - (uint32_t)value : (uint32_t)value;
+    out.put(text, 1 + NumberFormat::hex(text + 1, magnitude, WIDTH));
+  }
+
+  template <typename T>
+  static bool read(TextReader& in, T& value) noexcept {
+    bool negative = in.take('-');
+    uint32_t magnitude;
+    if ((!negative && !in.take('+')) || !in.hex(magnitude)) {
+      return false;
+    }
+    value = (T)(negative ? 0U - magnitude : magnitude);
+    return true;
+  }
+};
+
+/** GPS::Timestamp::rawValue as hours:minutes:seconds:milliseconds */
+struct ClockTime {
+  static void write(TextWriter& out, uint32_t raw) noexcept {
+    // "31:63:63:1023"
+    char text[13];
+    size_t length = NumberFormat::digits(text, timestampHours(raw));
+    text[length++] = ':';
+    length += NumberFormat::digits(text + length, timestampMinutes(raw));
+    text[length++] = ':';
+    length += NumberFormat::digits(text + length, timestampSeconds(raw));
+    text[length++] = ':';
+    length += NumberFormat::digits(text + length, timestampMilliseconds(raw));
+    out.put(text, length);
+  }
+};
+
+// ---------------------------------------------------------------------------------------------
+// Channels: stored value <-> integer at the resolution its text shows, for CompressedLog.h
+
+/** Integer fields are their own channel. */
+template <typename STORED, typename FORMAT>
+struct Channel {
+  static int32_t quantize(STORED value) noexcept {
+    return (int32_t)value;
+  }
+
+  static STORED restore(int32_t channel) noexcept {
+    return (STORED)channel;
+  }
+};
+
+constexpr uint32_t powerOfTen(unsigned exponent) noexcept {
+  return exponent == 0 ? 1 : 10 * powerOfTen(exponent - 1);
+}
+
+/**
+ * A float in units of 10^-DECIMALS. Rounded from the float's exact value, half to even, so the
+ * channel has the digits "%.<DECIMALS>f" shows. Integer arithmetic only, like NumberFormat.h.
+ * Anything out of range (infinities included) saturates; NaN has a channel value of its own.
+ */
+template <unsigned DECIMALS>
+struct DecimalChannel {
+  static const int32_t NOT_A_NUMBER = -2147483647 - 1;
+
+  static int32_t quantize(float value) noexcept {
+    const uint32_t HIGHEST = 2147483647;
+    NumberFormat::detail::Parts parts = NumberFormat::detail::split(value);
+    if (parts.nan) {
+      return NOT_A_NUMBER;
+    }
+
+    // |value| * 10^DECIMALS = scaled * 2^exponent, with scaled under 2^34
+    uint64_t scaled = (uint64_t)parts.mantissa * powerOfTen(DECIMALS);
+    uint32_t magnitude;
+    if (parts.infinite || parts.exponent >= 30) {
+      magnitude = HIGHEST;
+    } else if (parts.exponent >= 0) {
+      scaled <<= parts.exponent;
+      magnitude = scaled > HIGHEST ? HIGHEST : (uint32_t)scaled;
+    } else if (parts.exponent <= -64) {
+      magnitude = 0;
+    } else {
+      unsigned shift = -parts.exponent;
+      uint64_t whole = scaled >> shift;
+      uint64_t rest = scaled - (whole << shift);
+      uint64_t half = 1ULL << (shift - 1);
+      if (rest > half || (rest == half && (whole & 1) != 0)) {
+        ++whole;
+      }
+      magnitude = whole > HIGHEST ? HIGHEST : (uint32_t)whole;
+    }
+    return parts.negative ? -(int32_t)magnitude : (int32_t)magnitude;
+  }
+
+  static float restore(int32_t channel) noexcept {
+    return channel == NOT_A_NUMBER ? NAN : channel / (float)powerOfTen(DECIMALS);
+  }
+};
+
+template <unsigned DECIMALS>
+struct Channel<float, Fixed<DECIMALS>> : DecimalChannel<DECIMALS> {};
+
+/**
+ * %.<DIGITS>g shows DIGITS - 4 decimals of a value in the thousands, like altitude in feet. One more
+ * is kept, since the text is rounded again from the restored value; that can still be one unit off.
+ */
+template <unsigned DIGITS>
+struct Channel<float, General<DIGITS>> : DecimalChannel<(DIGITS > 3 ? DIGITS - 3 : 0)> {};
+
+// ---------------------------------------------------------------------------------------------
+// Fields
+
+/**
+ * One field: Snapshot::*SOURCE, converted by SCALE to STORED, written as text by FORMAT. A field
+ * is a struct deriving from this that adds its column name as `static const char* name()`.
+ */
+template <typename STORED, typename SOURCE, SOURCE Snapshot::*MEMBER, typename SCALE, typename FORMAT>
+struct Field {
+  typedef STORED Stored;
+
+  static Stored pack(const Snapshot& snapshot) noexcept {
+    return SCALE::template apply<Stored>(snapshot.*MEMBER);
+  }
+
+  static void write(TextWriter& out, Stored value) noexcept {
+    FORMAT::write(out, value);
+  }
+
+  /** The stored value back from its text, for formats that have a read() (the radio's) */
+  static bool read(TextReader& in, Stored& value) noexcept {
+    return FORMAT::read(in, value);
+  }
+
+  static int32_t quantize(Stored value) noexcept {
+    return Channel<Stored, FORMAT>::quantize(value);
+  }
+
+  static Stored restore(int32_t channel) noexcept {
+    return Channel<Stored, FORMAT>::restore(channel);
+  }
+};
+
+#define TELEMETRY_FIELD(NAME, COLUMN, ...) \
+  struct NAME : Field<__VA_ARGS__> { static const char* name() noexcept { return COLUMN; } }
+
+// As logged to the SD card: the sensors' own values
+TELEMETRY_FIELD(Sample, "Sample", uint32_t, uint32_t, &Snapshot::sample, AsIs, Unsigned);
+TELEMETRY_FIELD(SampleTime, "Sample Time (us)", uint32_t, uint32_t, &Snapshot::sampleMicros, AsIs, Unsigned);
+TELEMETRY_FIELD(Latitude, "Latitude", int32_t, int32_t, &Snapshot::latitude, AsIs, Decimal);
+TELEMETRY_FIELD(Longitude, "Longitude", int32_t, int32_t, &Snapshot::longitude, AsIs, Decimal);
+TELEMETRY_FIELD(AltitudeMSL, "Altitude (MSL)", float, float, &Snapshot::altitudeMSL, AsIs, General<5>);
+TELEMETRY_FIELD(Satellites, "Satellites", uint8_t, uint8_t, &Snapshot::numSatellites, AsIs, Decimal);
+TELEMETRY_FIELD(Timestamp, "Timestamp", uint32_t, uint32_t, &Snapshot::timestamp, AsIs, ClockTime);
+TELEMETRY_FIELD(AccelX, "Accel X", float, float, &Snapshot::accelX, AsIs, Fixed<2>);
+TELEMETRY_FIELD(AccelY, "Accel Y", float, float, &Snapshot::accelY, AsIs, Fixed<2>);
+TELEMETRY_FIELD(AccelZ, "Accel Z", float, float, &Snapshot::accelZ, AsIs, Fixed<2>);
+TELEMETRY_FIELD(Altitude, "Altitude (AGL)", float, float, &Snapshot::altitude, AsIs, Fixed<2>);
+TELEMETRY_FIELD(VocReading, "VOC Reading", int16_t, int, &Snapshot::vocReading, AsIs, Decimal);
+TELEMETRY_FIELD(Humidity, "Humidity", float, float, &Snapshot::humidity, AsIs, Fixed<2>);
+TELEMETRY_FIELD(Temperature, "Temperature", float, float, &Snapshot::temperature, AsIs, Fixed<1>);
+TELEMETRY_FIELD(GyroX, "Gyro X", float, float, &Snapshot::gyroX, AsIs, Fixed<3>);
+TELEMETRY_FIELD(GyroY, "Gyro Y", float, float, &Snapshot::gyroY, AsIs, Fixed<3>);
+TELEMETRY_FIELD(GyroZ, "Gyro Z", float, float, &Snapshot::gyroZ, AsIs, Fixed<3>);
+TELEMETRY_FIELD(AttitudeW, "Attitude W", float, Quaternion, &Snapshot::attitude, QuaternionComponent<&Quaternion::w>, Fixed<4>);
+TELEMETRY_FIELD(AttitudeX, "Attitude X", float, Quaternion, &Snapshot::attitude, QuaternionComponent<&Quaternion::x>, Fixed<4>);
+TELEMETRY_FIELD(AttitudeY, "Attitude Y", float, Quaternion, &Snapshot::attitude, QuaternionComponent<&Quaternion::y>, Fixed<4>);
+TELEMETRY_FIELD(AttitudeZ, "Attitude Z", float, Quaternion, &Snapshot::attitude, QuaternionComponent<&Quaternion::z>, Fixed<4>);
+
+// As sent over the radio: scaled down to small integers and shown in hex
+TELEMETRY_FIELD(RadioLatitude, "Latitude", int32_t, int32_t, &Snapshot::latitude, AsIs, SignedHex<8>);
+TELEMETRY_FIELD(RadioLongitude, "Longitude", int32_t, int32_t, &Snapshot::longitude, AsIs, SignedHex<8>);
+TELEMETRY_FIELD(RadioTimestamp, "Timestamp (ms)", uint32_t, uint32_t, &Snapshot::timestamp, TotalMillis, Hex<7>);
+TELEMETRY_FIELD(RadioSatellites, "Satellites", uint8_t, uint8_t, &Snapshot::numSatellites, AsIs, Hex<1, 15>);
+TELEMETRY_FIELD(RadioPitch, "Pitch (deg)", int16_t, Quaternion, &Snapshot::attitude, RoundedDegrees<angleAboutX>, SignedHex<2>);
+TELEMETRY_FIELD(RadioRoll, "Roll (deg)", int16_t, Quaternion, &Snapshot::attitude, RoundedDegrees<angleAboutY>, SignedHex<2>);
+TELEMETRY_FIELD(RadioYaw, "Yaw (deg)", int16_t, Quaternion, &Snapshot::attitude, RoundedDegrees<angleAboutZ>, SignedHex<2>);
+TELEMETRY_FIELD(RadioAccelX, "Accel X (cm/s^2)", int16_t, float, &Snapshot::accelX, Saturated<100>, SignedHex<4>);
+TELEMETRY_FIELD(RadioAccelY, "Accel Y (cm/s^2)", int16_t, float, &Snapshot::accelY, Saturated<100>, SignedHex<4>);
+TELEMETRY_FIELD(RadioAccelZ, "Accel Z (cm/s^2)", int16_t, float, &Snapshot::accelZ, Saturated<100>, SignedHex<4>);
+TELEMETRY_FIELD(RadioAltitude, "Altitude (AGL)", int16_t, float, &Snapshot::altitude, Saturated<1>, SignedHex<4>);
+TELEMETRY_FIELD(RadioVocReading, "VOC Reading", uint16_t, int, &Snapshot::vocReading, AsIs, Hex<3>);
+TELEMETRY_FIELD(RadioTemperature, "Temperature", int8_t, float, &Snapshot::temperature, Saturated<1>, SignedHex<3>);
+TELEMETRY_FIELD(RadioHumidity, "Humidity", uint8_t, float, &Snapshot::humidity, AsIs, Hex<2>);
+
+#undef TELEMETRY_FIELD
+
+// ---------------------------------------------------------------------------------------------
+// Schemas
+
+/**
+ * An ordered list of fields, stored back to back with no padding (SIZE bytes) and written as text
+ * separated by commas. Every function unrolls into one block of code per field.
+ */
+template <typename... FIELDS>
+struct Schema;
+
+template <>
+struct Schema<> {
+  static constexpr size_t SIZE = 0;
+  static constexpr size_t COUNT = 0;
+
+  static void pack(const Snapshot&, uint8_t*) noexcept {}
+  static void writeRest(TextWriter&, const Snapshot&) noexcept {}
+  static void writeRestStored(TextWriter&, const uint8_t*) noexcept {}
+  static void writeRestNames(TextWriter&) noexcept {}
+  static bool readRestStored(TextReader&, uint8_t*) noexcept { return true; }
+  static void quantize(const Snapshot&, int32_t*) noexcept {}
+  static void restore(const int32_t*, uint8_t*) noexcept {}
+};
+
+template <typename FIRST, typename... REST>
+struct Schema<FIRST, REST...> {
+  typedef Schema<REST...> Rest;
+
+  /** Bytes of one stored record */
+  static constexpr size_t SIZE = sizeof(typename FIRST::Stored) + Rest::SIZE;
+  static constexpr size_t COUNT = 1 + Rest::COUNT;
+
+  /** Store every field of `snapshot` into `out` (SIZE bytes). */
+  static void pack(const Snapshot& snapshot, uint8_t* out) noexcept {
+    typename FIRST::Stored value = FIRST::pack(snapshot);
+    memcpy(out, &value, sizeof value);
+    Rest::pack(snapshot, out + sizeof value);
+  }
+
+  /** The fields of `snapshot` as one line of text, without a line ending. */
+  static void write(TextWriter& out, const Snapshot& snapshot) noexcept {
+    FIRST::write(out, FIRST::pack(snapshot));
+    Rest::writeRest(out, snapshot);
+  }
+
+  /** The same text from a record stored by pack(), so decoders reproduce it exactly. */
+  static void writeStored(TextWriter& out, const uint8_t* stored) noexcept {
+    typename FIRST::Stored value;
+    memcpy(&value, stored, sizeof value);
+    FIRST::write(out, value);
+    Rest::writeRestStored(out, stored + sizeof value);
+  }
+
+  /**
+   * A record as pack() stores it, from the text write() made of it. Only checks that there is a
+   * field of the right form for each; the caller checks that nothing is left.
+   */
+  static bool readStored(TextReader& in, uint8_t* stored) noexcept {
+    typename FIRST::Stored value;
+    if (!FIRST::read(in, value)) {
+      return false;
+    }
+    memcpy(stored, &value, sizeof value);
+    return Rest::readRestStored(in, stored + sizeof value);
+  }
+
+  /** Every field as its channel (COUNT values), for CompressedLog.h */
+  static void quantize(const Snapshot& snapshot, int32_t* out) noexcept {
+    *out = FIRST::quantize(FIRST::pack(snapshot));
+    Rest::quantize(snapshot, out + 1);
+  }
+
+  /** A record as pack() stores it, from quantize()'s channels */
+  static void restore(const int32_t* channels, uint8_t* out) noexcept {
+    typename FIRST::Stored value = FIRST::restore(*channels);
+    memcpy(out, &value, sizeof value);
+    Rest::restore(channels + 1, out + sizeof value);
+  }
+
+  /** The column names, comma-separated */
+  static void writeNames(TextWriter& out) noexcept {
+    const char* name = FIRST::name();
+    out.put(name, strlen(name));
+    Rest::writeRestNames(out);
+  }
+
+  // The same, each field preceded by a comma
+
+  static void writeRest(TextWriter& out, const Snapshot& snapshot) noexcept {
+    out.put(',');
+    write(out, snapshot);
+  }
+
+  static void writeRestStored(TextWriter& out, const uint8_t* stored) noexcept {
+    out.put(',');
+    writeStored(out, stored);
+  }
+
+  static void writeRestNames(TextWriter& out) noexcept {
+    out.put(',');
+    writeNames(out);
+  }
+
+  static bool readRestStored(TextReader& in, uint8_t* stored) noexcept {
+    return in.take(',') && readStored(in, stored);
+  }
+};
+
+/** Rows of the SD log, as CSV text or BinaryLog.h records */
+template <int capsule>
+struct LogSchema;
+
+template <>
+struct LogSchema<1> : Schema<
+  Sample, SampleTime, Latitude, Longitude, AltitudeMSL, Satellites, Timestamp, AccelX, AccelY, AccelZ, Altitude,
+  GyroX, GyroY, GyroZ, AttitudeW, AttitudeX, AttitudeY, AttitudeZ> {};
+
+template <>
+struct LogSchema<2> : Schema<
+  Sample, SampleTime, Latitude, Longitude, AltitudeMSL, Satellites, Timestamp, AccelX, AccelY, AccelZ, Altitude,
+  VocReading, Humidity, Temperature,
+  GyroX, GyroY, GyroZ, AttitudeW, AttitudeX, AttitudeY, AttitudeZ> {};
+
+/** Radio packets, as hex text lines or RadioFrame.h binary frames */
+template <int capsule>
+struct RadioSchema;
+
+template <>
+struct RadioSchema<1> : Schema<
+  RadioLatitude, RadioLongitude, RadioTimestamp, RadioSatellites, RadioPitch, RadioRoll, RadioYaw,
+  RadioAccelX, RadioAccelY, RadioAccelZ, RadioAltitude> {};
+
+template <>
+struct RadioSchema<2> : Schema<
+  RadioLatitude, RadioLongitude, RadioTimestamp, RadioSatellites, RadioPitch, RadioRoll, RadioYaw,
+  RadioAccelX, RadioAccelY, RadioAccelZ, RadioAltitude,
+  RadioVocReading, RadioTemperature, RadioHumidity> {};
+
+} // namespace Telemetry
@@ -2,14 +2,136 @@
 
 #include <Adafruit_BMP3XX.h>
 
+#include "I2cDma.h"
+
 class Altimeter {
 private:
   Adafruit_BMP3XX m_baro;
+  TwoWire* m_wire;
   bool m_begun;
   bool m_reasonable;
   float m_seaLevel;
+  // The sensor converts on its own (normal mode) and is read directly, bypassing the driver
+  bool m_continuous;
+  float m_lastAltitude;
+  // requestAltitude()'s read of the status and data registers
+  I2CTransaction m_request;
+  uint8_t m_requestData[7];
+
+  // Compensation coefficients from the sensor's NVM, scaled as in the datasheet (section 9.1)
+  struct Calibration {
+    float t1, t2, t3;
+    float p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11;
+  } m_calibration;
+
+  // BMP3xx registers used in continuous mode
+  static const uint8_t M_REG_ERR = 0x02;
+  static const uint8_t M_REG_STATUS = 0x03;
+  static const uint8_t M_REG_PWR_CTRL = 0x1B;
+  static const uint8_t M_REG_OSR = 0x1C;
+  static const uint8_t M_REG_ODR = 0x1D;
+  static const uint8_t M_REG_CONFIG = 0x1F;
+  static const uint8_t M_REG_CALIBRATION = 0x31;
+  static const uint8_t M_STATUS_DRDY_PRESS = 0x20;
+  static const uint8_t M_ERR_CONF = 0x04;
+  // press_en | temp_en | normal mode
+  static const uint8_t M_PWR_NORMAL = 0x33;
+
+  bool writeRegister(uint8_t reg, uint8_t value) {
+    m_wire->beginTransmission(BMP3XX_DEFAULT_ADDRESS);
+    m_wire->write(reg);
+    m_wire->write(value);
+    return m_wire->endTransmission() == 0;
+  }
+
+  bool readRegisters(uint8_t reg, uint8_t* buffer, size_t length) {
+    m_wire->beginTransmission(BMP3XX_DEFAULT_ADDRESS);
+    m_wire->write(reg);
+    if (m_wire->endTransmission(false) != 0) {
+      return false;
+    }
+    if (m_wire->requestFrom((uint8_t)BMP3XX_DEFAULT_ADDRESS, length) != length) {
+      return false;
+    }
+    for (size_t i = 0; i < length; ++i) {
+      buffer[i] = m_wire->read();
+    }
+    return true;
+  }
+
+  bool readCalibration() {
+    uint8_t nvm[21];
+    if (!readRegisters(M_REG_CALIBRATION, nvm, sizeof nvm)) {
+      return false;
+    }
+    auto u16 = [&](int i) { return (float)(uint16_t)(nvm[i] | (nvm[i + 1] << 8)); };
+    auto s16 = [&](int i) { return (float)(int16_t)(nvm[i] | (nvm[i + 1] << 8)); };
+    auto s8 = [&](int i) { return (float)(int8_t)nvm[i]; };
+    m_calibration.t1 = u16(0) * 256.0F;
+    m_calibration.t2 = u16(2) / 1073741824.0F;            // 2^30
+    m_calibration.t3 = s8(4) / 281474976710656.0F;        // 2^48
+    m_calibration.p1 = (s16(5) - 16384.0F) / 1048576.0F;  // 2^20
+    m_calibration.p2 = (s16(7) - 16384.0F) / 536870912.0F; // 2^29
+    m_calibration.p3 = s8(9) / 4294967296.0F;             // 2^32
+    m_calibration.p4 = s8(10) / 137438953472.0F;          // 2^37
+    m_calibration.p5 = u16(11) * 8.0F;                    // 2^-3
+    m_calibration.p6 = u16(13) / 64.0F;                   // 2^6
+    m_calibration.p7 = s8(15) / 256.0F;                   // 2^8
+    m_calibration.p8 = s8(16) / 32768.0F;                 // 2^15
+    m_calibration.p9 = s16(17) / 281474976710656.0F;      // 2^48
+    m_calibration.p10 = s8(19) / 281474976710656.0F;      // 2^48
+    m_calibration.p11 = s8(20) / 36893488147419103232.0F; // 2^65
+    return true;
+  }
+
+  /** Pressure in Pa from raw ADC values, per the datasheet's floating-point compensation. */
+  float compensate(uint32_t rawPressure, uint32_t rawTemperature) const {
+    const Calibration& c = m_calibration;
+    float d = (float)rawTemperature - c.t1;
+    float t = d * c.t2 + d * d * c.t3;
+
+    float p = (float)rawPressure;
+    float t2 = t * t;
+    float t3 = t2 * t;
+    float out1 = c.p5 + c.p6 * t + c.p7 * t2 + c.p8 * t3;
+    float out2 = p * (c.p1 + c.p2 * t + c.p3 * t2 + c.p4 * t3);
+    float p2 = p * p;
+    return out1 + out2 + p2 * (c.p9 + c.p10 * t) + p2 * p * c.p11;
+  }
+
+  /**
+   * The altitude from a burst of the status and both data registers, if the status says there was
+   * a new conversion. Reading the data clears the ready flag.
+   */
+  bool parseSample(const uint8_t* data, float* altitude) {
+    if (!(data[0] & M_STATUS_DRDY_PRESS)) {
+      return false;
+    }
+    uint32_t rawPressure = data[1] | ((uint32_t)data[2] << 8) | ((uint32_t)data[3] << 16);
+    uint32_t rawTemperature = data[4] | ((uint32_t)data[5] << 8) | ((uint32_t)data[6] << 16);
+    m_lastAltitude = pressureToFeet(compensate(rawPressure, rawTemperature));
+    *altitude = m_lastAltitude;
+    return true;
+  }
+
+  float pressureToFeet(float pascals) const {
+    // Same formula as Adafruit_BMP3XX::readAltitude
+    float meters = 44330.0F * (1.0F - powf(pascals / 100.0F / m_seaLevel, 0.1903F));
+    const float FEET_PER_METER = 3.28084F;
+    return meters * FEET_PER_METER;
+  }
 public:
-  Altimeter() : m_baro(), m_begun(false), m_reasonable(false), m_seaLevel(NAN) {}
+  Altimeter() :
+    m_baro(),
+    m_wire(nullptr),
+    m_begun(false),
+    m_reasonable(false),
+    m_seaLevel(NAN),
+    m_continuous(false),
+    m_lastAltitude(NAN),
+    m_request(),
+    m_requestData(),
+    m_calibration() {}
 
   enum Status {
     /** I2C communications have not been established. */
@@ -38,6 +160,7 @@ public:
    */
   void initialize(TwoWire* theWire = &Wire) {
     if (!m_begun) {
+      m_wire = theWire;
       m_begun = m_baro.begin_I2C(BMP3XX_DEFAULT_ADDRESS, theWire);
     }
     if (m_begun && !m_reasonable) {
@@ -52,10 +175,101 @@ public:
   }
 
   /**
-   * Get the current altitude. Blocks until a value is available.
+   * Switch the sensor to continuous (normal) mode, where it converts on its own every ODR period
+   * and readAltitude() never waits. Call once the status is ACTIVE. The conversion time for the
+   * oversampling settings must fit in the ODR period (datasheet section 3.9.2), otherwise the sensor
+   * rejects the configuration, this returns false, and reads stay in blocking forced mode.
+   * @param[in] pressureOversampling One of BMP3_NO_OVERSAMPLING ... BMP3_OVERSAMPLING_32X
+   * @param[in] temperatureOversampling Likewise
+   * @param[in] iirCoefficient One of BMP3_IIR_FILTER_DISABLE ... BMP3_IIR_FILTER_COEFF_127
+   * @param[in] outputDataRate One of BMP3_ODR_200_HZ ... BMP3_ODR_0_78_HZ
+   */
+  bool startContinuous(
+    uint8_t pressureOversampling,
+    uint8_t temperatureOversampling,
+    uint8_t iirCoefficient,
+    uint8_t outputDataRate
+  ) {
+    if (getStatus() != Status::ACTIVE || !readCalibration()) {
+      return false;
+    }
+
+    // Seed the latest value so getAltitude() has something to return before the first conversion
+    m_lastAltitude = getAltitude();
+
+    uint8_t err;
+    m_continuous = writeRegister(M_REG_OSR, pressureOversampling | (temperatureOversampling << 3))
+      && writeRegister(M_REG_ODR, outputDataRate)
+      && writeRegister(M_REG_CONFIG, iirCoefficient << 1)
+      && writeRegister(M_REG_PWR_CTRL, M_PWR_NORMAL)
+      && readRegisters(M_REG_ERR, &err, 1)
+      && !(err & M_ERR_CONF);
+    return m_continuous;
+  }
+
+  /** Whether startContinuous() succeeded. */
+  bool isContinuous() const noexcept {
+    return m_continuous;
+  }
+
+  /**
+   * Get a new altitude sample without waiting. In continuous mode this is one short I2C read, and
+   * returns false if the sensor hasn't finished a conversion since the last sample. Otherwise it is
+   * the same blocking forced-mode read as getAltitude().
+   * @param[out] altitude AGL in feet. Unchanged if there is no new sample.
+   */
+  bool readAltitude(float* altitude) {
+    if (!m_continuous) {
+      *altitude = getAltitude();
+      return true;
+    }
+
+    // Status and both data registers in one burst
+    uint8_t data[7];
+    return readRegisters(M_REG_STATUS, data, sizeof data) && parseSample(data, altitude);
+  }
+
+  /**
+   * Start the read readAltitude() does in continuous mode on `bus` without waiting for it;
+   * collectAltitude() takes the result. Only in continuous mode.
+   * @param[in] bus The altimeter's bus, begun.
+   * @return false if there is nothing to request or the bus wouldn't take it.
+   */
+  bool requestAltitude(I2CBus& bus) {
+    if (!m_continuous || bus.wire() != m_wire || m_request.pending()) {
+      return false;
+    }
+    m_request.setRead(BMP3XX_DEFAULT_ADDRESS, M_REG_STATUS, m_requestData, sizeof m_requestData);
+    return bus.submit(m_request);
+  }
+
+  /**
+   * readAltitude() with the read requestAltitude() started: waits for it if it hasn't finished.
+   * Without a request, the same as readAltitude(). Either way, returns false if there was no new
+   * conversion.
+   * @param[out] altitude AGL in feet. Unchanged if there is no new sample.
+   */
+  bool collectAltitude(float* altitude) {
+    if (m_request.status == I2CTransaction::IDLE) {
+      return readAltitude(altitude);
+    }
+    m_request.wait();
+    bool read = m_request.succeeded() && parseSample(m_requestData, altitude);
+    m_request.status = I2CTransaction::IDLE;
+    return read;
+  }
+
+  /**
+   * Get the current altitude. In forced mode, blocks until a conversion finishes; in continuous
+   * mode, returns the latest sample without waiting.
    * @return AGL in feet.
    */
   float getAltitude() {
+    if (m_continuous) {
+      float altitude;
+      readAltitude(&altitude);
+      return m_lastAltitude;
+    }
     float meters = m_baro.readAltitude(m_seaLevel);
     const float FEET_PER_METER = 3.28084F;
     return meters * FEET_PER_METER;
@@ -12,13 +12,56 @@ private:
   bool m_begun;
   // Has data been successfully read?
   bool m_valid;
+  // Baud rate and fix rate to configure the receiver for
+  unsigned long m_targetBaud;
+  uint8_t m_updateHz;
+  // Baud rate the UART is open at now
+  unsigned long m_baud;
+  // When the last sentence with a good checksum arrived, or when the UART was (re)opened
+  unsigned long m_lastSentenceMillis;
+
+  // Bytes of the sentences we use, from the interrupt handler to getLocation(). Single producer
+  // (the interrupt), single consumer, so the indices need no lock; each is written by one side only.
+  static const uint16_t RING_SIZE = 512;
+  volatile uint8_t m_ring[RING_SIZE];
+  volatile uint16_t m_ringHead;
+  volatile uint16_t m_ringTail;
+  volatile uint16_t m_ringOverruns;
+  // The interrupt handler's place in the current sentence: "$" and the 5-character address are
+  // held back until the sentence type is known
+  char m_header[6];
+  uint8_t m_headerLength;
+  bool m_keepSentence;
+
+  static const unsigned long DEFAULT_BAUD = 9600;
+  // Without a good sentence for this long, the receiver isn't at the baud rate we're listening at
+  static const unsigned long BAUD_TIMEOUT_MS = 2000;
+
 public:
-  GPS(Uart& bus) :
+  /**
+   * @param[in] bus The UART the receiver is on.
+   * @param[in] baud The baud rate to switch the receiver to. At the default of 9600 it is left as it
+   * powers up. Needs the MCU's TX wired to the receiver's RX; if it isn't, initialize() falls back
+   * to 9600.
+   * @param[in] updateHz Fixes per second to ask for. 1 leaves the receiver's default.
+   */
+  GPS(Uart& bus, unsigned long baud = DEFAULT_BAUD, uint8_t updateHz = 1) :
     m_bus(bus),
     m_buffer{0},
     m_nmea(m_buffer, sizeof m_buffer),
     m_begun(false),
-    m_valid(false) {}
+    m_valid(false),
+    m_targetBaud(baud),
+    m_updateHz(updateHz),
+    m_baud(0),
+    m_lastSentenceMillis(0),
+    m_ring{0},
+    m_ringHead(0),
+    m_ringTail(0),
+    m_ringOverruns(0),
+    m_header{0},
+    m_headerLength(0),
+    m_keepSentence(false) {}
 
   union Timestamp {
     struct {
@@ -36,23 +79,23 @@ public:
 
     // Explicitly default parameterless constructor and copy and move operators
     // The presence of other constructors and operator=s below would mean these don't exist
+    // (GCC can't generate the copy constructors for a union with an anonymous struct, so spell them out)
     Timestamp() = default;
-    Timestamp(const Timestamp&) = default;
-    Timestamp(Timestamp&&) = default;
+    Timestamp(const Timestamp& other) noexcept : rawValue(other.rawValue) {}
+    Timestamp(Timestamp&& other) noexcept : rawValue(other.rawValue) {}
     Timestamp& operator=(const Timestamp&) = default;
     Timestamp& operator=(Timestamp&&) = default;
 
-    // Some things to make working with volatile Timestamps easier
+    // Some things to make working with volatile Timestamps easier. The volatile assignments return
+    // nothing, since a volatile reference left unused by `a = b;` is a warning that it isn't read
     Timestamp(const volatile Timestamp& other) noexcept : rawValue(other.rawValue) {}
     Timestamp(volatile Timestamp&& other) noexcept : rawValue(other.rawValue) {}
 
-    volatile Timestamp& operator=(const Timestamp& other) volatile noexcept {
+    void operator=(const Timestamp& other) volatile noexcept {
       this->rawValue = other.rawValue;
-      return *this;
     }
-    volatile Timestamp& operator=(Timestamp&& other) volatile noexcept {
+    void operator=(Timestamp&& other) volatile noexcept {
       this->rawValue = other.rawValue;
-      return *this;
     }
   };
 
@@ -93,10 +136,21 @@ public:
     }
   };
   
+  /**
+   * Open the UART and configure the receiver. Later calls check that sentences are arriving, and if
+   * none have for BAUD_TIMEOUT_MS, switch between the configured baud rate and the 9600 the
+   * receiver starts at: the configuration may not have reached it.
+   */
   void initialize() {
     if (!m_begun) {
-      m_bus.begin(9600);
+      configure();
       m_begun = true;
+    } else if (!m_valid && millis() - m_lastSentenceMillis > BAUD_TIMEOUT_MS && m_targetBaud != DEFAULT_BAUD) {
+      if (m_baud == DEFAULT_BAUD) {
+        configure();
+      } else {
+        open(DEFAULT_BAUD);
+      }
     }
   }
 
@@ -105,29 +159,81 @@ public:
     INVALID
   };
 
-  Status getStatus() {
-    if (!m_valid) {
-      // try to get data off the GPS, because we haven't been successful yet
-      Coordinates coords;
-      getLocation(&coords);
-    }
+  /** ACTIVE once a valid fix has been read. Doesn't read anything itself. */
+  Status getStatus() const noexcept {
     return m_valid ? Status::ACTIVE : Status::INVALID;
   }
 
-  bool getLocation(volatile Coordinates* coords) {
-    while (m_bus.available()) {
-      char c = m_bus.read();
-      if (m_nmea.process(c)) {
-        if (!m_nmea.isValid()) {
-          return false;
+  /** Call from the UART's SERCOMn_Handler, in place of its IrqHandler(). */
+  void handleInterrupt() noexcept {
+    m_bus.IrqHandler();
+    receive();
+  }
+
+  /**
+   * Move received bytes into the ring, dropping every sentence except GGA and RMC (the only ones
+   * MicroNMEA parses) as soon as its address is in. handleInterrupt() does this; call it directly,
+   * before getLocation(), only where the UART's interrupt handler belongs to the core (Serial1).
+   */
+  void receive() noexcept {
+    int c;
+    while ((c = m_bus.read()) >= 0) {
+      if (c == '$') {
+        m_header[0] = '$';
+        m_headerLength = 1;
+        m_keepSentence = false;
+      } else if (m_headerLength > 0 && m_headerLength < sizeof m_header) {
+        m_header[m_headerLength++] = (char)c;
+        if (m_headerLength == sizeof m_header) {
+          // "$GPGGA": talker ID, then sentence type
+          const char* type = m_header + 3;
+          m_keepSentence = (type[0] == 'G' && type[1] == 'G' && type[2] == 'A')
+            || (type[0] == 'R' && type[1] == 'M' && type[2] == 'C');
+          for (uint8_t i = 0; m_keepSentence && i < sizeof m_header; ++i) {
+            push(m_header[i]);
+          }
         }
+      } else if (m_keepSentence) {
+        push((char)c);
+        if (c == '\n') {
+          m_keepSentence = false;
+          m_headerLength = 0;
+        }
+      }
+    }
+  }
+
+  /**
+   * Parse whatever the interrupt handler has queued and store the newest valid fix in `coords`.
+   * @return true if `coords` was updated.
+   */
+  bool getLocation(volatile Coordinates* coords) {
+    bool updated = false;
+    uint16_t tail = m_ringTail;
+    while (tail != m_ringHead) {
+      char c = m_ring[tail];
+      tail = (tail + 1) % RING_SIZE;
+      m_ringTail = tail;
+      if (!m_nmea.process(c)) {
+        continue;
+      }
+      if (MicroNMEA::testChecksum(m_nmea.getSentence())) {
+        m_lastSentenceMillis = millis();
+      }
+      if (!m_nmea.isValid()) {
+        continue;
+      }
 
-        m_valid = true;
+      m_valid = true;
+      updated = true;
 
-        // MicroNMEA gives coords in 10^-6, not 10^-7, so multiply by 10
-        coords->latitude = m_nmea.getLatitude() * 10;
-        coords->longitude = m_nmea.getLongitude() * 10;
+      // MicroNMEA gives coords in 10^-6, not 10^-7, so multiply by 10
+      coords->latitude = m_nmea.getLatitude() * 10;
+      coords->longitude = m_nmea.getLongitude() * 10;
 
+      // Only GGA has these. The RMC that follows each GGA would read as no altitude and 0
+      // satellites, so keep the GGA's until the next one
+      if (strcmp(m_nmea.getMessageID(), "GGA") == 0) {
         long altitudeMillimeters;
         if (m_nmea.getAltitude(altitudeMillimeters)) {
           const float FEET_PER_MILLIMETER = 0.0032808399F;
@@ -135,23 +241,85 @@ public:
         }
 
         coords->numSatellites = m_nmea.getNumSatellites();
+      }
 
-        // MicroNMEA is only precise to the hundredth of a second
-        coords->timestamp.milliseconds = m_nmea.getHundredths() * 10;
-        coords->timestamp.seconds = m_nmea.getSecond();
-        coords->timestamp.minutes = m_nmea.getMinute();
-        coords->timestamp.hours = m_nmea.getHour();
+      // MicroNMEA is only precise to the hundredth of a second
+      coords->timestamp.milliseconds = m_nmea.getHundredths() * 10;
+      coords->timestamp.seconds = m_nmea.getSecond();
+      coords->timestamp.minutes = m_nmea.getMinute();
+      coords->timestamp.hours = m_nmea.getHour();
 
-        m_nmea.clear();
-        return true;
-      }
+      m_nmea.clear();
     }
+    return updated;
+  }
 
-    // No data available for read
-    return false;
+  /** Bytes of wanted sentences dropped because getLocation() fell behind. */
+  uint16_t getRingOverruns() const noexcept {
+    return m_ringOverruns;
   }
 
   static uint32_t getTotalMS(Timestamp t) noexcept {
     return ((t.hours * 60 + t.minutes) * 60 + t.seconds) * 1000 + t.milliseconds;
   }
+
+private:
+  void push(char c) noexcept {
+    uint16_t next = (m_ringHead + 1) % RING_SIZE;
+    if (next == m_ringTail) {
+      ++m_ringOverruns;
+      return;
+    }
+    m_ring[m_ringHead] = c;
+    m_ringHead = next;
+  }
+
+  void open(unsigned long baud) {
+    if (m_baud != 0) {
+      m_bus.end();
+    }
+    m_bus.begin(baud);
+    m_baud = baud;
+    m_headerLength = 0;
+    m_keepSentence = false;
+    m_lastSentenceMillis = millis();
+  }
+
+  /** Send a PMTK command (MediaTek receivers), adding the "$", checksum and line ending. */
+  void sendCommand(const char* body) {
+    uint8_t checksum = 0;
+    for (const char* p = body; *p != '\0'; ++p) {
+      checksum ^= (uint8_t)*p;
+    }
+    char tail[6];
+    snprintf(tail, sizeof tail, "*%02X\r\n", checksum);
+    m_bus.write('$');
+    m_bus.write(body);
+    m_bus.write(tail);
+  }
+
+  /**
+   * Switch the receiver from 9600 baud to m_targetBaud, then set the fix rate and turn off the
+   * sentences we don't parse, so the UART carries less than a quarter of the bytes.
+   */
+  void configure() {
+    open(DEFAULT_BAUD);
+    if (m_targetBaud == DEFAULT_BAUD && m_updateHz <= 1) {
+      return;
+    }
+    char command[24];
+    if (m_targetBaud != DEFAULT_BAUD) {
+      snprintf(command, sizeof command, "PMTK251,%lu", m_targetBaud);
+      sendCommand(command);
+      m_bus.flush();
+      open(m_targetBaud);
+    }
+    // GGA and RMC every fix, nothing else
+    sendCommand("PMTK314,0,1,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0");
+    if (m_updateHz > 1) {
+      snprintf(command, sizeof command, "PMTK220,%u", 1000U / m_updateHz);
+      sendCommand(command);
+    }
+    m_bus.flush();
+  }
 };
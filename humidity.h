@@ -2,6 +2,8 @@
 
 #include <Adafruit_SHT4x.h>
 
+#include "I2cDma.h"
+
 class HumiditySensor {
 private:
   Adafruit_SHT4x m_sensor;
@@ -10,6 +12,35 @@ private:
   float m_lastTemp;
   float m_lastHumid;
   bool m_begun;
+  // A measurement has been started and not yet read back
+  bool m_measuring;
+  bool m_measurementHeated;
+  unsigned long m_measurementStart;
+  unsigned long m_measurementMillis;
+  // requestValues(): the read of a measurement that is due, then the command for the next one,
+  // which onMeasurementRead() queues; or just the command
+  I2CBus* m_requestBus;
+  bool m_requestHeat;
+  I2CTransaction m_readRequest;
+  I2CTransaction m_commandRequest;
+  uint8_t m_requestData[6];
+  // Set by onMeasurementRead(): the read passed its CRCs
+  volatile bool m_requestStored;
+  bool m_requestHeated;
+  unsigned long m_requestMillis;
+  unsigned long m_requestStart;
+
+  // Measurements are started and read directly, bypassing the driver, whose getEvent() waits
+  // through the whole measurement: up to 110 ms with the heater on
+  static const uint8_t M_ADDRESS = SHT4x_DEFAULT_ADDR;
+  // Commands and their maximum durations from the datasheet, rounded up to the millisecond
+  static const uint8_t M_MEASURE_LOW_PRECISION = 0xE0;
+  static const unsigned long M_LOW_PRECISION_MILLIS = 2;
+  static const uint8_t M_HIGH_HEATER_100MS = 0x32;
+  static const uint8_t M_LOW_HEATER_100MS = 0x15;
+  static const unsigned long M_HEATER_100MS_MILLIS = 110;
+  // Give up on a measurement the sensor still hasn't finished this long after it was due
+  static const unsigned long M_TIMEOUT_MILLIS = 50;
 
   bool safeToHeat() const noexcept {
     // According to the datasheet, the heater must only be run at temperatures below 65C and at 10% duty cycle.
@@ -32,6 +63,110 @@ private:
     // By default, don't run the heater, as it makes measurements slower
     return SHT4X_NO_HEATER;
   }
+
+  /**
+   * The command for a measurement, heated first if `heat` and recommendedHeatLevel() say so.
+   * @param[out] duration How long it takes, in ms.
+   * @param[out] heated Whether the heater runs.
+   */
+  uint8_t measurementCommand(bool heat, unsigned long* duration, bool* heated) const noexcept {
+    sht4x_heater_t heater = heat ? recommendedHeatLevel() : SHT4X_NO_HEATER;
+    *heated = heater != SHT4X_NO_HEATER;
+    if (heater == SHT4X_HIGH_HEATER_100MS) {
+      *duration = M_HEATER_100MS_MILLIS;
+      return M_HIGH_HEATER_100MS;
+    } else if (heater == SHT4X_LOW_HEATER_100MS) {
+      *duration = M_HEATER_100MS_MILLIS;
+      return M_LOW_HEATER_100MS;
+    }
+    *duration = M_LOW_PRECISION_MILLIS;
+    return M_MEASURE_LOW_PRECISION;
+  }
+
+  /** The sensor took a measurement command at `start`. */
+  void measurementStarted(bool heated, unsigned long start, unsigned long duration) noexcept {
+    m_measuring = true;
+    m_measurementHeated = heated;
+    m_measurementStart = start;
+    m_measurementMillis = duration;
+  }
+
+  /** A measurement is over, read or given up on. */
+  void measurementEnded() noexcept {
+    m_measuring = false;
+    // Count the heater's duty cycle from when it's known to be off again
+    if (m_measurementHeated) {
+      m_lastHeated = millis();
+    }
+  }
+
+  /** A read of a measurement the sensor didn't acknowledge: try again later, unless it has clearly gone away. */
+  void measurementNotReady() noexcept {
+    if (millis() - m_measurementStart > m_measurementMillis + M_TIMEOUT_MILLIS) {
+      measurementEnded();
+    }
+  }
+
+  /** Check and convert a measurement's 6 bytes. */
+  bool storeValues(const uint8_t* data, volatile float* humidity, volatile float* temperature) noexcept {
+    if (crc8(data, 2) != data[2] || crc8(data + 3, 2) != data[5]) {
+      return false;
+    }
+
+    // Conversion formulas from the datasheet, section 4.6
+    float temperatureTicks = (uint16_t)(data[0] << 8 | data[1]);
+    float humidityTicks = (uint16_t)(data[3] << 8 | data[4]);
+    m_lastTemp = -45.0F + 175.0F * temperatureTicks / 65535.0F;
+    m_lastHumid = -6.0F + 125.0F * humidityTicks / 65535.0F;
+    if (m_lastHumid > 100.0F) {
+      m_lastHumid = 100.0F;
+    } else if (m_lastHumid < 0.0F) {
+      m_lastHumid = 0.0F;
+    }
+
+    if (humidity != nullptr) {
+      *humidity = m_lastHumid;
+    }
+    if (temperature != nullptr) {
+      *temperature = m_lastTemp;
+    }
+    return true;
+  }
+
+  /** Queue the command for the next measurement on the requestValues() bus. */
+  bool submitCommand() {
+    uint8_t command = measurementCommand(m_requestHeat, &m_requestMillis, &m_requestHeated);
+    m_commandRequest.setWrite(M_ADDRESS, &command, 1);
+    m_requestStart = millis();
+    return m_requestBus->submit(m_commandRequest);
+  }
+
+  /**
+   * requestValues()'s read is done: take the measurement and start the next, as pollValues() and
+   * startMeasurement() would one after the other, so a measurement is under way every pass.
+   */
+  static void onMeasurementRead(I2CTransaction& transaction) {
+    HumiditySensor& sensor = *static_cast<HumiditySensor*>(transaction.context);
+    if (!transaction.succeeded()) {
+      return;
+    }
+    sensor.measurementEnded();
+    // The next command's heater depends on these values
+    sensor.m_requestStored = sensor.storeValues(sensor.m_requestData, nullptr, nullptr);
+    sensor.submitCommand();
+  }
+
+  /** CRC-8 the sensor sends after each 16-bit word (polynomial 0x31, initial value 0xFF). */
+  static uint8_t crc8(const uint8_t* data, size_t length) noexcept {
+    uint8_t crc = 0xFF;
+    for (size_t i = 0; i < length; ++i) {
+      crc ^= data[i];
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+      }
+    }
+    return crc;
+  }
 public:
   /**
    * @param[in] theI2C Pointer to a TwoWire instance representing the I2C interface. Must be valid
@@ -43,7 +178,20 @@ public:
     m_lastHeated(0),
     m_lastTemp(NAN),
     m_lastHumid(NAN),
-    m_begun(false) {}
+    m_begun(false),
+    m_measuring(false),
+    m_measurementHeated(false),
+    m_measurementStart(0),
+    m_measurementMillis(0),
+    m_requestBus(nullptr),
+    m_requestHeat(false),
+    m_readRequest(),
+    m_commandRequest(),
+    m_requestData(),
+    m_requestStored(false),
+    m_requestHeated(false),
+    m_requestMillis(0),
+    m_requestStart(0) {}
 
   enum Status {
     /** I2C communications have not been established. */
@@ -80,58 +228,168 @@ public:
     }
   }
 
+  /** The values from the last measurement, or from initialize() before the first. */
+  void getLastValues(volatile float* humidity, volatile float* temperature) const noexcept {
+    *humidity = m_lastHumid;
+    *temperature = m_lastTemp;
+  }
+
+  /** Has a measurement been started and not yet been read by pollValues()? */
+  bool isMeasuring() const noexcept {
+    return m_measuring;
+  }
+
   /**
-   * Get the humidity and/or temperature values.
+   * Start a measurement and return without waiting for it; pollValues() reads the result. The
+   * heater is run first if recommendedHeatLevel() says so, which makes the measurement take 110 ms
+   * instead of 2.
+   * @param[in] heat Pass `false` if only the temperature is wanted: heating makes the humidity
+   * more reliable but artificially increases temperature.
+   * @return false if the sensor isn't connected, is already measuring or didn't acknowledge.
+   */
+  bool startMeasurement(bool heat = true) {
+    if (!m_begun || m_measuring) {
+      return false;
+    }
+
+    unsigned long duration;
+    bool heated;
+    uint8_t command = measurementCommand(heat, &duration, &heated);
+    m_i2c->beginTransmission(M_ADDRESS);
+    m_i2c->write(command);
+    if (m_i2c->endTransmission() != 0) {
+      return false;
+    }
+    measurementStarted(heated, millis(), duration);
+    return true;
+  }
+
+  /**
+   * Read the measurement started by startMeasurement(), if it has finished. Takes one 6-byte I2C
+   * read once it's due, and nothing before then.
    * @param[out] humidity Pointer to the humidity. Pass `nullptr` to only get temperature.
    * @param[out] temperature Pointer to the temperature. Pass `nullptr` to only get humidity.
-   * @return A boolean indicating whether the values were successfully read.
+   * @return true if new values were stored. isMeasuring() is false afterwards unless the sensor
+   * wasn't finished yet.
    */
-  bool getValues(
+  bool pollValues(
     volatile float* humidity,
     volatile float* temperature
   ) {
-    if (humidity == nullptr && temperature == nullptr) {
-      // there's nothing to try
-      return true;
+    if (!m_measuring || millis() - m_measurementStart < m_measurementMillis) {
+      return false;
     }
 
-    // If the humidity sensor isn't being read, there's no point in heating
-    // Heating makes the humidity more reliable but artificially increases temperature
-    sht4x_heater_t heater;
-    if (humidity == nullptr) {
-      heater = SHT4X_NO_HEATER;
-    } else {
-      heater = recommendedHeatLevel();
+    // The sensor doesn't acknowledge reads until it's done
+    uint8_t data[6];
+    if (m_i2c->requestFrom(M_ADDRESS, sizeof data) != sizeof data) {
+      measurementNotReady();
+      return false;
     }
-    m_sensor.setHeater(heater);
+    for (size_t i = 0; i < sizeof data; ++i) {
+      data[i] = m_i2c->read();
+    }
+    measurementEnded();
+    return storeValues(data, humidity, temperature);
+  }
 
-    bool success;
+  /**
+   * Start on `bus` what pollValues() and startMeasurement() would do next, without waiting for
+   * it: once the measurement under way is due, its read, followed by the command for the next
+   * one if the read succeeds; with no measurement under way, just the command. collectValues()
+   * takes the result.
+   * @param[in] bus The sensor's bus, begun.
+   * @param[in] heat As for startMeasurement().
+   * @return false if there is nothing to do yet or the bus wouldn't take it.
+   */
+  bool requestValues(I2CBus& bus, bool heat = true) {
+    if (!m_begun || bus.wire() != m_i2c || m_readRequest.pending() || m_commandRequest.pending()) {
+      return false;
+    }
+    m_requestBus = &bus;
+    m_requestHeat = heat;
+    if (!m_measuring) {
+      return submitCommand();
+    }
+    if (millis() - m_measurementStart < m_measurementMillis) {
+      return false;
+    }
+    m_requestStored = false;
+    m_readRequest.setRead(M_ADDRESS, m_requestData, sizeof m_requestData);
+    m_readRequest.callback = onMeasurementRead;
+    m_readRequest.context = this;
+    return bus.submit(m_readRequest);
+  }
 
-    if (temperature == nullptr) {
-      sensors_event_t humidEvent;
-      success = m_sensor.getEvent(&humidEvent, nullptr);
-      if (success) {
-        *humidity = m_lastHumid = humidEvent.relative_humidity;
-      }
-    } else if (humidity == nullptr) {
-      sensors_event_t tempEvent;
-      success = m_sensor.getEvent(nullptr, &tempEvent);
-      if (success) {
-        *temperature = m_lastTemp = tempEvent.temperature;
+  /**
+   * Finish what requestValues() started, waiting for it if it hasn't finished. Without a request,
+   * the same as pollValues().
+   * @param[out] humidity Pointer to the humidity. Pass `nullptr` to only get temperature.
+   * @param[out] temperature Pointer to the temperature. Pass `nullptr` to only get humidity.
+   * @return true if it read a measurement and new values were stored.
+   */
+  bool collectValues(
+    volatile float* humidity,
+    volatile float* temperature
+  ) {
+    if (m_readRequest.status == I2CTransaction::IDLE && m_commandRequest.status == I2CTransaction::IDLE) {
+      return pollValues(humidity, temperature);
+    }
+    bool stored = false;
+    if (m_readRequest.status != I2CTransaction::IDLE) {
+      // On success, onMeasurementRead() has already stored the values and queued the command
+      m_readRequest.wait();
+      if (m_readRequest.succeeded()) {
+        stored = m_requestStored;
+      } else {
+        measurementNotReady();
       }
-    } else {
-      sensors_event_t humidEvent, tempEvent;
-      success = m_sensor.getEvent(&humidEvent, &tempEvent);
-      if (success) {
-        *humidity = m_lastHumid = humidEvent.relative_humidity;
-        *temperature = m_lastTemp = tempEvent.temperature;
+      m_readRequest.status = I2CTransaction::IDLE;
+    }
+    if (m_commandRequest.status != I2CTransaction::IDLE) {
+      m_commandRequest.wait();
+      if (m_commandRequest.succeeded()) {
+        measurementStarted(m_requestHeated, m_requestStart, m_requestMillis);
       }
+      m_commandRequest.status = I2CTransaction::IDLE;
     }
 
-    if (heater != SHT4X_NO_HEATER) {
-      m_lastHeated = millis();
+    if (stored && humidity != nullptr) {
+      *humidity = m_lastHumid;
     }
+    if (stored && temperature != nullptr) {
+      *temperature = m_lastTemp;
+    }
+    return stored;
+  }
 
-    return success;
+  /**
+   * Get the humidity and/or temperature values, waiting for the measurement. Finishes the one
+   * already started by startMeasurement(), if there is one.
+   * @param[out] humidity Pointer to the humidity. Pass `nullptr` to only get temperature.
+   * @param[out] temperature Pointer to the temperature. Pass `nullptr` to only get humidity.
+   * @return A boolean indicating whether the values were successfully read.
+   */
+  bool getValues(
+    volatile float* humidity,
+    volatile float* temperature
+  ) {
+    if (humidity == nullptr && temperature == nullptr) {
+      // there's nothing to try
+      return true;
+    }
+
+    // If the humidity sensor isn't being read, there's no point in heating
+    if (!m_measuring && !startMeasurement(humidity != nullptr)) {
+      return false;
+    }
+    while (true) {
+      delay(1);
+      if (pollValues(humidity, temperature)) {
+        return true;
+      } else if (!m_measuring) {
+        return false;
+      }
+    }
   }
 };
@@ -2,11 +2,54 @@
 
 #include <Adafruit_LSM9DS1.h>
 
+#include "I2cDma.h"
+
 class IMU {
 private:
   Adafruit_LSM9DS1 m_sensor;
+  TwoWire* m_wire;
   bool m_begun;
   bool m_reasonableGravity;
+  // Samples are queued in the sensor's FIFO and drained in bursts, bypassing the driver
+  bool m_fifo;
+  float m_outputDataRate;
+  uint32_t m_sequence;
+  unsigned long m_lastDrainMicros;
+
+  // LSM9DS1 accelerometer/gyroscope registers used in FIFO mode
+  static const uint8_t M_REG_CTRL_REG1_G = 0x10;
+  static const uint8_t M_REG_OUT_X_L_G = 0x18;
+  static const uint8_t M_REG_CTRL_REG6_XL = 0x20;
+  static const uint8_t M_REG_CTRL_REG9 = 0x23;
+  static const uint8_t M_REG_OUT_X_L_XL = 0x28;
+  static const uint8_t M_REG_FIFO_CTRL = 0x2E;
+  static const uint8_t M_REG_FIFO_SRC = 0x2F;
+  static const uint8_t M_CTRL_REG9_FIFO_EN = 0x02;
+  // Continuous mode: when full, the oldest sample is overwritten
+  static const uint8_t M_FIFO_CTRL_CONTINUOUS = 0xC0;
+  static const uint8_t M_FIFO_SRC_OVRN = 0x40;
+  static const uint8_t M_FIFO_SRC_FSS = 0x3F;
+
+  // Full scale set in initialize(): 0.732 mg/LSB and 70 mdps/LSB
+  static constexpr float M_ACCEL_PER_LSB = 0.732F / 1000.0F * SENSORS_GRAVITY_STANDARD;
+  static constexpr float M_GYRO_PER_LSB = 0.070F * SENSORS_DPS_TO_RADS;
+
+  bool writeRegister(uint8_t reg, uint8_t value) {
+    m_wire->beginTransmission(LSM9DS1_ADDRESS_ACCELGYRO);
+    m_wire->write(reg);
+    m_wire->write(value);
+    return m_wire->endTransmission() == 0;
+  }
+
+  /** Start a burst read; the bytes are then taken straight out of the Wire buffer. */
+  bool requestRegisters(uint8_t reg, size_t length) {
+    m_wire->beginTransmission(LSM9DS1_ADDRESS_ACCELGYRO);
+    m_wire->write(reg);
+    if (m_wire->endTransmission(false) != 0) {
+      return false;
+    }
+    return m_wire->requestFrom((uint8_t)LSM9DS1_ADDRESS_ACCELGYRO, length) == length;
+  }
 public:
   union vector3 {
     float data[3];
@@ -37,14 +80,50 @@ public:
     }
   };
 
+  /** Gyroscope ODR (CTRL_REG1_G); the accelerometer runs at the same rate. */
+  enum OutputDataRate : uint8_t {
+    ODR_14_9_HZ = 1,
+    ODR_59_5_HZ = 2,
+    ODR_119_HZ = 3,
+    ODR_238_HZ = 4,
+    ODR_476_HZ = 5,
+    ODR_952_HZ = 6,
+  };
+
+  /** Number of samples the sensor's FIFO holds. */
+  static const size_t FIFO_DEPTH = 32;
+
+  /** One accelerometer and gyroscope sample from the FIFO. */
+  struct Sample {
+    /** Counts every sample the sensor produced since startFifo(), so a jump means samples were lost. */
+    uint32_t sequence;
+    vector3 accel;
+    vector3 gyro;
+  };
+
   /**
    * @param[in] theI2C Pointer to a TwoWire instance representing the I2C interface. Must be valid
    * for the whole lifetime of the IMU instance.
    */
   IMU(TwoWire* theI2C) :
     m_sensor(theI2C),
+    m_wire(theI2C),
     m_begun(false),
-    m_reasonableGravity(false) {}
+    m_reasonableGravity(false),
+    m_fifo(false),
+    m_outputDataRate(0.0F),
+    m_sequence(0),
+    m_lastDrainMicros(0),
+    m_requestBus(nullptr),
+    m_statusRequest(),
+    m_gyroRequest(),
+    m_accelRequest(),
+    m_requestCapacity(0),
+    m_requestCount(0),
+    m_requestMicros(0),
+    m_fifoStatus(0),
+    m_gyroData(),
+    m_accelData() {}
 
   enum Status {
     /** I2C communications have not been established. */
@@ -75,6 +154,10 @@ public:
    * @return A boolean indicating whether the values were successfully read.
    */
   bool getValues(vector3* accel, vector3* gyro) {
+    if (m_fifo) {
+      // Reading the output registers would pop samples out from under readFifo()
+      return false;
+    }
     if (accel == nullptr) {
       if (gyro == nullptr) {
         return true;
@@ -105,6 +188,133 @@ public:
     }
   }
 
+  /** Whether startFifo() succeeded. getValues() doesn't work in FIFO mode; use readFifo(). */
+  bool isFifo() const noexcept {
+    return m_fifo;
+  }
+
+  /**
+   * Queue every sample in the sensor's FIFO at the given rate, so none are lost between reads as
+   * long as readFifo() is called at least every FIFO_DEPTH samples. Call once the status is ACTIVE.
+   * Also raises the bus to 400 kHz, since at 952 Hz the samples alone would saturate 100 kHz.
+   */
+  bool startFifo(OutputDataRate outputDataRate) {
+    if (getStatus() != Status::ACTIVE) {
+      return false;
+    }
+
+    m_wire->setClock(400000);
+    m_fifo = writeOutputDataRate(outputDataRate)
+      && writeRegister(M_REG_CTRL_REG9, M_CTRL_REG9_FIFO_EN)
+      && writeRegister(M_REG_FIFO_CTRL, M_FIFO_CTRL_CONTINUOUS);
+    m_sequence = 0;
+    m_lastDrainMicros = micros();
+    return m_fifo;
+  }
+
+  /**
+   * Change the sample rate while the FIFO keeps running. Samples already queued stay queued, and
+   * sequence numbers carry on.
+   */
+  bool setOutputDataRate(OutputDataRate outputDataRate) {
+    if (!m_fifo) {
+      return false;
+    }
+    return writeOutputDataRate(outputDataRate);
+  }
+
+  /** Samples per second since the last startFifo() or setOutputDataRate(). */
+  float getOutputDataRate() const noexcept {
+    return m_outputDataRate;
+  }
+
+  /**
+   * Drain the FIFO: one status read, then one burst each for the gyroscope and accelerometer
+   * (the output address rolls over in FIFO mode), no matter how many samples are waiting.
+   * @param[out] samples Oldest first.
+   * @param[in] capacity Size of `samples`. Anything beyond it stays queued for the next call.
+   * @return The number of samples read.
+   */
+  size_t readFifo(Sample* samples, size_t capacity) {
+    if (!m_fifo || capacity == 0 || !requestRegisters(M_REG_FIFO_SRC, 1)) {
+      return 0;
+    }
+    uint8_t fifoStatus = m_wire->read();
+    size_t count = fifoCount(fifoStatus, capacity);
+    countOverrun(fifoStatus, micros());
+    if (count == 0) {
+      return 0;
+    }
+
+    uint8_t bytes[6];
+    if (!requestRegisters(M_REG_OUT_X_L_G, 6 * count)) {
+      return 0;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      readWireBytes(bytes, sizeof bytes);
+      toAxes(bytes, &samples[i].gyro, M_GYRO_PER_LSB);
+    }
+    if (!requestRegisters(M_REG_OUT_X_L_XL, 6 * count)) {
+      return 0;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      readWireBytes(bytes, sizeof bytes);
+      toAxes(bytes, &samples[i].accel, M_ACCEL_PER_LSB);
+      samples[i].sequence = m_sequence++;
+    }
+    return count;
+  }
+
+  /**
+   * Start the reads readFifo() makes on `bus` without waiting for them; collectFifo() takes the
+   * samples. The status read's callback queues both bursts once it knows how many samples there
+   * are, so the three still take one call.
+   * @param[in] bus The IMU's bus, begun.
+   * @param[in] capacity As for readFifo(): pass collectFifo() the same.
+   * @return false if there is nothing to request or the bus wouldn't take it.
+   */
+  bool requestFifo(I2CBus& bus, size_t capacity) {
+    if (!m_fifo || capacity == 0 || bus.wire() != m_wire || m_statusRequest.pending()) {
+      return false;
+    }
+    m_requestBus = &bus;
+    m_requestCapacity = capacity;
+    m_requestCount = 0;
+    m_statusRequest.setRead(LSM9DS1_ADDRESS_ACCELGYRO, M_REG_FIFO_SRC, &m_fifoStatus, 1);
+    m_statusRequest.callback = onFifoStatus;
+    m_statusRequest.context = this;
+    return bus.submit(m_statusRequest);
+  }
+
+  /**
+   * readFifo() with the reads requestFifo() started: waits for them if they haven't finished.
+   * Without a request, the same as readFifo().
+   */
+  size_t collectFifo(Sample* samples, size_t capacity) {
+    if (m_statusRequest.status == I2CTransaction::IDLE) {
+      return readFifo(samples, capacity);
+    }
+    m_statusRequest.wait();
+    bool read = m_statusRequest.succeeded();
+    m_statusRequest.status = I2CTransaction::IDLE;
+    size_t count = m_requestCount < capacity ? m_requestCount : capacity;
+    if (m_requestCount > 0) {
+      m_gyroRequest.wait();
+      m_accelRequest.wait();
+      read = read && m_gyroRequest.succeeded() && m_accelRequest.succeeded();
+    }
+    if (!read) {
+      return 0;
+    }
+    countOverrun(m_fifoStatus, m_requestMicros);
+    for (size_t i = 0; i < count; ++i) {
+      toAxes(m_gyroData + 6 * i, &samples[i].gyro, M_GYRO_PER_LSB);
+      toAxes(m_accelData + 6 * i, &samples[i].accel, M_ACCEL_PER_LSB);
+      samples[i].sequence = m_sequence++;
+    }
+    return count;
+  }
+
   /** Get the magnitude of acceleration. */
   static float getMagnitude(const vector3& accel) noexcept {
     return sqrtf(accel.x * accel.x + accel.y * accel.y + accel.z * accel.z);
@@ -131,4 +341,76 @@ public:
       m_reasonableGravity = (8.93F <= magnitude && magnitude <= 10.69F);
     }
   }
+
+private:
+  bool writeOutputDataRate(OutputDataRate outputDataRate) {
+    const float RATES_HZ[] = {0.0F, 14.9F, 59.5F, 119.0F, 238.0F, 476.0F, 952.0F};
+    m_outputDataRate = RATES_HZ[outputDataRate];
+    // Same full scale as initialize(): 2000 dps and 16 g
+    return writeRegister(M_REG_CTRL_REG1_G, (outputDataRate << 5) | Adafruit_LSM9DS1::LSM9DS1_GYROSCALE_2000DPS)
+      && writeRegister(M_REG_CTRL_REG6_XL, (outputDataRate << 5) | Adafruit_LSM9DS1::LSM9DS1_ACCELRANGE_16G);
+  }
+
+  /** Samples waiting, from FIFO_SRC, up to `capacity`. */
+  static size_t fifoCount(uint8_t fifoStatus, size_t capacity) noexcept {
+    size_t count = fifoStatus & M_FIFO_SRC_FSS;
+    return count < capacity ? count : capacity;
+  }
+
+  /** Account for a drain whose FIFO_SRC read `fifoStatus` at `now`. */
+  void countOverrun(uint8_t fifoStatus, unsigned long now) noexcept {
+    if (fifoStatus & M_FIFO_SRC_OVRN) {
+      // The oldest samples were overwritten; skip the sequence ahead by however many the elapsed
+      // time says the sensor produced beyond what it still holds
+      uint32_t produced = (uint32_t)((now - m_lastDrainMicros) * m_outputDataRate / 1e6F);
+      if (produced > FIFO_DEPTH) {
+        m_sequence += produced - FIFO_DEPTH;
+      }
+    }
+    m_lastDrainMicros = now;
+  }
+
+  void readWireBytes(uint8_t* bytes, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+      bytes[i] = m_wire->read();
+    }
+  }
+
+  /** Three little-endian 16-bit axes, scaled. */
+  static void toAxes(const uint8_t* bytes, vector3* out, float scale) noexcept {
+    for (int i = 0; i < 3; ++i) {
+      out->data[i] = (int16_t)(bytes[2 * i] | (bytes[2 * i + 1] << 8)) * scale;
+    }
+  }
+
+  /** requestFifo()'s status read is done: queue the bursts for the samples it says are waiting. */
+  static void onFifoStatus(I2CTransaction& transaction) {
+    IMU& imu = *static_cast<IMU*>(transaction.context);
+    if (!transaction.succeeded()) {
+      return;
+    }
+    imu.m_requestMicros = micros();
+    size_t count = fifoCount(imu.m_fifoStatus, imu.m_requestCapacity);
+    if (count == 0) {
+      return;
+    }
+    imu.m_gyroRequest.setRead(LSM9DS1_ADDRESS_ACCELGYRO, M_REG_OUT_X_L_G, imu.m_gyroData, 6 * count);
+    imu.m_accelRequest.setRead(LSM9DS1_ADDRESS_ACCELGYRO, M_REG_OUT_X_L_XL, imu.m_accelData, 6 * count);
+    imu.m_requestCount = count;
+    imu.m_requestBus->submit(imu.m_gyroRequest);
+    imu.m_requestBus->submit(imu.m_accelRequest);
+  }
+
+  // requestFifo(): the status read, then the bursts onFifoStatus() queues
+  I2CBus* m_requestBus;
+  I2CTransaction m_statusRequest;
+  I2CTransaction m_gyroRequest;
+  I2CTransaction m_accelRequest;
+  size_t m_requestCapacity;
+  // Samples the bursts carry
+  volatile size_t m_requestCount;
+  unsigned long m_requestMicros;
+  uint8_t m_fifoStatus;
+  uint8_t m_gyroData[6 * FIFO_DEPTH];
+  uint8_t m_accelData[6 * FIFO_DEPTH];
 };
@@ -1,23 +1,58 @@
 // When uploading to the payload bay micro, change this to true and the other INO to false
 #if false
 #include "altimeter.h"
+#include "ApogeeFilter.h"
 #include "Buffer.h"
+#include "CommandReader.h"
+#include "FlightPhase.h"
 
 // Set this to "true" to allow the radio to force ejection
 // Only turn this on during testing -- this should be "false" on the rocket!
 #define EJECT_COMMAND false
 
-// How often to signal the radio, in Hertz
+// Set this to "false" to detect apogee with Buffer's vote over the last 200 raw samples instead of
+// ApogeeFilter's velocity estimate. See HostHarness/bench/ApogeeBenchmark.cpp for a comparison.
+#define APOGEE_FILTER true
+
+// How often to signal the radio before launch, in Hertz
 const unsigned long RADIO_FREQ = 20;
+// Radio packets per second in each flight phase once started: fastest while the altitude is
+// changing quickly, and slowly on the pad and once landed, to save power
+const unsigned long PHASE_RADIO_FREQ[FlightPhase::PHASE_COUNT] = {
+  /* PAD */     5,
+  /* BOOST */   20,
+  /* COAST */   20,
+  /* APOGEE */  20,
+  /* DESCENT */ 10,
+  /* LANDED */  1,
+};
 // The last time the altitude was transmitted, in us
 unsigned long lastRadioTime = 0;
 
+// Altimeter settings for continuous mode: a new sample every 10 ms without waiting for it. Buffer's
+// window is a sample count, so this rate makes it 2 s long, enough that baro noise near apogee
+// can't trip it early. No IIR filter, since any lag would delay ejection.
+const uint8_t ALT_PRESSURE_OVERSAMPLING = BMP3_OVERSAMPLING_2X;
+const uint8_t ALT_TEMPERATURE_OVERSAMPLING = BMP3_NO_OVERSAMPLING;
+const uint8_t ALT_IIR_COEFFICIENT = BMP3_IIR_FILTER_DISABLE;
+const uint8_t ALT_OUTPUT_DATA_RATE = BMP3_ODR_100_HZ;
+
 bool turnedOff = true;
 
 unsigned long time;
 
 Altimeter alt;
 
+// Commands the ground station can send, in the order of RADIO_COMMAND_NAMES
+enum RadioCommand {
+  START,
+  TRANSMIT_DATA,
+  FILL,
+  EJECT,
+};
+const char* const RADIO_COMMAND_NAMES[] = { "start", "transmit_data", "fill", "eject" };
+CommandReader radioCommands(Serial1, RADIO_COMMAND_NAMES, sizeof RADIO_COMMAND_NAMES / sizeof *RADIO_COMMAND_NAMES);
+
 constexpr float mapFloat(
   float value,
   float xMin, float xMax,
@@ -60,39 +95,40 @@ void setup() {
   do { //Until the altimeter is active, attempt to initialize
     alt.initialize();
   } while (alt.getStatus() != Altimeter::ACTIVE);
+  // If this fails, reads stay in (slower) forced mode
+  alt.startContinuous(
+    ALT_PRESSURE_OVERSAMPLING,
+    ALT_TEMPERATURE_OVERSAMPLING,
+    ALT_IIR_COEFFICIENT,
+    ALT_OUTPUT_DATA_RATE
+  );
   // digitalWrite(9, HIGH);
   // Wait for radio command
   while (true) {
-    if (Serial1.available()) {
-      String command = Serial1.readStringUntil('\n');
-      if (command == "start") {
+    int command = radioCommands.poll();
+    if (command != CommandReader::NONE) {
+      if (command == START) {
         digitalWrite(9, HIGH);
         break;
-      } else if (command == "transmit_data") {
+      } else if (command == TRANSMIT_DATA) {
         sendToRadio(alt.getAltitude(), readTankPressure(), false);
-      } else if (command == "fill") {
+      } else if (command == FILL) {
         // Send data without doing anything else until told to stop
         // Used to monitor tank pressure while filling
         while (true) {
           sendToRadio(0.0f, readTankPressure(), false);
-          if (Serial1.available()) {
-            String newCommand = Serial1.readStringUntil('\n');
-            if (newCommand == "fill") {
-              break;
-            }
+          if (radioCommands.received(FILL)) {
+            break;
           }
           delay(1000 / RADIO_FREQ);
         }
 #if EJECT_COMMAND
-      } else if (command == "eject") {
+      } else if (command == EJECT) {
         // Send data until we get a second "eject" command
         while (true) {
           sendToRadio(alt.getAltitude(), readTankPressure(), false);
-          if (Serial1.available()) {
-            String newCommand = Serial1.readStringUntil('\n');
-            if (newCommand == "eject") {
-              break;
-            }
+          if (radioCommands.received(EJECT)) {
+            break;
           }
           delay(1000 / RADIO_FREQ);
         }
@@ -110,49 +146,54 @@ void setup() {
   }
 }
 
-enum Mode {
-  BELOW_5K,
-  WATCHING,
-  PAST_APOGEE,
-};
-
 void loop() {
+  static FlightPhase phases;
+#if !APOGEE_FILTER
   static Buffer data;
-  static Mode mode = BELOW_5K;
-
-  float altitude;
-  
+#endif
+  // Ejection has its own gate rather than waiting for the APOGEE phase, so nothing that holds up
+  // the earlier phases can hold up the parachutes
+  static bool watching = false;
+  static bool ejected = false;
+
+  // Kept between calls so the radio always has the latest sample
+  static float altitude = 0.0F;
+
+  // The phases have to follow the whole flight from the pad, so they get every sample
+  bool newSample = alt.readAltitude(&altitude);
+  if (newSample) {
+    phases.addAltitude(altitude, micros());
+  }
 
-  switch (mode) {
-  case BELOW_5K:
-    delay(1000 / RADIO_FREQ);
-    altitude = alt.getAltitude();
+  if (!ejected && newSample) {
     if (altitude >= 5000.0F) {
-      mode = WATCHING;
+      watching = true;
+    }
+#if APOGEE_FILTER
+    //If the estimated velocity has turned negative, we've reached apogee
+    bool pastApogee = watching && phases.filter().isPastApogee();
+#else
+    // Only feed the buffer real samples, not repeats while a conversion is in progress
+    if (watching) {
+      data.addPoint(altitude);
     }
-    break;
-  case WATCHING:
-    altitude = alt.getAltitude();
-    data.addPoint(altitude);
-    if (data.isDecreasing()) { //If we notice our altitude is decreasing, we've reached apogee
+    //If we notice our altitude is decreasing, we've reached apogee
+    bool pastApogee = watching && data.isDecreasing();
+#endif
+    if (pastApogee) {
       time = millis();
       turnedOff = false;
       digitalWrite(8, LOW); //Flip ejection pin low
-      mode = PAST_APOGEE; //Put us in 'PAST_APOGEE' mode
-    }
-    break;
-  case PAST_APOGEE:
-    // Track the altitude just for the radio
-    if (!turnedOff && ((millis() - time) > 10000)){ //greater than 10 seconds
-      turnedOff = true;
-      digitalWrite(8, HIGH);
+      ejected = true;
     }
-    altitude = alt.getAltitude();
-    break;
+  }
+  if (!turnedOff && ((millis() - time) > 10000)){ //greater than 10 seconds
+    turnedOff = true;
+    digitalWrite(8, HIGH);
   }
 
-  if (micros() - lastRadioTime >= 1e6 / RADIO_FREQ) {
-    sendToRadio(altitude, readTankPressure(), mode == PAST_APOGEE);
+  if (micros() - lastRadioTime >= 1000000UL / PHASE_RADIO_FREQ[phases.phase()]) {
+    sendToRadio(altitude, readTankPressure(), ejected);
   }
 }
 
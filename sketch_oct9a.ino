@@ -4,7 +4,9 @@
 #include "Scheduler.h"
 
 // 1 for camera, 2 for atmospheric sensors
+#ifndef CAPSULE
 #define CAPSULE 2
+#endif
 
 #include "altimeter.h"
 #include "imu.h"
@@ -14,20 +16,93 @@
 #include "humidity.h"
 #endif
 
+// true to log packed binary records (CAPS_INF.BIN) instead of text; see AnalysesFolder/binaryLog
+#ifndef SD_BINARY_LOG
+#define SD_BINARY_LOG false
+#endif
+// true to log delta-compressed records (CAPS_INF.BSZ), under a third the size of the binary ones;
+// see CompressedLog.h. Takes precedence over SD_BINARY_LOG.
+#ifndef SD_COMPRESSED_LOG
+#define SD_COMPRESSED_LOG false
+#endif
+// true to give every sector of the log a sequence number and CRC (LogBlock.h), so it can be
+// recovered from a raw image of the card after a power cut; see AnalysesFolder/cardRecovery
+#ifndef SD_BLOCK_LOG
+#define SD_BLOCK_LOG false
+#endif
+
 #include "SD_Card.h"
 
+// true to send COBS-framed binary packets with a CRC and sequence number instead of hex text.
+// Frames are less than half the size of the text lines; see RadioFrame.h and
+// AnalysesFolder/radioFrames for the ground-side decoder.
+#ifndef RADIO_BINARY_FRAMES
+#define RADIO_BINARY_FRAMES false
+#endif
+
+// true to read the IMU, altimeter and humidity sensor with DMA transactions (I2cDma.h), all three
+// buses at once, started at the top of loop() and collected where the blocking reads were
+#ifndef I2C_DMA
+#define I2C_DMA false
+#endif
+
+#include "Attitude.h"
+#include "CommandReader.h"
+#include "FlightPhase.h"
+#include "I2cDma.h"
+#include "RadioFrame.h"
+#include "SampleQueue.h"
+#include "TaskTimer.h"
+
 // Baud rate for radio UART
 const unsigned long RADIO_BAUD = 230400;
 
 // How many times per second the data will be sent over radio.
-// If this is more than ~18, some packets will have outdated GPS info.
+// If this is more than GPS_UPDATE_HZ, consecutive packets repeat the same GPS fix.
 // If this is more than ~200, the radio will be rate-limited by the sensors.
 const unsigned long RADIO_FREQ = 144;
 
 const unsigned long GPS_FREQ = 18;
 
+// The GPS receiver is switched to this baud rate and fix rate at startup. At 9600 baud it can only
+// send GGA and RMC about 5 times a second, and it starts at 1 Hz.
+const unsigned long GPS_BAUD = 115200;
+const uint8_t GPS_UPDATE_HZ = 10;
+
+// IMU sample rate from launch through apogee. The FIFO holds 32 samples, so at 952 Hz loop() must
+// drain it every 33 ms.
+const IMU::OutputDataRate IMU_OUTPUT_DATA_RATE = IMU::ODR_952_HZ;
+
+// What the capsule does in each flight phase. Full rate from launch through apogee; on the pad and
+// under the parachute, fewer samples, SD rows and packets, to save card bandwidth and power.
+struct PhaseRates {
+  IMU::OutputDataRate imuRate;
+  // One SD row per this many IMU samples; 0 closes the file for good
+  uint8_t logEvery;
+  // Radio packets per second
+  uint16_t radioHz;
+};
+const PhaseRates PHASE_RATES[FlightPhase::PHASE_COUNT] = {
+  /* PAD */     { IMU::ODR_119_HZ, 12, 10 },
+  /* BOOST */   { IMU_OUTPUT_DATA_RATE, 1, RADIO_FREQ },
+  /* COAST */   { IMU_OUTPUT_DATA_RATE, 1, RADIO_FREQ },
+  /* APOGEE */  { IMU_OUTPUT_DATA_RATE, 1, RADIO_FREQ },
+  /* DESCENT */ { IMU::ODR_238_HZ, 5, 20 },
+  /* LANDED */  { IMU::ODR_14_9_HZ, 0, 2 },
+};
+
+// Decided in loop() from the altimeter and IMU; the other loops only read the phase
+FlightPhase flight_phase;
+volatile FlightPhase::Phase current_phase = FlightPhase::PAD;
+
 volatile bool ledsOn = true;
 
+// Timing of each Scheduler loop; the radio command "task_stats" dumps them. loop() has to come back
+// before the IMU FIFO fills, and the others shouldn't fall a whole period behind.
+TaskTimer loopTimer("loop", IMU::FIFO_DEPTH * 1000000UL / 952, 0);
+TaskTimer gpsTimer("gps_and_save_loop", 2 * 1000000UL / GPS_FREQ, GPS_FREQ);
+TaskTimer radioTimer("radio_loop", 2 * 1000000UL / RADIO_FREQ, RADIO_FREQ);
+
 /*
 On the Arduino MKR series, all pins for a I2C/UART/SPI instance must be on the same "sercom" object.
 Additionally, for I2C, only some pins are suitable for clock and only some pins are suitable for
@@ -58,12 +133,19 @@ static TwoWire altI2C(
 );
 
 Altimeter alt;
-volatile float last_alt;
-float max_alt = -INFINITY;
+// Only used by loop()
+float last_alt;
 
 IMU imu(&Wire);
-volatile IMU::vector3 last_accel;
-volatile IMU::vector3 last_gyro;
+// The samples from the last IMU read, oldest first. Only used by loop().
+IMU::Sample imu_samples[IMU::FIFO_DEPTH];
+size_t imu_sample_count = 0;
+
+// Fed every IMU sample by loop(), at the interval between samples: the sequence number's step
+// times the FIFO's period, or the time between direct reads. Only used by loop().
+AttitudeFilter attitude_filter;
+uint32_t last_imu_sequence;
+uint32_t last_imu_micros;
 
 #if CAPSULE == 2
 static TwoWire humidityI2C(
@@ -72,14 +154,47 @@ static TwoWire humidityI2C(
   /*scl:*/9
 );
 HumiditySensor hum(&humidityI2C);
-volatile float last_humid;
-volatile float last_temp;
+// Only used by loop()
+float last_humid;
+float last_temp;
+
+int last_voc;
+#endif
+
+#if I2C_DMA
+// One DMA channel each. Only loop() submits transactions.
+I2CBus imuBus(&Wire, 0, 0);
+I2CBus altBus(&altI2C, 3, 1);
+#if CAPSULE == 2
+I2CBus humidityBus(&humidityI2C, 1, 2);
+#endif
+#endif
 
-volatile int last_voc;
+// One IMU sample, with the other sensors' latest readings when it was read: one row of the SD log
+struct SensorRecord {
+  // IMU::Sample::sequence, so a gap is a sample the IMU FIFO lost
+  uint32_t sequence;
+  // When the IMU took it, from micros(): when loop() read the FIFO, less a sample period for each
+  // newer sample in the same read
+  uint32_t micros;
+  IMU::vector3 accel;
+  IMU::vector3 gyro;
+  Quaternion attitude;
+  float altitude;
+#if CAPSULE == 2
+  int voc;
+  float humidity;
+  float temperature;
 #endif
+};
 
-// Even though this is in simplex operation and doesn't even have a physical wire to write to,
-// the initializer still needs a TX pin.
+// loop() queues every record for saveDataToSD() in gps_and_save_loop, which writes each one once;
+// sendDataToRadio() only takes the newest. 128 records last 134 ms at 952 Hz, over twice the GPS
+// loop's period. "task_stats" reports the depth and drops.
+SampleQueue<SensorRecord, 128> sensor_queue;
+
+// TX (pin 2) carries the baud and rate configuration to the receiver. If it isn't wired, GPS
+// falls back to listening at the receiver's default 9600 baud and 1 Hz.
 static Uart gpsUart(
   &sercom0,
   /*rx:*/3,
@@ -89,34 +204,79 @@ static Uart gpsUart(
 );
 Uart& radioUart = Serial1;
 
-GPS gps(gpsUart);
-volatile GPS::Coordinates last_coords;
+// Commands the ground station can send, in the order of RADIO_COMMAND_NAMES
+enum RadioCommand {
+  START,
+  TRANSMIT_DATA,
+  TASK_STATS,
+};
+const char* const RADIO_COMMAND_NAMES[] = { "start", "transmit_data", "task_stats" };
+CommandReader radioCommands(radioUart, RADIO_COMMAND_NAMES, sizeof RADIO_COMMAND_NAMES / sizeof *RADIO_COMMAND_NAMES);
+
+GPS gps(gpsUart, GPS_BAUD, GPS_UPDATE_HZ);
+// The fix as of the last readGPS(). Only used by gps_and_save_loop (and setup).
+GPS::Coordinates gps_fix;
+// The same fix for radio_loop
+LatestValue<GPS::Coordinates> latest_coords;
 
 SDCard card;
 
-int8_t radiansToCappedDegrees(float rad) {
-  float deg = degrees(rad);
-  if (fabsf(deg) > 127.0F) {
-    return -128;
-  } else {
-    return (int8_t)deg;
-  }
+// One row of the SD log or one radio packet: a fix and a sensor record side by side. Which fields
+// go where, and how each is scaled and written, is in TelemetrySchema.h.
+Telemetry::Snapshot makeSnapshot(const GPS::Coordinates& coords, const SensorRecord& record) {
+  Telemetry::Snapshot snapshot = {};
+  snapshot.sample = record.sequence;
+  snapshot.sampleMicros = record.micros;
+  snapshot.latitude = coords.latitude;
+  snapshot.longitude = coords.longitude;
+  snapshot.altitudeMSL = coords.altitudeMSL;
+  snapshot.numSatellites = coords.numSatellites;
+  snapshot.timestamp = coords.timestamp.rawValue;
+  snapshot.accelX = record.accel.x;
+  snapshot.accelY = record.accel.y;
+  snapshot.accelZ = record.accel.z;
+  snapshot.altitude = record.altitude;
+#if CAPSULE == 2
+  snapshot.vocReading = record.voc;
+  snapshot.humidity = record.humidity;
+  snapshot.temperature = record.temperature;
+#endif
+  snapshot.gyroX = record.gyro.x;
+  snapshot.gyroY = record.gyro.y;
+  snapshot.gyroZ = record.gyro.z;
+  snapshot.attitude = record.attitude;
+  return snapshot;
 }
 
 extern "C" {
 void SERCOM0_Handler(void) {
-  gpsUart.IrqHandler();
+  gps.handleInterrupt();
+#if I2C_DMA
+  imuBus.onService();
+#endif
 }
 
 #if CAPSULE == 2
 void SERCOM1_Handler(void) {
   humidityI2C.onService();
+#if I2C_DMA
+  humidityBus.onService();
+#endif
 }
 #endif
 
 void SERCOM3_Handler(void) {
   altI2C.onService();
+#if I2C_DMA
+  altBus.onService();
+#endif
 }
+
+#if I2C_DMA
+void DMAC_Handler(void) {
+  I2CBus::onDmaInterrupt();
+}
+#endif
 } // extern "C"
 
 #if CAPSULE == 2
@@ -144,22 +304,80 @@ void updateMissionCriticalLEDs() {
   digitalWrite(7, good);
 }
 
+// Write what loop() has queued, oldest first: from launch through apogee one row per IMU sample, so
+// the card gets the full inertial rate, and fewer before and after (PHASE_RATES). Each record is
+// written at most once. Once the capsule has landed, the file is closed for good.
 void saveDataToSD() {
+  const PhaseRates& rates = PHASE_RATES[current_phase];
+  SensorRecord record;
+  if (rates.logEvery == 0) {
+    if (card.getStatus() == SDCard::ACTIVE) {
+      card.closeFile();
+    }
+    while (sensor_queue.pop(record)) {}
+    return;
+  }
+
   if (card.getStatus() != SDCard::ACTIVE) {
     card.initialize();
     updateMissionCriticalLEDs();
   }
-  card.writeToCSV(
-    last_coords,
-    last_accel,
-    last_alt,
-#if CAPSULE == 2
-    last_voc,
-    last_humid,
-    last_temp,
-#endif
-    last_gyro
-  );
+  for (unsigned rows = 1; sensor_queue.pop(record); ++rows) {
+    // Formatting a whole GPS period of rows takes several ms; let the radio loop keep its rate
+    if (rows % 8 == 0) {
+      gpsTimer.yield();
+    }
+    if (record.sequence % rates.logEvery == 0) {
+      card.writeToCSV(makeSnapshot(gps_fix, record));
+    }
+  }
+}
+
+// Altimeter settings for continuous mode. 2x pressure oversampling takes ~7 ms, inside the 10 ms
+// period, and the light IIR filter smooths the extra noise without lagging behind apogee.
+const uint8_t ALT_PRESSURE_OVERSAMPLING = BMP3_OVERSAMPLING_2X;
+const uint8_t ALT_TEMPERATURE_OVERSAMPLING = BMP3_NO_OVERSAMPLING;
+const uint8_t ALT_IIR_COEFFICIENT = BMP3_IIR_FILTER_COEFF_1;
+const uint8_t ALT_OUTPUT_DATA_RATE = BMP3_ODR_100_HZ;
+
+// Try to initialize the altimeter and put it in continuous mode, so reads never wait for a conversion
+void initializeAltimeter() {
+  alt.initialize(&altI2C);
+  if (alt.getStatus() == Altimeter::ACTIVE && !alt.isContinuous()) {
+    alt.startContinuous(
+      ALT_PRESSURE_OVERSAMPLING,
+      ALT_TEMPERATURE_OVERSAMPLING,
+      ALT_IIR_COEFFICIENT,
+      ALT_OUTPUT_DATA_RATE
+    );
+  }
+}
+
+// Run the IMU at `rate`, starting its FIFO if it isn't yet, so no samples are lost between reads.
+// loop() has to drain the FIFO before it fills, so its deadline follows the rate.
+void setIMURate(IMU::OutputDataRate rate) {
+  if (imu.isFifo()) {
+    imu.setOutputDataRate(rate);
+  } else if (imu.getStatus() == IMU::ACTIVE) {
+    imu.startFifo(rate);
+  }
+  if (imu.isFifo()) {
+    loopTimer.setDeadline((unsigned long)(IMU::FIFO_DEPTH * 1e6F / imu.getOutputDataRate()), 0);
+  }
+}
+
+// Try to initialize the IMU and start its FIFO
+void initializeIMU() {
+  imu.initialize();
+  if (!imu.isFifo()) {
+    setIMURate(PHASE_RATES[current_phase].imuRate);
+  }
+}
+
+// Called by loop() when the altimeter and IMU show the flight has moved on
+void enterPhase(FlightPhase::Phase phase) {
+  current_phase = phase;
+  setIMURate(PHASE_RATES[phase].imuRate);
 }
 
 // Try to initialize all sensors. Has no effect once everything is initialized.
@@ -167,12 +385,28 @@ void initializeAll() {
 #if CAPSULE == 2
   hum.initialize();
   updateTempHumidLEDs();
+  // loop() only has values once its first measurement is done
+  if (hum.getStatus() == HumiditySensor::ACTIVE) {
+    hum.getLastValues(&last_humid, &last_temp);
+  }
 #endif
 
-  alt.initialize(&altI2C);
-  imu.initialize();
+  initializeAltimeter();
+  initializeIMU();
+#if I2C_DMA
+  // After the drivers have started their buses
+  imuBus.begin();
+  altBus.begin();
+#if CAPSULE == 2
+  humidityBus.begin();
+#endif
+#endif
   card.initialize();
   gps.initialize();
+  // Nothing else reads the GPS before the Scheduler loops start
+  if (gps.getLocation(&gps_fix)) {
+    latest_coords.store(gps_fix);
+  }
   updateMissionCriticalLEDs();
 }
 
@@ -186,7 +420,35 @@ void readAtmospheric() {
     updateTempHumidLEDs();
   }
 
-  hum.getValues(&last_humid, &last_temp);
+  // Take the result of the measurement started on an earlier pass, if it's done, and start the
+  // next. A heated measurement takes 110 ms, and the altimeter and IMU keep being read meanwhile.
+#if I2C_DMA
+  // requestSensorReads() already started whichever of the two is next
+  hum.collectValues(&last_humid, &last_temp);
+#else
+  hum.pollValues(&last_humid, &last_temp);
+  if (!hum.isMeasuring()) {
+    hum.startMeasurement();
+  }
+#endif
+}
+#endif
+
+#if I2C_DMA
+// Start this pass's reads on all three buses at once; readAtmospheric() and readAltIMU() collect
+// them. Sensors that need initializing are left to those, which use the blocking reads meanwhile.
+void requestSensorReads() {
+#if CAPSULE == 2
+  if (hum.getStatus() == HumiditySensor::ACTIVE) {
+    hum.requestValues(humidityBus);
+  }
+#endif
+  if (imu.getStatus() == IMU::ACTIVE && imu.isFifo()) {
+    imu.requestFifo(imuBus, IMU::FIFO_DEPTH);
+  }
+  if (alt.getStatus() == Altimeter::ACTIVE) {
+    alt.requestAltitude(altBus);
+  }
 }
 #endif
 
@@ -196,79 +458,131 @@ void readGPS() {
     updateMissionCriticalLEDs();
   }
 
-  gps.getLocation(&last_coords);
+  if (gps.getLocation(&gps_fix)) {
+    latest_coords.store(gps_fix);
+  }
 }
 
 void readAltIMU() {
   if (imu.getStatus() != IMU::ACTIVE) {
-    imu.initialize();
+    initializeIMU();
     updateMissionCriticalLEDs();
   }
 
-  // This has to be done like this because imu.getValues cannot take a pointer to a volatile vector3
-  IMU::vector3 accel, gyro;
-  if (imu.getValues(&accel, &gyro)) {
-    last_accel = accel;
-    last_gyro = gyro;
+  if (imu.isFifo()) {
+#if I2C_DMA
+    imu_sample_count = imu.collectFifo(imu_samples, IMU::FIFO_DEPTH);
+#else
+    imu_sample_count = imu.readFifo(imu_samples, IMU::FIFO_DEPTH);
+#endif
+  } else if (imu.getValues(&imu_samples[0].accel, &imu_samples[0].gyro)) {
+    ++imu_samples[0].sequence;
+    imu_sample_count = 1;
+  } else {
+    imu_sample_count = 0;
   }
 
   if (alt.getStatus() != Altimeter::ACTIVE) {
-    alt.initialize(&altI2C);
+    initializeAltimeter();
     updateMissionCriticalLEDs();
   }
 
-  if (alt.getStatus() == Altimeter::ACTIVE) {
-    float altitude = alt.getAltitude();
+  uint32_t now = micros();
+  float samplePeriod = imu.isFifo() ? 1.0F / imu.getOutputDataRate() : (now - last_imu_micros) * 1e-6F;
+  last_imu_micros = now;
+
+  float altitude;
+#if I2C_DMA
+  bool altitudeRead = alt.getStatus() == Altimeter::ACTIVE && alt.collectAltitude(&altitude);
+#else
+  bool altitudeRead = alt.getStatus() == Altimeter::ACTIVE && alt.readAltitude(&altitude);
+#endif
+  if (altitudeRead) {
     last_alt = altitude;
-    if (max_alt < altitude) {
-      max_alt = altitude;
-    }
+    flight_phase.addAltitude(altitude, now);
+  }
+  for (size_t i = 0; i < imu_sample_count; ++i) {
+    flight_phase.addAcceleration(IMU::getMagnitude(imu_samples[i].accel), now);
+  }
+  if (flight_phase.phase() != current_phase) {
+    enterPhase(flight_phase.phase());
+  }
+
+  // Never waits: if saveDataToSD() is a whole queue behind, the record is dropped and counted
+  for (size_t i = 0; i < imu_sample_count; ++i) {
+    const IMU::Sample& sample = imu_samples[i];
+    attitude_filter.update(sample.gyro.x, sample.gyro.y, sample.gyro.z, sample.accel.x, sample.accel.y, sample.accel.z,
+      (sample.sequence - last_imu_sequence) * samplePeriod);
+    last_imu_sequence = sample.sequence;
+
+    SensorRecord record;
+    record.sequence = sample.sequence;
+    uint32_t newer = imu_samples[imu_sample_count - 1].sequence - sample.sequence;
+    record.micros = now - (uint32_t)(newer * samplePeriod * 1e6F);
+    record.accel = sample.accel;
+    record.gyro = sample.gyro;
+    record.attitude = attitude_filter.attitude();
+    record.altitude = last_alt;
+#if CAPSULE == 2
+    record.voc = last_voc;
+    record.humidity = last_humid;
+    record.temperature = last_temp;
+#endif
+    sensor_queue.push(record);
   }
 }
 
-char sign(int n) {
-  return n < 0 ? '-' : '+';
+void transmit(const Telemetry::Snapshot& snapshot) {
+#if RADIO_BINARY_FRAMES
+  static uint16_t sequence = 0;
+  uint8_t frame[RadioFrame::maxSize<CAPSULE>()];
+  radioUart.write(frame, RadioFrame::encode<CAPSULE>(snapshot, sequence++, frame));
+#else
+  char buf[79];
+  RadioFrame::formatText<CAPSULE>(snapshot, buf, sizeof buf);
+  radioUart.write(buf);
+#endif
 }
 
 void sendDataToRadio() {
-  char buf[79];
-  
-  int pitch = radiansToCappedDegrees(last_gyro.x);
-  int roll = radiansToCappedDegrees(last_gyro.y);
-  int yaw = radiansToCappedDegrees(last_gyro.z);
+  // All zeros until the sensors have produced something
+  SensorRecord record = {};
+  sensor_queue.newest(record);
+  transmit(makeSnapshot(latest_coords.load(), record));
+}
 
-  int accelXcm = last_accel.x * 100;
-  int accelYcm = last_accel.y * 100;
-  int accelZcm = last_accel.z * 100;
+void sendTaskStats() {
+  loopTimer.print(radioUart);
+  gpsTimer.print(radioUart);
+  radioTimer.print(radioUart);
 
+  // queue,<name>,<depth>,<capacity>,<max depth>,<pushed>,<dropped>
+  char line[80];
   snprintf(
-    buf,
-    sizeof buf,
-    "%c%08X,%c%08X,%07X,%X,%c%02X,%c%02X,%c%02X,%c%04X,%c%04X,%c%04X,%c%04X"
-#if CAPSULE == 2
-    ",%03X,%c%03X,%02X"
-#endif
-    "\n",
-    sign(last_coords.latitude), abs(last_coords.latitude),
-    sign(last_coords.longitude), abs(last_coords.longitude),
-    GPS::getTotalMS(last_coords.timestamp),
-    min(15U, (unsigned int)last_coords.numSatellites),
-    sign(pitch), abs(pitch),
-    sign(roll), abs(roll),
-    sign(yaw), abs(yaw),
-    sign(accelXcm), abs(accelXcm),
-    sign(accelYcm), abs(accelYcm),
-    sign(accelZcm), abs(accelZcm),
-    sign(last_alt), (unsigned int)abs(last_alt)
-#if CAPSULE == 2
-    ,
-    last_voc,
-    sign(last_temp), (unsigned int)abs(last_temp),
-    (unsigned int)last_humid
-#endif
+    line,
+    sizeof line,
+    "queue,sensor_queue,%u,%u,%u,%lu,%lu\n",
+    (unsigned)sensor_queue.size(),
+    (unsigned)sensor_queue.capacity(),
+    (unsigned)sensor_queue.maxDepth(),
+    (unsigned long)sensor_queue.pushed(),
+    (unsigned long)sensor_queue.dropped()
   );
-  
-  radioUart.write(buf);
+  radioUart.write(line);
+
+  // phase,<name>
+  snprintf(line, sizeof line, "phase,%s\n", FlightPhase::name(current_phase));
+  radioUart.write(line);
+}
+
+// Commands accepted after "start". Never waits for the rest of a line.
+void pollRadioCommands() {
+  int command;
+  while ((command = radioCommands.poll()) != CommandReader::NONE) {
+    if (command == TASK_STATS) {
+      sendTaskStats();
+    }
+  }
 }
 
 void setup() {
@@ -303,11 +617,9 @@ void setup() {
   do {
     initializeAll();
 
-    if (radioUart.available()) {
-      //The string returned from readStringUntil does not include the terminator
-      String command = radioUart.readStringUntil('\n');
-
-      if (command == "start") {
+    int command = radioCommands.poll();
+    if (command != CommandReader::NONE) {
+      if (command == START) {
         // disable LEDs
         ledsOn = false;
 #if CAPSULE == 2
@@ -316,21 +628,22 @@ void setup() {
         pinMode(7, PinMode::INPUT);
 
         break;
-      } else if (command == "transmit_data") {
+      } else if (command == TRANSMIT_DATA) {
 #if CAPSULE == 2
         readAtmospheric();
+        // Nothing else is running yet, so send this measurement rather than the last one
+        hum.getValues(&last_humid, &last_temp);
 #endif
         readGPS();
         readAltIMU();
         sendDataToRadio();
         saveDataToSD();
+      } else if (command == TASK_STATS) {
+        sendTaskStats();
       } else {
         // unrecognized command -- send back all zeros
-#if CAPSULE == 1
-        radioUart.write("+00000000,+00000000,0000000,0,+00,+00,+00,+0000,+0000,+0000,+0000\n");
-#else
-        radioUart.write("+00000000,+00000000,0000000,0,+00,+00,+00,+0000,+0000,+0000,+0000,000,+000,+00\n");
-#endif
+        Telemetry::Snapshot zeros = {};
+        transmit(zeros);
       }
     }
   } while (true);
@@ -340,45 +653,62 @@ void setup() {
 }
 
 void loop() {
+  loopTimer.begin();
+
+#if I2C_DMA
+  requestSensorReads();
+#endif
+
 #if CAPSULE == 2
   readAtmospheric();
 
-  // Requesting data from the humidity sensor can be relatively slow
-  yield();
+  // The VOC sensor's analogRead() is relatively slow
+  loopTimer.yield();
 #endif
 
   readAltIMU();
 
   // Leaving this yield in in capsule 2 increases the amount of time spent context switching by up to 9x!
 #if CAPSULE == 1
-  yield();
+  loopTimer.yield();
 #endif
 
-  if (max_alt > 2000 && last_alt < 1000) {
-    if (card.getStatus() == SDCard::ACTIVE) {
-      card.closeFile();
-    }
-  } else {
-    saveDataToSD();
-    yield();
-  }
+  loopTimer.end();
+  yield();
 }
 
+// gps_and_save_loop() passes (2 s each) between syncs, which bring the directory entry up to date.
+// Without SD_BLOCK_LOG that is all that makes rows survive a power cut. With it, every sector that
+// reached the card can be recovered anyway, so the directory is only updated every 30 s.
+const unsigned SYNC_EVERY_PASSES = SD_BLOCK_LOG ? 15 : 1;
+
 void gps_and_save_loop() {
+  static unsigned passes = 0;
+  ++passes;
   for (int i = 0; i < 2 * GPS_FREQ; ++i) {
+    gpsTimer.begin();
     readGPS();
-    delay(1000 / GPS_FREQ);
-  }
+    // loop() only queues records; rows are formatted here and full sectors go to the card
+    saveDataToSD();
+    card.writePending();
 
-  // If the file was intentionally closed, don't re-open it.
-  if (card.getStatus() != SDCard::FILE_CLOSED) {
-    card.closeAndReopen();
+    // If the file was intentionally closed, don't re-open it.
+    if (i == 2 * GPS_FREQ - 1 && passes % SYNC_EVERY_PASSES == 0 && card.getStatus() != SDCard::FILE_CLOSED) {
+      card.sync();
+    }
+    gpsTimer.end();
+    delay(1000 / GPS_FREQ);
   }
 }
 
 void radio_loop() {
-  delay(1000 / RADIO_FREQ);
+  unsigned long radioHz = PHASE_RATES[current_phase].radioHz;
+  radioTimer.setDeadline(2 * 1000000UL / radioHz, radioHz);
+  delay(1000 / radioHz);
+  radioTimer.begin();
   sendDataToRadio();
+  radioTimer.end();
+  pollRadioCommands();
 }
 
 #endif
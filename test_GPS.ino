@@ -18,6 +18,9 @@ void loop() {
 
   GPS::Coordinates testCoordinates;
 
+  // Serial1's interrupt handler is the core's, so move its bytes over by hand
+  testGPS.receive();
+
   bool justChecking = testGPS.getLocation(&testCoordinates);
 
   if (justChecking){
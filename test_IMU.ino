@@ -10,7 +10,6 @@ SDCard card;
 // Write two lines of fake data
 GPS::Coordinates fakeCoords{0};
 
-IMU::vector3 fakeGyro{0};
 IMU::vector3 testAccel;
 static unsigned int frequency = 200; //THIS IS FREQUENCY OF MEASUREMENTS TAKEN BY IMU. MAKE SURE THAT 'shortDelay' WOULD STILL BE A WHOLE NUMBER
 static unsigned int shortDelay = int(1000/frequency); //THIS IS THE NUMBER OF MILLISECONDS THAT YOU WANT THE IMU TO RECORD TO CSV (ie 5 milliseconds is 200Hz)
@@ -56,7 +55,12 @@ void setup() {
 void loop(){ 
 
   testIMU.getValues(&testAccel, nullptr);
-  card.writeToCSV(fakeCoords, testAccel, 0, fakeGyro);
+  Telemetry::Snapshot row = {};
+  row.timestamp = fakeCoords.timestamp.rawValue;
+  row.accelX = testAccel.x;
+  row.accelY = testAccel.y;
+  row.accelZ = testAccel.z;
+  card.writeToCSV(row);
 
   //wait until 2 milliseconds have passed, taking into account runtime of code
   delayMicroseconds((shortDelay * 1000) - (micros() % (shortDelay * 1000))); 
@@ -31,11 +31,8 @@ void setup() {
     card.initialize();
   }
 
-  GPS::Coordinates fakeCoords{0};
-  IMU::vector3 accel{0};
-  IMU::vector3 gyro{0};
-
-  float humidity, temperature;
+  // Everything but the humidity and temperature stays zero
+  Telemetry::Snapshot row = {};
 
   // get multiple readings
   for (int i = 0; i < 50; ++i) {
@@ -43,9 +40,9 @@ void setup() {
     delayMicroseconds(5000 - (micros() % 5000));
 
     // get the values until they succeed
-    while (!hum.getValues(&humidity, &temperature)) {}
+    while (!hum.getValues(&row.humidity, &row.temperature)) {}
 
-    card.writeToCSV(fakeCoords, accel, 0, 0, humidity, temperature, gyro);
+    card.writeToCSV(row);
   }
 
   card.closeFile();
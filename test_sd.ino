@@ -34,23 +34,17 @@ void setup() {
     initializeCard();
 
     // Write two lines of fake data
-    GPS::Coordinates fakeCoords;
-    fakeCoords.latitude = 391342467;
-    fakeCoords.longitude = -845157413;
-    fakeCoords.altitudeMSL = 790;
-    fakeCoords.numSatellites = 7;
-    fakeCoords.timestamp.hours = 12;
-    fakeCoords.timestamp.minutes = 22;
-    fakeCoords.timestamp.seconds = 12;
-    fakeCoords.timestamp.milliseconds = 345;
-
-    IMU::vector3 fakeAccel{0};
-    fakeAccel.y = -9.81;
-
-    IMU::vector3 fakeGyro{0};
-
-    card.writeToCSV(fakeCoords, fakeAccel, 0, fakeGyro);
-    card.writeToCSV(fakeCoords, fakeAccel, 0, fakeGyro);
+    Telemetry::Snapshot fakeRow = {};
+    fakeRow.latitude = 391342467;
+    fakeRow.longitude = -845157413;
+    fakeRow.altitudeMSL = 790;
+    fakeRow.numSatellites = 7;
+    // 12:22:12.345, laid out as GPS::Timestamp
+    fakeRow.timestamp = (12U << 22) | (22U << 16) | (12U << 10) | 345U;
+    fakeRow.accelY = -9.81;
+
+    card.writeToCSV(fakeRow);
+    card.writeToCSV(fakeRow);
 
     Serial.println("Fake data written. Closing file...");
     card.closeFile();
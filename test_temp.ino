@@ -29,9 +29,7 @@ void setup() {
     card.initialize();
   }
 
-  GPS::Coordinates fakeCoords{0};
-  IMU::vector3 accel{0};
-  IMU::vector3 gyro{0};
+  Telemetry::Snapshot row = {};
 
   unsigned long startTime = micros();
   unsigned long currTime;
@@ -43,11 +41,12 @@ void setup() {
     }
 
     currTime = micros();
-    fakeCoords.timestamp.milliseconds = (currTime / 1000) % 1000;
-    fakeCoords.timestamp.seconds = currTime / 1000000;
+    // GPS::Timestamp's milliseconds and seconds;
     // not going to go long enough to worry about minutes
+    row.timestamp = (currTime / 1000) % 1000 | ((currTime / 1000000) % 64) << 10;
+    row.temperature = temperature;
 
-    card.writeToCSV(fakeCoords, accel, 0, 0, 0, temperature, gyro);
+    card.writeToCSV(row);
 
     // add some delay
     delayMicroseconds(DELAY - (currTime % DELAY));